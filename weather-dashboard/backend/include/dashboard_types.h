@@ -7,6 +7,7 @@
 #define MAX_NAME_LENGTH 256
 #define MAX_LOCATION_LENGTH 256
 #define MAX_URL_LENGTH 512
+#define MAX_FIELDS_LENGTH 512
 #define MAX_USER_ID_LENGTH 128
 #define MAX_SESSION_ID_LENGTH 64
 #define MAX_TOKEN_LENGTH 1024
@@ -68,6 +69,8 @@ typedef struct {
     bool include_aqi;
     bool include_alerts;
     bool include_hourly;
+    char fields[MAX_FIELDS_LENGTH];     // Members to return (?fields=), empty for all
+    bool columnar;                      // Hours as one array per member (?layout=columnar)
 } weather_request_t;
 
 #endif // DASHBOARD_TYPES_H
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+// Per-request arenas for cJSON
+// json_arena_init() installs cJSON allocation hooks. Between json_arena_begin()
+// and json_arena_end(), every cJSON node, string and printed document created
+// on the calling thread comes from a bump allocator and is released all at
+// once when the scope ends. Outside a scope cJSON uses the heap as before.
+// Nothing allocated in a scope may outlive it: let MHD copy printed bodies
+// (MHD_RESPMEM_MUST_COPY) and release cJSON strings with cJSON_free().
+
+// Install the cJSON hooks (call once at startup)
+void json_arena_init(void);
+
+// Start a scope on the calling thread
+void json_arena_begin(void);
+
+// End the calling thread's scope, releasing everything allocated in it
+void json_arena_end(void);
+
+#endif // JSON_ARENA_H
@@ -192,7 +192,7 @@ int db_save_profile(const user_profile_t *profile) {
     }
     
     PQclear(res);
-    free(json_str);
+    cJSON_free(json_str);
     
     return result;
 }
@@ -18,6 +18,7 @@
 #include "session_manager.h"
 #include "db_manager.h"
 #include "oidc_client.h"
+#include "json_arena.h"
 
 static struct MHD_Daemon *http_daemon = NULL;
 static server_config_t server_config;
@@ -231,6 +232,16 @@ static user_profile_t* get_current_profile(struct MHD_Connection *connection) {
     return profile_get_default();
 }
 
+// Print a JSON document into a new response
+// MHD copies the body, so the printed text can live in the request's cJSON arena
+static struct MHD_Response* json_response(cJSON *json) {
+    char *json_string = cJSON_Print(json);
+    struct MHD_Response *response = MHD_create_response_from_buffer(
+        json_string ? strlen(json_string) : 0, json_string ? json_string : "", MHD_RESPMEM_MUST_COPY);
+    cJSON_free(json_string);
+    return response;
+}
+
 // Create JSON error response
 static struct MHD_Response* create_error_response(int code, const char *message) {
     cJSON *json = cJSON_CreateObject();
@@ -240,9 +251,7 @@ static struct MHD_Response* create_error_response(int code, const char *message)
     cJSON_AddStringToObject(error, "message", message);
     cJSON_AddItemToObject(json, "error", error);
     
-    char *json_string = cJSON_Print(json);
-    struct MHD_Response *response = MHD_create_response_from_buffer(
-        strlen(json_string), json_string, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(json);
     
     MHD_add_response_header(response, "Content-Type", "application/json; charset=utf-8");
     add_cors_headers(response);
@@ -267,9 +276,7 @@ static enum MHD_Result handle_profile_get(struct MHD_Connection *connection) {
         profile->wind_unit == WIND_KNOTS ? "knots" : "ms");
     cJSON_AddStringToObject(json, "defaultLocation", profile->default_location);
     
-    char *json_string = cJSON_Print(json);
-    struct MHD_Response *response = MHD_create_response_from_buffer(
-        strlen(json_string), json_string, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(json);
     
     MHD_add_response_header(response, "Content-Type", "application/json; charset=utf-8");
     add_cors_headers(response);
@@ -317,7 +324,7 @@ static enum MHD_Result handle_profile_put(struct MHD_Connection *connection,
             updated_profile.temp_unit = TEMP_CELSIUS;
         }
     }
-
+    
     if (wind_unit && cJSON_IsString(wind_unit)) {
         if (strcmp(wind_unit->valuestring, "knots") == 0) {
             updated_profile.wind_unit = WIND_KNOTS;
@@ -414,9 +421,7 @@ static enum MHD_Result handle_oidc_login(struct MHD_Connection *connection) {
     cJSON *response_json = cJSON_CreateObject();
     cJSON_AddStringToObject(response_json, "redirectUrl", auth_url);
     
-    char *json_string = cJSON_Print(response_json);
-    struct MHD_Response *response = MHD_create_response_from_buffer(
-        strlen(json_string), json_string, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(response_json);
     
     MHD_add_response_header(response, "Content-Type", "application/json; charset=utf-8");
     add_cors_headers(response);
@@ -572,9 +577,7 @@ static enum MHD_Result handle_login(struct MHD_Connection *connection,
     cJSON_AddStringToObject(response_json, "name", name->valuestring);
     cJSON_AddStringToObject(response_json, "sessionId", session_id);
     
-    char *json_string = cJSON_Print(response_json);
-    struct MHD_Response *response = MHD_create_response_from_buffer(
-        strlen(json_string), json_string, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(response_json);
     
     MHD_add_response_header(response, "Content-Type", "application/json; charset=utf-8");
     
@@ -605,9 +608,7 @@ static enum MHD_Result handle_logout(struct MHD_Connection *connection) {
     cJSON *response_json = cJSON_CreateObject();
     cJSON_AddBoolToObject(response_json, "success", true);
     
-    char *json_string = cJSON_Print(response_json);
-    struct MHD_Response *response = MHD_create_response_from_buffer(
-        strlen(json_string), json_string, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(response_json);
     
     MHD_add_response_header(response, "Content-Type", "application/json; charset=utf-8");
     
@@ -698,6 +699,8 @@ static enum MHD_Result handle_weather_forecast(struct MHD_Connection *connection
     const char *aqi_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_aqi");
     const char *alerts_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_alerts");
     const char *hourly_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_hourly");
+    const char *fields_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "fields");
+    const char *layout_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "layout");
     
     if (!location || !days_str) {
         struct MHD_Response *response = create_error_response(400, "Missing 'location' or 'days' parameter");
@@ -713,6 +716,12 @@ static enum MHD_Result handle_weather_forecast(struct MHD_Connection *connection
     request.include_aqi = aqi_str && strcmp(aqi_str, "true") == 0;
     request.include_alerts = alerts_str && strcmp(alerts_str, "true") == 0;
     request.include_hourly = hourly_str && strcmp(hourly_str, "true") == 0;
+    request.fields[0] = '\0';
+    if (fields_str) {
+        strncpy(request.fields, fields_str, MAX_FIELDS_LENGTH - 1);
+        request.fields[MAX_FIELDS_LENGTH - 1] = '\0';
+    }
+    request.columnar = layout_str && strcmp(layout_str, "columnar") == 0;
     
     if (request.days < 1 || request.days > 14) {
         struct MHD_Response *response = create_error_response(400, "Invalid days parameter (must be 1-14)");
@@ -801,13 +810,11 @@ static enum MHD_Result serve_static_file(struct MHD_Connection *connection, cons
     return ret;
 }
 
-// Main request handler
-static enum MHD_Result answer_to_connection(void *cls, struct MHD_Connection *connection,
-                                          const char *url, const char *method,
-                                          const char *version, const char *upload_data,
-                                          size_t *upload_data_size, void **con_cls) {
-    (void)cls; (void)version;
-    
+// Route a request to its handler
+static enum MHD_Result handle_request(struct MHD_Connection *connection,
+                                      const char *url, const char *method,
+                                      const char *upload_data, size_t *upload_data_size,
+                                      void **con_cls) {
     // First call - initialize context
     if (*con_cls == NULL) {
         struct request_context *ctx = malloc(sizeof(struct request_context));
@@ -908,6 +915,22 @@ static enum MHD_Result answer_to_connection(void *cls, struct MHD_Connection *co
     return result;
 }
 
+// Main request handler
+// cJSON trees built while handling a request come from a per-request arena,
+// released together once the response has been queued
+static enum MHD_Result answer_to_connection(void *cls, struct MHD_Connection *connection,
+                                          const char *url, const char *method,
+                                          const char *version, const char *upload_data,
+                                          size_t *upload_data_size, void **con_cls) {
+    (void)cls; (void)version;
+    
+    json_arena_begin();
+    enum MHD_Result result = handle_request(connection, url, method, upload_data, upload_data_size, con_cls);
+    json_arena_end();
+    
+    return result;
+}
+
 // Profile management functions
 int profile_init(void) {
     // Initialization now handled by session_manager
@@ -964,6 +987,9 @@ int http_server_start(const server_config_t *config) {
         return -1;
     }
     
+    // Route cJSON allocations through per-request arenas
+    json_arena_init();
+    
     // Start HTTP daemon
     http_daemon = MHD_start_daemon(MHD_USE_SELECT_INTERNALLY,
                              config->port,
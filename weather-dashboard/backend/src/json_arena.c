@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include "json_arena.h"
+
+#define ARENA_BLOCK_MIN (16 * 1024)         // First block of a thread's arena
+#define ARENA_BLOCK_KEEP (1024 * 1024)      // Largest block kept between requests
+#define ARENA_ALIGN 16
+
+// Arena block; a scope grows by chaining blocks of doubling size
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+} arena_block_t;
+
+#define ARENA_BLOCK_HEADER ((sizeof(arena_block_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+// Scope state of one thread
+typedef struct {
+    int active;
+    arena_block_t *blocks;  // Newest (largest) first
+} arena_scope_t;
+
+static pthread_key_t scope_key;
+static pthread_once_t scope_once = PTHREAD_ONCE_INIT;
+static int scope_ready = 0;
+
+static void free_blocks(arena_block_t *block) {
+    while (block) {
+        arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+static void destroy_scope(void *data) {
+    arena_scope_t *scope = data;
+    free_blocks(scope->blocks);
+    free(scope);
+}
+
+static void init_scope_key(void) {
+    scope_ready = pthread_key_create(&scope_key, destroy_scope) == 0;
+}
+
+// Active scope of the calling thread, or NULL
+static arena_scope_t* active_scope(void) {
+    if (!scope_ready) return NULL;
+    arena_scope_t *scope = pthread_getspecific(scope_key);
+    return scope && scope->active ? scope : NULL;
+}
+
+static void* arena_malloc(size_t size) {
+    arena_scope_t *scope = active_scope();
+    if (!scope) return malloc(size);
+    
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    arena_block_t *block = scope->blocks;
+    if (!block || size > block->size - block->used) {
+        size_t capacity = block ? block->size * 2 : ARENA_BLOCK_MIN;
+        while (capacity < size) capacity *= 2;
+        
+        arena_block_t *grown = malloc(ARENA_BLOCK_HEADER + capacity);
+        if (!grown) {
+            fprintf(stderr, "Failed to allocate JSON arena block of %zu bytes\n", capacity);
+            return NULL;
+        }
+        grown->next = block;
+        grown->size = capacity;
+        grown->used = 0;
+        scope->blocks = block = grown;
+    }
+    
+    void *ptr = (char *)block + ARENA_BLOCK_HEADER + block->used;
+    block->used += size;
+    return ptr;
+}
+
+static void arena_free(void *ptr) {
+    if (!ptr) return;
+    
+    // Arena allocations are released when their scope ends
+    arena_scope_t *scope = active_scope();
+    if (scope) {
+        for (arena_block_t *block = scope->blocks; block; block = block->next) {
+            char *data = (char *)block + ARENA_BLOCK_HEADER;
+            if ((char *)ptr >= data && (char *)ptr < data + block->size) return;
+        }
+    }
+    free(ptr);
+}
+
+void json_arena_init(void) {
+    pthread_once(&scope_once, init_scope_key);
+    
+    cJSON_Hooks hooks = { arena_malloc, arena_free };
+    cJSON_InitHooks(&hooks);
+}
+
+void json_arena_begin(void) {
+    if (!scope_ready) return;
+    
+    arena_scope_t *scope = pthread_getspecific(scope_key);
+    if (!scope) {
+        scope = calloc(1, sizeof(arena_scope_t));
+        if (!scope || pthread_setspecific(scope_key, scope) != 0) {
+            free(scope);
+            return;
+        }
+    }
+    scope->active = 1;
+}
+
+void json_arena_end(void) {
+    arena_scope_t *scope = active_scope();
+    if (!scope) return;
+    scope->active = 0;
+    
+    // Keep the newest (largest) block for the next request unless it is too large to sit idle
+    arena_block_t *keep = scope->blocks;
+    if (keep && keep->size <= ARENA_BLOCK_KEEP) {
+        free_blocks(keep->next);
+        keep->next = NULL;
+        keep->used = 0;
+    } else {
+        free_blocks(keep);
+        keep = NULL;
+    }
+    scope->blocks = keep;
+}
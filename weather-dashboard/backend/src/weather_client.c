@@ -171,16 +171,32 @@ int weather_client_get_forecast(const weather_request_t *request, char **respons
         return -1;
     }
     
+    // Projection passed through so the weather service only serializes what is shown
+    char *encoded_fields = NULL;
+    if (request->fields[0]) {
+        encoded_fields = curl_easy_escape(curl, request->fields, 0);
+        if (!encoded_fields) {
+            fprintf(stderr, "Failed to URL encode fields\n");
+            curl_free(encoded_location);
+            curl_easy_cleanup(curl);
+            return -1;
+        }
+    }
+    
     // Build URL
-    char url[1024];
-    snprintf(url, sizeof(url), "%s/forecast?location=%s&days=%d&include_aqi=%s&include_alerts=%s&include_hourly=%s",
+    char url[2048];
+    snprintf(url, sizeof(url), "%s/forecast?location=%s&days=%d&include_aqi=%s&include_alerts=%s&include_hourly=%s%s%s%s",
              weather_service_url,
              encoded_location,
              request->days,
              request->include_aqi ? "true" : "false",
              request->include_alerts ? "true" : "false",
-             request->include_hourly ? "true" : "false");
+             request->include_hourly ? "true" : "false",
+             encoded_fields ? "&fields=" : "",
+             encoded_fields ? encoded_fields : "",
+             request->columnar ? "&layout=columnar" : "");
     
+    curl_free(encoded_fields);
     curl_free(encoded_location);
     curl_easy_cleanup(curl);
     
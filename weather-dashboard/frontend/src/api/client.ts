@@ -103,7 +103,9 @@ class WeatherDashboardAPI {
         days: request.days,
         include_aqi: request.include_aqi || false,
         include_alerts: request.include_alerts || false,
-        include_hourly: request.include_hourly || false
+        include_hourly: request.include_hourly || false,
+        ...(request.fields ? { fields: request.fields } : {}),
+        ...(request.layout ? { layout: request.layout } : {})
       }
     })
     return response.data
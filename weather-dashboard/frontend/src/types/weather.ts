@@ -114,6 +114,28 @@ export interface ForecastHour {
   chance_of_rain: number
 }
 
+// Hours with layout=columnar: one array per member, in hour order
+export interface ForecastHourColumns {
+  time_epoch?: number[]
+  time?: string[]
+  temp_c?: number[]
+  temp_f?: number[]
+  is_day?: number[]
+  condition?: {
+    text?: string[]
+    icon?: string[]
+    code?: number[]
+  }
+  wind_mph?: number[]
+  wind_kph?: number[]
+  wind_degree?: number[]
+  wind_dir?: string[]
+  humidity?: number[]
+  cloud?: number[]
+  precip_mm?: number[]
+  chance_of_rain?: number[]
+}
+
 export interface ForecastDaily {
   date: string
   date_epoch: number
@@ -135,6 +157,8 @@ export interface ForecastRequest {
   include_aqi?: boolean
   include_alerts?: boolean
   include_hourly?: boolean
+  fields?: string
+  layout?: 'rows' | 'columnar'
 }
 
 export interface ApiError {
@@ -0,0 +1,11 @@
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+/**
+ * Number of malloc, calloc and realloc calls made by the process so far
+ * Counted by wrapping glibc's allocator; elsewhere counting is unavailable.
+ * @return Call count, or -1 if allocations are not counted
+ */
+long alloc_count(void);
+
+#endif // ALLOC_COUNT_H
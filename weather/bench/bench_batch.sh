@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Upstream batching benchmark
+# Runs weather_service (response cache disabled) against the mock upstream,
+# sending every miss on its own and then collecting misses into bulk
+# requests for a few window lengths, and reports client-side latency plus the
+# service's upstream calls, batch fill and added wait from /health.
+#
+# Usage: ./bench/bench_batch.sh [REQUESTS]
+
+source "$(dirname "$0")/common.sh"
+
+REQUESTS=${1:-4000}
+CONCURRENCY=64
+UPSTREAM_DELAY_MS=20
+
+# Distinct locations, so neither the cache nor coalescing hides upstream
+URLS=()
+for i in $(seq 1 256); do
+    URLS+=("http://127.0.0.1:$SERVER_PORT/current?location=City$i")
+done
+
+# run_case LABEL [SERVICE FLAGS...]
+run_case() {
+    local label=$1
+    shift
+
+    start_mock -d "$UPSTREAM_DELAY_MS"
+
+    if start_service -M 0 "$@"; then
+        "$LOAD" -c "$CONCURRENCY" -n "$REQUESTS" -l "$label" "${URLS[@]}"
+        echo "    upstream: attempts=$(health_stat upstream attempts) bulk_requests=$(health_stat upstream bulk_requests)" \
+             "batch_fill=$(health_stat upstream batch_fill) batch_wait_ms=$(health_stat upstream batch_wait_ms)"
+    fi
+
+    stop_service
+    stop_mock
+}
+
+echo "=== Upstream batching: ${UPSTREAM_DELAY_MS}ms upstream, $CONCURRENCY clients, $REQUESTS requests ==="
+
+run_case "unbatched"
+run_case "window-2ms" -w 2
+run_case "window-5ms" -w 5
+run_case "window-5ms-max-16" -w 5 -m 16
@@ -0,0 +1,45 @@
+#!/bin/bash
+
+# Response fragment cache benchmark
+# Serves cached 3-, 7- and 14-day hourly forecasts with and without the cached
+# response fragments and reports latency plus the share of responses
+# assembled without rendering anything.
+#
+# Usage: ./bench/bench_body_cache.sh [THREADS] [REQUESTS]
+
+source "$(dirname "$0")/common.sh"
+
+THREADS=${1:-$(nproc)}
+REQUESTS=${2:-4000}
+CONCURRENCY=32
+
+start_mock -d 5
+
+URLS=()
+for city in London Paris Tokyo Oslo; do
+    for days in 14 7 3; do
+        URLS+=("http://127.0.0.1:$SERVER_PORT/forecast?location=$city&days=$days&include_hourly=true")
+    done
+done
+
+echo "=== Fragment cache: hourly forecasts from cache, $THREADS threads, $CONCURRENCY clients, $REQUESTS requests ==="
+
+for mode in cached serialize; do
+    FLAGS=()
+    [ "$mode" = "serialize" ] && FLAGS=(-B)
+
+    if start_service -T "$THREADS" "${FLAGS[@]}"; then
+        # Fill the cache (the 14-day forecast also answers 7 and 3 days), then measure only cache hits
+        for url in "${URLS[@]}"; do
+            curl -s "$url" > /dev/null
+        done
+        hits_before=$(health_stat fragments hits)
+
+        "$LOAD" -c "$CONCURRENCY" -n "$REQUESTS" -l "$mode" "${URLS[@]}"
+
+        hits_after=$(health_stat fragments hits)
+        echo "$mode: $(( (hits_after - hits_before) * 100 / REQUESTS ))% of responses assembled from cached fragments," \
+             "$(health_stat fragments bytes) bytes of fragments held"
+    fi
+    stop_service
+done
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# JSON arena benchmark
+# Serves cached 14-day hourly forecasts with and without the per-request
+# cJSON arenas and reports latency plus heap allocations per request.
+#
+# Usage: ./bench/bench_json_arena.sh [THREADS] [REQUESTS]
+
+source "$(dirname "$0")/common.sh"
+
+THREADS=${1:-$(nproc)}
+REQUESTS=${2:-4000}
+CONCURRENCY=32
+
+start_mock -d 5
+
+URLS=()
+for city in London Paris Tokyo Oslo; do
+    URLS+=("http://127.0.0.1:$SERVER_PORT/forecast?location=$city&days=14&include_hourly=true")
+done
+
+echo "=== JSON arena: 14-day hourly forecasts from cache, $THREADS threads, $CONCURRENCY clients, $REQUESTS requests ==="
+
+for mode in arena heap; do
+    FLAGS=()
+    [ "$mode" = "heap" ] && FLAGS=(-J)
+
+    if start_service -T "$THREADS" "${FLAGS[@]}"; then
+        # Fill the cache, then measure only cache hits
+        for url in "${URLS[@]}"; do
+            curl -s "$url" > /dev/null
+        done
+        requests_before=$(health_stat json requests)
+        heap_before=$(health_stat json heap_allocs)
+
+        "$LOAD" -c "$CONCURRENCY" -n "$REQUESTS" -l "$mode" "${URLS[@]}"
+
+        requests_after=$(health_stat json requests)
+        heap_after=$(health_stat json heap_allocs)
+        echo "$mode: $(( (heap_after - heap_before) / (requests_after - requests_before) )) cJSON heap allocations per request"
+    fi
+    stop_service
+done
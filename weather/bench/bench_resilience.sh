@@ -0,0 +1,60 @@
+#!/bin/bash
+
+# Upstream resilience benchmark
+# Runs weather_service (response cache disabled) against the mock upstream
+# with injected faults, once with a resilience feature and once without, and
+# reports client-side latency and failures plus the service's upstream
+# counters from /health.
+#
+# Usage: ./bench/bench_resilience.sh [REQUESTS]
+
+source "$(dirname "$0")/common.sh"
+
+REQUESTS=${1:-2000}
+CONCURRENCY=16
+UPSTREAM_DELAY_MS=10
+
+# Distinct locations, so neither the cache nor coalescing hides upstream
+URLS=()
+for i in $(seq 1 64); do
+    URLS+=("http://127.0.0.1:$SERVER_PORT/current?location=City$i")
+done
+
+# run_case LABEL "MOCK FAULT FLAGS" [SERVICE FLAGS...]
+run_case() {
+    local label=$1
+    local faults=$2
+    shift 2
+
+    # shellcheck disable=SC2086
+    start_mock -d "$UPSTREAM_DELAY_MS" $faults
+
+    if start_service -M 0 "$@"; then
+        "$LOAD" -c "$CONCURRENCY" -n "$REQUESTS" -l "$label" "${URLS[@]}"
+        echo "    upstream: attempts=$(health_stat upstream attempts) retries=$(health_stat upstream retries)" \
+             "hedges=$(health_stat upstream hedges) hedge_wins=$(health_stat upstream hedge_wins)" \
+             "shed=$(health_stat upstream shed) breaker_trips=$(health_stat upstream breaker_trips)" \
+             "limit=$(health_stat upstream limit)"
+    fi
+
+    stop_service
+    stop_mock
+}
+
+echo "=== Upstream resilience: ${UPSTREAM_DELAY_MS}ms upstream, $CONCURRENCY clients, $REQUESTS requests ==="
+
+echo "--- 20% of upstream requests answered 503 ---"
+run_case "no-retries" "-e 20" -r 0
+run_case "retries" "-e 20"
+
+echo "--- 5% of upstream connections dropped ---"
+run_case "no-retries" "-x 5" -r 0
+run_case "retries" "-x 5"
+
+echo "--- 5% of upstream requests 500ms slower ---"
+run_case "no-hedge" "-s 5 -S 500" -e
+run_case "hedge" "-s 5 -S 500"
+
+echo "--- Upstream down for the first 3 seconds ---"
+run_case "no-breaker" "-O 3" -O 0
+run_case "breaker" "-O 3"
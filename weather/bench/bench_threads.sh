@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Thread scaling benchmark
+# Runs weather_service against the mock upstream with 1..N worker threads
+# and reports throughput and latency for each configuration.
+#
+# Usage: ./bench/bench_threads.sh [MAX_THREADS] [UPSTREAM_DELAY_MS]
+
+source "$(dirname "$0")/common.sh"
+
+MAX_THREADS=${1:-$(nproc)}
+UPSTREAM_DELAY_MS=${2:-20}
+CONCURRENCY=64
+REQUESTS=2000
+
+start_mock -d "$UPSTREAM_DELAY_MS"
+
+URLS=()
+for city in London Paris Tokyo Oslo Bergen Athens Paros Naxos; do
+    URLS+=("http://127.0.0.1:$SERVER_PORT/current?location=$city")
+done
+
+echo "=== Thread scaling: upstream delay ${UPSTREAM_DELAY_MS}ms, $CONCURRENCY clients, $REQUESTS requests ==="
+
+threads=1
+while [ "$threads" -le "$MAX_THREADS" ]; do
+    if start_service -T "$threads"; then
+        "$LOAD" -c "$CONCURRENCY" -n "$REQUESTS" -l "threads=$threads" "${URLS[@]}"
+    fi
+    stop_service
+
+    if [ "$threads" -eq "$MAX_THREADS" ]; then
+        break
+    fi
+    threads=$((threads * 2))
+    if [ "$threads" -gt "$MAX_THREADS" ]; then
+        threads=$MAX_THREADS
+    fi
+done
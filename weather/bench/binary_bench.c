@@ -0,0 +1,345 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+#include "fixtures.h"
+#include "cjson_baseline.h"
+#include "weather_parser.h"
+#include "weather_arena.h"
+#include "weather_compact.h"
+#include "weather_json.h"
+#include "weather_binary.h"
+
+/*
+ * Binary body microbenchmark: the size of /current and /forecast bodies as
+ * compact JSON, CBOR and MessagePack, the time to write each, and the time a
+ * client takes to read them back (cJSON for JSON, weather_decode.c for the
+ * binary formats).
+ *
+ * Every binary body is decoded and compared with the data it was written
+ * from, member by member (local time strings are not sent); any difference
+ * fails the run.
+ *
+ * A second table writes 14-day hourly forecasts with the hours as rows and
+ * as columns (layout=columnar) in each format. JSON is read back with
+ * cJSON_Parse() alone there, as no struct filler reads columns.
+ */
+
+#define TARGET_BYTES (64UL * 1024 * 1024)     // Write about this much JSON per case
+
+typedef struct {
+    const char *name;
+    int days;                                 // 0 for a /current body
+    int include_hourly;                       // weather_hourly_t
+} bench_case_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int load_forecast(const char *location, int days, weather_result_t *result) {
+    size_t length = 0;
+    char *body = fixture_forecast_json(location, days, &length);
+    if (!body) return -1;
+
+    memset(result, 0, sizeof(*result));
+    result->is_forecast = 1;
+    weather_parser_t *parser = weather_parser_create(result, 0);
+    int status = parser ? weather_parser_feed(parser, body, length) : -1;
+    if (status == 0) status = weather_parser_finish(parser);
+    weather_parser_free(parser);
+    free(body);
+    return status;
+}
+
+static int load_current(const char *location, weather_result_t *result) {
+    char *body = fixture_current_json(location, NULL);
+    if (!body) return -1;
+
+    memset(result, 0, sizeof(*result));
+    int status = baseline_parse_current(body, &result->current);
+    free(body);
+    return status;
+}
+
+static char *json_serialize(const bench_case_t *c, const weather_result_t *result, size_t *length) {
+    weather_json_writer_t writer;
+    weather_json_writer_init(&writer, 0, WEATHER_JSON_SHORTEST);
+    if (c->days) {
+        weather_json_write_forecast(&writer, result, c->include_hourly);
+    } else {
+        weather_json_write_current(&writer, &result->current);
+    }
+    return weather_json_writer_finish(&writer, length);
+}
+
+static unsigned char *binary_serialize(const bench_case_t *c, const weather_result_t *result,
+                                       weather_binary_format_t format, size_t *length) {
+    weather_binary_writer_t writer;
+    weather_binary_writer_init(&writer, format);
+    if (c->days) {
+        weather_binary_write_forecast(&writer, result, c->include_hourly);
+    } else {
+        weather_binary_write_current(&writer, &result->current);
+    }
+    return weather_binary_writer_finish(&writer, length);
+}
+
+static void forecast_free(forecast_response_t *forecast) {
+    for (int i = 0; i < forecast->forecast_days; i++) {
+        free(forecast->forecast[i].hour);
+    }
+    free(forecast->forecast);
+}
+
+static int json_decode(const bench_case_t *c, const char *body) {
+    if (!c->days) {
+        weather_response_t response;
+        return baseline_parse_current(body, &response);
+    }
+    forecast_response_t forecast;
+    memset(&forecast, 0, sizeof(forecast));
+    int status = baseline_parse_forecast(body, &forecast);
+    forecast_free(&forecast);
+    return status;
+}
+
+static int binary_decode(const bench_case_t *c, const unsigned char *body, size_t length,
+                         weather_binary_format_t format) {
+    if (!c->days) {
+        weather_response_t response;
+        return weather_binary_decode_current(body, length, format, &response);
+    }
+    forecast_response_t forecast;
+    int status = weather_binary_decode_forecast(body, length, format, &forecast);
+    weather_binary_forecast_free(&forecast);
+    return status;
+}
+
+/**
+ * Compare the members of two structs described by a member table
+ * @return Number of differing members
+ */
+static int members_differ(const weather_schema_t *schema, const void *expected, const void *actual,
+                          const char *what) {
+    int differing = 0;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        const char *a = (const char *)expected + member->offset;
+        const char *b = (const char *)actual + member->offset;
+        int same = 1;
+        switch (member->type) {
+            case WEATHER_MEMBER_TIME:
+                break;
+            case WEATHER_MEMBER_STRING:
+                same = strcmp(a, b) == 0;
+                break;
+            case WEATHER_MEMBER_INT:
+                same = *(const int *)a == *(const int *)b;
+                break;
+            case WEATHER_MEMBER_LONG:
+                same = *(const long *)a == *(const long *)b;
+                break;
+            case WEATHER_MEMBER_DOUBLE:
+                same = *(const double *)a == *(const double *)b;
+                break;
+            case WEATHER_MEMBER_CONDITION:
+                differing += members_differ(&weather_schema_condition, a, b, what);
+                break;
+        }
+        if (!same) {
+            fprintf(stderr, "Decoded %s.%s differs\n", what, member->name);
+            differing++;
+        }
+    }
+    return differing;
+}
+
+/**
+ * Decode a binary body and compare it with the data it was written from
+ */
+static int binary_verify(const bench_case_t *c, const weather_result_t *result, const unsigned char *body,
+                         size_t length, weather_binary_format_t format) {
+    if (!c->days) {
+        weather_response_t decoded;
+        if (weather_binary_decode_current(body, length, format, &decoded) != 0) return -1;
+        int differing = members_differ(&weather_schema_location, &result->current.location, &decoded.location,
+                                       "location");
+        differing += members_differ(&weather_schema_current, &result->current.current, &decoded.current, "current");
+        return differing ? -1 : 0;
+    }
+
+    forecast_response_t decoded;
+    if (weather_binary_decode_forecast(body, length, format, &decoded) != 0) return -1;
+    const forecast_response_t *source = &result->forecast;
+    int differing = members_differ(&weather_schema_location, &source->location, &decoded.location, "location");
+    if (decoded.forecast_days != source->forecast_days) {
+        fprintf(stderr, "Decoded %d days instead of %d\n", decoded.forecast_days, source->forecast_days);
+        differing++;
+    }
+    for (int i = 0; i < decoded.forecast_days && i < source->forecast_days; i++) {
+        const forecast_daily_t *expected = &source->forecast[i];
+        const forecast_daily_t *actual = &decoded.forecast[i];
+        differing += members_differ(&weather_schema_daily, expected, actual, "forecast");
+        differing += members_differ(&weather_schema_day, &expected->day, &actual->day, "day");
+        differing += members_differ(&weather_schema_astro, &expected->astro, &actual->astro, "astro");
+
+        const weather_hours_t *hours = c->include_hourly ? weather_result_hours(result, i) : NULL;
+        int hour_count = hours ? hours->count : 0;
+        if (actual->hour_count != hour_count) {
+            fprintf(stderr, "Decoded %d hours instead of %d\n", actual->hour_count, hour_count);
+            differing++;
+            continue;
+        }
+        for (int h = 0; h < hour_count; h++) {
+            forecast_hour_t hour;
+            weather_hours_get(hours, h, &hour);
+            differing += members_differ(&weather_schema_hour, &hour, &actual->hour[h], "hour");
+        }
+    }
+    weather_binary_forecast_free(&decoded);
+    return differing ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *location = argc > 1 ? argv[1] : "London";
+    static const bench_case_t cases[] = {
+        {"current", 0, 0},
+        {"3d", 3, 0},
+        {"14d", 14, 0},
+        {"3d+hourly", 3, 1},
+        {"14d+hourly", 14, 1},
+    };
+    static const struct {
+        const char *name;
+        weather_binary_format_t format;
+    } formats[] = {
+        {"cbor", WEATHER_BINARY_CBOR},
+        {"msgpack", WEATHER_BINARY_MSGPACK},
+    };
+    int failed = 0;
+
+    printf("%-11s %-8s %8s %8s %6s %12s %12s\n", "case", "format", "bytes", "smaller", "iters", "encode us/op",
+           "decode us/op");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const bench_case_t *c = &cases[i];
+        weather_result_t result;
+        if ((c->days ? load_forecast(location, c->days, &result) : load_current(location, &result)) != 0) {
+            fprintf(stderr, "Failed to load the %s payload\n", c->name);
+            return 1;
+        }
+
+        size_t json_length = 0;
+        char *json = json_serialize(c, &result, &json_length);
+        if (!json || json_decode(c, json) != 0) {
+            fprintf(stderr, "Failed to write or read back the %s JSON body\n", c->name);
+            return 1;
+        }
+
+        int iterations = (int)(TARGET_BYTES / json_length);
+        if (iterations < 20) iterations = 20;
+
+        double start = now_sec();
+        for (int n = 0; n < iterations; n++) free(json_serialize(c, &result, &json_length));
+        double json_encode_sec = now_sec() - start;
+
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) json_decode(c, json);
+        double json_decode_sec = now_sec() - start;
+        free(json);
+
+        printf("%-11s %-8s %8zu %7.1fx %6d %12.1f %12.1f\n", c->name, "json", json_length, 1.0, iterations,
+               json_encode_sec * 1e6 / iterations, json_decode_sec * 1e6 / iterations);
+
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            size_t length = 0;
+            unsigned char *body = binary_serialize(c, &result, formats[f].format, &length);
+            if (!body || binary_verify(c, &result, body, length, formats[f].format) != 0) {
+                fprintf(stderr, "Decoded %s body differs from the %s payload\n", formats[f].name, c->name);
+                failed = 1;
+            }
+
+            start = now_sec();
+            for (int n = 0; n < iterations; n++) free(binary_serialize(c, &result, formats[f].format, &length));
+            double encode_sec = now_sec() - start;
+
+            start = now_sec();
+            for (int n = 0; n < iterations; n++) binary_decode(c, body, length, formats[f].format);
+            double decode_sec = now_sec() - start;
+            free(body);
+
+            printf("%-11s %-8s %8zu %7.1fx %6d %12.1f %12.1f\n", c->name, formats[f].name, length,
+                   (double)json_length / length, iterations, encode_sec * 1e6 / iterations,
+                   decode_sec * 1e6 / iterations);
+        }
+
+        if (c->days) weather_arena_free(weather_arena_of(result.forecast.forecast));
+    }
+
+    static const bench_case_t layouts[] = {
+        {"rows", 14, WEATHER_HOURLY_ROWS},
+        {"columns", 14, WEATHER_HOURLY_COLUMNS},
+    };
+    weather_result_t result;
+    if (load_forecast(location, 14, &result) != 0) {
+        fprintf(stderr, "Failed to load the 14d+hourly payload\n");
+        return 1;
+    }
+
+    printf("\n%-11s %-8s %8s %6s %12s %12s\n", "layout", "format", "bytes", "iters", "encode us/op", "decode us/op");
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+        const bench_case_t *c = &layouts[i];
+        size_t json_length = 0;
+        char *json = json_serialize(c, &result, &json_length);
+        cJSON *parsed = json ? cJSON_Parse(json) : NULL;
+        if (!parsed) {
+            fprintf(stderr, "The %s JSON body does not parse\n", c->name);
+            failed = 1;
+        }
+        cJSON_Delete(parsed);
+
+        int iterations = (int)(TARGET_BYTES / json_length);
+        if (iterations < 20) iterations = 20;
+
+        double start = now_sec();
+        for (int n = 0; n < iterations; n++) free(json_serialize(c, &result, &json_length));
+        double encode_sec = now_sec() - start;
+
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) cJSON_Delete(cJSON_Parse(json));
+        double decode_sec = now_sec() - start;
+        free(json);
+
+        printf("%-11s %-8s %8zu %6d %12.1f %12.1f\n", c->name, "json", json_length, iterations,
+               encode_sec * 1e6 / iterations, decode_sec * 1e6 / iterations);
+
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            size_t length = 0;
+            unsigned char *body = binary_serialize(c, &result, formats[f].format, &length);
+            if (!body || binary_verify(c, &result, body, length, formats[f].format) != 0) {
+                fprintf(stderr, "Decoded %s body differs from the %s payload\n", formats[f].name, c->name);
+                failed = 1;
+            }
+
+            start = now_sec();
+            for (int n = 0; n < iterations; n++) free(binary_serialize(c, &result, formats[f].format, &length));
+            encode_sec = now_sec() - start;
+
+            start = now_sec();
+            for (int n = 0; n < iterations; n++) binary_decode(c, body, length, formats[f].format);
+            decode_sec = now_sec() - start;
+            free(body);
+
+            printf("%-11s %-8s %8zu %6d %12.1f %12.1f\n", c->name, formats[f].name, length, iterations,
+                   encode_sec * 1e6 / iterations, decode_sec * 1e6 / iterations);
+        }
+    }
+    weather_arena_free(weather_arena_of(result.forecast.forecast));
+
+    return failed;
+}
@@ -0,0 +1,541 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cjson/cJSON.h>
+#include "cjson_baseline.h"
+#include "weather_compact.h"
+
+/*
+ * The cJSON DOM parser the service used before the streaming parser
+ * (src/weather_parser.c), kept unchanged as the benchmark baseline: the whole
+ * body is parsed into a tree, then every field is looked up by name.
+ */
+
+/**
+ * Helper function to safely extract string from JSON object
+ */
+static void json_get_string(const cJSON *json, const char *key, char *dest, size_t dest_size) {
+    const cJSON *item = cJSON_GetObjectItem(json, key);
+    if (cJSON_IsString(item) && item->valuestring) {
+        strncpy(dest, item->valuestring, dest_size - 1);
+        dest[dest_size - 1] = '\0';
+    } else {
+        dest[0] = '\0';
+    }
+}
+
+/**
+ * Helper function to safely extract double from JSON object
+ */
+static double json_get_double(const cJSON *json, const char *key) {
+    const cJSON *item = cJSON_GetObjectItem(json, key);
+    if (cJSON_IsNumber(item)) {
+        return item->valuedouble;
+    }
+    return 0.0;
+}
+
+/**
+ * Helper function to safely extract integer from JSON object
+ */
+static int json_get_int(const cJSON *json, const char *key) {
+    const cJSON *item = cJSON_GetObjectItem(json, key);
+    if (cJSON_IsNumber(item)) {
+        return item->valueint;
+    }
+    return 0;
+}
+
+/**
+ * Helper function to safely extract long from JSON object
+ */
+static long json_get_long(const cJSON *json, const char *key) {
+    const cJSON *item = cJSON_GetObjectItem(json, key);
+    if (cJSON_IsNumber(item)) {
+        return (long)item->valuedouble;
+    }
+    return 0;
+}
+
+/**
+ * Parse location data from JSON
+ */
+static void parse_location(const cJSON *location_json, location_t *location) {
+    if (!location_json || !location) return;
+    
+    json_get_string(location_json, "name", location->name, sizeof(location->name));
+    json_get_string(location_json, "region", location->region, sizeof(location->region));
+    json_get_string(location_json, "country", location->country, sizeof(location->country));
+    location->lat = json_get_double(location_json, "lat");
+    location->lon = json_get_double(location_json, "lon");
+    json_get_string(location_json, "tz_id", location->tz_id, sizeof(location->tz_id));
+    location->localtime_epoch = json_get_long(location_json, "localtime_epoch");
+    json_get_string(location_json, "localtime", location->localtime, sizeof(location->localtime));
+}
+
+/**
+ * Parse weather condition from JSON
+ */
+static void parse_condition(const cJSON *condition_json, weather_condition_t *condition) {
+    if (!condition_json || !condition) return;
+    
+    json_get_string(condition_json, "text", condition->text, sizeof(condition->text));
+    json_get_string(condition_json, "icon", condition->icon, sizeof(condition->icon));
+    condition->code = json_get_int(condition_json, "code");
+}
+
+/**
+ * Parse current weather data from JSON
+ */
+static void parse_current_weather(const cJSON *current_json, current_weather_t *current) {
+    if (!current_json || !current) return;
+    
+    current->last_updated_epoch = json_get_long(current_json, "last_updated_epoch");
+    json_get_string(current_json, "last_updated", current->last_updated, sizeof(current->last_updated));
+    current->temp_c = json_get_double(current_json, "temp_c");
+    current->temp_f = json_get_double(current_json, "temp_f");
+    current->is_day = json_get_int(current_json, "is_day");
+    
+    // Parse condition
+    const cJSON *condition_json = cJSON_GetObjectItem(current_json, "condition");
+    parse_condition(condition_json, &current->condition);
+    
+    current->wind_mph = json_get_double(current_json, "wind_mph");
+    current->wind_kph = json_get_double(current_json, "wind_kph");
+    current->wind_degree = json_get_int(current_json, "wind_degree");
+    json_get_string(current_json, "wind_dir", current->wind_dir, sizeof(current->wind_dir));
+    current->pressure_mb = json_get_double(current_json, "pressure_mb");
+    current->pressure_in = json_get_double(current_json, "pressure_in");
+    current->precip_mm = json_get_double(current_json, "precip_mm");
+    current->precip_in = json_get_double(current_json, "precip_in");
+    current->humidity = json_get_int(current_json, "humidity");
+    current->cloud = json_get_int(current_json, "cloud");
+    current->feelslike_c = json_get_double(current_json, "feelslike_c");
+    current->feelslike_f = json_get_double(current_json, "feelslike_f");
+    current->windchill_c = json_get_double(current_json, "windchill_c");
+    current->windchill_f = json_get_double(current_json, "windchill_f");
+    current->heatindex_c = json_get_double(current_json, "heatindex_c");
+    current->heatindex_f = json_get_double(current_json, "heatindex_f");
+    current->dewpoint_c = json_get_double(current_json, "dewpoint_c");
+    current->dewpoint_f = json_get_double(current_json, "dewpoint_f");
+    current->vis_km = json_get_double(current_json, "vis_km");
+    current->vis_miles = json_get_double(current_json, "vis_miles");
+    current->uv = json_get_double(current_json, "uv");
+    current->gust_mph = json_get_double(current_json, "gust_mph");
+    current->gust_kph = json_get_double(current_json, "gust_kph");
+    current->short_rad = json_get_double(current_json, "short_rad");
+    current->diff_rad = json_get_double(current_json, "diff_rad");
+    current->dni = json_get_double(current_json, "dni");
+    current->gti = json_get_double(current_json, "gti");
+}
+
+/**
+ * Parse a current.json body into a weather response
+ */
+int baseline_parse_current(const char *body, weather_response_t *response) {
+    // Parse JSON response
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        return -1;
+    }
+    
+    // Clear response structure
+    memset(response, 0, sizeof(weather_response_t));
+    
+    // Parse location
+    const cJSON *location_json = cJSON_GetObjectItem(json, "location");
+    if (location_json) {
+        parse_location(location_json, &response->location);
+    }
+    
+    // Parse current weather
+    const cJSON *current_json = cJSON_GetObjectItem(json, "current");
+    if (current_json) {
+        parse_current_weather(current_json, &response->current);
+    }
+    
+    // Cleanup
+    cJSON_Delete(json);
+    
+    return 0;
+}
+
+/**
+ * Parse astronomy data from JSON
+ */
+static void parse_astronomy(const cJSON *astro_json, astronomy_t *astro) {
+    if (!astro_json || !astro) return;
+    
+    json_get_string(astro_json, "sunrise", astro->sunrise, sizeof(astro->sunrise));
+    json_get_string(astro_json, "sunset", astro->sunset, sizeof(astro->sunset));
+    json_get_string(astro_json, "moonrise", astro->moonrise, sizeof(astro->moonrise));
+    json_get_string(astro_json, "moonset", astro->moonset, sizeof(astro->moonset));
+    json_get_string(astro_json, "moon_phase", astro->moon_phase, sizeof(astro->moon_phase));
+    astro->moon_illumination = json_get_int(astro_json, "moon_illumination");
+}
+
+/**
+ * Parse forecast day data from JSON
+ */
+static void parse_forecast_day(const cJSON *day_json, forecast_day_t *day) {
+    if (!day_json || !day) return;
+    
+    day->maxtemp_c = json_get_double(day_json, "maxtemp_c");
+    day->maxtemp_f = json_get_double(day_json, "maxtemp_f");
+    day->mintemp_c = json_get_double(day_json, "mintemp_c");
+    day->mintemp_f = json_get_double(day_json, "mintemp_f");
+    day->avgtemp_c = json_get_double(day_json, "avgtemp_c");
+    day->avgtemp_f = json_get_double(day_json, "avgtemp_f");
+    day->maxwind_mph = json_get_double(day_json, "maxwind_mph");
+    day->maxwind_kph = json_get_double(day_json, "maxwind_kph");
+    day->totalprecip_mm = json_get_double(day_json, "totalprecip_mm");
+    day->totalprecip_in = json_get_double(day_json, "totalprecip_in");
+    day->totalsnow_cm = json_get_double(day_json, "totalsnow_cm");
+    day->avgvis_km = json_get_double(day_json, "avgvis_km");
+    day->avgvis_miles = json_get_double(day_json, "avgvis_miles");
+    day->avghumidity = json_get_int(day_json, "avghumidity");
+    day->daily_will_it_rain = json_get_int(day_json, "daily_will_it_rain");
+    day->daily_chance_of_rain = json_get_int(day_json, "daily_chance_of_rain");
+    day->daily_will_it_snow = json_get_int(day_json, "daily_will_it_snow");
+    day->daily_chance_of_snow = json_get_int(day_json, "daily_chance_of_snow");
+    day->uv = json_get_double(day_json, "uv");
+    
+    // Parse condition
+    const cJSON *condition_json = cJSON_GetObjectItem(day_json, "condition");
+    parse_condition(condition_json, &day->condition);
+}
+
+/**
+ * Parse hourly forecast data from JSON
+ */
+static void parse_forecast_hour(const cJSON *hour_json, forecast_hour_t *hour) {
+    if (!hour_json || !hour) return;
+    
+    hour->time_epoch = json_get_long(hour_json, "time_epoch");
+    json_get_string(hour_json, "time", hour->time, sizeof(hour->time));
+    hour->temp_c = json_get_double(hour_json, "temp_c");
+    hour->temp_f = json_get_double(hour_json, "temp_f");
+    hour->is_day = json_get_int(hour_json, "is_day");
+    
+    // Parse condition
+    const cJSON *condition_json = cJSON_GetObjectItem(hour_json, "condition");
+    parse_condition(condition_json, &hour->condition);
+    
+    hour->wind_mph = json_get_double(hour_json, "wind_mph");
+    hour->wind_kph = json_get_double(hour_json, "wind_kph");
+    hour->wind_degree = json_get_int(hour_json, "wind_degree");
+    json_get_string(hour_json, "wind_dir", hour->wind_dir, sizeof(hour->wind_dir));
+    hour->pressure_mb = json_get_double(hour_json, "pressure_mb");
+    hour->pressure_in = json_get_double(hour_json, "pressure_in");
+    hour->precip_mm = json_get_double(hour_json, "precip_mm");
+    hour->precip_in = json_get_double(hour_json, "precip_in");
+    hour->humidity = json_get_int(hour_json, "humidity");
+    hour->cloud = json_get_int(hour_json, "cloud");
+    hour->feelslike_c = json_get_double(hour_json, "feelslike_c");
+    hour->feelslike_f = json_get_double(hour_json, "feelslike_f");
+    hour->windchill_c = json_get_double(hour_json, "windchill_c");
+    hour->windchill_f = json_get_double(hour_json, "windchill_f");
+    hour->heatindex_c = json_get_double(hour_json, "heatindex_c");
+    hour->heatindex_f = json_get_double(hour_json, "heatindex_f");
+    hour->dewpoint_c = json_get_double(hour_json, "dewpoint_c");
+    hour->dewpoint_f = json_get_double(hour_json, "dewpoint_f");
+    hour->will_it_rain = json_get_int(hour_json, "will_it_rain");
+    hour->chance_of_rain = json_get_int(hour_json, "chance_of_rain");
+    hour->will_it_snow = json_get_int(hour_json, "will_it_snow");
+    hour->chance_of_snow = json_get_int(hour_json, "chance_of_snow");
+    hour->vis_km = json_get_double(hour_json, "vis_km");
+    hour->vis_miles = json_get_double(hour_json, "vis_miles");
+    hour->gust_mph = json_get_double(hour_json, "gust_mph");
+    hour->gust_kph = json_get_double(hour_json, "gust_kph");
+    hour->uv = json_get_double(hour_json, "uv");
+}
+
+/**
+ * Parse a forecast.json body into a forecast response
+ */
+int baseline_parse_forecast(const char *body, forecast_response_t *response) {
+    // Parse JSON response
+    cJSON *json = cJSON_Parse(body);
+    if (!json) {
+        fprintf(stderr, "Failed to parse JSON response\n");
+        return -1;
+    }
+    
+    // Clear response structure
+    memset(response, 0, sizeof(forecast_response_t));
+    
+    // Parse location
+    const cJSON *location_json = cJSON_GetObjectItem(json, "location");
+    if (location_json) {
+        parse_location(location_json, &response->location);
+    }
+    
+    // Parse current weather
+    const cJSON *current_json = cJSON_GetObjectItem(json, "current");
+    if (current_json) {
+        parse_current_weather(current_json, &response->current);
+    }
+    
+    // Parse forecast
+    const cJSON *forecast_json = cJSON_GetObjectItem(json, "forecast");
+    if (forecast_json) {
+        const cJSON *forecastday_array = cJSON_GetObjectItem(forecast_json, "forecastday");
+        if (cJSON_IsArray(forecastday_array)) {
+            int array_size = cJSON_GetArraySize(forecastday_array);
+            if (array_size > 0) {
+                response->forecast = malloc(array_size * sizeof(forecast_daily_t));
+                if (!response->forecast) {
+                    fprintf(stderr, "Failed to allocate memory for forecast days\n");
+                    cJSON_Delete(json);
+                    return -1;
+                }
+                
+                response->forecast_days = array_size;
+                
+                for (int i = 0; i < array_size; i++) {
+                    const cJSON *day_json = cJSON_GetArrayItem(forecastday_array, i);
+                    if (day_json) {
+                        forecast_daily_t *daily = &response->forecast[i];
+                        memset(daily, 0, sizeof(forecast_daily_t));
+                        
+                        // Parse date
+                        json_get_string(day_json, "date", daily->date, sizeof(daily->date));
+                        daily->date_epoch = json_get_long(day_json, "date_epoch");
+                        
+                        // Parse day data
+                        const cJSON *day_data = cJSON_GetObjectItem(day_json, "day");
+                        if (day_data) {
+                            parse_forecast_day(day_data, &daily->day);
+                        }
+                        
+                        // Parse astronomy
+                        const cJSON *astro_json = cJSON_GetObjectItem(day_json, "astro");
+                        if (astro_json) {
+                            parse_astronomy(astro_json, &daily->astro);
+                        }
+                        
+                        // Parse hourly data
+                        const cJSON *hour_array = cJSON_GetObjectItem(day_json, "hour");
+                        if (cJSON_IsArray(hour_array)) {
+                            int hour_count = cJSON_GetArraySize(hour_array);
+                            if (hour_count > 0) {
+                                daily->hour = malloc(hour_count * sizeof(forecast_hour_t));
+                                if (daily->hour) {
+                                    daily->hour_count = hour_count;
+                                    for (int h = 0; h < hour_count; h++) {
+                                        const cJSON *hour_json = cJSON_GetArrayItem(hour_array, h);
+                                        if (hour_json) {
+                                            parse_forecast_hour(hour_json, &daily->hour[h]);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    // Cleanup
+    cJSON_Delete(json);
+    
+    return 0;
+}
+
+/*
+ * The cJSON tree builders the service used before the streaming JSON writer
+ * (src/weather_json.c), kept as the serialization baseline. They write the
+ * members the table-driven writer added (wind chill, heat index, dew point,
+ * snow, visibility, solar radiation and all hourly members) in the same
+ * order, so the two outputs still compare byte for byte.
+ */
+
+/**
+ * Add a location object
+ */
+static void add_location(cJSON *json, const location_t *loc) {
+    cJSON *location = cJSON_CreateObject();
+    cJSON_AddStringToObject(location, "name", loc->name);
+    cJSON_AddStringToObject(location, "region", loc->region);
+    cJSON_AddStringToObject(location, "country", loc->country);
+    cJSON_AddNumberToObject(location, "lat", loc->lat);
+    cJSON_AddNumberToObject(location, "lon", loc->lon);
+    cJSON_AddStringToObject(location, "tz_id", loc->tz_id);
+    cJSON_AddNumberToObject(location, "localtime_epoch", loc->localtime_epoch);
+    cJSON_AddStringToObject(location, "localtime", loc->localtime);
+    cJSON_AddItemToObject(json, "location", location);
+}
+
+/**
+ * Add a condition object
+ */
+static void add_condition(cJSON *json, const weather_condition_t *cond) {
+    cJSON *condition = cJSON_CreateObject();
+    cJSON_AddStringToObject(condition, "text", cond->text);
+    cJSON_AddStringToObject(condition, "icon", cond->icon);
+    cJSON_AddNumberToObject(condition, "code", cond->code);
+    cJSON_AddItemToObject(json, "condition", condition);
+}
+
+/**
+ * Convert weather_response_t to JSON
+ */
+cJSON *baseline_current_to_json(const weather_response_t *response) {
+    const current_weather_t *cur = &response->current;
+    cJSON *json = cJSON_CreateObject();
+    
+    add_location(json, &response->location);
+    
+    // Current weather
+    cJSON *current = cJSON_CreateObject();
+    cJSON_AddNumberToObject(current, "last_updated_epoch", cur->last_updated_epoch);
+    cJSON_AddStringToObject(current, "last_updated", cur->last_updated);
+    cJSON_AddNumberToObject(current, "temp_c", cur->temp_c);
+    cJSON_AddNumberToObject(current, "temp_f", cur->temp_f);
+    cJSON_AddNumberToObject(current, "is_day", cur->is_day);
+    add_condition(current, &cur->condition);
+    cJSON_AddNumberToObject(current, "wind_mph", cur->wind_mph);
+    cJSON_AddNumberToObject(current, "wind_kph", cur->wind_kph);
+    cJSON_AddNumberToObject(current, "wind_degree", cur->wind_degree);
+    cJSON_AddStringToObject(current, "wind_dir", cur->wind_dir);
+    cJSON_AddNumberToObject(current, "pressure_mb", cur->pressure_mb);
+    cJSON_AddNumberToObject(current, "pressure_in", cur->pressure_in);
+    cJSON_AddNumberToObject(current, "precip_mm", cur->precip_mm);
+    cJSON_AddNumberToObject(current, "precip_in", cur->precip_in);
+    cJSON_AddNumberToObject(current, "humidity", cur->humidity);
+    cJSON_AddNumberToObject(current, "cloud", cur->cloud);
+    cJSON_AddNumberToObject(current, "feelslike_c", cur->feelslike_c);
+    cJSON_AddNumberToObject(current, "feelslike_f", cur->feelslike_f);
+    cJSON_AddNumberToObject(current, "windchill_c", cur->windchill_c);
+    cJSON_AddNumberToObject(current, "windchill_f", cur->windchill_f);
+    cJSON_AddNumberToObject(current, "heatindex_c", cur->heatindex_c);
+    cJSON_AddNumberToObject(current, "heatindex_f", cur->heatindex_f);
+    cJSON_AddNumberToObject(current, "dewpoint_c", cur->dewpoint_c);
+    cJSON_AddNumberToObject(current, "dewpoint_f", cur->dewpoint_f);
+    cJSON_AddNumberToObject(current, "vis_km", cur->vis_km);
+    cJSON_AddNumberToObject(current, "vis_miles", cur->vis_miles);
+    cJSON_AddNumberToObject(current, "uv", cur->uv);
+    cJSON_AddNumberToObject(current, "gust_mph", cur->gust_mph);
+    cJSON_AddNumberToObject(current, "gust_kph", cur->gust_kph);
+    cJSON_AddNumberToObject(current, "short_rad", cur->short_rad);
+    cJSON_AddNumberToObject(current, "diff_rad", cur->diff_rad);
+    cJSON_AddNumberToObject(current, "dni", cur->dni);
+    cJSON_AddNumberToObject(current, "gti", cur->gti);
+    
+    cJSON_AddItemToObject(json, "current", current);
+    return json;
+}
+
+/**
+ * Convert a forecast result to JSON
+ * Hourly data is unpacked from the compact hours.
+ */
+cJSON *baseline_forecast_to_json(const weather_result_t *result, int include_hourly) {
+    const forecast_response_t *response = &result->forecast;
+    cJSON *json = cJSON_CreateObject();
+    
+    add_location(json, &response->location);
+    
+    // Forecast
+    cJSON *forecast_obj = cJSON_CreateObject();
+    cJSON *forecastday_array = cJSON_CreateArray();
+    
+    for (int i = 0; i < response->forecast_days; i++) {
+        const forecast_daily_t *daily = &response->forecast[i];
+        const forecast_day_t *d = &daily->day;
+        cJSON *day_obj = cJSON_CreateObject();
+        
+        cJSON_AddStringToObject(day_obj, "date", daily->date);
+        cJSON_AddNumberToObject(day_obj, "date_epoch", daily->date_epoch);
+        
+        // Day data
+        cJSON *day_data = cJSON_CreateObject();
+        cJSON_AddNumberToObject(day_data, "maxtemp_c", d->maxtemp_c);
+        cJSON_AddNumberToObject(day_data, "maxtemp_f", d->maxtemp_f);
+        cJSON_AddNumberToObject(day_data, "mintemp_c", d->mintemp_c);
+        cJSON_AddNumberToObject(day_data, "mintemp_f", d->mintemp_f);
+        cJSON_AddNumberToObject(day_data, "avgtemp_c", d->avgtemp_c);
+        cJSON_AddNumberToObject(day_data, "avgtemp_f", d->avgtemp_f);
+        cJSON_AddNumberToObject(day_data, "maxwind_mph", d->maxwind_mph);
+        cJSON_AddNumberToObject(day_data, "maxwind_kph", d->maxwind_kph);
+        cJSON_AddNumberToObject(day_data, "totalprecip_mm", d->totalprecip_mm);
+        cJSON_AddNumberToObject(day_data, "totalprecip_in", d->totalprecip_in);
+        cJSON_AddNumberToObject(day_data, "totalsnow_cm", d->totalsnow_cm);
+        cJSON_AddNumberToObject(day_data, "avgvis_km", d->avgvis_km);
+        cJSON_AddNumberToObject(day_data, "avgvis_miles", d->avgvis_miles);
+        cJSON_AddNumberToObject(day_data, "avghumidity", d->avghumidity);
+        cJSON_AddNumberToObject(day_data, "daily_will_it_rain", d->daily_will_it_rain);
+        cJSON_AddNumberToObject(day_data, "daily_chance_of_rain", d->daily_chance_of_rain);
+        cJSON_AddNumberToObject(day_data, "daily_will_it_snow", d->daily_will_it_snow);
+        cJSON_AddNumberToObject(day_data, "daily_chance_of_snow", d->daily_chance_of_snow);
+        add_condition(day_data, &d->condition);
+        cJSON_AddNumberToObject(day_data, "uv", d->uv);
+        cJSON_AddItemToObject(day_obj, "day", day_data);
+        
+        // Astronomy
+        cJSON *astro = cJSON_CreateObject();
+        cJSON_AddStringToObject(astro, "sunrise", daily->astro.sunrise);
+        cJSON_AddStringToObject(astro, "sunset", daily->astro.sunset);
+        cJSON_AddStringToObject(astro, "moonrise", daily->astro.moonrise);
+        cJSON_AddStringToObject(astro, "moonset", daily->astro.moonset);
+        cJSON_AddStringToObject(astro, "moon_phase", daily->astro.moon_phase);
+        cJSON_AddNumberToObject(astro, "moon_illumination", daily->astro.moon_illumination);
+        cJSON_AddItemToObject(day_obj, "astro", astro);
+        
+        // Hourly data (if requested)
+        const weather_hours_t *hours = include_hourly ? weather_result_hours(result, i) : NULL;
+        if (hours) {
+            cJSON *hour_array = cJSON_CreateArray();
+            for (int h = 0; h < hours->count; h++) {
+                forecast_hour_t hour;
+                weather_hours_get(hours, h, &hour);
+                
+                cJSON *hour_obj = cJSON_CreateObject();
+                cJSON_AddNumberToObject(hour_obj, "time_epoch", (double)hour.time_epoch);
+                cJSON_AddStringToObject(hour_obj, "time", hour.time);
+                cJSON_AddNumberToObject(hour_obj, "temp_c", hour.temp_c);
+                cJSON_AddNumberToObject(hour_obj, "temp_f", hour.temp_f);
+                cJSON_AddNumberToObject(hour_obj, "is_day", hour.is_day);
+                add_condition(hour_obj, &hour.condition);
+                cJSON_AddNumberToObject(hour_obj, "wind_mph", hour.wind_mph);
+                cJSON_AddNumberToObject(hour_obj, "wind_kph", hour.wind_kph);
+                cJSON_AddNumberToObject(hour_obj, "wind_degree", hour.wind_degree);
+                cJSON_AddStringToObject(hour_obj, "wind_dir", hour.wind_dir);
+                cJSON_AddNumberToObject(hour_obj, "pressure_mb", hour.pressure_mb);
+                cJSON_AddNumberToObject(hour_obj, "pressure_in", hour.pressure_in);
+                cJSON_AddNumberToObject(hour_obj, "precip_mm", hour.precip_mm);
+                cJSON_AddNumberToObject(hour_obj, "precip_in", hour.precip_in);
+                cJSON_AddNumberToObject(hour_obj, "humidity", hour.humidity);
+                cJSON_AddNumberToObject(hour_obj, "cloud", hour.cloud);
+                cJSON_AddNumberToObject(hour_obj, "feelslike_c", hour.feelslike_c);
+                cJSON_AddNumberToObject(hour_obj, "feelslike_f", hour.feelslike_f);
+                cJSON_AddNumberToObject(hour_obj, "windchill_c", hour.windchill_c);
+                cJSON_AddNumberToObject(hour_obj, "windchill_f", hour.windchill_f);
+                cJSON_AddNumberToObject(hour_obj, "heatindex_c", hour.heatindex_c);
+                cJSON_AddNumberToObject(hour_obj, "heatindex_f", hour.heatindex_f);
+                cJSON_AddNumberToObject(hour_obj, "dewpoint_c", hour.dewpoint_c);
+                cJSON_AddNumberToObject(hour_obj, "dewpoint_f", hour.dewpoint_f);
+                cJSON_AddNumberToObject(hour_obj, "will_it_rain", hour.will_it_rain);
+                cJSON_AddNumberToObject(hour_obj, "chance_of_rain", hour.chance_of_rain);
+                cJSON_AddNumberToObject(hour_obj, "will_it_snow", hour.will_it_snow);
+                cJSON_AddNumberToObject(hour_obj, "chance_of_snow", hour.chance_of_snow);
+                cJSON_AddNumberToObject(hour_obj, "vis_km", hour.vis_km);
+                cJSON_AddNumberToObject(hour_obj, "vis_miles", hour.vis_miles);
+                cJSON_AddNumberToObject(hour_obj, "gust_mph", hour.gust_mph);
+                cJSON_AddNumberToObject(hour_obj, "gust_kph", hour.gust_kph);
+                cJSON_AddNumberToObject(hour_obj, "uv", hour.uv);
+                cJSON_AddItemToArray(hour_array, hour_obj);
+            }
+            cJSON_AddItemToObject(day_obj, "hour", hour_array);
+        }
+        
+        cJSON_AddItemToArray(forecastday_array, day_obj);
+    }
+    
+    cJSON_AddItemToObject(forecast_obj, "forecastday", forecastday_array);
+    cJSON_AddItemToObject(json, "forecast", forecast_obj);
+    
+    return json;
+}
@@ -0,0 +1,38 @@
+#ifndef CJSON_BASELINE_H
+#define CJSON_BASELINE_H
+
+#include <cjson/cJSON.h>
+#include "weather_types.h"
+
+/**
+ * Parse a current.json body with the cJSON DOM baseline
+ * @param body NUL-terminated JSON body
+ * @param response Filled with the parsed data
+ * @return 0 on success, -1 on error
+ */
+int baseline_parse_current(const char *body, weather_response_t *response);
+
+/**
+ * Parse a forecast.json body with the cJSON DOM baseline
+ * @param body NUL-terminated JSON body
+ * @param response Filled with the parsed data (caller frees the arrays)
+ * @return 0 on success, -1 on error
+ */
+int baseline_parse_forecast(const char *body, forecast_response_t *response);
+
+/**
+ * Build a /current response with the cJSON tree baseline
+ * @param response Current weather
+ * @return JSON tree (caller deletes)
+ */
+cJSON *baseline_current_to_json(const weather_response_t *response);
+
+/**
+ * Build a /forecast response with the cJSON tree baseline
+ * @param result Forecast result with its hours loaded
+ * @param include_hourly 1 to include each day's hours
+ * @return JSON tree (caller deletes)
+ */
+cJSON *baseline_forecast_to_json(const weather_result_t *result, int include_hourly);
+
+#endif // CJSON_BASELINE_H
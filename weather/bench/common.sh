@@ -0,0 +1,74 @@
+#!/bin/bash
+
+# Shared harness for the service benchmarks
+# Sourced by the bench_*.sh scripts: checks the binaries are built, stops the
+# mock upstream and the service on exit, and starts them and reads /health
+# counters for the experiment loop each script keeps.
+#
+# Usage: source "$(dirname "$0")/common.sh"
+
+SERVER_PORT=18080
+MOCK_PORT=19090
+
+BUILD_DIR="$(dirname "${BASH_SOURCE[0]}")/../build"
+SERVICE="$BUILD_DIR/weather_service"
+MOCK="$BUILD_DIR/bench/mock_upstream"
+LOAD="$BUILD_DIR/bench/http_load"
+
+for bin in "$SERVICE" "$MOCK" "$LOAD"; do
+    if [ ! -x "$bin" ]; then
+        echo "Error: $bin not found. Build with: make all bench-tools"
+        exit 1
+    fi
+done
+
+cleanup() {
+    [ -n "$SERVER_PID" ] && kill "$SERVER_PID" 2>/dev/null
+    [ -n "$MOCK_PID" ] && kill "$MOCK_PID" 2>/dev/null
+    wait 2>/dev/null
+}
+trap cleanup EXIT
+
+wait_for_health() {
+    for _ in $(seq 1 50); do
+        if curl -s "http://127.0.0.1:$SERVER_PORT/health" > /dev/null 2>&1; then
+            return 0
+        fi
+        sleep 0.1
+    done
+    echo "Error: weather_service did not become healthy"
+    return 1
+}
+
+# start_mock [MOCK FLAGS...]
+start_mock() {
+    "$MOCK" -p "$MOCK_PORT" "$@" > /dev/null &
+    MOCK_PID=$!
+    sleep 0.3
+}
+
+stop_mock() {
+    kill "$MOCK_PID" 2>/dev/null
+    wait "$MOCK_PID" 2>/dev/null
+    MOCK_PID=""
+}
+
+# start_service [SERVICE FLAGS...]: server mode against the mock, then wait until healthy
+start_service() {
+    "$SERVICE" -s -p "$SERVER_PORT" -k bench "$@" \
+        -u "http://127.0.0.1:$MOCK_PORT/v1" > /dev/null 2>&1 &
+    SERVER_PID=$!
+    wait_for_health
+}
+
+stop_service() {
+    kill "$SERVER_PID" 2>/dev/null
+    wait "$SERVER_PID" 2>/dev/null
+    SERVER_PID=""
+}
+
+# health_stat BLOCK FIELD: value of a field in one block of /health ("upstream", "json", ...)
+health_stat() {
+    curl -s "http://127.0.0.1:$SERVER_PORT/health" | tr -d ' \t\n' |
+        sed -n "s/.*\"$1\":{[^}]*\"$2\":\"*\([a-z_.0-9]*\).*/\1/p"
+}
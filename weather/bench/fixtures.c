@@ -0,0 +1,312 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <time.h>
+#include "fixtures.h"
+
+/**
+ * Growable text buffer used while building payloads
+ */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} fixture_buf_t;
+
+static void buf_printf(fixture_buf_t *buf, const char *fmt, ...) {
+    if (buf->failed) return;
+
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+        va_end(ap);
+
+        if (n < 0) {
+            buf->failed = 1;
+            return;
+        }
+        if ((size_t)n < buf->cap - buf->len) {
+            buf->len += (size_t)n;
+            return;
+        }
+
+        size_t new_cap = buf->cap * 2 + (size_t)n + 1;
+        char *ptr = realloc(buf->data, new_cap);
+        if (!ptr) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = ptr;
+        buf->cap = new_cap;
+    }
+}
+
+/**
+ * Append a JSON string literal, escaping quotes, backslashes and control characters
+ */
+static void buf_string(fixture_buf_t *buf, const char *text) {
+    buf_printf(buf, "\"");
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            buf_printf(buf, "\\%c", *p);
+        } else if (*p < 0x20) {
+            buf_printf(buf, "\\u%04x", *p);
+        } else {
+            buf_printf(buf, "%c", *p);
+        }
+    }
+    buf_printf(buf, "\"");
+}
+
+static int buf_init(fixture_buf_t *buf, size_t cap) {
+    buf->data = malloc(cap);
+    buf->len = 0;
+    buf->cap = cap;
+    buf->failed = (buf->data == NULL);
+    if (buf->data) buf->data[0] = '\0';
+    return buf->failed ? -1 : 0;
+}
+
+static char *buf_finish(fixture_buf_t *buf, size_t *length) {
+    if (buf->failed) {
+        free(buf->data);
+        return NULL;
+    }
+    if (length) *length = buf->len;
+    return buf->data;
+}
+
+/**
+ * FNV-1a hash used to derive stable per-location values
+ */
+static unsigned long fixture_hash(const char *text) {
+    unsigned long h = 2166136261UL;
+    for (const unsigned char *p = (const unsigned char *)text; *p; p++) {
+        h ^= (unsigned long)tolower(*p);
+        h *= 16777619UL;
+    }
+    return h & 0xffffffffUL;
+}
+
+static const struct {
+    int code;
+    const char *text;
+    int icon;
+} fixture_conditions[] = {
+    {1000, "Sunny", 113},
+    {1003, "Partly cloudy", 116},
+    {1006, "Cloudy", 119},
+    {1009, "Overcast", 122},
+    {1063, "Patchy rain nearby", 176},
+    {1183, "Light rain", 296},
+    {1195, "Heavy rain", 308},
+    {1213, "Light snow", 326},
+};
+
+static const char *fixture_wind_dirs[] = {
+    "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE",
+    "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW"
+};
+
+static void emit_condition(fixture_buf_t *buf, unsigned long seed, int is_day) {
+    size_t n = sizeof(fixture_conditions) / sizeof(fixture_conditions[0]);
+    size_t idx = seed % n;
+    buf_printf(buf, "\"condition\":{\"text\":");
+    buf_string(buf, fixture_conditions[idx].text);
+    buf_printf(buf, ",\"icon\":\"//cdn.weatherapi.com/weather/64x64/%s/%d.png\",\"code\":%d}",
+               is_day ? "day" : "night", fixture_conditions[idx].icon, fixture_conditions[idx].code);
+}
+
+static double c_to_f(double c) {
+    return c * 9.0 / 5.0 + 32.0;
+}
+
+/**
+ * Derive location name and coordinates from the query the way WeatherAPI echoes them
+ */
+static void describe_location(const char *location, char *name, size_t name_size, double *lat, double *lon) {
+    double qlat, qlon;
+
+    if (sscanf(location, "%lf,%lf", &qlat, &qlon) == 2) {
+        snprintf(name, name_size, "Point %.2f %.2f", qlat, qlon);
+        *lat = ((long)(qlat * 100.0)) / 100.0;
+        *lon = ((long)(qlon * 100.0)) / 100.0;
+        return;
+    }
+
+    size_t i = 0;
+    while (location[i] && location[i] != ',' && i + 1 < name_size) {
+        name[i] = location[i];
+        i++;
+    }
+    while (i > 0 && isspace((unsigned char)name[i - 1])) i--;
+    name[i] = '\0';
+    if (name[0]) name[0] = (char)toupper((unsigned char)name[0]);
+
+    // Like a geocoder, resolve "Paros" and "paros, greece" to the same place
+    unsigned long h = fixture_hash(name);
+    *lat = (double)(h % 18000) / 100.0 - 90.0;
+    *lon = (double)((h / 18000) % 36000) / 100.0 - 180.0;
+}
+
+static void emit_location(fixture_buf_t *buf, const char *location, time_t now) {
+    char name[128];
+    double lat, lon;
+    describe_location(location, name, sizeof(name), &lat, &lon);
+
+    struct tm tm_now;
+    gmtime_r(&now, &tm_now);
+    char localtime_str[32];
+    strftime(localtime_str, sizeof(localtime_str), "%Y-%m-%d %H:%M", &tm_now);
+
+    buf_printf(buf, "\"location\":{\"name\":");
+    buf_string(buf, name);
+    buf_printf(buf, ",\"region\":\"Mock Region\",\"country\":\"Mockland\",\"lat\":%.4g,\"lon\":%.4g,"
+               "\"tz_id\":\"Etc/UTC\",\"localtime_epoch\":%ld,\"localtime\":\"%s\"}",
+               lat, lon, (long)now, localtime_str);
+}
+
+static void emit_current(fixture_buf_t *buf, unsigned long seed, time_t now) {
+    time_t updated = now - (now % 900);
+    struct tm tm_upd;
+    gmtime_r(&updated, &tm_upd);
+    char updated_str[32];
+    strftime(updated_str, sizeof(updated_str), "%Y-%m-%d %H:%M", &tm_upd);
+
+    double temp = (double)(seed % 350) / 10.0;
+    double wind = (double)(seed % 400) / 10.0;
+    int is_day = (tm_upd.tm_hour >= 6 && tm_upd.tm_hour < 19);
+
+    buf_printf(buf, "\"current\":{\"last_updated_epoch\":%ld,\"last_updated\":\"%s\","
+               "\"temp_c\":%.1f,\"temp_f\":%.1f,\"is_day\":%d,",
+               (long)updated, updated_str, temp, c_to_f(temp), is_day);
+    emit_condition(buf, seed, is_day);
+    buf_printf(buf, ",\"wind_mph\":%.1f,\"wind_kph\":%.1f,\"wind_degree\":%lu,\"wind_dir\":\"%s\","
+               "\"pressure_mb\":%.1f,\"pressure_in\":%.2f,\"precip_mm\":%.2f,\"precip_in\":%.2f,"
+               "\"humidity\":%lu,\"cloud\":%lu,\"feelslike_c\":%.1f,\"feelslike_f\":%.1f,"
+               "\"windchill_c\":%.1f,\"windchill_f\":%.1f,\"heatindex_c\":%.1f,\"heatindex_f\":%.1f,"
+               "\"dewpoint_c\":%.1f,\"dewpoint_f\":%.1f,\"vis_km\":%.1f,\"vis_miles\":%.1f,\"uv\":%.1f,"
+               "\"gust_mph\":%.1f,\"gust_kph\":%.1f,\"short_rad\":%.2f,\"diff_rad\":%.2f,\"dni\":%.2f,\"gti\":%.2f}",
+               wind * 0.621, wind, seed % 360, fixture_wind_dirs[(seed % 360) / 23 % 16],
+               1000.0 + (double)(seed % 300) / 10.0, 29.5 + (double)(seed % 100) / 100.0,
+               (double)(seed % 50) / 10.0, (double)(seed % 50) / 254.0,
+               seed % 100, seed % 100, temp - 1.0, c_to_f(temp - 1.0),
+               temp - 2.0, c_to_f(temp - 2.0), temp + 0.5, c_to_f(temp + 0.5),
+               temp - 6.0, c_to_f(temp - 6.0), 10.0, 6.0, (double)(seed % 11),
+               wind * 0.9, wind * 1.45, 412.5, 120.25, 510.0, 330.75);
+}
+
+static void emit_hour(fixture_buf_t *buf, unsigned long seed, time_t epoch) {
+    struct tm tm_hour;
+    gmtime_r(&epoch, &tm_hour);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", &tm_hour);
+
+    unsigned long s = seed ^ ((unsigned long)epoch * 2654435761UL);
+    double temp = (double)(s % 350) / 10.0 - 2.0;
+    double wind = (double)(s % 400) / 10.0;
+    int is_day = (tm_hour.tm_hour >= 6 && tm_hour.tm_hour < 19);
+    int rain = (int)(s % 101);
+    int snow = temp < 1.0 ? (int)(s % 60) : 0;
+
+    buf_printf(buf, "{\"time_epoch\":%ld,\"time\":\"%s\",\"temp_c\":%.1f,\"temp_f\":%.1f,\"is_day\":%d,",
+               (long)epoch, time_str, temp, c_to_f(temp), is_day);
+    emit_condition(buf, s, is_day);
+    buf_printf(buf, ",\"wind_mph\":%.1f,\"wind_kph\":%.1f,\"wind_degree\":%lu,\"wind_dir\":\"%s\","
+               "\"pressure_mb\":%.1f,\"pressure_in\":%.2f,\"precip_mm\":%.2f,\"precip_in\":%.2f,"
+               "\"snow_cm\":%.2f,\"humidity\":%lu,\"cloud\":%lu,\"feelslike_c\":%.1f,\"feelslike_f\":%.1f,"
+               "\"windchill_c\":%.1f,\"windchill_f\":%.1f,\"heatindex_c\":%.1f,\"heatindex_f\":%.1f,"
+               "\"dewpoint_c\":%.1f,\"dewpoint_f\":%.1f,\"will_it_rain\":%d,\"chance_of_rain\":%d,"
+               "\"will_it_snow\":%d,\"chance_of_snow\":%d,\"vis_km\":%.1f,\"vis_miles\":%.1f,"
+               "\"gust_mph\":%.1f,\"gust_kph\":%.1f,\"uv\":%.1f,\"short_rad\":%.2f,\"diff_rad\":%.2f,"
+               "\"dni\":%.2f,\"gti\":%.2f}",
+               wind * 0.621, wind, s % 360, fixture_wind_dirs[(s % 360) / 23 % 16],
+               1000.0 + (double)(s % 300) / 10.0, 29.5 + (double)(s % 100) / 100.0,
+               (double)(s % 50) / 10.0, (double)(s % 50) / 254.0, snow ? 0.3 : 0.0,
+               s % 100, s % 100, temp - 1.0, c_to_f(temp - 1.0),
+               temp - 2.0, c_to_f(temp - 2.0), temp + 0.5, c_to_f(temp + 0.5),
+               temp - 6.0, c_to_f(temp - 6.0), rain > 70, rain, snow > 30, snow,
+               10.0, 6.0, wind * 0.9, wind * 1.45, is_day ? (double)(s % 11) : 0.0,
+               is_day ? 412.5 : 0.0, is_day ? 120.25 : 0.0, is_day ? 510.0 : 0.0, is_day ? 330.75 : 0.0);
+}
+
+static void emit_forecast_day(fixture_buf_t *buf, unsigned long seed, time_t date_epoch) {
+    struct tm tm_day;
+    gmtime_r(&date_epoch, &tm_day);
+    char date_str[16];
+    strftime(date_str, sizeof(date_str), "%Y-%m-%d", &tm_day);
+
+    unsigned long s = seed ^ ((unsigned long)date_epoch * 40503UL);
+    double max_c = (double)(s % 300) / 10.0 + 5.0;
+    double min_c = max_c - 8.0;
+    double avg_c = (max_c + min_c) / 2.0;
+    int rain = (int)(s % 101);
+
+    buf_printf(buf, "{\"date\":\"%s\",\"date_epoch\":%ld,\"day\":{"
+               "\"maxtemp_c\":%.1f,\"maxtemp_f\":%.1f,\"mintemp_c\":%.1f,\"mintemp_f\":%.1f,"
+               "\"avgtemp_c\":%.1f,\"avgtemp_f\":%.1f,\"maxwind_mph\":%.1f,\"maxwind_kph\":%.1f,"
+               "\"totalprecip_mm\":%.2f,\"totalprecip_in\":%.2f,\"totalsnow_cm\":%.2f,"
+               "\"avgvis_km\":%.1f,\"avgvis_miles\":%.1f,\"avghumidity\":%lu,"
+               "\"daily_will_it_rain\":%d,\"daily_chance_of_rain\":%d,"
+               "\"daily_will_it_snow\":%d,\"daily_chance_of_snow\":%d,",
+               date_str, (long)date_epoch, max_c, c_to_f(max_c), min_c, c_to_f(min_c),
+               avg_c, c_to_f(avg_c), (double)(s % 300) / 10.0 * 0.621, (double)(s % 300) / 10.0,
+               (double)(s % 200) / 10.0, (double)(s % 200) / 254.0, min_c < 0.0 ? 1.2 : 0.0,
+               10.0, 6.0, s % 100, rain > 70, rain, min_c < 0.0, min_c < 0.0 ? 40 : 0);
+    emit_condition(buf, s, 1);
+    buf_printf(buf, ",\"uv\":%.1f},\"astro\":{\"sunrise\":\"06:%02lu AM\",\"sunset\":\"07:%02lu PM\","
+               "\"moonrise\":\"09:%02lu PM\",\"moonset\":\"11:%02lu AM\",\"moon_phase\":\"Waxing Gibbous\","
+               "\"moon_illumination\":%lu,\"is_moon_up\":0,\"is_sun_up\":0},\"hour\":[",
+               (double)(s % 11), s % 60, (s / 7) % 60, (s / 11) % 60, (s / 13) % 60, s % 101);
+
+    for (int h = 0; h < 24; h++) {
+        if (h > 0) buf_printf(buf, ",");
+        emit_hour(buf, seed, date_epoch + h * 3600);
+    }
+    buf_printf(buf, "]}");
+}
+
+char *fixture_current_json(const char *location, size_t *length) {
+    if (!location) return NULL;
+
+    fixture_buf_t buf;
+    if (buf_init(&buf, 2048) != 0) return NULL;
+
+    time_t now = time(NULL);
+    buf_printf(&buf, "{");
+    emit_location(&buf, location, now);
+    buf_printf(&buf, ",");
+    emit_current(&buf, fixture_hash(location), now);
+    buf_printf(&buf, "}");
+
+    return buf_finish(&buf, length);
+}
+
+char *fixture_forecast_json(const char *location, int days, size_t *length) {
+    if (!location || days < 1 || days > 14) return NULL;
+
+    fixture_buf_t buf;
+    if (buf_init(&buf, 16384 * (size_t)days) != 0) return NULL;
+
+    time_t now = time(NULL);
+    time_t midnight = now - (now % 86400);
+    unsigned long seed = fixture_hash(location);
+
+    buf_printf(&buf, "{");
+    emit_location(&buf, location, now);
+    buf_printf(&buf, ",");
+    emit_current(&buf, seed, now);
+    buf_printf(&buf, ",\"forecast\":{\"forecastday\":[");
+    for (int d = 0; d < days; d++) {
+        if (d > 0) buf_printf(&buf, ",");
+        emit_forecast_day(&buf, seed, midnight + (time_t)d * 86400);
+    }
+    buf_printf(&buf, "]}}");
+
+    return buf_finish(&buf, length);
+}
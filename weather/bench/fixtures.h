@@ -0,0 +1,23 @@
+#ifndef FIXTURES_H
+#define FIXTURES_H
+
+#include <stddef.h>
+
+/**
+ * Build a WeatherAPI.com-shaped current.json payload for a location
+ * @param location Location query the payload should describe
+ * @param length Optional pointer to store the payload length
+ * @return Newly allocated JSON string (caller must free), or NULL on error
+ */
+char *fixture_current_json(const char *location, size_t *length);
+
+/**
+ * Build a WeatherAPI.com-shaped forecast.json payload for a location
+ * @param location Location query the payload should describe
+ * @param days Number of forecast days (1-14)
+ * @param length Optional pointer to store the payload length
+ * @return Newly allocated JSON string (caller must free), or NULL on error
+ */
+char *fixture_forecast_json(const char *location, int days, size_t *length);
+
+#endif // FIXTURES_H
@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <curl/curl.h>
+
+/*
+ * Closed-loop HTTP load generator for the weather service benchmarks.
+ * Each worker keeps one keep-alive connection and issues requests back to
+ * back, cycling through the URLs given on the command line.
+ */
+
+typedef struct {
+    char **urls;
+    int url_count;
+    int requests;           // Requests this worker should issue
+    int offset;             // Starting index into urls
+    double *latencies_ms;   // Per-request latency samples
+    int completed;
+    int failed;
+    size_t bytes;
+} load_worker_t;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static size_t sink_callback(void *contents, size_t size, size_t nmemb, void *userdata) {
+    (void)contents;
+    size_t realsize = size * nmemb;
+    *(size_t *)userdata += realsize;
+    return realsize;
+}
+
+static void *load_worker(void *arg) {
+    load_worker_t *w = arg;
+    CURL *curl = curl_easy_init();
+    if (!curl) return NULL;
+
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, sink_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &w->bytes);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 60L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Weather-Bench/1.0");
+
+    for (int i = 0; i < w->requests; i++) {
+        const char *url = w->urls[(w->offset + i) % w->url_count];
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+
+        double start = now_ms();
+        CURLcode res = curl_easy_perform(curl);
+        double elapsed = now_ms() - start;
+
+        long status = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        if (res != CURLE_OK || status != 200) {
+            w->failed++;
+        }
+        w->latencies_ms[w->completed++] = elapsed;
+    }
+
+    curl_easy_cleanup(curl);
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS] <url> [url...]\n", program_name);
+    printf("\n");
+    printf("OPTIONS:\n");
+    printf("  -c <N>   Concurrent connections (default: 16)\n");
+    printf("  -n <N>   Total requests (default: 2000)\n");
+    printf("  -l <STR> Label printed in the result line\n");
+    printf("  -h       Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    int concurrency = 16;
+    int total = 2000;
+    const char *label = "load";
+    int c;
+
+    while ((c = getopt(argc, argv, "c:n:l:h")) != -1) {
+        switch (c) {
+            case 'c':
+                concurrency = atoi(optarg);
+                break;
+            case 'n':
+                total = atoi(optarg);
+                break;
+            case 'l':
+                label = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc || concurrency < 1 || total < concurrency) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    load_worker_t *workers = calloc((size_t)concurrency, sizeof(load_worker_t));
+    pthread_t *threads = calloc((size_t)concurrency, sizeof(pthread_t));
+    double *samples = calloc((size_t)total, sizeof(double));
+    if (!workers || !threads || !samples) {
+        fprintf(stderr, "Out of memory\n");
+        return EXIT_FAILURE;
+    }
+
+    int assigned = 0;
+    for (int i = 0; i < concurrency; i++) {
+        load_worker_t *w = &workers[i];
+        w->urls = &argv[optind];
+        w->url_count = argc - optind;
+        w->requests = total / concurrency + (i < total % concurrency ? 1 : 0);
+        w->offset = i;
+        w->latencies_ms = samples + assigned;
+        assigned += w->requests;
+    }
+
+    double start = now_ms();
+    for (int i = 0; i < concurrency; i++) {
+        pthread_create(&threads[i], NULL, load_worker, &workers[i]);
+    }
+    for (int i = 0; i < concurrency; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_ms() - start;
+
+    int completed = 0, failed = 0;
+    size_t bytes = 0;
+    for (int i = 0; i < concurrency; i++) {
+        completed += workers[i].completed;
+        failed += workers[i].failed;
+        bytes += workers[i].bytes;
+    }
+
+    /* Workers fill disjoint slices, so the samples are contiguous */
+    qsort(samples, (size_t)completed, sizeof(double), compare_double);
+    double p50 = samples[completed / 2];
+    double p99 = samples[(int)((completed - 1) * 0.99)];
+    double p999 = samples[(int)((completed - 1) * 0.999)];
+
+    printf("%-16s requests=%d failed=%d conc=%d  %.0f req/s  p50=%.2fms p99=%.2fms p99.9=%.2fms  %.1f KB/req\n",
+           label, completed, failed, concurrency, completed / (elapsed / 1000.0),
+           p50, p99, p999, completed ? (double)bytes / completed / 1024.0 : 0.0);
+
+    free(samples);
+    free(threads);
+    free(workers);
+    curl_global_cleanup();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
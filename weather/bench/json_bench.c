@@ -0,0 +1,253 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cjson/cJSON.h>
+#include "fixtures.h"
+#include "cjson_baseline.h"
+#include "json_handwritten.h"
+#include "weather_parser.h"
+#include "weather_arena.h"
+#include "weather_json.h"
+#include "alloc_count.h"
+
+/*
+ * Response serialization microbenchmark: the cJSON tree builders the service
+ * used to call (build the tree, print it, delete it) against the streaming
+ * writer, for a /current body and 3- and 14-day forecasts with and without
+ * hourly data. Compact writer output must be byte-identical to
+ * cJSON_PrintUnformatted() and pretty output to cJSON_Print(); any
+ * difference fails the run.
+ *
+ * The hand column times the writer driven by one hand-written call per
+ * member (json_handwritten.c), the table-driven writer's baseline; both must
+ * write the same bytes.
+ *
+ * The allocs columns count heap allocations per response with cJSON on the
+ * plain heap, i.e. without the per-request arenas of weather_json_init().
+ *
+ * A second table writes 14-day hourly forecasts with ?fields= projections
+ * (what the dashboard's forecast chart reads, and single series) against the
+ * full body; projected output must parse as JSON.
+ */
+
+#define TARGET_BYTES (256UL * 1024 * 1024)    // Write about this much compact output per case
+
+typedef struct {
+    const char *name;
+    int days;                                 // 0 for a /current body
+    int include_hourly;
+} bench_case_t;
+
+typedef struct {
+    const char *name;
+    const char *fields;                       // ?fields= value
+} projection_case_t;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int load_forecast(const char *location, int days, weather_result_t *result) {
+    size_t length = 0;
+    char *body = fixture_forecast_json(location, days, &length);
+    if (!body) return -1;
+
+    memset(result, 0, sizeof(*result));
+    result->is_forecast = 1;
+    weather_parser_t *parser = weather_parser_create(result, 0);
+    int status = parser ? weather_parser_feed(parser, body, length) : -1;
+    if (status == 0) status = weather_parser_finish(parser);
+    weather_parser_free(parser);
+    free(body);
+    return status;
+}
+
+static int load_current(const char *location, weather_result_t *result) {
+    char *body = fixture_current_json(location, NULL);
+    if (!body) return -1;
+
+    memset(result, 0, sizeof(*result));
+    int status = baseline_parse_current(body, &result->current);
+    free(body);
+    return status;
+}
+
+static char *cjson_serialize(const bench_case_t *c, const weather_result_t *result, int pretty) {
+    cJSON *json = c->days ? baseline_forecast_to_json(result, c->include_hourly)
+                          : baseline_current_to_json(&result->current);
+    char *text = pretty ? cJSON_Print(json) : cJSON_PrintUnformatted(json);
+    cJSON_Delete(json);
+    return text;
+}
+
+static char *writer_project(const bench_case_t *c, const weather_result_t *result, int pretty,
+                            const weather_fields_t *fields, size_t *length) {
+    weather_json_writer_t writer;
+    weather_json_writer_init(&writer, pretty, WEATHER_JSON_SHORTEST);
+    weather_json_writer_project(&writer, fields);
+    if (c->days) {
+        weather_json_write_forecast(&writer, result, c->include_hourly);
+    } else {
+        weather_json_write_current(&writer, &result->current);
+    }
+    return weather_json_writer_finish(&writer, length);
+}
+
+static char *handwritten_serialize(const bench_case_t *c, const weather_result_t *result, size_t *length) {
+    weather_json_writer_t writer;
+    weather_json_writer_init(&writer, 0, WEATHER_JSON_SHORTEST);
+    if (c->days) {
+        handwritten_write_forecast(&writer, result, c->include_hourly);
+    } else {
+        handwritten_write_current(&writer, &result->current);
+    }
+    return weather_json_writer_finish(&writer, length);
+}
+
+static char *writer_serialize(const bench_case_t *c, const weather_result_t *result, int pretty, size_t *length) {
+    return writer_project(c, result, pretty, NULL, length);
+}
+
+int main(int argc, char *argv[]) {
+    const char *location = argc > 1 ? argv[1] : "London";
+    static const bench_case_t cases[] = {
+        {"current", 0, 0},
+        {"3d", 3, 0},
+        {"14d", 14, 0},
+        {"3d+hourly", 3, 1},
+        {"14d+hourly", 14, 1},
+    };
+    int failed = 0;
+    int counting = alloc_count() >= 0;
+
+    printf("%-11s %8s %6s %12s %12s %12s %12s %12s %8s %13s %13s\n",
+           "case", "bytes", "iters", "print us/op", "unfmt us/op", "writer us/op", "hand us/op", "pretty us/op",
+           "writer x", "cjson allocs", "writer allocs");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const bench_case_t *c = &cases[i];
+        weather_result_t result;
+        if ((c->days ? load_forecast(location, c->days, &result) : load_current(location, &result)) != 0) {
+            fprintf(stderr, "Failed to load the %s payload\n", c->name);
+            return 1;
+        }
+
+        // The writer must reproduce cJSON's output byte for byte, in both layouts
+        size_t length = 0, pretty_length = 0;
+        char *unformatted = cjson_serialize(c, &result, 0);
+        char *printed = cjson_serialize(c, &result, 1);
+        char *compact = writer_serialize(c, &result, 0, &length);
+        char *pretty = writer_serialize(c, &result, 1, &pretty_length);
+        char *handwritten = handwritten_serialize(c, &result, &length);
+        if (!unformatted || !printed || !compact || !pretty || !handwritten) {
+            fprintf(stderr, "Failed to serialize the %s payload\n", c->name);
+            return 1;
+        }
+        if (strcmp(compact, unformatted) != 0 || strcmp(pretty, printed) != 0) {
+            fprintf(stderr, "Writer output differs from cJSON for the %s payload\n", c->name);
+            failed = 1;
+        }
+        if (strcmp(compact, handwritten) != 0) {
+            fprintf(stderr, "Writer output differs from the hand-written writer for the %s payload\n", c->name);
+            failed = 1;
+        }
+        cJSON_free(unformatted);
+        cJSON_free(printed);
+        free(compact);
+        free(pretty);
+        free(handwritten);
+
+        int iterations = (int)(TARGET_BYTES / length);
+        if (iterations < 20) iterations = 20;
+
+        double start = now_sec();
+        for (int n = 0; n < iterations; n++) cJSON_free(cjson_serialize(c, &result, 1));
+        double print_sec = now_sec() - start;
+
+        long before = alloc_count();
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) cJSON_free(cjson_serialize(c, &result, 0));
+        double unformatted_sec = now_sec() - start;
+        long cjson_allocs = alloc_count() - before;
+
+        before = alloc_count();
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) free(writer_serialize(c, &result, 0, &length));
+        double writer_sec = now_sec() - start;
+        long writer_allocs = alloc_count() - before;
+
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) free(handwritten_serialize(c, &result, &length));
+        double handwritten_sec = now_sec() - start;
+
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) free(writer_serialize(c, &result, 1, &pretty_length));
+        double pretty_sec = now_sec() - start;
+
+        printf("%-11s %8zu %6d %12.1f %12.1f %12.1f %12.1f %12.1f %7.1fx", c->name, length, iterations,
+               print_sec * 1e6 / iterations, unformatted_sec * 1e6 / iterations, writer_sec * 1e6 / iterations,
+               handwritten_sec * 1e6 / iterations, pretty_sec * 1e6 / iterations, unformatted_sec / writer_sec);
+        if (counting) {
+            printf(" %13.0f %13.1f\n", (double)cjson_allocs / iterations, (double)writer_allocs / iterations);
+        } else {
+            printf(" %13s %13s\n", "-", "-");
+        }
+
+        if (c->days) weather_arena_free(weather_arena_of(result.forecast.forecast));
+    }
+
+    static const projection_case_t projections[] = {
+        {"chart", "location.name,forecast.date,forecast.day.maxtemp_c,forecast.day.mintemp_c,"
+                  "forecast.day.avgtemp_c,forecast.hour.time,forecast.hour.temp_c,forecast.hour.wind_kph"},
+        {"hour.temp_c", "forecast.hour.temp_c"},
+        {"day", "forecast.date,forecast.day"},
+    };
+    static const bench_case_t hourly = {"14d+hourly", 14, 1};
+    weather_result_t result;
+    if (load_forecast(location, hourly.days, &result) != 0) {
+        fprintf(stderr, "Failed to load the %s payload\n", hourly.name);
+        return 1;
+    }
+
+    size_t full_length = 0;
+    free(writer_serialize(&hourly, &result, 0, &full_length));
+    int iterations = (int)(TARGET_BYTES / full_length);
+    if (iterations < 20) iterations = 20;
+    double start = now_sec();
+    for (int n = 0; n < iterations; n++) free(writer_serialize(&hourly, &result, 0, &full_length));
+    double full_sec = now_sec() - start;
+
+    printf("\n%-11s %8s %8s %12s %8s\n", "fields", "bytes", "smaller", "writer us/op", "faster");
+    printf("%-11s %8zu %7.1fx %12.1f %7.1fx\n", "(all)", full_length, 1.0, full_sec * 1e6 / iterations, 1.0);
+    for (size_t i = 0; i < sizeof(projections) / sizeof(projections[0]); i++) {
+        weather_fields_t fields;
+        if (weather_fields_parse(projections[i].fields, &fields, NULL, 0) != 0) {
+            fprintf(stderr, "Invalid projection %s\n", projections[i].fields);
+            return 1;
+        }
+
+        size_t length = 0;
+        char *projected = writer_project(&hourly, &result, 0, &fields, &length);
+        cJSON *parsed = projected ? cJSON_Parse(projected) : NULL;
+        if (!parsed) {
+            fprintf(stderr, "Projection %s is not valid JSON\n", projections[i].name);
+            failed = 1;
+        }
+        cJSON_Delete(parsed);
+        free(projected);
+
+        start = now_sec();
+        for (int n = 0; n < iterations; n++) free(writer_project(&hourly, &result, 0, &fields, &length));
+        double projected_sec = now_sec() - start;
+
+        printf("%-11s %8zu %7.1fx %12.1f %7.1fx\n", projections[i].name, length, (double)full_length / length,
+               projected_sec * 1e6 / iterations, full_sec / projected_sec);
+    }
+    weather_arena_free(weather_arena_of(result.forecast.forecast));
+
+    return failed;
+}
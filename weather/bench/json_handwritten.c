@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include "json_handwritten.h"
+#include "weather_compact.h"
+
+/*
+ * The streaming writer as it was before the member tables (weather_fields.h):
+ * one weather_json_* call per member, with the members the tables added
+ * written in the same order, so its output is byte-identical to the
+ * table-driven writer's. Kept as the baseline the table-driven loops must
+ * not fall behind.
+ */
+
+static void write_location(weather_json_writer_t *writer, const location_t *location) {
+    weather_json_begin_object(writer, "location");
+    weather_json_string(writer, "name", location->name);
+    weather_json_string(writer, "region", location->region);
+    weather_json_string(writer, "country", location->country);
+    weather_json_number(writer, "lat", location->lat);
+    weather_json_number(writer, "lon", location->lon);
+    weather_json_string(writer, "tz_id", location->tz_id);
+    weather_json_int(writer, "localtime_epoch", location->localtime_epoch);
+    weather_json_string(writer, "localtime", location->localtime);
+    weather_json_end_object(writer);
+}
+
+static void write_condition(weather_json_writer_t *writer, const weather_condition_t *condition) {
+    weather_json_begin_object(writer, "condition");
+    weather_json_string(writer, "text", condition->text);
+    weather_json_string(writer, "icon", condition->icon);
+    weather_json_int(writer, "code", condition->code);
+    weather_json_end_object(writer);
+}
+
+void handwritten_write_current(weather_json_writer_t *writer, const weather_response_t *response) {
+    const current_weather_t *current = &response->current;
+
+    weather_json_begin_object(writer, NULL);
+    write_location(writer, &response->location);
+
+    weather_json_begin_object(writer, "current");
+    weather_json_int(writer, "last_updated_epoch", current->last_updated_epoch);
+    weather_json_string(writer, "last_updated", current->last_updated);
+    weather_json_number(writer, "temp_c", current->temp_c);
+    weather_json_number(writer, "temp_f", current->temp_f);
+    weather_json_int(writer, "is_day", current->is_day);
+    write_condition(writer, &current->condition);
+    weather_json_number(writer, "wind_mph", current->wind_mph);
+    weather_json_number(writer, "wind_kph", current->wind_kph);
+    weather_json_int(writer, "wind_degree", current->wind_degree);
+    weather_json_string(writer, "wind_dir", current->wind_dir);
+    weather_json_number(writer, "pressure_mb", current->pressure_mb);
+    weather_json_number(writer, "pressure_in", current->pressure_in);
+    weather_json_number(writer, "precip_mm", current->precip_mm);
+    weather_json_number(writer, "precip_in", current->precip_in);
+    weather_json_int(writer, "humidity", current->humidity);
+    weather_json_int(writer, "cloud", current->cloud);
+    weather_json_number(writer, "feelslike_c", current->feelslike_c);
+    weather_json_number(writer, "feelslike_f", current->feelslike_f);
+    weather_json_number(writer, "windchill_c", current->windchill_c);
+    weather_json_number(writer, "windchill_f", current->windchill_f);
+    weather_json_number(writer, "heatindex_c", current->heatindex_c);
+    weather_json_number(writer, "heatindex_f", current->heatindex_f);
+    weather_json_number(writer, "dewpoint_c", current->dewpoint_c);
+    weather_json_number(writer, "dewpoint_f", current->dewpoint_f);
+    weather_json_number(writer, "vis_km", current->vis_km);
+    weather_json_number(writer, "vis_miles", current->vis_miles);
+    weather_json_number(writer, "uv", current->uv);
+    weather_json_number(writer, "gust_mph", current->gust_mph);
+    weather_json_number(writer, "gust_kph", current->gust_kph);
+    weather_json_number(writer, "short_rad", current->short_rad);
+    weather_json_number(writer, "diff_rad", current->diff_rad);
+    weather_json_number(writer, "dni", current->dni);
+    weather_json_number(writer, "gti", current->gti);
+    weather_json_end_object(writer);
+
+    weather_json_end_object(writer);
+}
+
+static void write_hours(weather_json_writer_t *writer, const weather_hours_t *hours) {
+    weather_json_begin_array(writer, "hour");
+    for (int h = 0; h < hours->count; h++) {
+        char time_str[32];
+        weather_hours_time(hours, h, time_str, sizeof(time_str));
+
+        weather_json_begin_object(writer, NULL);
+        weather_json_int(writer, "time_epoch", hours->time_epoch[h]);
+        weather_json_string(writer, "time", time_str);
+        weather_json_fixed(writer, "temp_c", hours->temp_c[h], 1);
+        weather_json_fixed(writer, "temp_f", hours->temp_f[h], 1);
+        weather_json_int(writer, "is_day", hours->is_day[h]);
+        write_condition(writer, weather_condition_lookup(hours->condition[h]));
+        weather_json_fixed(writer, "wind_mph", hours->wind_mph[h], 1);
+        weather_json_fixed(writer, "wind_kph", hours->wind_kph[h], 1);
+        weather_json_int(writer, "wind_degree", hours->wind_degree[h]);
+        weather_json_string(writer, "wind_dir", weather_wind_dir_name(hours->wind_dir[h]));
+        weather_json_fixed(writer, "pressure_mb", hours->pressure_mb[h], 1);
+        weather_json_fixed(writer, "pressure_in", hours->pressure_in[h], 2);
+        weather_json_fixed(writer, "precip_mm", hours->precip_mm[h], 2);
+        weather_json_fixed(writer, "precip_in", hours->precip_in[h], 2);
+        weather_json_int(writer, "humidity", hours->humidity[h]);
+        weather_json_int(writer, "cloud", hours->cloud[h]);
+        weather_json_fixed(writer, "feelslike_c", hours->feelslike_c[h], 1);
+        weather_json_fixed(writer, "feelslike_f", hours->feelslike_f[h], 1);
+        weather_json_fixed(writer, "windchill_c", hours->windchill_c[h], 1);
+        weather_json_fixed(writer, "windchill_f", hours->windchill_f[h], 1);
+        weather_json_fixed(writer, "heatindex_c", hours->heatindex_c[h], 1);
+        weather_json_fixed(writer, "heatindex_f", hours->heatindex_f[h], 1);
+        weather_json_fixed(writer, "dewpoint_c", hours->dewpoint_c[h], 1);
+        weather_json_fixed(writer, "dewpoint_f", hours->dewpoint_f[h], 1);
+        weather_json_int(writer, "will_it_rain", hours->will_it_rain[h]);
+        weather_json_int(writer, "chance_of_rain", hours->chance_of_rain[h]);
+        weather_json_int(writer, "will_it_snow", hours->will_it_snow[h]);
+        weather_json_int(writer, "chance_of_snow", hours->chance_of_snow[h]);
+        weather_json_fixed(writer, "vis_km", hours->vis_km[h], 1);
+        weather_json_fixed(writer, "vis_miles", hours->vis_miles[h], 1);
+        weather_json_fixed(writer, "gust_mph", hours->gust_mph[h], 1);
+        weather_json_fixed(writer, "gust_kph", hours->gust_kph[h], 1);
+        weather_json_fixed(writer, "uv", hours->uv[h], 1);
+        weather_json_end_object(writer);
+    }
+    weather_json_end_array(writer);
+}
+
+void handwritten_write_forecast(weather_json_writer_t *writer, const weather_result_t *result, int include_hourly) {
+    weather_json_begin_object(writer, NULL);
+    write_location(writer, &result->forecast.location);
+
+    weather_json_begin_object(writer, "forecast");
+    weather_json_begin_array(writer, "forecastday");
+    for (int i = 0; i < result->forecast.forecast_days; i++) {
+        const forecast_daily_t *daily = &result->forecast.forecast[i];
+        const forecast_day_t *day = &daily->day;
+
+        weather_json_begin_object(writer, NULL);
+        weather_json_string(writer, "date", daily->date);
+        weather_json_int(writer, "date_epoch", daily->date_epoch);
+
+        weather_json_begin_object(writer, "day");
+        weather_json_number(writer, "maxtemp_c", day->maxtemp_c);
+        weather_json_number(writer, "maxtemp_f", day->maxtemp_f);
+        weather_json_number(writer, "mintemp_c", day->mintemp_c);
+        weather_json_number(writer, "mintemp_f", day->mintemp_f);
+        weather_json_number(writer, "avgtemp_c", day->avgtemp_c);
+        weather_json_number(writer, "avgtemp_f", day->avgtemp_f);
+        weather_json_number(writer, "maxwind_mph", day->maxwind_mph);
+        weather_json_number(writer, "maxwind_kph", day->maxwind_kph);
+        weather_json_number(writer, "totalprecip_mm", day->totalprecip_mm);
+        weather_json_number(writer, "totalprecip_in", day->totalprecip_in);
+        weather_json_number(writer, "totalsnow_cm", day->totalsnow_cm);
+        weather_json_number(writer, "avgvis_km", day->avgvis_km);
+        weather_json_number(writer, "avgvis_miles", day->avgvis_miles);
+        weather_json_int(writer, "avghumidity", day->avghumidity);
+        weather_json_int(writer, "daily_will_it_rain", day->daily_will_it_rain);
+        weather_json_int(writer, "daily_chance_of_rain", day->daily_chance_of_rain);
+        weather_json_int(writer, "daily_will_it_snow", day->daily_will_it_snow);
+        weather_json_int(writer, "daily_chance_of_snow", day->daily_chance_of_snow);
+        write_condition(writer, &day->condition);
+        weather_json_number(writer, "uv", day->uv);
+        weather_json_end_object(writer);
+
+        weather_json_begin_object(writer, "astro");
+        weather_json_string(writer, "sunrise", daily->astro.sunrise);
+        weather_json_string(writer, "sunset", daily->astro.sunset);
+        weather_json_string(writer, "moonrise", daily->astro.moonrise);
+        weather_json_string(writer, "moonset", daily->astro.moonset);
+        weather_json_string(writer, "moon_phase", daily->astro.moon_phase);
+        weather_json_int(writer, "moon_illumination", daily->astro.moon_illumination);
+        weather_json_end_object(writer);
+
+        const weather_hours_t *hours = include_hourly ? weather_result_hours(result, i) : NULL;
+        if (hours) {
+            write_hours(writer, hours);
+        }
+        weather_json_end_object(writer);
+    }
+    weather_json_end_array(writer);
+    weather_json_end_object(writer);
+
+    weather_json_end_object(writer);
+}
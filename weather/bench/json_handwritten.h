@@ -0,0 +1,23 @@
+#ifndef JSON_HANDWRITTEN_H
+#define JSON_HANDWRITTEN_H
+
+#include "weather_types.h"
+#include "weather_json.h"
+
+/**
+ * Write a /current body with one hand-written call per member
+ * @param writer Writer (empty)
+ * @param response Current weather
+ */
+void handwritten_write_current(weather_json_writer_t *writer, const weather_response_t *response);
+
+/**
+ * Write a /forecast body with one hand-written call per member
+ * Hours are read straight from the compact columns.
+ * @param writer Writer (empty)
+ * @param result Forecast result with its sections loaded
+ * @param include_hourly 1 to include each day's hours
+ */
+void handwritten_write_forecast(weather_json_writer_t *writer, const weather_result_t *result, int include_hourly);
+
+#endif // JSON_HANDWRITTEN_H
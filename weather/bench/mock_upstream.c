@@ -0,0 +1,466 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "fixtures.h"
+
+/*
+ * Minimal stand-in for api.weatherapi.com used by the benchmarks.
+ * Serves synthetic current.json / forecast.json payloads over plain HTTP/1.1
+ * with keep-alive, after an optional artificial upstream latency.
+ *
+ * Faults can be injected to exercise the service's upstream resilience:
+ * a share of requests answered 503, a share dropped without an answer, a
+ * share held back for a slow tail, and an outage answering 503 to
+ * everything for a while after startup.
+ *
+ * A POST with q=bulk is answered like WeatherAPI's bulk requests: one
+ * {"query": {...}} per location in the body, tagged with its custom_id.
+ *
+ * Locations starting with "zz" match nothing and get WeatherAPI's
+ * "No matching location found." error (code 1006), so the service's
+ * negative cache can be exercised.
+ */
+
+#define MOCK_MAX_HEADER 16384
+#define MOCK_MAX_BODY (1024 * 1024)
+
+static int mock_delay_ms = 0;
+static int mock_verbose = 0;
+static int mock_error_pct = 0;          // Requests answered 503
+static int mock_drop_pct = 0;           // Requests whose connection is closed unanswered
+static int mock_slow_pct = 0;           // Requests delayed by mock_slow_ms on top of mock_delay_ms
+static int mock_slow_ms = 1000;
+static int mock_outage_s = 0;           // Answer 503 to everything this long after startup
+static time_t mock_started;
+static volatile int mock_running = 1;
+
+static void mock_signal_handler(int sig) {
+    (void)sig;
+    mock_running = 0;
+}
+
+static void mock_sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static int send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int send_response(int fd, int status, const char *body, size_t body_len) {
+    char header[256];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                     "Content-Length: %zu\r\nConnection: keep-alive\r\n\r\n",
+                     status, status == 200 ? "OK" : (status == 400 ? "Bad Request" :
+                             (status == 503 ? "Service Unavailable" : "Not Found")),
+                     body_len);
+    if (send_all(fd, header, (size_t)n) != 0) return -1;
+    return send_all(fd, body, body_len);
+}
+
+/**
+ * Extract and URL-decode a query parameter from a request target
+ */
+static int query_param(const char *target, const char *name, char *dest, size_t dest_size) {
+    const char *q = strchr(target, '?');
+    size_t name_len = strlen(name);
+
+    while (q) {
+        q++;
+        if (strncmp(q, name, name_len) == 0 && q[name_len] == '=') {
+            const char *v = q + name_len + 1;
+            size_t i = 0;
+            while (*v && *v != '&' && i + 1 < dest_size) {
+                if (*v == '%' && isxdigit((unsigned char)v[1]) && isxdigit((unsigned char)v[2])) {
+                    char hex[3] = {v[1], v[2], '\0'};
+                    dest[i++] = (char)strtol(hex, NULL, 16);
+                    v += 3;
+                } else {
+                    dest[i++] = (*v == '+') ? ' ' : *v;
+                    v++;
+                }
+            }
+            dest[i] = '\0';
+            return 0;
+        }
+        q = strchr(q, '&');
+    }
+    return -1;
+}
+
+/**
+ * Whether a fault that hits pct percent of requests hits this one
+ */
+static int mock_fault(int pct, unsigned int *seed) {
+    return pct > 0 && rand_r(seed) % 100 < pct;
+}
+
+/**
+ * Copy a string member of a flat JSON object (between start and end) into dest
+ */
+static int json_member(const char *start, const char *end, const char *name, char *dest, size_t dest_size) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", name);
+    const char *p = strstr(start, pattern);
+    if (!p || p >= end) return -1;
+    p += strlen(pattern);
+    while (p < end && (*p == ' ' || *p == ':')) p++;
+    if (p >= end || *p != '"') return -1;
+    p++;
+
+    size_t i = 0;
+    while (p < end && *p != '"' && i + 1 < dest_size) {
+        if (*p == '\\' && p + 1 < end) p++;
+        dest[i++] = *p++;
+    }
+    dest[i] = '\0';
+    return 0;
+}
+
+static int append(char **out, size_t *len, size_t *cap, const char *data, size_t n) {
+    if (*len + n + 1 > *cap) {
+        size_t new_cap = (*len + n + 1) * 2;
+        char *p = realloc(*out, new_cap);
+        if (!p) return -1;
+        *out = p;
+        *cap = new_cap;
+    }
+    memcpy(*out + *len, data, n);
+    *len += n;
+    (*out)[*len] = '\0';
+    return 0;
+}
+
+/**
+ * Whether a query matches no location
+ */
+static int mock_unknown(const char *location) {
+    return strncasecmp(location, "zz", 2) == 0;
+}
+
+/**
+ * Answer a bulk request: {"locations": [{"q": "...", "custom_id": "..."}, ...]}
+ */
+static void handle_bulk(int fd, const char *request_body, int forecast, int days) {
+    size_t len = 0, cap = 0;
+    char *out = NULL;
+    int items = 0;
+    int ok = append(&out, &len, &cap, "{\"bulk\":[", 9) == 0;
+
+    const char *p = request_body ? strstr(request_body, "\"locations\"") : NULL;
+    while (ok && p && (p = strchr(p, '{')) != NULL) {
+        const char *end = strchr(p, '}');
+        if (!end) break;
+
+        char location[256], id[64], head[512];
+        if (json_member(p, end, "q", location, sizeof(location)) != 0) location[0] = '\0';
+        if (json_member(p, end, "custom_id", id, sizeof(id)) != 0) id[0] = '\0';
+        p = end + 1;
+
+        size_t body_len = 0;
+        char *body = location[0] == '\0' || mock_unknown(location) ? NULL :
+                     forecast ? fixture_forecast_json(location, days, &body_len) : fixture_current_json(location, &body_len);
+        int n = snprintf(head, sizeof(head), "%s{\"query\":{\"custom_id\":\"%s\",\"q\":\"%s\",",
+                         items++ > 0 ? "," : "", id, location);
+        ok = append(&out, &len, &cap, head, (size_t)n) == 0;
+        if (ok && body && body_len > 2) {
+            // The payload's members go inside the query object
+            ok = append(&out, &len, &cap, body + 1, body_len - 2) == 0;
+        } else if (ok) {
+            const char *err = "\"error\":{\"code\":1006,\"message\":\"No matching location found.\"}";
+            ok = append(&out, &len, &cap, err, strlen(err)) == 0;
+        }
+        ok = ok && append(&out, &len, &cap, "}}", 2) == 0;
+        free(body);
+    }
+    ok = ok && append(&out, &len, &cap, "]}", 2) == 0;
+
+    if (ok && items > 0) {
+        send_response(fd, 200, out, len);
+    } else {
+        const char *err = "{\"error\":{\"code\":1003,\"message\":\"Parameter q is missing.\"}}";
+        send_response(fd, 400, err, strlen(err));
+    }
+    free(out);
+}
+
+/**
+ * Answer one request
+ * @return 0 to keep the connection, -1 to close it unanswered
+ */
+static int handle_request(int fd, const char *target, const char *request_body, unsigned int *seed) {
+    char location[256];
+    char days_str[16];
+
+    if (mock_fault(mock_drop_pct, seed)) {
+        return -1;
+    }
+
+    mock_sleep_ms(mock_delay_ms + (mock_fault(mock_slow_pct, seed) ? mock_slow_ms : 0));
+
+    if (time(NULL) - mock_started < mock_outage_s || mock_fault(mock_error_pct, seed)) {
+        const char *err = "{\"error\":{\"code\":9999,\"message\":\"Service temporarily unavailable.\"}}";
+        send_response(fd, 503, err, strlen(err));
+        return 0;
+    }
+
+    if (query_param(target, "q", location, sizeof(location)) != 0 || location[0] == '\0') {
+        const char *err = "{\"error\":{\"code\":1003,\"message\":\"Parameter q is missing.\"}}";
+        send_response(fd, 400, err, strlen(err));
+        return 0;
+    }
+
+    char *body = NULL;
+    size_t body_len = 0;
+
+    if (mock_unknown(location)) {
+        const char *err = "{\"error\":{\"code\":1006,\"message\":\"No matching location found.\"}}";
+        send_response(fd, 400, err, strlen(err));
+        return 0;
+    }
+
+    if (strcmp(location, "bulk") == 0 && (strstr(target, "/current.json") || strstr(target, "/forecast.json"))) {
+        int days = 1;
+        if (query_param(target, "days", days_str, sizeof(days_str)) == 0) {
+            days = atoi(days_str);
+        }
+        if (days < 1) days = 1;
+        if (days > 14) days = 14;
+        handle_bulk(fd, request_body, strstr(target, "/forecast.json") != NULL, days);
+        return 0;
+    } else if (strstr(target, "/current.json")) {
+        body = fixture_current_json(location, &body_len);
+    } else if (strstr(target, "/forecast.json")) {
+        int days = 1;
+        if (query_param(target, "days", days_str, sizeof(days_str)) == 0) {
+            days = atoi(days_str);
+        }
+        if (days < 1) days = 1;
+        if (days > 14) days = 14;
+        body = fixture_forecast_json(location, days, &body_len);
+    } else {
+        const char *err = "{\"error\":{\"code\":1005,\"message\":\"API request url is invalid.\"}}";
+        send_response(fd, 404, err, strlen(err));
+        return 0;
+    }
+
+    if (!body) {
+        const char *err = "{\"error\":{\"code\":9999,\"message\":\"Internal application error.\"}}";
+        send_response(fd, 400, err, strlen(err));
+        return 0;
+    }
+
+    send_response(fd, 200, body, body_len);
+    free(body);
+    return 0;
+}
+
+static void *connection_thread(void *arg) {
+    int fd = (int)(long)arg;
+    char buf[MOCK_MAX_HEADER];
+    size_t used = 0;
+    unsigned int seed = (unsigned int)time(NULL) ^ (unsigned int)fd * 2654435761u;
+    buf[0] = '\0';
+
+    for (;;) {
+        char *end = NULL;
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            if (used + 1 >= sizeof(buf)) goto done;
+            ssize_t n = recv(fd, buf + used, sizeof(buf) - used - 1, 0);
+            if (n <= 0) {
+                if (n < 0 && errno == EINTR) continue;
+                goto done;
+            }
+            used += (size_t)n;
+            buf[used] = '\0';
+        }
+
+        size_t header_len = (size_t)(end - buf) + 4;
+        size_t content_length = 0;
+        const char *cl = strcasestr(buf, "\r\nContent-Length:");
+        if (cl && cl < end) {
+            content_length = (size_t)strtoul(cl + 17, NULL, 10);
+        }
+
+        if (content_length > MOCK_MAX_BODY) goto done;
+
+        /* Collect the request body; bulk requests carry their locations in it */
+        char *request_body = malloc(content_length + 1);
+        if (!request_body) goto done;
+        size_t buffered = used - header_len;
+        size_t have = buffered < content_length ? buffered : content_length;
+        memcpy(request_body, buf + header_len, have);
+        while (have < content_length) {
+            ssize_t n = recv(fd, request_body + have, content_length - have, 0);
+            if (n <= 0) {
+                free(request_body);
+                goto done;
+            }
+            have += (size_t)n;
+        }
+        request_body[content_length] = '\0';
+
+        char method[16], target[4096];
+        int status = -1;
+        if (sscanf(buf, "%15s %4095s", method, target) == 2) {
+            if (mock_verbose) {
+                printf("%s %s\n", method, target);
+            }
+            status = handle_request(fd, target, request_body, &seed);
+        }
+        free(request_body);
+        if (status != 0) goto done;
+
+        size_t consumed = header_len + (content_length < buffered ? content_length : buffered);
+        memmove(buf, buf + consumed, used - consumed);
+        used -= consumed;
+        buf[used] = '\0';
+    }
+
+done:
+    close(fd);
+    return NULL;
+}
+
+static void print_usage(const char *program_name) {
+    printf("Usage: %s [OPTIONS]\n", program_name);
+    printf("\n");
+    printf("Mock WeatherAPI.com upstream for benchmarks.\n");
+    printf("\n");
+    printf("OPTIONS:\n");
+    printf("  -p <PORT>   Listen port (default: 9090)\n");
+    printf("  -d <MS>     Artificial latency per request in milliseconds (default: 0)\n");
+    printf("  -e <PCT>    Answer this percentage of requests with 503 (default: 0)\n");
+    printf("  -x <PCT>    Close the connection on this percentage of requests without answering (default: 0)\n");
+    printf("  -s <PCT>    Delay this percentage of requests by the -S latency on top of -d (default: 0)\n");
+    printf("  -S <MS>     Extra latency of slow requests in milliseconds (default: 1000)\n");
+    printf("  -O <SEC>    Answer 503 to every request for this long after startup (default: 0)\n");
+    printf("  -v          Log every request\n");
+    printf("  -h          Show this help message\n");
+}
+
+int main(int argc, char *argv[]) {
+    int port = 9090;
+    int c;
+
+    while ((c = getopt(argc, argv, "p:d:e:x:s:S:O:vh")) != -1) {
+        switch (c) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'd':
+                mock_delay_ms = atoi(optarg);
+                break;
+            case 'e':
+                mock_error_pct = atoi(optarg);
+                break;
+            case 'x':
+                mock_drop_pct = atoi(optarg);
+                break;
+            case 's':
+                mock_slow_pct = atoi(optarg);
+                break;
+            case 'S':
+                mock_slow_ms = atoi(optarg);
+                break;
+            case 'O':
+                mock_outage_s = atoi(optarg);
+                break;
+            case 'v':
+                mock_verbose = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                print_usage(argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    // No SA_RESTART: the signal must interrupt accept() so the loop can exit
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = mock_signal_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return EXIT_FAILURE;
+    }
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 512) != 0) {
+        perror("bind/listen");
+        close(listen_fd);
+        return EXIT_FAILURE;
+    }
+
+    mock_started = time(NULL);
+    printf("Mock upstream listening on http://127.0.0.1:%d/v1 (delay %d ms)\n", port, mock_delay_ms);
+    if (mock_error_pct || mock_drop_pct || mock_slow_pct || mock_outage_s) {
+        printf("Faults: %d%% 503, %d%% dropped, %d%% slowed by %d ms, outage for the first %d s\n",
+               mock_error_pct, mock_drop_pct, mock_slow_pct, mock_slow_ms, mock_outage_s);
+    }
+    fflush(stdout);
+
+    while (mock_running) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("accept");
+            break;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, connection_thread, (void *)(long)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+
+    close(listen_fd);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "weather_location.h"
+
+/*
+ * Nearby lookup microbenchmark: the cost of weather_location_nearby() with
+ * 100,000 cached points, against a linear scan over the same points.
+ *
+ * Two layouts are measured for each radius: points spread uniformly over
+ * the globe, and points clustered around 50 cities the way GPS traffic
+ * is. Queries are drawn from the same distribution as the points. Every
+ * lookup's nearest match is checked against the linear scan; any
+ * difference fails the run.
+ */
+
+#define POINTS 100000
+#define QUERIES 20000
+#define CITIES 50
+#define CITY_SPREAD 0.3                       // Degrees around a city centre
+#define CHECK_KM 1e-6                         // Distance tolerance of the check
+
+typedef struct {
+    double lat;
+    double lon;
+    char canonical[WEATHER_LOCATION_POINT_SIZE];
+} bench_point_t;
+
+static const double radii_km[] = {1, 5, 25, 100};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double uniform(unsigned int *seed, double low, double high) {
+    return low + (high - low) * ((double)rand_r(seed) / RAND_MAX);
+}
+
+/**
+ * Draw a coordinate: anywhere (uniform in area), or near one of the cities
+ */
+static void draw(unsigned int *seed, int clustered, const double *cities, double *lat, double *lon) {
+    if (clustered) {
+        int city = rand_r(seed) % CITIES;
+        *lat = fmax(-90, fmin(90, cities[2 * city] + uniform(seed, -CITY_SPREAD, CITY_SPREAD)));
+        *lon = cities[2 * city + 1] + uniform(seed, -CITY_SPREAD, CITY_SPREAD);
+        if (*lon >= 180) *lon -= 360;
+        if (*lon < -180) *lon += 360;
+    } else {
+        *lat = asin(uniform(seed, -1, 1)) * 57.29577951308232;
+        *lon = uniform(seed, -180, 180);
+    }
+}
+
+static double haversine_km(double lat1, double lon1, double lat2, double lon2) {
+    const double rad = 0.017453292519943295;
+    double dlat = (lat2 - lat1) * rad;
+    double dlon = (lon2 - lon1) * rad;
+    double a = sin(dlat / 2) * sin(dlat / 2) + cos(lat1 * rad) * cos(lat2 * rad) * sin(dlon / 2) * sin(dlon / 2);
+    return 2 * 6371.0088 * asin(sqrt(a < 1 ? a : 1));
+}
+
+/**
+ * Nearest point within the radius by linear scan
+ * @return Its distance, or -1 if none is that close
+ */
+static double scan_nearest(const bench_point_t *points, double lat, double lon, double radius_km) {
+    double best = -1;
+    for (int i = 0; i < POINTS; i++) {
+        double distance = haversine_km(lat, lon, points[i].lat, points[i].lon);
+        if (distance <= radius_km && (best < 0 || distance < best)) {
+            best = distance;
+        }
+    }
+    return best;
+}
+
+static int run_case(int clustered, double radius_km, bench_point_t *points, char (*queries)[64]) {
+    unsigned int seed = 12345;
+    double cities[2 * CITIES];
+    for (int i = 0; i < CITIES; i++) {
+        draw(&seed, 0, NULL, &cities[2 * i], &cities[2 * i + 1]);
+    }
+
+    weather_location_cleanup();
+    weather_location_set_radius(radius_km);
+    for (int i = 0; i < POINTS; i++) {
+        draw(&seed, clustered, cities, &points[i].lat, &points[i].lon);
+        char query[64];
+        snprintf(query, sizeof(query), "%.6f,%.6f", points[i].lat, points[i].lon);
+        weather_location_normalize(query, points[i].canonical, sizeof(points[i].canonical));
+        sscanf(points[i].canonical, "%lf,%lf", &points[i].lat, &points[i].lon);
+        weather_location_point_add(points[i].canonical, strlen(points[i].canonical));
+    }
+    for (int i = 0; i < QUERIES; i++) {
+        double lat, lon;
+        draw(&seed, clustered, cities, &lat, &lon);
+        snprintf(queries[i], sizeof(queries[i]), "%.6f,%.6f", lat, lon);
+    }
+
+    weather_location_match_t matches[WEATHER_LOCATION_NEARBY_MAX];
+    int found = 0;
+    double start = now_sec();
+    for (int i = 0; i < QUERIES; i++) {
+        found += weather_location_nearby(queries[i], NULL, matches, WEATHER_LOCATION_NEARBY_MAX) > 0;
+    }
+    double index_ns = (now_sec() - start) * 1e9 / QUERIES;
+
+    // The scan is slow; time and check a tenth of the queries
+    int errors = 0;
+    int checked = QUERIES / 10;
+    double scan_seconds = 0;
+    for (int i = 0; i < checked; i++) {
+        double lat, lon;
+        sscanf(queries[i], "%lf,%lf", &lat, &lon);
+        double scan_start = now_sec();
+        double expected = scan_nearest(points, lat, lon, radius_km);
+        scan_seconds += now_sec() - scan_start;
+
+        int count = weather_location_nearby(queries[i], NULL, matches, WEATHER_LOCATION_NEARBY_MAX);
+        double actual = count > 0 ? matches[0].distance_km : -1;
+        if (fabs(actual - expected) > CHECK_KM) {
+            if (errors++ < 5) {
+                fprintf(stderr, "Mismatch for %s: index %.6f km, scan %.6f km\n", queries[i], actual, expected);
+            }
+        }
+    }
+
+    weather_location_stats_t stats;
+    weather_location_get_stats(&stats);
+    printf("%-10s %9.0f %9zu %9.1f%% %12.0f %12.0f %9.0fx\n", clustered ? "clustered" : "uniform", radius_km,
+           stats.points, 100.0 * found / QUERIES, index_ns, scan_seconds * 1e9 / checked,
+           scan_seconds * 1e9 / checked / index_ns);
+    return errors;
+}
+
+int main(void) {
+    bench_point_t *points = calloc(POINTS, sizeof(bench_point_t));
+    char (*queries)[64] = calloc(QUERIES, sizeof(*queries));
+    if (!points || !queries) {
+        fprintf(stderr, "Failed to allocate benchmark data\n");
+        return 1;
+    }
+
+    printf("Nearby lookup, %d cached points, %d queries per case\n\n", POINTS, QUERIES);
+    printf("%-10s %9s %9s %10s %12s %12s %10s\n", "layout", "radius_km", "points", "answered", "index_ns", "scan_ns", "speedup");
+
+    int errors = 0;
+    for (int clustered = 0; clustered <= 1; clustered++) {
+        for (size_t r = 0; r < sizeof(radii_km) / sizeof(radii_km[0]); r++) {
+            errors += run_case(clustered, radii_km[r], points, queries);
+        }
+    }
+
+    weather_location_cleanup();
+    free(points);
+    free(queries);
+
+    if (errors) {
+        fprintf(stderr, "%d lookups disagree with the linear scan\n", errors);
+        return 1;
+    }
+    return 0;
+}
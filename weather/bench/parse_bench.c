@@ -0,0 +1,258 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "fixtures.h"
+#include "cjson_baseline.h"
+#include "weather_parser.h"
+#include "weather_compact.h"
+#include "weather_arena.h"
+#include "alloc_count.h"
+
+/*
+ * Forecast parsing microbenchmark: the cJSON DOM baseline against the
+ * streaming parser on 1-, 3- and 14-day payloads. The streaming parser is
+ * fed in 16 KB chunks, the largest write libcurl hands to a write callback.
+ * The lazy column keeps hour, astro and current sections as raw bytes and
+ * then loads astro, which is what a /forecast request without hourly data
+ * costs. The KB columns are the memory each result holds: the public
+ * structs the cJSON baseline fills, the streamed result with compact hours,
+ * and the lazy result before its hours are loaded.
+ *
+ * A second table counts heap allocations per request: the cJSON baseline,
+ * and the service's path for a synchronous forecast (stream the body keeping
+ * current and astro raw, load astro, copy the result out, free both).
+ */
+
+#define CHUNK_SIZE 16384
+#define TARGET_BYTES (256UL * 1024 * 1024)    // Parse about this much per case
+#define ALLOC_ITERATIONS 100                  // Requests averaged for allocation counts
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void result_free(weather_result_t *result) {
+    weather_arena_free(weather_arena_of(result->forecast.forecast));
+    weather_lazy_free(result->lazy);
+}
+
+static size_t result_kb(const weather_result_t *result) {
+    size_t bytes = sizeof(weather_result_t) + weather_arena_size(weather_arena_of(result->forecast.forecast));
+    return (bytes + weather_lazy_bytes(result->lazy)) / 1024;
+}
+
+static size_t forecast_kb(const forecast_response_t *forecast) {
+    size_t bytes = sizeof(forecast_response_t) + forecast->forecast_days * sizeof(forecast_daily_t);
+    for (int i = 0; i < forecast->forecast_days; i++) {
+        bytes += forecast->forecast[i].hour_count * sizeof(forecast_hour_t);
+    }
+    return bytes / 1024;
+}
+
+static void forecast_free(forecast_response_t *forecast) {
+    for (int i = 0; i < forecast->forecast_days; i++) {
+        free(forecast->forecast[i].hour);
+    }
+    free(forecast->forecast);
+    memset(forecast, 0, sizeof(*forecast));
+}
+
+static void copy_free(forecast_response_t *forecast) {
+    weather_arena_free(weather_arena_of(forecast->forecast));
+    memset(forecast, 0, sizeof(*forecast));
+}
+
+static int stream_parse(const char *body, size_t length, weather_result_t *result, unsigned int lazy_sections) {
+    memset(result, 0, sizeof(*result));
+    result->is_forecast = 1;
+
+    weather_parser_t *parser = weather_parser_create(result, lazy_sections);
+    if (!parser) return -1;
+
+    int status = 0;
+    for (size_t offset = 0; offset < length && status == 0; offset += CHUNK_SIZE) {
+        size_t n = length - offset < CHUNK_SIZE ? length - offset : CHUNK_SIZE;
+        status = weather_parser_feed(parser, body + offset, n);
+    }
+    if (status == 0) status = weather_parser_finish(parser);
+    if (status == 0 && lazy_sections) status = weather_result_load(result, WEATHER_SECTION_ASTRO);
+
+    weather_parser_free(parser);
+    return status;
+}
+
+/**
+ * Check that both parsers produced the same data
+ * Whole structs are compared where the baseline zeroes them; hours are
+ * compared field by field because the baseline leaves their padding unset.
+ */
+static int same_forecast(const forecast_response_t *a, const forecast_response_t *b) {
+    if (memcmp(&a->location, &b->location, sizeof(a->location)) != 0) return 0;
+    if (memcmp(&a->current, &b->current, sizeof(a->current)) != 0) return 0;
+    if (a->forecast_days != b->forecast_days) return 0;
+
+    for (int d = 0; d < a->forecast_days; d++) {
+        const forecast_daily_t *x = &a->forecast[d];
+        const forecast_daily_t *y = &b->forecast[d];
+        if (strcmp(x->date, y->date) != 0 || x->date_epoch != y->date_epoch) return 0;
+        if (memcmp(&x->day, &y->day, sizeof(x->day)) != 0) return 0;
+        if (memcmp(&x->astro, &y->astro, sizeof(x->astro)) != 0) return 0;
+        if (x->hour_count != y->hour_count) return 0;
+
+        for (int h = 0; h < x->hour_count; h++) {
+            const forecast_hour_t *p = &x->hour[h];
+            const forecast_hour_t *q = &y->hour[h];
+            if (p->time_epoch != q->time_epoch || strcmp(p->time, q->time) != 0 ||
+                p->temp_c != q->temp_c || p->temp_f != q->temp_f || p->is_day != q->is_day ||
+                strcmp(p->condition.text, q->condition.text) != 0 ||
+                strcmp(p->condition.icon, q->condition.icon) != 0 || p->condition.code != q->condition.code ||
+                p->wind_kph != q->wind_kph || p->wind_degree != q->wind_degree ||
+                strcmp(p->wind_dir, q->wind_dir) != 0 || p->pressure_mb != q->pressure_mb ||
+                p->precip_mm != q->precip_mm || p->humidity != q->humidity || p->cloud != q->cloud ||
+                p->feelslike_c != q->feelslike_c || p->dewpoint_f != q->dewpoint_f ||
+                p->will_it_rain != q->will_it_rain || p->chance_of_rain != q->chance_of_rain ||
+                p->chance_of_snow != q->chance_of_snow || p->vis_miles != q->vis_miles ||
+                p->gust_kph != q->gust_kph || p->uv != q->uv ||
+                p->wind_mph != q->wind_mph || p->gust_mph != q->gust_mph ||
+                p->pressure_in != q->pressure_in || p->precip_in != q->precip_in ||
+                p->feelslike_f != q->feelslike_f || p->windchill_f != q->windchill_f ||
+                p->heatindex_f != q->heatindex_f) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *location = argc > 1 ? argv[1] : "London";
+    static const int day_counts[] = {1, 3, 14};
+    int failed = 0;
+
+    printf("%-5s %8s %7s %12s %13s %11s %11s %9s %9s %9s %8s %8s\n",
+           "days", "bytes", "iters", "cjson us/op", "stream us/op", "lazy us/op", "stream MB/s",
+           "stream x", "lazy x", "public KB", "full KB", "lazy KB");
+
+    for (size_t c = 0; c < sizeof(day_counts) / sizeof(day_counts[0]); c++) {
+        size_t length = 0;
+        char *body = fixture_forecast_json(location, day_counts[c], &length);
+        if (!body) {
+            fprintf(stderr, "Failed to build a %d-day payload\n", day_counts[c]);
+            return 1;
+        }
+
+        forecast_response_t baseline;
+        weather_result_t streamed, lazy;
+        if (baseline_parse_forecast(body, &baseline) != 0 || stream_parse(body, length, &streamed, 0) != 0 ||
+            stream_parse(body, length, &lazy, WEATHER_SECTION_ALL) != 0) {
+            fprintf(stderr, "Failed to parse the %d-day payload\n", day_counts[c]);
+            return 1;
+        }
+        size_t public_kb = forecast_kb(&baseline);
+        size_t full_kb = result_kb(&streamed);
+        size_t lazy_kb = result_kb(&lazy);
+
+        // Unpacked hours, and every section loaded, must match the baseline
+        forecast_response_t unpacked, loaded;
+        if (weather_result_copy_forecast(&streamed, &unpacked) != 0 ||
+            weather_result_copy_forecast(&lazy, &loaded) != 0) {
+            fprintf(stderr, "Failed to load the %d-day payload\n", day_counts[c]);
+            return 1;
+        }
+        if (!same_forecast(&baseline, &unpacked) || !same_forecast(&baseline, &loaded)) {
+            fprintf(stderr, "Parsers disagree on the %d-day payload\n", day_counts[c]);
+            failed = 1;
+        }
+        forecast_free(&baseline);
+        copy_free(&unpacked);
+        copy_free(&loaded);
+        result_free(&streamed);
+        result_free(&lazy);
+
+        int iterations = (int)(TARGET_BYTES / length);
+        if (iterations < 20) iterations = 20;
+
+        double start = now_sec();
+        for (int i = 0; i < iterations; i++) {
+            baseline_parse_forecast(body, &baseline);
+            forecast_free(&baseline);
+        }
+        double cjson_sec = now_sec() - start;
+
+        start = now_sec();
+        for (int i = 0; i < iterations; i++) {
+            stream_parse(body, length, &streamed, 0);
+            result_free(&streamed);
+        }
+        double stream_sec = now_sec() - start;
+
+        start = now_sec();
+        for (int i = 0; i < iterations; i++) {
+            stream_parse(body, length, &lazy, WEATHER_SECTION_ALL);
+            result_free(&lazy);
+        }
+        double lazy_sec = now_sec() - start;
+
+        double mb = (double)length * iterations / (1024.0 * 1024.0);
+        printf("%-5d %8zu %7d %12.1f %13.1f %11.1f %11.1f %8.2fx %8.2fx %9zu %8zu %8zu\n",
+               day_counts[c], length, iterations,
+               cjson_sec * 1e6 / iterations, stream_sec * 1e6 / iterations, lazy_sec * 1e6 / iterations,
+               mb / stream_sec, cjson_sec / stream_sec, cjson_sec / lazy_sec, public_kb, full_kb, lazy_kb);
+
+        free(body);
+    }
+
+    if (alloc_count() < 0) {
+        printf("\nAllocation counts need glibc\n");
+        return failed;
+    }
+
+    printf("\n%-5s %13s %13s %12s %14s\n", "days", "cjson allocs", "parse allocs", "copy allocs", "arenas reused");
+    for (size_t c = 0; c < sizeof(day_counts) / sizeof(day_counts[0]); c++) {
+        size_t length = 0;
+        char *body = fixture_forecast_json(location, day_counts[c], &length);
+        if (!body) {
+            return 1;
+        }
+
+        forecast_response_t baseline, copy;
+        weather_result_t result;
+        long cjson_allocs = 0, parse_allocs = 0, copy_allocs = 0;
+        weather_arena_stats_t before, after;
+
+        // The first request warms the thread's arena free list
+        for (int i = 0; i <= ALLOC_ITERATIONS; i++) {
+            if (i == 1) weather_arena_get_stats(&before);
+
+            long start = alloc_count();
+            baseline_parse_forecast(body, &baseline);
+            forecast_free(&baseline);
+            long parsed = alloc_count();
+            stream_parse(body, length, &result, WEATHER_SECTION_CURRENT | WEATHER_SECTION_ASTRO);
+            long streamed = alloc_count();
+            weather_result_copy_forecast(&result, &copy);
+            copy_free(&copy);
+            result_free(&result);
+            long copied = alloc_count();
+
+            if (i > 0) {
+                cjson_allocs += parsed - start;
+                parse_allocs += streamed - parsed;
+                copy_allocs += copied - streamed;
+            }
+        }
+        weather_arena_get_stats(&after);
+
+        printf("%-5d %13.1f %13.1f %12.1f %13.0f%%\n", day_counts[c],
+               (double)cjson_allocs / ALLOC_ITERATIONS, (double)parse_allocs / ALLOC_ITERATIONS,
+               (double)copy_allocs / ALLOC_ITERATIONS,
+               100.0 * (after.reused - before.reused) / (double)(after.created - before.created));
+        free(body);
+    }
+
+    return failed;
+}
@@ -3,11 +3,28 @@
 
 #include "weather_types.h"
 
+#define HTTP_LOW_SPEED_BYTES 1024           // Transfers slower than this (bytes per second) ...
+#define HTTP_LOW_SPEED_SECONDS 5            // ... for this long are aborted
+
 /**
  * Initialize the HTTP client (must be called before using other functions)
+ * Sets up a pool of reusable easy handles that share DNS cache and TLS
+ * sessions, so repeated calls to the same host skip DNS/TCP/TLS setup.
+ * Besides the total timeout, every transfer gives up if connecting takes
+ * longer than connect_timeout_seconds or if the body stalls below
+ * HTTP_LOW_SPEED_BYTES per second for HTTP_LOW_SPEED_SECONDS.
+ * @param timeout_seconds Total timeout per request (weather_config_t.timeout)
+ * @param connect_timeout_seconds Timeout to establish a connection (0 for the default)
  * @return 0 on success, -1 on error
  */
-int http_client_init(void);
+int http_client_init(int timeout_seconds, int connect_timeout_seconds);
+
+/**
+ * Stop the reactor, failing every asynchronous request still queued or in
+ * flight; later ones fail at once. Synchronous calls keep working until
+ * http_client_cleanup().
+ */
+void http_client_stop(void);
 
 /**
  * Cleanup the HTTP client (should be called when done)
@@ -31,6 +48,125 @@ int http_get(const char *url, http_response_t *response);
  */
 int http_post_json(const char *url, const char *json_data, http_response_t *response);
 
+/**
+ * Perform an HTTP POST request with JSON data and a bearer token
+ * @param url The URL to request
+ * @param json_data The JSON data to send in the request body
+ * @param bearer_token Token for the Authorization header (NULL for none)
+ * @param timeout_seconds Total timeout of this request (0 for weather_config_t.timeout)
+ * @param response Pointer to store the response (caller must free response->data)
+ * @return 0 on success, -1 on error
+ */
+int http_post_json_auth(const char *url, const char *json_data, const char *bearer_token, long timeout_seconds,
+                        http_response_t *response);
+
+/**
+ * Percent-encode a string for use in a URL query
+ * @param input The string to encode
+ * @param output Buffer for the encoded string
+ * @param output_size Size of the output buffer
+ * @return 0 on success, -1 if the output buffer is too small
+ */
+int http_url_encode(const char *input, char *output, size_t output_size);
+
+/**
+ * Completion callback for asynchronous requests
+ * Invoked on the client's reactor thread. The response is only valid for the
+ * duration of the callback; copy or parse what is needed before returning.
+ * @param result 0 if the transfer completed, -1 on transport error
+ * @param response The received response (status_code and data)
+ * @param user_data Opaque pointer passed when the request was started
+ */
+typedef void (*http_completion_callback_t)(int result, http_response_t *response, void *user_data);
+
+/**
+ * Start an asynchronous HTTP GET request
+ * The transfer is driven by a shared curl_multi reactor thread, which is
+ * started on first use. The callback is invoked exactly once, including
+ * when the client is cleaned up with the transfer still in flight.
+ * @param url The URL to request
+ * @param callback Function to call when the transfer completes
+ * @param user_data Opaque pointer passed to the callback
+ * @return 0 if the request was queued, -1 on error (callback is not invoked)
+ */
+int http_get_async(const char *url, http_completion_callback_t callback, void *user_data);
+
+/**
+ * Body callback for streamed requests
+ * Invoked on the client's reactor thread for each chunk as it is received.
+ * @param data Chunk of the response body
+ * @param length Length of the chunk
+ * @param user_data Opaque pointer passed when the request was started
+ * @return 0 to continue, -1 to abort the transfer (completes with result -1)
+ */
+typedef int (*http_body_callback_t)(const char *data, size_t length, void *user_data);
+
+/**
+ * Retry and hedging policy for an asynchronous request
+ * Every attempt of a request shares one deadline. An attempt that fails
+ * (transport error, timeout, or a retryable status: 429 or 5xx) is retried
+ * after a jittered exponential backoff while attempts and time remain. A
+ * hedge is a second attempt started while the first is still running, when
+ * it has gone hedge_after_ms without a body; whichever starts a 200 body
+ * first wins and the other is cancelled. Only a request that has not
+ * delivered any body is retried.
+ */
+typedef struct {
+    long deadline_ms;           // Time for all attempts together (0 = client timeout)
+    int max_attempts;           // Attempts including the first and the hedge (0 = 1)
+    long backoff_ms;            // Retry n waits between half and all of backoff_ms * 2^(n-1)
+    long hedge_after_ms;        // Hedge a single running attempt after this long (0 = never)
+} http_request_policy_t;
+
+/**
+ * Start an asynchronous HTTP GET request with a streamed body
+ * Like http_get_async(), but a 200 response body is handed to body_callback
+ * as it arrives instead of being buffered, so the completion callback sees
+ * an empty response->data. Bodies of other statuses are still buffered for
+ * error reporting. The completion callback sees the response of the attempt
+ * that won, or of the last attempt that failed.
+ * @param url The URL to request
+ * @param policy Retries, hedging and deadline (NULL for one attempt within the client timeout)
+ * @param body_callback Function to receive the body of a 200 response (NULL buffers it)
+ * @param callback Function to call when the transfer completes
+ * @param user_data Opaque pointer passed to both callbacks
+ * @return 0 if the request was queued, -1 on error (callbacks are not invoked)
+ */
+int http_get_async_stream(const char *url, const http_request_policy_t *policy,
+                          http_body_callback_t body_callback,
+                          http_completion_callback_t callback, void *user_data);
+
+/**
+ * Start an asynchronous HTTP POST request with JSON data
+ * Driven by the same reactor as http_get_async_stream(); the response body
+ * is buffered. The policy retries and hedges the POST like a GET, so use one
+ * only for requests that are safe to repeat.
+ * @param url The URL to request
+ * @param json_data The JSON data to send in the request body (copied)
+ * @param policy Retries, hedging and deadline (NULL for one attempt within the client timeout)
+ * @param callback Function to call when the transfer completes
+ * @param user_data Opaque pointer passed to the callback
+ * @return 0 if the request was queued, -1 on error (callback is not invoked)
+ */
+int http_post_json_async(const char *url, const char *json_data, const http_request_policy_t *policy,
+                         http_completion_callback_t callback, void *user_data);
+
+/**
+ * Asynchronous request counters
+ */
+typedef struct {
+    unsigned long attempts;             // Transfers started, including retries and hedges
+    unsigned long retries;              // Attempts started after a failed one
+    unsigned long hedges;               // Attempts started alongside a slow one
+    unsigned long hedge_wins;           // Hedges that answered first
+} http_client_stats_t;
+
+/**
+ * Get asynchronous request counters
+ * @param stats Filled with the current counters
+ */
+void http_client_get_stats(http_client_stats_t *stats);
+
 /**
  * Free memory allocated for an HTTP response
  * @param response The response to free
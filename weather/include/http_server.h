@@ -13,6 +13,8 @@ int http_server_init(const server_config_t *server_config, const weather_config_
 
 /**
  * Start the HTTP server (blocking call)
+ * Uses a pool of server_config_t.thread_pool_size worker threads when it is
+ * greater than 1, otherwise a single internal polling thread.
  * @return 0 on success, -1 on error
  */
 int http_server_start(void);
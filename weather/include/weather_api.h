@@ -2,14 +2,32 @@
 #define WEATHER_API_H
 
 #include "weather_types.h"
+#include "weather_cache.h"
+
+#define WEATHER_API_UNAVAILABLE -2      // Not sent: upstream is failing or at its concurrency limit
+#define WEATHER_API_UNKNOWN_LOCATION -3 // Upstream has no location matching the query
+#define WEATHER_API_BULK_MAX 50         // Most locations WeatherAPI accepts in one bulk request
 
 /**
  * Initialize the weather API client
+ * With config->batch_window_ms set, upstream misses are not sent one by one:
+ * a miss opens a batch for its endpoint and options, later misses with the
+ * same ones join it, and it goes upstream as one WeatherAPI bulk request when
+ * the window closes or it holds config->batch_max locations. A batch of one
+ * goes as an ordinary request.
  * @param config Configuration for the weather API
  * @return 0 on success, -1 on error
  */
 int weather_api_init(const weather_config_t *config);
 
+/**
+ * Stop the batcher and the upstream reactor
+ * Every request waiting in a batch or in flight fails, which resumes the
+ * connections suspended on it, and later misses fail at once. The cache and
+ * the location index stay usable until weather_api_cleanup().
+ */
+void weather_api_stop(void);
+
 /**
  * Cleanup the weather API client
  */
@@ -35,6 +53,107 @@ int weather_api_get_current(const char *location, int include_aqi, weather_respo
  */
 int weather_api_get_forecast(const char *location, int days, int include_aqi, int include_alerts, forecast_response_t *response);
 
+/**
+ * Upstream request counters
+ */
+typedef struct {
+    unsigned long leader_requests;      // Requests that went upstream
+    unsigned long coalesced_requests;   // Requests that joined one already in flight
+    unsigned long batches;              // Batches sent (one upstream call each)
+    unsigned long bulk_requests;        // Of those, bulk requests (more than one location)
+    unsigned long batched_requests;     // Leader requests sent in a batch
+    double batch_wait_seconds;          // Total time they waited for their batch to be sent
+} weather_api_stats_t;
+
+/**
+ * Completion callback for asynchronous weather requests
+ * Invoked once on the HTTP client's reactor thread, or on the batcher thread
+ * when a batch cannot be sent. Concurrent requests for the same location and
+ * options share one upstream call and one result.
+ * @param result 0 on success, -1 on error, WEATHER_API_UNAVAILABLE if the
+ *               shared call was refused by upstream admission control,
+ *               WEATHER_API_UNKNOWN_LOCATION if upstream matched no location
+ * @param data Parsed result on success (caller owns one reference and must
+ *             call weather_result_release), NULL on error
+ * @param user_data Opaque pointer passed when the request was started
+ */
+typedef void (*weather_api_callback_t)(int result, weather_result_t *data, void *user_data);
+
+/**
+ * Get current weather for a location without blocking
+ * @param location Location query (city name, coordinates, etc.)
+ * @param include_aqi Whether to include air quality data (0 = no, 1 = yes)
+ * @param callback Function to call when the request completes
+ * @param user_data Opaque pointer passed to the callback
+ * @return 0 if the request was started, -1 on error, WEATHER_API_UNAVAILABLE
+ *         if the circuit breaker is open or the upstream concurrency limit is
+ *         reached, WEATHER_API_UNKNOWN_LOCATION if upstream recently matched
+ *         no location for the query (callback is not invoked)
+ */
+int weather_api_get_current_async(const char *location, int include_aqi,
+                                  weather_api_callback_t callback, void *user_data);
+
+/**
+ * Get weather forecast for a location without blocking
+ * @param location Location query (city name, coordinates, etc.)
+ * @param days Number of forecast days (1-14)
+ * @param include_aqi Whether to include air quality data (0 = no, 1 = yes)
+ * @param include_alerts Whether to include weather alerts (0 = no, 1 = yes)
+ * @param callback Function to call when the request completes
+ * @param user_data Opaque pointer passed to the callback
+ * @return 0 if the request was started, -1 on error, WEATHER_API_UNAVAILABLE
+ *         if the circuit breaker is open or the upstream concurrency limit is
+ *         reached, WEATHER_API_UNKNOWN_LOCATION if upstream recently matched
+ *         no location for the query (callback is not invoked)
+ */
+int weather_api_get_forecast_async(const char *location, int days, int include_aqi, int include_alerts,
+                                   weather_api_callback_t callback, void *user_data);
+
+/**
+ * Get current weather from the response cache only
+ * Falls back to the current block of a fresher cached forecast. A stale or
+ * nearly expired hit starts one background refresh upstream.
+ * @param location Location query (city name, coordinates, etc.)
+ * @param include_aqi Whether to include air quality data (0 = no, 1 = yes)
+ * @param status Filled with the freshness of a hit (may be NULL)
+ * @return Cached result (release with weather_result_release), NULL on miss
+ */
+weather_result_t *weather_api_get_current_cached(const char *location, int include_aqi,
+                                                 weather_cache_status_t *status);
+
+/**
+ * Get a weather forecast from the response cache only
+ * Falls back to a fresher cached forecast covering more days. A stale or
+ * nearly expired hit starts one background refresh upstream.
+ * @param location Location query (city name, coordinates, etc.)
+ * @param days Number of forecast days (1-14)
+ * @param include_aqi Whether to include air quality data (0 = no, 1 = yes)
+ * @param include_alerts Whether to include weather alerts (0 = no, 1 = yes)
+ * @param status Filled with the freshness of a hit (may be NULL)
+ * @return Cached result (release with weather_result_release), NULL on miss
+ */
+weather_result_t *weather_api_get_forecast_cached(const char *location, int days, int include_aqi, int include_alerts,
+                                                  weather_cache_status_t *status);
+
+/**
+ * Take an additional reference to a shared result
+ * @param result The result (may be NULL)
+ * @return The same result
+ */
+weather_result_t *weather_result_retain(weather_result_t *result);
+
+/**
+ * Drop a reference to a shared result, freeing it with the last reference
+ * @param result The result (may be NULL)
+ */
+void weather_result_release(weather_result_t *result);
+
+/**
+ * Get upstream request counters (leaders vs. coalesced followers, batching)
+ * @param stats Filled with the current counters
+ */
+void weather_api_get_stats(weather_api_stats_t *stats);
+
 /**
  * Free memory allocated for a weather response
  * @param response The response to free
@@ -43,6 +162,7 @@ void weather_response_free(weather_response_t *response);
 
 /**
  * Free memory allocated for a forecast response
+ * The days and hours of a response filled by this API share one arena.
  * @param response The forecast response to free
  */
 void forecast_response_free(forecast_response_t *response);
@@ -0,0 +1,78 @@
+#ifndef WEATHER_ARENA_H
+#define WEATHER_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Single-block bump allocator for data freed all at once
+ * A forecast's day and hour arrays are carved from one arena sized up front,
+ * so building it is one allocation and freeing it is one call. Freed arenas
+ * are kept on a small free list shared by all threads and reused by the next
+ * arena of a similar size, whichever thread creates it.
+ */
+typedef struct weather_arena weather_arena_t;
+
+/**
+ * Room an allocation of n bytes takes in an arena (sum these to size one)
+ */
+#define WEATHER_ARENA_SIZE(n) (((size_t)(n) + 15) & ~(size_t)15)
+
+/**
+ * Arena allocation counters (all threads)
+ */
+typedef struct {
+    unsigned long created;      // Arenas handed out
+    unsigned long reused;       // ...of which came from the free list
+} weather_arena_stats_t;
+
+/**
+ * Create an arena
+ * @param size Bytes the arena must hold (see WEATHER_ARENA_SIZE)
+ * @return New arena, or NULL on allocation failure
+ */
+weather_arena_t *weather_arena_create(size_t size);
+
+/**
+ * Carve an allocation from an arena (contents are not initialized)
+ * @param arena Arena from weather_arena_create()
+ * @param size Size in bytes
+ * @return Allocation, or NULL if the arena is exhausted
+ */
+void *weather_arena_alloc(weather_arena_t *arena, size_t size);
+
+/**
+ * Arena whose first allocation is first
+ * Lets a structure keep only the pointer to its first array, e.g.
+ * forecast_response_t.forecast.
+ * @param first First allocation carved from the arena
+ * @return The arena
+ */
+weather_arena_t *weather_arena_of(void *first);
+
+/**
+ * Bytes an arena occupies
+ * @param arena Arena (may be NULL)
+ * @return Size in bytes, including its header
+ */
+size_t weather_arena_size(const weather_arena_t *arena);
+
+/**
+ * Free an arena and everything carved from it
+ * The block goes to the shared free list, or back to the heap if the list
+ * is full.
+ * @param arena Arena to free (may be NULL)
+ */
+void weather_arena_free(weather_arena_t *arena);
+
+/**
+ * Return the blocks on the free list to the heap
+ */
+void weather_arena_cleanup(void);
+
+/**
+ * Read the allocation counters
+ * @param stats Filled with the counters
+ */
+void weather_arena_get_stats(weather_arena_stats_t *stats);
+
+#endif // WEATHER_ARENA_H
@@ -0,0 +1,162 @@
+#ifndef WEATHER_BINARY_H
+#define WEATHER_BINARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "weather_types.h"
+#include "weather_fields.h"
+
+/**
+ * Binary response bodies (CBOR and MessagePack)
+ * The same data as the JSON bodies, keyed by number instead of by name:
+ *
+ *   body  map: WEATHER_BINARY_KEY_SCHEMA -> WEATHER_BINARY_SCHEMA,
+ *              field id -> value for each location member (and each current
+ *              member in a /current body),
+ *              WEATHER_BINARY_KEY_DAYS -> array of day maps (/forecast)
+ *   day   map: field id -> value for each forecast, day and astro member,
+ *              WEATHER_BINARY_KEY_HOURS -> array of hour maps
+ *   hour  map: field id -> value for each hour member
+ *
+ * With WEATHER_HOURLY_COLUMNS, WEATHER_BINARY_KEY_HOURS holds one map instead
+ * of the array: field id -> array of the member's values, one per hour.
+ *
+ * Field ids are those of weather_fields.h, so objects are flattened: a
+ * condition's text, icon and code are three entries of the map holding it.
+ * A ?fields= projection leaves out the keys it does not select, and the days
+ * and hours keys when none of their members are selected. Local time strings
+ * (TIME members) are not sent; their epoch members carry the same instant.
+ *
+ * Strings are text strings, INT and LONG members integers. DOUBLE members
+ * are integers when integral, float32 when they have at most two fraction
+ * digits and fewer than WEATHER_BINARY_FLOAT_MAX in magnitude (a reader
+ * rounds them back to two digits, which gives the exact double parsed from
+ * WeatherAPI.com's text), and float64 otherwise. Readers skip keys they do
+ * not know. WEATHER_BINARY_SCHEMA changes whenever a member table does.
+ */
+
+#define WEATHER_BINARY_SCHEMA 1                         // Schema id written with every body
+#define WEATHER_BINARY_KEY_SCHEMA WEATHER_FIELD_COUNT
+#define WEATHER_BINARY_KEY_DAYS (WEATHER_FIELD_COUNT + 1)
+#define WEATHER_BINARY_KEY_HOURS (WEATHER_FIELD_COUNT + 2)
+#define WEATHER_BINARY_FLOAT_MAX 100000.0               // Doubles at or above this stay float64
+
+/**
+ * Binary formats
+ */
+typedef enum {
+    WEATHER_BINARY_CBOR,                // RFC 8949, application/cbor
+    WEATHER_BINARY_MSGPACK              // application/msgpack
+} weather_binary_format_t;
+
+/**
+ * Binary body writer
+ * Writes into one growable buffer, like weather_json_writer_t, and can be
+ * limited to a projection.
+ */
+typedef struct {
+    unsigned char *data;        // Output so far (NULL until the first write)
+    size_t length;
+    size_t capacity;
+    int format;                 // weather_binary_format_t
+    int failed;                 // Out of memory
+    const weather_fields_t *fields; // Fields the body writers write (NULL for all)
+} weather_binary_writer_t;
+
+/**
+ * Initialize a writer
+ * @param writer Writer to initialize
+ * @param format Output format
+ */
+void weather_binary_writer_init(weather_binary_writer_t *writer, weather_binary_format_t format);
+
+/**
+ * Limit the body writers to a projection
+ * @param writer Writer
+ * @param fields Fields to write, or NULL for all; must outlive the writer
+ */
+void weather_binary_writer_project(weather_binary_writer_t *writer, const weather_fields_t *fields);
+
+/**
+ * Take the output of a writer
+ * @param writer Writer
+ * @param length Set to the output length
+ * @return Output to release with free() (non-NULL even when empty), or NULL if writing failed
+ */
+unsigned char *weather_binary_writer_finish(weather_binary_writer_t *writer, size_t *length);
+
+/**
+ * Write a /current response body
+ * @param writer Writer (empty)
+ * @param response Current weather
+ */
+void weather_binary_write_current(weather_binary_writer_t *writer, const weather_response_t *response);
+
+/**
+ * Write a /forecast response body
+ * Hourly data is read straight from the compact hours, which must be loaded.
+ * @param writer Writer (empty)
+ * @param result Forecast result or view
+ * @param include_hourly Layout of each day's hours (weather_hourly_t, 0 for none)
+ */
+void weather_binary_write_forecast(weather_binary_writer_t *writer, const weather_result_t *result,
+                                   int include_hourly);
+
+/**
+ * Write a /forecast response body in pieces
+ * The body is the head, the header of the days array
+ * (weather_binary_days_header()), then each day; there is nothing after the
+ * last day. The head does not depend on the number of days, so forecasts of
+ * different lengths for the same place share it. A projection without
+ * forecast fields has no days array.
+ * @param writer Writer
+ * @param result Forecast result or view
+ * @param day Day index
+ * @param include_hourly Layout of the day's hours (weather_hourly_t, 0 for none)
+ */
+void weather_binary_write_forecast_head(weather_binary_writer_t *writer, const weather_result_t *result);
+void weather_binary_write_forecast_day(weather_binary_writer_t *writer, const weather_result_t *result, int day,
+                                       int include_hourly);
+
+/**
+ * Header of a days array
+ * @param format Output format
+ * @param days Number of days (0 to 15)
+ * @param length Set to the header length
+ * @return Static bytes
+ */
+const unsigned char *weather_binary_days_header(weather_binary_format_t format, int days, size_t *length);
+
+/**
+ * Decode a /current body
+ * Needs only weather_fields.c besides this decoder (weather_decode.c), so
+ * clients can link the two on their own. Members the body leaves out stay
+ * zero (empty strings).
+ * @param data Body
+ * @param length Body length
+ * @param format Format of the body (from its Content-Type)
+ * @param response Filled with the decoded data
+ * @return 0 on success, -1 if the body is malformed or of another schema
+ */
+int weather_binary_decode_current(const void *data, size_t length, weather_binary_format_t format,
+                                  weather_response_t *response);
+
+/**
+ * Decode a /forecast body
+ * Days and hours are allocated; release them with weather_binary_forecast_free().
+ * @param data Body
+ * @param length Body length
+ * @param format Format of the body (from its Content-Type)
+ * @param response Filled with the decoded data
+ * @return 0 on success, -1 if the body is malformed or of another schema
+ */
+int weather_binary_decode_forecast(const void *data, size_t length, weather_binary_format_t format,
+                                   forecast_response_t *response);
+
+/**
+ * Free the days and hours of a decoded forecast
+ * @param response Forecast from weather_binary_decode_forecast()
+ */
+void weather_binary_forecast_free(forecast_response_t *response);
+
+#endif // WEATHER_BINARY_H
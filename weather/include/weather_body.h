@@ -0,0 +1,97 @@
+#ifndef WEATHER_BODY_H
+#define WEATHER_BODY_H
+
+#include <stddef.h>
+#include "weather_types.h"
+#include "weather_fields.h"
+
+#define WEATHER_BODY_DAYS 14                // Most forecast days a result holds
+#define WEATHER_BODY_MAX_PIECES (2 * WEATHER_BODY_DAYS + 1) // Head, days and separators (or days array header), tail
+
+/**
+ * Cached response fragments
+ * A result keeps the rendered pieces of the responses written from it, per
+ * set of output options: the whole /current body, or a forecast's head
+ * (location and the opening of "forecastday"), each day without its hours
+ * and with them in either layout, and the tail. A response is assembled from pieces without
+ * rendering or copying anything once they exist, and forecasts of different
+ * lengths for the same place share their days. Projections (?fields=) are
+ * cached the same way, a few per result. Binary bodies (CBOR, MessagePack)
+ * have the header of the days array after the head instead of separators
+ * between days, and no tail.
+ *
+ * Fragments belong to the result that owns the data (the source of a
+ * forecast view) and are immutable once stored; they are freed with it,
+ * i.e. once the cache has dropped it and no connection holds it any more.
+ * Any thread may render and read fragments concurrently.
+ */
+
+/**
+ * Output formats
+ */
+typedef enum {
+    WEATHER_FORMAT_JSON = 0,
+    WEATHER_FORMAT_CBOR,                    // weather_binary.h
+    WEATHER_FORMAT_MSGPACK
+} weather_format_t;
+
+/**
+ * One piece of a response, valid while the result is held
+ */
+typedef struct {
+    const char *data;
+    size_t length;
+} weather_piece_t;
+
+/**
+ * Fragment cache counters
+ */
+typedef struct {
+    unsigned long hits;                     // Responses assembled without rendering anything
+    unsigned long renders;                  // Fragments rendered
+    unsigned long bytes;                    // Bytes held by fragments
+} weather_body_stats_t;
+
+/**
+ * Pack the output options fragments depend on
+ * @param format Output format
+ * @param pretty 1 for indented output (JSON only)
+ * @param precision Fraction digits, or WEATHER_JSON_SHORTEST (JSON only)
+ * @return Key for weather_body_pieces()
+ */
+unsigned int weather_body_key(weather_format_t format, int pretty, int precision);
+
+/**
+ * Get the pieces of a response, rendering the ones not cached yet
+ * Forecast sections a missing day needs are loaded first.
+ * @param result Result or forecast view the response is written from
+ * @param key Output options (weather_body_key)
+ * @param fields Projection to write, or NULL for all fields
+ * @param include_hourly Layout of each forecast day's hours (weather_hourly_t, 0 for none)
+ * @param pieces Filled with up to WEATHER_BODY_MAX_PIECES pieces, in order
+ * @return Number of pieces, 0 if the result keeps no more projections (write
+ *         the response directly), or -1 on error
+ */
+int weather_body_pieces(weather_result_t *result, unsigned int key, const weather_fields_t *fields,
+                        int include_hourly, weather_piece_t *pieces);
+
+/**
+ * Bytes held by a result's fragments
+ * @param result Result owning the fragments
+ * @return Bytes, including bookkeeping
+ */
+size_t weather_body_bytes(const weather_result_t *result);
+
+/**
+ * Free a result's fragments (when the result itself is freed)
+ * @param result Result owning the fragments
+ */
+void weather_body_free_all(weather_result_t *result);
+
+/**
+ * Read the fragment cache counters
+ * @param stats Filled with the counters
+ */
+void weather_body_get_stats(weather_body_stats_t *stats);
+
+#endif // WEATHER_BODY_H
@@ -0,0 +1,176 @@
+#ifndef WEATHER_CACHE_H
+#define WEATHER_CACHE_H
+
+#include <stddef.h>
+#include "weather_types.h"
+#include "weather_location.h"
+
+#define WEATHER_CACHE_KEY_SIZE 320
+#define WEATHER_CACHE_UPDATE_INTERVAL 900   // WeatherAPI publishes a new observation every 15 minutes
+#define WEATHER_CACHE_MIN_FRESH 60          // Soft TTL floor once the next observation is due
+#define WEATHER_CACHE_STALE_SECONDS 3600    // Serve stale data this long past the soft TTL
+#define WEATHER_CACHE_REFRESH_RETRY 30      // Seconds between background refresh attempts
+#define WEATHER_CACHE_XFETCH_BETA 1.0       // Early refresh eagerness (XFetch)
+
+/**
+ * Freshness of a cache hit
+ */
+typedef struct {
+    int stale;                      // Past the soft TTL, served while revalidating
+    int refresh;                    // Caller should start a background refresh
+    long age;                       // Seconds since the result was fetched upstream
+    char nearby[WEATHER_LOCATION_POINT_SIZE];   // Cached point that answered a coordinate query ("" if none)
+    double nearby_km;               // Distance from the query to that point
+} weather_cache_status_t;
+
+/**
+ * Cache statistics (summed over all shards)
+ */
+typedef struct {
+    unsigned long hits;             // Lookups answered from the cache
+    unsigned long misses;           // Lookups that found no usable entry
+    unsigned long stale_hits;       // Hits served past the soft TTL
+    unsigned long superset_hits;    // Hits answered from a fresher superset entry
+    unsigned long nearby_hits;      // Coordinate queries answered from a nearby cached point
+    unsigned long refreshes;        // Background refreshes requested
+    unsigned long inserts;          // Entries admitted
+    unsigned long rejections;       // Entries refused by the frequency sketch
+    unsigned long evictions;        // Entries evicted to stay within budget
+    unsigned long expirations;      // Entries dropped after their hard TTL
+    size_t entries;                 // Entries currently cached
+    size_t bytes;                   // Bytes currently accounted
+    size_t max_bytes;               // Configured byte budget
+} weather_cache_stats_t;
+
+/**
+ * Initialize the response cache
+ * The budget is split across lock-striped shards. Each shard admits a new
+ * entry over an LRU victim only if a count-min frequency sketch (TinyLFU)
+ * says the new key is requested more often.
+ * @param max_bytes Memory budget in bytes (0 disables the cache)
+ * @return 0 on success, -1 on error
+ */
+int weather_cache_init(size_t max_bytes);
+
+/**
+ * Free all cached entries and shard state
+ */
+void weather_cache_cleanup(void);
+
+/**
+ * Check whether the cache is enabled
+ * @return 1 if initialized with a non-zero budget, 0 otherwise
+ */
+int weather_cache_enabled(void);
+
+/**
+ * Build the cache key for a current weather request
+ * The location is keyed by its canonical form (see
+ * weather_location_canonical()), so " Paros,greece", "PAROS, Greece" and,
+ * once upstream has resolved them, "Paros" and "37.08,25.15" share an entry.
+ * @param location Location query
+ * @param include_aqi Whether air quality data is included
+ * @param key Buffer for the key (WEATHER_CACHE_KEY_SIZE bytes)
+ * @param key_size Size of the key buffer
+ */
+void weather_cache_current_key(const char *location, int include_aqi, char *key, size_t key_size);
+
+/**
+ * Build the cache key for a forecast request
+ * The location is keyed like weather_cache_current_key() does it.
+ * @param location Location query
+ * @param days Number of forecast days
+ * @param include_aqi Whether air quality data is included
+ * @param include_alerts Whether weather alerts are included
+ * @param key Buffer for the key (WEATHER_CACHE_KEY_SIZE bytes)
+ * @param key_size Size of the key buffer
+ */
+void weather_cache_forecast_key(const char *location, int days, int include_aqi, int include_alerts,
+                                char *key, size_t key_size);
+
+/**
+ * Look up a cached result
+ * Entries are fresh until the soft TTL and served stale until the hard TTL.
+ * At most one caller per entry is asked to refresh: once the soft TTL has
+ * passed, or slightly earlier with XFetch probability so hot keys are
+ * renewed before they go stale.
+ * @param key Cache key from weather_cache_current_key() or weather_cache_forecast_key()
+ * @param status Filled with the freshness of a hit (may be NULL)
+ * @return Result with a reference for the caller (release with
+ *         weather_result_release), NULL on miss
+ */
+weather_result_t *weather_cache_get(const char *key, weather_cache_status_t *status);
+
+/**
+ * Look up current weather, falling back to fresher superset entries
+ * If the exact entry is missing or stale, a fresh current entry fetched with
+ * air quality, or the current block of any fresh forecast for the same
+ * location, answers instead. The most recently fetched candidate wins.
+ * Failing that, a "lat,lon" query is answered the same way from the nearest
+ * cached point within the weather_location_set_radius() radius, reported in
+ * status->nearby. Otherwise behaves like weather_cache_get() on the exact key.
+ * @param location Location query
+ * @param include_aqi Whether air quality data is requested
+ * @param status Filled with the freshness of a hit (may be NULL)
+ * @return Result with a reference for the caller, NULL on miss
+ */
+weather_result_t *weather_cache_get_current(const char *location, int include_aqi,
+                                            weather_cache_status_t *status);
+
+/**
+ * Look up a forecast, falling back to fresher superset entries
+ * A fresh forecast with more days, or with air quality or alerts the request
+ * did not ask for, answers a missing or stale exact entry. Longer forecasts
+ * are returned as a view of their first days. A "lat,lon" query falls back
+ * to the nearest cached point like weather_cache_get_current().
+ * @param location Location query
+ * @param days Number of forecast days
+ * @param include_aqi Whether air quality data is requested
+ * @param include_alerts Whether weather alerts are requested
+ * @param status Filled with the freshness of a hit (may be NULL)
+ * @return Result with a reference for the caller, NULL on miss
+ */
+weather_result_t *weather_cache_get_forecast(const char *location, int days, int include_aqi, int include_alerts,
+                                             weather_cache_status_t *status);
+
+/**
+ * Store a result; the cache takes its own reference
+ * The soft TTL runs until the next upstream observation is due
+ * (last_updated_epoch + WEATHER_CACHE_UPDATE_INTERVAL). Evicted entries
+ * stay valid for callers that still hold a reference.
+ * @param key Cache key for the result
+ * @param result Parsed result to share
+ * @param fetch_seconds How long the upstream request took (XFetch delta)
+ * @return 0 if stored, -1 if rejected by admission or on error
+ */
+int weather_cache_put(const char *key, weather_result_t *result, double fetch_seconds);
+
+/**
+ * Write all cached entries to a binary snapshot file
+ * The file is written next to the target and renamed into place. Members
+ * are written through the weather_fields.h tables and hours as their compact
+ * columns, with the names of both recorded in the file. Retained forecast
+ * sections are parsed into the cached results first.
+ * @param path Snapshot file path
+ * @return Number of entries written, -1 on error
+ */
+int weather_cache_save(const char *path);
+
+/**
+ * Load a snapshot written by weather_cache_save() into the cache
+ * The file is mmap'd and entries past their hard TTL are skipped. Loaded
+ * entries keep their original fetch time, so freshness carries over. Members
+ * and columns are matched by name: ones this build lacks are skipped, ones
+ * the file lacks are left zero.
+ * @param path Snapshot file path
+ * @return Number of entries loaded, -1 if the file is missing or incompatible
+ */
+int weather_cache_load(const char *path);
+
+/**
+ * Get cache statistics
+ * @param stats Filled with counters summed over all shards
+ */
+void weather_cache_get_stats(weather_cache_stats_t *stats);
+
+#endif // WEATHER_CACHE_H
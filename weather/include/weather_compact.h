@@ -0,0 +1,172 @@
+#ifndef WEATHER_COMPACT_H
+#define WEATHER_COMPACT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "weather_types.h"
+
+#define WEATHER_HOURS_MAX 24            // Hours kept per forecast day
+#define WEATHER_CONDITIONS_MAX 4096     // Distinct conditions the shared table holds
+
+/**
+ * Compact hourly forecast for one day, one array per field
+ * Values are stored at the precision WeatherAPI.com reports them: tenths for
+ * temperatures, speeds, millibars, visibility and UV, hundredths for
+ * precipitation and inches of mercury. Imperial values are kept as upstream
+ * sent them rather than converted, so they match the daily ones. The local
+ * time string is derived when an hour is read back. Conditions are ids in
+ * the shared condition table.
+ * A result holds one per forecast day (weather_result_t.hours).
+ */
+typedef struct weather_hours {
+    int count;                                  // Hours filled
+    int64_t time_epoch[WEATHER_HOURS_MAX];
+    int16_t temp_c[WEATHER_HOURS_MAX];          // Tenths of a degree
+    int16_t feelslike_c[WEATHER_HOURS_MAX];
+    int16_t windchill_c[WEATHER_HOURS_MAX];
+    int16_t heatindex_c[WEATHER_HOURS_MAX];
+    int16_t dewpoint_c[WEATHER_HOURS_MAX];
+    int16_t temp_f[WEATHER_HOURS_MAX];          // Tenths of a degree
+    int16_t feelslike_f[WEATHER_HOURS_MAX];
+    int16_t windchill_f[WEATHER_HOURS_MAX];
+    int16_t heatindex_f[WEATHER_HOURS_MAX];
+    int16_t dewpoint_f[WEATHER_HOURS_MAX];
+    uint16_t wind_kph[WEATHER_HOURS_MAX];       // Tenths of a kph
+    uint16_t gust_kph[WEATHER_HOURS_MAX];
+    uint16_t wind_mph[WEATHER_HOURS_MAX];       // Tenths of a mph
+    uint16_t gust_mph[WEATHER_HOURS_MAX];
+    uint16_t pressure_mb[WEATHER_HOURS_MAX];    // Tenths of a millibar
+    uint16_t pressure_in[WEATHER_HOURS_MAX];    // Hundredths of an inch
+    uint16_t precip_mm[WEATHER_HOURS_MAX];      // Hundredths of a mm
+    uint16_t precip_in[WEATHER_HOURS_MAX];      // Hundredths of an inch
+    uint16_t vis_km[WEATHER_HOURS_MAX];         // Tenths of a km
+    uint16_t vis_miles[WEATHER_HOURS_MAX];      // Tenths of a mile
+    uint16_t uv[WEATHER_HOURS_MAX];             // Tenths
+    uint16_t wind_degree[WEATHER_HOURS_MAX];
+    uint16_t condition[WEATHER_HOURS_MAX];      // Id from weather_condition_intern()
+    int8_t utc_offset[WEATHER_HOURS_MAX];       // Local time offset in quarter hours
+    uint8_t wind_dir[WEATHER_HOURS_MAX];        // Compass point index (0 = N, 15 = NNW)
+    uint8_t is_day[WEATHER_HOURS_MAX];
+    uint8_t humidity[WEATHER_HOURS_MAX];
+    uint8_t cloud[WEATHER_HOURS_MAX];
+    uint8_t will_it_rain[WEATHER_HOURS_MAX];
+    uint8_t chance_of_rain[WEATHER_HOURS_MAX];
+    uint8_t will_it_snow[WEATHER_HOURS_MAX];
+    uint8_t chance_of_snow[WEATHER_HOURS_MAX];
+} weather_hours_t;
+
+/**
+ * Intern a condition into the shared table
+ * Conditions are keyed by code, text and icon (day and night variants of a
+ * code differ in text and icon). Entries are never removed.
+ * @param condition Condition to intern
+ * @return Condition id, or 0 (the empty condition) if the table is full
+ */
+uint16_t weather_condition_intern(const weather_condition_t *condition);
+
+/**
+ * Look up an interned condition
+ * Lock-free; the returned entry stays valid for the life of the process.
+ * @param id Id from weather_condition_intern()
+ * @return Condition (the empty condition for an unknown id)
+ */
+const weather_condition_t *weather_condition_lookup(uint16_t id);
+
+/**
+ * Append an hour to a day's compact hours
+ * @param hours Day to append to
+ * @param hour Hour to pack
+ * @return 0 on success, -1 if the day already holds WEATHER_HOURS_MAX hours
+ */
+int weather_hours_append(weather_hours_t *hours, const forecast_hour_t *hour);
+
+/**
+ * Compact hours of a forecast day of a result or view
+ * Retained hour sections must have been loaded (weather_result_load).
+ * @param result Forecast result or view
+ * @param day Day index (below result->forecast.forecast_days)
+ * @return Hours of the day, or NULL if it has none
+ */
+const weather_hours_t *weather_result_hours(const weather_result_t *result, int day);
+
+/**
+ * Unpack one hour, deriving the local time string
+ * @param hours Day to read from
+ * @param index Hour index (below hours->count)
+ * @param hour Filled with the hour
+ */
+void weather_hours_get(const weather_hours_t *hours, int index, forecast_hour_t *hour);
+
+/**
+ * Unpack one member of an hour, leaving the others as they are
+ * Lets a writer that shows a few members skip deriving the rest.
+ * @param hours Day to read from
+ * @param index Hour index (below hours->count)
+ * @param offset Offset of the member in forecast_hour_t (weather_schema_hour)
+ * @param hour Member is written into this hour
+ */
+void weather_hours_get_member(const weather_hours_t *hours, int index, size_t offset, forecast_hour_t *hour);
+
+/**
+ * Column types of the compact layout
+ */
+typedef enum {
+    WEATHER_COLUMN_INT64,
+    WEATHER_COLUMN_INT16,
+    WEATHER_COLUMN_UINT16,
+    WEATHER_COLUMN_UINT8,
+    WEATHER_COLUMN_INT8
+} weather_column_type_t;
+
+/**
+ * Column an hour member is stored in, as a scaled integer
+ * Writing a member from its column skips converting it to a double and back.
+ */
+typedef struct {
+    uint16_t offset;            // Offset of the array in weather_hours_t
+    uint8_t type;               // weather_column_type_t
+    uint8_t decimals;           // Fraction digits stored (value times 10^decimals)
+} weather_column_t;
+
+/**
+ * Look up the column of an hour member
+ * @param offset Offset of the member in forecast_hour_t (weather_schema_hour)
+ * @return Column, or NULL if the member is not a number stored in a column
+ */
+const weather_column_t *weather_hours_column(size_t offset);
+
+/**
+ * Named column of the compact layout
+ */
+typedef struct {
+    const char *name;           // Hour member name, or "condition", "utc_offset" or "wind_dir"
+    weather_column_t column;
+} weather_hours_field_t;
+
+/**
+ * List every column of the compact layout
+ * Includes the columns weather_hours_column() does not return: condition
+ * ids, local time offsets and compass point indexes. Lets the cache
+ * snapshot store the layout as it is.
+ * @param count Set to the number of columns
+ * @return Columns in layout order
+ */
+const weather_hours_field_t *weather_hours_fields(int *count);
+
+/**
+ * Local time string of an hour ("YYYY-MM-DD HH:MM")
+ * @param hours Day to read from
+ * @param index Hour index (below hours->count)
+ * @param buffer Output buffer
+ * @param size Size of the buffer
+ */
+void weather_hours_time(const weather_hours_t *hours, int index, char *buffer, size_t size);
+
+/**
+ * Name of a compass point index ("" for an unknown direction)
+ * @param index Value from weather_hours_t.wind_dir
+ * @return Direction name such as "NNE"
+ */
+const char *weather_wind_dir_name(uint8_t index);
+
+#endif // WEATHER_COMPACT_H
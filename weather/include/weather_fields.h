@@ -0,0 +1,255 @@
+#ifndef WEATHER_FIELDS_H
+#define WEATHER_FIELDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "weather_types.h"
+
+/**
+ * Member tables of the weather structs
+ * One list per struct, in the member order of WeatherAPI.com's JSON (and of
+ * the struct): X(arg, struct, member, type), with type one of STRING (char
+ * array), TIME (a local time string next to its epoch member), DOUBLE, INT,
+ * LONG or CONDITION (a nested weather_condition_t).
+ * The streaming parser, the JSON writer, ?fields= projections and the
+ * binary encoders are all generated from or driven by these lists, so a
+ * member added here is parsed, written and selectable everywhere.
+ */
+#define WEATHER_CONDITION_MEMBERS(X, arg) \
+    X(arg, weather_condition_t, text, STRING) \
+    X(arg, weather_condition_t, icon, STRING) \
+    X(arg, weather_condition_t, code, INT)
+
+#define WEATHER_LOCATION_MEMBERS(X, arg) \
+    X(arg, location_t, name, STRING) \
+    X(arg, location_t, region, STRING) \
+    X(arg, location_t, country, STRING) \
+    X(arg, location_t, lat, DOUBLE) \
+    X(arg, location_t, lon, DOUBLE) \
+    X(arg, location_t, tz_id, STRING) \
+    X(arg, location_t, localtime_epoch, LONG) \
+    X(arg, location_t, localtime, TIME)
+
+#define WEATHER_CURRENT_MEMBERS(X, arg) \
+    X(arg, current_weather_t, last_updated_epoch, LONG) \
+    X(arg, current_weather_t, last_updated, TIME) \
+    X(arg, current_weather_t, temp_c, DOUBLE) \
+    X(arg, current_weather_t, temp_f, DOUBLE) \
+    X(arg, current_weather_t, is_day, INT) \
+    X(arg, current_weather_t, condition, CONDITION) \
+    X(arg, current_weather_t, wind_mph, DOUBLE) \
+    X(arg, current_weather_t, wind_kph, DOUBLE) \
+    X(arg, current_weather_t, wind_degree, INT) \
+    X(arg, current_weather_t, wind_dir, STRING) \
+    X(arg, current_weather_t, pressure_mb, DOUBLE) \
+    X(arg, current_weather_t, pressure_in, DOUBLE) \
+    X(arg, current_weather_t, precip_mm, DOUBLE) \
+    X(arg, current_weather_t, precip_in, DOUBLE) \
+    X(arg, current_weather_t, humidity, INT) \
+    X(arg, current_weather_t, cloud, INT) \
+    X(arg, current_weather_t, feelslike_c, DOUBLE) \
+    X(arg, current_weather_t, feelslike_f, DOUBLE) \
+    X(arg, current_weather_t, windchill_c, DOUBLE) \
+    X(arg, current_weather_t, windchill_f, DOUBLE) \
+    X(arg, current_weather_t, heatindex_c, DOUBLE) \
+    X(arg, current_weather_t, heatindex_f, DOUBLE) \
+    X(arg, current_weather_t, dewpoint_c, DOUBLE) \
+    X(arg, current_weather_t, dewpoint_f, DOUBLE) \
+    X(arg, current_weather_t, vis_km, DOUBLE) \
+    X(arg, current_weather_t, vis_miles, DOUBLE) \
+    X(arg, current_weather_t, uv, DOUBLE) \
+    X(arg, current_weather_t, gust_mph, DOUBLE) \
+    X(arg, current_weather_t, gust_kph, DOUBLE) \
+    X(arg, current_weather_t, short_rad, DOUBLE) \
+    X(arg, current_weather_t, diff_rad, DOUBLE) \
+    X(arg, current_weather_t, dni, DOUBLE) \
+    X(arg, current_weather_t, gti, DOUBLE)
+
+// Scalar members of a forecast day; its day, astro and hour objects have their own lists
+#define WEATHER_DAILY_MEMBERS(X, arg) \
+    X(arg, forecast_daily_t, date, TIME) \
+    X(arg, forecast_daily_t, date_epoch, LONG)
+
+#define WEATHER_DAY_MEMBERS(X, arg) \
+    X(arg, forecast_day_t, maxtemp_c, DOUBLE) \
+    X(arg, forecast_day_t, maxtemp_f, DOUBLE) \
+    X(arg, forecast_day_t, mintemp_c, DOUBLE) \
+    X(arg, forecast_day_t, mintemp_f, DOUBLE) \
+    X(arg, forecast_day_t, avgtemp_c, DOUBLE) \
+    X(arg, forecast_day_t, avgtemp_f, DOUBLE) \
+    X(arg, forecast_day_t, maxwind_mph, DOUBLE) \
+    X(arg, forecast_day_t, maxwind_kph, DOUBLE) \
+    X(arg, forecast_day_t, totalprecip_mm, DOUBLE) \
+    X(arg, forecast_day_t, totalprecip_in, DOUBLE) \
+    X(arg, forecast_day_t, totalsnow_cm, DOUBLE) \
+    X(arg, forecast_day_t, avgvis_km, DOUBLE) \
+    X(arg, forecast_day_t, avgvis_miles, DOUBLE) \
+    X(arg, forecast_day_t, avghumidity, INT) \
+    X(arg, forecast_day_t, daily_will_it_rain, INT) \
+    X(arg, forecast_day_t, daily_chance_of_rain, INT) \
+    X(arg, forecast_day_t, daily_will_it_snow, INT) \
+    X(arg, forecast_day_t, daily_chance_of_snow, INT) \
+    X(arg, forecast_day_t, condition, CONDITION) \
+    X(arg, forecast_day_t, uv, DOUBLE)
+
+#define WEATHER_ASTRO_MEMBERS(X, arg) \
+    X(arg, astronomy_t, sunrise, STRING) \
+    X(arg, astronomy_t, sunset, STRING) \
+    X(arg, astronomy_t, moonrise, STRING) \
+    X(arg, astronomy_t, moonset, STRING) \
+    X(arg, astronomy_t, moon_phase, STRING) \
+    X(arg, astronomy_t, moon_illumination, INT)
+
+#define WEATHER_HOUR_MEMBERS(X, arg) \
+    X(arg, forecast_hour_t, time_epoch, LONG) \
+    X(arg, forecast_hour_t, time, TIME) \
+    X(arg, forecast_hour_t, temp_c, DOUBLE) \
+    X(arg, forecast_hour_t, temp_f, DOUBLE) \
+    X(arg, forecast_hour_t, is_day, INT) \
+    X(arg, forecast_hour_t, condition, CONDITION) \
+    X(arg, forecast_hour_t, wind_mph, DOUBLE) \
+    X(arg, forecast_hour_t, wind_kph, DOUBLE) \
+    X(arg, forecast_hour_t, wind_degree, INT) \
+    X(arg, forecast_hour_t, wind_dir, STRING) \
+    X(arg, forecast_hour_t, pressure_mb, DOUBLE) \
+    X(arg, forecast_hour_t, pressure_in, DOUBLE) \
+    X(arg, forecast_hour_t, precip_mm, DOUBLE) \
+    X(arg, forecast_hour_t, precip_in, DOUBLE) \
+    X(arg, forecast_hour_t, humidity, INT) \
+    X(arg, forecast_hour_t, cloud, INT) \
+    X(arg, forecast_hour_t, feelslike_c, DOUBLE) \
+    X(arg, forecast_hour_t, feelslike_f, DOUBLE) \
+    X(arg, forecast_hour_t, windchill_c, DOUBLE) \
+    X(arg, forecast_hour_t, windchill_f, DOUBLE) \
+    X(arg, forecast_hour_t, heatindex_c, DOUBLE) \
+    X(arg, forecast_hour_t, heatindex_f, DOUBLE) \
+    X(arg, forecast_hour_t, dewpoint_c, DOUBLE) \
+    X(arg, forecast_hour_t, dewpoint_f, DOUBLE) \
+    X(arg, forecast_hour_t, will_it_rain, INT) \
+    X(arg, forecast_hour_t, chance_of_rain, INT) \
+    X(arg, forecast_hour_t, will_it_snow, INT) \
+    X(arg, forecast_hour_t, chance_of_snow, INT) \
+    X(arg, forecast_hour_t, vis_km, DOUBLE) \
+    X(arg, forecast_hour_t, vis_miles, DOUBLE) \
+    X(arg, forecast_hour_t, gust_mph, DOUBLE) \
+    X(arg, forecast_hour_t, gust_kph, DOUBLE) \
+    X(arg, forecast_hour_t, uv, DOUBLE)
+
+/**
+ * Member types
+ */
+typedef enum {
+    WEATHER_MEMBER_STRING,
+    WEATHER_MEMBER_TIME,
+    WEATHER_MEMBER_DOUBLE,
+    WEATHER_MEMBER_INT,
+    WEATHER_MEMBER_LONG,
+    WEATHER_MEMBER_CONDITION
+} weather_member_type_t;
+
+// Projection fields per member: one, or one per condition member
+#define WEATHER_MEMBER_WIDTH_STRING 1
+#define WEATHER_MEMBER_WIDTH_TIME 1
+#define WEATHER_MEMBER_WIDTH_DOUBLE 1
+#define WEATHER_MEMBER_WIDTH_INT 1
+#define WEATHER_MEMBER_WIDTH_LONG 1
+#define WEATHER_MEMBER_WIDTH_CONDITION 3
+#define WEATHER_MEMBER_WIDTH(arg, s, m, type) + WEATHER_MEMBER_WIDTH_##type
+
+/**
+ * Fields a ?fields= projection can select
+ * Every scalar the weather endpoints write has an id; the ids of a struct's
+ * members are consecutive from its first id, in table order, with the three
+ * condition members in place of a CONDITION member. Only the first id of
+ * each struct is named.
+ */
+typedef enum {
+    WEATHER_FIELD_LOCATION = 0,
+    WEATHER_FIELD_CURRENT = WEATHER_FIELD_LOCATION WEATHER_LOCATION_MEMBERS(WEATHER_MEMBER_WIDTH, 0),
+    WEATHER_FIELD_DAILY = WEATHER_FIELD_CURRENT WEATHER_CURRENT_MEMBERS(WEATHER_MEMBER_WIDTH, 0),
+    WEATHER_FIELD_DAY = WEATHER_FIELD_DAILY WEATHER_DAILY_MEMBERS(WEATHER_MEMBER_WIDTH, 0),
+    WEATHER_FIELD_ASTRO = WEATHER_FIELD_DAY WEATHER_DAY_MEMBERS(WEATHER_MEMBER_WIDTH, 0),
+    WEATHER_FIELD_HOUR = WEATHER_FIELD_ASTRO WEATHER_ASTRO_MEMBERS(WEATHER_MEMBER_WIDTH, 0),
+    WEATHER_FIELD_COUNT = WEATHER_FIELD_HOUR WEATHER_HOUR_MEMBERS(WEATHER_MEMBER_WIDTH, 0)
+} weather_field_t;
+
+/**
+ * Field ranges of each container, as first, last arguments for weather_fields_any()
+ */
+#define WEATHER_FIELDS_LOCATION WEATHER_FIELD_LOCATION, WEATHER_FIELD_CURRENT - 1
+#define WEATHER_FIELDS_CURRENT WEATHER_FIELD_CURRENT, WEATHER_FIELD_DAILY - 1
+#define WEATHER_FIELDS_FORECAST WEATHER_FIELD_DAILY, WEATHER_FIELD_COUNT - 1
+#define WEATHER_FIELDS_DAY WEATHER_FIELD_DAY, WEATHER_FIELD_ASTRO - 1
+#define WEATHER_FIELDS_ASTRO WEATHER_FIELD_ASTRO, WEATHER_FIELD_HOUR - 1
+#define WEATHER_FIELDS_HOUR WEATHER_FIELD_HOUR, WEATHER_FIELD_COUNT - 1
+
+/**
+ * One member of a struct
+ */
+typedef struct {
+    const char *name;           // JSON member name
+    uint8_t type;               // weather_member_type_t
+    uint16_t size;              // Buffer size (strings)
+    uint32_t offset;            // Offset in the struct
+} weather_member_t;
+
+/**
+ * Member table of one struct, for generic loops
+ */
+typedef struct {
+    const char *path;           // Projection path of the struct ("forecast.hour"), NULL for conditions
+    const weather_member_t *members;
+    int count;                  // Members
+    int width;                  // Projection fields the members take
+    weather_field_t first;      // Field id of the first member (0 for conditions)
+} weather_schema_t;
+
+extern const weather_schema_t weather_schema_condition;
+extern const weather_schema_t weather_schema_location;
+extern const weather_schema_t weather_schema_current;
+extern const weather_schema_t weather_schema_daily;
+extern const weather_schema_t weather_schema_day;
+extern const weather_schema_t weather_schema_astro;
+extern const weather_schema_t weather_schema_hour;
+
+/**
+ * Set of selected fields, one bit per field id
+ * A NULL set stands for every field wherever one is accepted.
+ */
+typedef struct {
+    uint64_t bits[(WEATHER_FIELD_COUNT + 63) / 64];
+} weather_fields_t;
+
+/**
+ * Compile a ?fields= list into a set
+ * Names are comma separated field paths: a struct's path and a member
+ * ("forecast.hour.temp_c", "current.condition.text"); forecast day members
+ * are under "forecast" (the "forecastday" array is implied). A path such as
+ * "location", "forecast.hour" or "current.condition" selects all of its fields.
+ * @param list Comma-separated field paths
+ * @param fields Filled with the selected fields
+ * @param unknown Filled with the first name that matches no field ("" if
+ *                the list names nothing), may be NULL
+ * @param unknown_size Size of unknown
+ * @return 0 on success, -1 if a name is unknown or nothing is selected
+ */
+int weather_fields_parse(const char *list, weather_fields_t *fields, char *unknown, size_t unknown_size);
+
+/**
+ * Check whether a field is selected
+ * @param fields Set, or NULL for all fields
+ * @param field Field id
+ * @return 1 if selected, 0 otherwise
+ */
+int weather_fields_has(const weather_fields_t *fields, int field);
+
+/**
+ * Check whether any field of a range is selected
+ * @param fields Set, or NULL for all fields
+ * @param first First field of the range (e.g. WEATHER_FIELDS_HOUR)
+ * @param last Last field of the range
+ * @return 1 if any is selected, 0 otherwise
+ */
+int weather_fields_any(const weather_fields_t *fields, int first, int last);
+
+#endif // WEATHER_FIELDS_H
@@ -0,0 +1,189 @@
+#ifndef WEATHER_JSON_H
+#define WEATHER_JSON_H
+
+#include <stddef.h>
+#include "weather_types.h"
+#include "weather_fields.h"
+
+#define WEATHER_JSON_MAX_DEPTH 16           // Deepest nesting the writer supports
+#define WEATHER_JSON_MAX_PRECISION 6        // Most fraction digits a writer can round to
+#define WEATHER_JSON_SHORTEST (-1)          // Precision: shortest text that reads back exactly
+#define WEATHER_JSON_DAY_CONTEXT "{{["      // Containers around each forecast day
+#define WEATHER_JSON_ROOT_CONTEXT "{"       // Containers around the tail of a forecast without days
+
+/**
+ * Per-request arenas for cJSON
+ * weather_json_init() installs cJSON allocation hooks. Between
+ * weather_json_scope_begin() and weather_json_scope_end(), every cJSON node,
+ * key, string and printed document created on the calling thread is
+ * bump-allocated from a block that thread keeps, and all of it is released
+ * at once when the scope ends (cJSON_Delete() and cJSON_free() only skip
+ * it). Outside a scope cJSON uses the heap as before.
+ *
+ * Nothing allocated inside a scope may outlive it: copy printed output
+ * (e.g. MHD_RESPMEM_MUST_COPY) before the scope ends, and free cJSON
+ * strings with cJSON_free(), never free(). Scopes do not nest.
+ */
+
+/**
+ * cJSON allocation counters (all threads)
+ */
+typedef struct {
+    unsigned long scopes;           // Scopes ended
+    unsigned long arena_allocs;     // Allocations served from a scope's arena
+    unsigned long heap_allocs;      // Allocations that went to malloc (including arena blocks)
+} weather_json_stats_t;
+
+/**
+ * Install the cJSON allocation hooks
+ * Call once at startup, before any thread uses cJSON.
+ * @param use_arena 1 to bump-allocate inside scopes, 0 to keep every cJSON
+ *                  allocation on the heap (allocations are still counted)
+ */
+void weather_json_init(int use_arena);
+
+/**
+ * Start a scope on the calling thread (no-op before weather_json_init)
+ */
+void weather_json_scope_begin(void);
+
+/**
+ * End the calling thread's scope, releasing everything allocated in it
+ * The thread keeps its largest block for the next scope.
+ */
+void weather_json_scope_end(void);
+
+/**
+ * Read the allocation counters
+ * @param stats Filled with the counters
+ */
+void weather_json_get_stats(weather_json_stats_t *stats);
+
+/**
+ * Streaming JSON writer
+ * Writes members straight into one growable buffer, without building a
+ * tree. Compact output is byte-identical to cJSON_PrintUnformatted() of the
+ * same members, pretty output to cJSON_Print(). Numbers are written in the
+ * shortest form that reads back as the same double (as cJSON does, via
+ * %1.15g/%1.17g only when no short decimal matches), or rounded to a fixed
+ * number of fraction digits. The weather body writers can be limited to a
+ * projection (weather_fields.h); containers left without members are omitted.
+ */
+typedef struct {
+    char *data;                 // Output so far (NULL until the first write)
+    size_t length;
+    size_t capacity;
+    int pretty;                 // cJSON_Print() layout (tabs and newlines)
+    int precision;              // Fraction digits numbers are rounded to, or WEATHER_JSON_SHORTEST
+    int depth;                  // Open containers
+    int first;                  // Next value is the first of its container
+    int failed;                 // Out of memory or nesting too deep
+    const weather_fields_t *fields; // Fields the weather body writers write (NULL for all)
+    char containers[WEATHER_JSON_MAX_DEPTH]; // '{' or '[' per open container
+} weather_json_writer_t;
+
+/**
+ * Initialize a writer
+ * @param writer Writer to initialize
+ * @param pretty 1 for the cJSON_Print() layout, 0 for compact output
+ * @param precision Fraction digits to round numbers to (0 to WEATHER_JSON_MAX_PRECISION),
+ *                  or WEATHER_JSON_SHORTEST
+ */
+void weather_json_writer_init(weather_json_writer_t *writer, int pretty, int precision);
+
+/**
+ * Limit the weather body writers to a projection
+ * @param writer Writer
+ * @param fields Fields to write, or NULL for all; must outlive the writer
+ */
+void weather_json_writer_project(weather_json_writer_t *writer, const weather_fields_t *fields);
+
+/**
+ * Continue inside containers opened in another writer's output
+ * For writing a fragment on its own: the writer separates, indents and
+ * closes as if it had opened them.
+ * @param writer Writer with nothing written yet
+ * @param containers '{' or '[' per open container, outermost first
+ */
+void weather_json_writer_enter(weather_json_writer_t *writer, const char *containers);
+
+/**
+ * Take the output of a writer
+ * Containers still open are left open (a fragment).
+ * @param writer Writer
+ * @param length Set to the output length (excluding the terminating NUL)
+ * @return NUL-terminated output to release with free(), or NULL if writing failed
+ */
+char *weather_json_writer_finish(weather_json_writer_t *writer, size_t *length);
+
+/**
+ * Discard a writer's output (after an error)
+ * @param writer Writer to release
+ */
+void weather_json_writer_free(weather_json_writer_t *writer);
+
+/**
+ * Open and close objects and arrays
+ * @param writer Writer
+ * @param key Member name inside an object, NULL inside an array or at the top level
+ */
+void weather_json_begin_object(weather_json_writer_t *writer, const char *key);
+void weather_json_end_object(weather_json_writer_t *writer);
+void weather_json_begin_array(weather_json_writer_t *writer, const char *key);
+void weather_json_end_array(weather_json_writer_t *writer);
+
+/**
+ * Write a value
+ * weather_json_fixed() writes a scaled integer such as tenths of a degree
+ * (value 253, decimals 1 is 25.3) without going through a double.
+ * @param writer Writer
+ * @param key Member name inside an object, NULL inside an array or at the top level
+ * @param value Value to write (a NULL string is written as "")
+ * @param decimals Fraction digits in value (weather_json_fixed only)
+ */
+void weather_json_string(weather_json_writer_t *writer, const char *key, const char *value);
+void weather_json_number(weather_json_writer_t *writer, const char *key, double value);
+void weather_json_int(weather_json_writer_t *writer, const char *key, long long value);
+void weather_json_fixed(weather_json_writer_t *writer, const char *key, long long value, int decimals);
+
+/**
+ * Write a /current response body
+ * @param writer Writer (empty)
+ * @param response Current weather
+ */
+void weather_json_write_current(weather_json_writer_t *writer, const weather_response_t *response);
+
+/**
+ * Write a /forecast response body
+ * Hourly data is read straight from the compact hours, which must be loaded.
+ * @param writer Writer (empty)
+ * @param result Forecast result or view
+ * @param include_hourly Layout of each day's hours (weather_hourly_t, 0 for none)
+ */
+void weather_json_write_forecast(weather_json_writer_t *writer, const weather_result_t *result, int include_hourly);
+
+/**
+ * Write a /forecast response body in pieces
+ * The body is the head, then each day (preceded by weather_json_day_separator()
+ * from the second day on), then the tail. Each piece can be written by its
+ * own writer: days and the tail after weather_json_writer_enter() with
+ * WEATHER_JSON_DAY_CONTEXT. A projection without forecast fields has no
+ * days, and its tail is written after entering WEATHER_JSON_ROOT_CONTEXT.
+ * @param writer Writer
+ * @param result Forecast result or view
+ * @param day Day index
+ * @param include_hourly Layout of the day's hours (weather_hourly_t, 0 for none)
+ */
+void weather_json_write_forecast_head(weather_json_writer_t *writer, const weather_result_t *result);
+void weather_json_write_forecast_day(weather_json_writer_t *writer, const weather_result_t *result, int day,
+                                     int include_hourly);
+void weather_json_write_forecast_tail(weather_json_writer_t *writer);
+
+/**
+ * Text between two forecast days
+ * @param pretty 1 for the indented layout
+ * @return Static string
+ */
+const char *weather_json_day_separator(int pretty);
+
+#endif // WEATHER_JSON_H
@@ -0,0 +1,133 @@
+#ifndef WEATHER_LOCATION_H
+#define WEATHER_LOCATION_H
+
+#include <stddef.h>
+#include "weather_types.h"
+
+#define WEATHER_LOCATION_SIZE 256               // Normalized and canonical queries, including the terminator
+#define WEATHER_LOCATION_DECIMALS 2             // Coordinates are keyed to 0.01 degree (about 1 km)
+#define WEATHER_LOCATION_ALIAS_SECONDS 604800   // A learned alias is trusted for a week
+#define WEATHER_LOCATION_REJECT_SECONDS 3600    // A query upstream rejected fails locally this long
+#define WEATHER_LOCATION_MAX_ENTRIES 65536      // Aliases and rejections kept, oldest dropped first
+#define WEATHER_LOCATION_POINT_SIZE 32          // Canonical "lat,lon" of a cached point, including the terminator
+#define WEATHER_LOCATION_NEARBY_MAX 4           // Nearest cached points a lookup returns
+#define WEATHER_LOCATION_MAX_RADIUS_KM 100.0    // Largest nearby radius accepted
+
+/**
+ * Location index statistics
+ */
+typedef struct {
+    size_t entries;                     // Aliases and rejections currently kept
+    unsigned long learned;              // Aliases learned from upstream results
+    unsigned long alias_hits;           // Queries keyed by a learned alias
+    unsigned long rejections;           // Queries upstream rejected
+    unsigned long rejected_hits;        // Requests refused locally as rejected
+    size_t points;                      // Cached coordinates in the spatial index
+    unsigned long nearby_lookups;       // Coordinate queries searched for nearby points
+} weather_location_stats_t;
+
+/**
+ * Cached point near a coordinate query
+ */
+typedef struct {
+    char location[WEATHER_LOCATION_POINT_SIZE]; // Canonical form of the point
+    double distance_km;                         // Great-circle distance from the query
+} weather_location_match_t;
+
+/**
+ * Normalize a location query
+ * ASCII is lowercased, Latin-1 and Latin Extended-A letters are folded to
+ * their base letters ("Zürich" and "zurich", "Málaga" and "malaga"),
+ * whitespace is trimmed and collapsed and dropped around commas. A
+ * "lat,lon" query is rewritten with WEATHER_LOCATION_DECIMALS fraction
+ * digits, so nearby coordinates share one key.
+ * @param query Location query
+ * @param out Buffer for the normalized query
+ * @param out_size Size of out (WEATHER_LOCATION_SIZE is always enough for
+ *                 queries that fit in a request)
+ */
+void weather_location_normalize(const char *query, char *out, size_t out_size);
+
+/**
+ * Canonical form of a query, which cache keys are built from
+ * Once upstream has resolved a query, its normalized form is an alias for
+ * the coordinates upstream answered with, written like a normalized
+ * coordinate query. "Paros", "paros, greece" and "37.08,25.15" then all
+ * have the canonical form "37.08,25.15". Queries not resolved yet are
+ * their normalized form.
+ * @param query Location query
+ * @param out Buffer for the canonical form
+ * @param out_size Size of out
+ */
+void weather_location_canonical(const char *query, char *out, size_t out_size);
+
+/**
+ * Learn where upstream resolved a query
+ * @param query Location query that was sent upstream
+ * @param location The location of upstream's answer (name, lat and lon)
+ */
+void weather_location_learn(const char *query, const location_t *location);
+
+/**
+ * Remember that upstream has no location matching a query
+ * @param query Location query that was sent upstream
+ */
+void weather_location_reject(const char *query);
+
+/**
+ * Check whether a query was rejected in the last WEATHER_LOCATION_REJECT_SECONDS
+ * @param query Location query
+ * @return 1 if it should fail without asking upstream, 0 otherwise
+ */
+int weather_location_rejected(const char *query);
+
+/**
+ * Set the radius of nearby lookups and size the spatial index for it
+ * Call before any point is added; 0 (the default) turns the index off.
+ * @param radius_km Radius in km, at most WEATHER_LOCATION_MAX_RADIUS_KM
+ */
+void weather_location_set_radius(double radius_km);
+
+/**
+ * Count one more cache entry at a canonical location
+ * Canonical forms that are not coordinates are ignored, so every cache
+ * key can be passed through.
+ * @param canonical Canonical form from the entry's key (not terminated)
+ * @param length Length of canonical
+ */
+void weather_location_point_add(const char *canonical, size_t length);
+
+/**
+ * Count one cache entry less at a canonical location, dropping the point
+ * with its last entry
+ * @param canonical Canonical form from the entry's key (not terminated)
+ * @param length Length of canonical
+ */
+void weather_location_point_remove(const char *canonical, size_t length);
+
+/**
+ * Find cached points within the radius of a "lat,lon" query
+ * Points are kept in a grid of cells half a radius wide, so a lookup reads
+ * the few cells around the query, nearest rows first. Distance is
+ * great-circle distance on a spherical Earth; elevation is ignored.
+ * @param query Location query (anything but a coordinate pair finds nothing)
+ * @param exclude Canonical form already looked up, or NULL
+ * @param matches Filled with the nearest points, nearest first
+ * @param max_matches Size of matches
+ * @return Number of matches
+ */
+int weather_location_nearby(const char *query, const char *exclude,
+                            weather_location_match_t *matches, int max_matches);
+
+/**
+ * Forget every alias, rejection and point
+ */
+void weather_location_cleanup(void);
+
+/**
+ * Get location index statistics
+ * @param stats Filled with the current counters
+ */
+void weather_location_get_stats(weather_location_stats_t *stats);
+
+#endif // WEATHER_LOCATION_H
@@ -0,0 +1,135 @@
+#ifndef WEATHER_PARSER_H
+#define WEATHER_PARSER_H
+
+#include <stddef.h>
+#include "weather_types.h"
+
+/**
+ * Forecast sections that can be left unparsed until first access
+ */
+#define WEATHER_SECTION_CURRENT 0x1     // Top-level "current" block
+#define WEATHER_SECTION_ASTRO 0x2       // Each day's "astro" block
+#define WEATHER_SECTION_HOURS 0x4       // Each day's "hour" array
+#define WEATHER_SECTION_ALL 0x7
+
+/**
+ * Incremental parser for WeatherAPI.com current.json and forecast.json bodies
+ * The body is fed in arbitrary chunks as it is received and parsed straight
+ * into the result structs, without building a JSON tree. Field names are
+ * dispatched through a perfect hash; unknown fields are skipped.
+ */
+typedef struct weather_parser weather_parser_t;
+
+/**
+ * Unparsed forecast sections retained by a result
+ */
+typedef struct weather_lazy weather_lazy_t;
+
+/**
+ * Create a parser that fills a result
+ * result->is_forecast selects whether result->current or result->forecast
+ * is filled. The target must be zeroed. Hourly forecasts are packed into
+ * result->hours (weather_compact.h).
+ * Forecast sections named in lazy_sections are only scanned for their closing
+ * bracket; their bytes are kept in result->lazy and parsed (and fully checked)
+ * by weather_result_load(). A lazy current block still fills
+ * current.last_updated_epoch, which the cache needs.
+ * @param result Result to fill (must outlive the parser)
+ * @param lazy_sections WEATHER_SECTION_* flags to defer (0 parses everything)
+ * @return New parser, or NULL on allocation failure
+ */
+weather_parser_t *weather_parser_create(weather_result_t *result, unsigned int lazy_sections);
+
+/**
+ * Feed the next chunk of the body
+ * @param parser Parser from weather_parser_create()
+ * @param data Chunk of the body (need not end on a token boundary)
+ * @param length Length of the chunk
+ * @return 0 on success, -1 on a syntax error (the parser stays failed)
+ */
+int weather_parser_feed(weather_parser_t *parser, const char *data, size_t length);
+
+/**
+ * Finish parsing once the whole body has been fed
+ * On success the forecast days and their hours are moved into one arena
+ * sized for them (weather_arena.h) and any retained sections are handed to
+ * result->lazy. On failure the days stay in the parser's scratch space and
+ * are taken back from the result by weather_parser_free().
+ * @param parser Parser from weather_parser_create()
+ * @return 0 if the body was a complete JSON document, -1 otherwise
+ */
+int weather_parser_finish(weather_parser_t *parser);
+
+/**
+ * Free a parser (a result it filled successfully is not touched)
+ * @param parser Parser to free (may be NULL)
+ */
+void weather_parser_free(weather_parser_t *parser);
+
+/**
+ * Location of a WeatherAPI bulk response
+ * @param custom_id The custom_id sent with the location (not terminated)
+ * @param id_length Length of custom_id
+ * @param data The location's "query" object, which parses like a
+ *             single-location body of the same endpoint
+ * @param length Length of data
+ * @param failed Whether upstream answered this location with an error
+ * @param user_data Opaque pointer passed to weather_parser_split_bulk()
+ */
+typedef void (*weather_bulk_callback_t)(const char *custom_id, size_t id_length,
+                                        const char *data, size_t length, int failed, void *user_data);
+
+/**
+ * Split a complete bulk response ({"bulk": [{"query": {...}}, ...]}) by location
+ * Only the nesting is scanned here; each location is parsed separately, so
+ * one malformed location fails no other.
+ * @param data The whole response body
+ * @param length Length of the body
+ * @param callback Called for each location that carries a custom_id
+ * @param user_data Opaque pointer passed to the callback
+ * @return 0 on success, -1 if the body is not a bulk response
+ */
+int weather_parser_split_bulk(const char *data, size_t length, weather_bulk_callback_t callback, void *user_data);
+
+/**
+ * Read the code of a WeatherAPI error body ({"error": {"code": N, ...}})
+ * Also reads the "query" object of a failed bulk location.
+ * @param data Complete body or object
+ * @param length Length of data
+ * @return The error code, or 0 if there is none
+ */
+int weather_parser_error_code(const char *data, size_t length);
+
+/**
+ * Parse retained sections of a shared result on first access
+ * Safe to call from several threads on the same result; each section is
+ * parsed once. For a view, only the days it covers are parsed, in its source.
+ * @param result Forecast result or view
+ * @param sections WEATHER_SECTION_* flags that must be valid on return
+ * @return 0 on success, -1 on allocation failure or a malformed section
+ */
+int weather_result_load(weather_result_t *result, unsigned int sections);
+
+/**
+ * Deep copy a forecast, parsing retained sections into the copy only
+ * Lets a private copy see every field without growing the shared result.
+ * @param result Forecast result or view
+ * @param copy Filled with arrays owned by the caller (forecast_response_free)
+ * @return 0 on success, -1 on allocation failure or a malformed section
+ */
+int weather_result_copy_forecast(weather_result_t *result, forecast_response_t *copy);
+
+/**
+ * Bytes held by retained sections (they are freed once all are parsed)
+ * @param lazy Retained sections (may be NULL)
+ * @return Size in bytes
+ */
+size_t weather_lazy_bytes(const weather_lazy_t *lazy);
+
+/**
+ * Free retained sections
+ * @param lazy Retained sections (may be NULL)
+ */
+void weather_lazy_free(weather_lazy_t *lazy);
+
+#endif // WEATHER_PARSER_H
@@ -170,6 +170,28 @@ typedef struct {
     int forecast_days;          // Number of forecast days
 } forecast_response_t;
 
+/**
+ * Reference-counted parsed upstream result
+ * Shared read-only between the response cache and every caller of the same
+ * upstream request; see weather_result_retain/weather_result_release.
+ * A view (source != NULL) borrows its forecast days from the source result
+ * it holds a reference to, e.g. a 3-day answer cut from a cached 14-day one.
+ * Forecast sections still held as raw JSON (lazy != NULL) are only valid
+ * after weather_result_load() (weather_parser.h).
+ * Hourly forecasts are kept in compact form in hours (weather_compact.h), one
+ * entry per forecast day; forecast_daily_t.hour stays NULL in a result.
+ */
+typedef struct weather_result {
+    int refcount;               // Number of holders
+    int is_forecast;            // Which of the members below holds the data
+    weather_response_t current; // Current weather (is_forecast == 0)
+    forecast_response_t forecast; // Forecast (is_forecast == 1)
+    struct weather_hours *hours; // Compact hours parallel to forecast.forecast (owners only)
+    struct weather_lazy *lazy;  // Sections parsed on first access (NULL if none)
+    struct weather_result *source; // Result owning the forecast days (views only)
+    struct weather_body *bodies; // Response fragments rendered from it (owners only, weather_body.h)
+} weather_result_t;
+
 /**
  * HTTP response structure
  */
@@ -186,6 +208,15 @@ typedef struct {
     char api_key[256];          // API key
     char base_url[512];         // Base URL for API
     int timeout;                // Request timeout in seconds
+    size_t cache_bytes;         // Response cache budget in bytes (0 = disabled)
+    int connect_timeout;        // Connect timeout in seconds (0 = default)
+    int retries;                // Extra attempts for a failed upstream request
+    int hedge;                  // Send a second request when the first is slower than the p95
+    int breaker_threshold;      // Consecutive upstream failures that open the circuit breaker (0 = never)
+    int max_upstream;           // Ceiling of the adaptive upstream concurrency limit (0 = unlimited)
+    int batch_window_ms;        // Collect upstream misses this long into one bulk request (0 = no batching)
+    int batch_max;              // Locations that send a batch before its window closes (2-50)
+    double nearby_km;           // Answer "lat,lon" queries from cached points this close (0 = exact only)
 } weather_config_t;
 
 /**
@@ -194,11 +225,17 @@ typedef struct {
 typedef struct {
     int port;                   // Server port
     int max_connections;        // Maximum concurrent connections
+    int thread_pool_size;       // Worker threads (1 = single internal polling thread)
     char bind_address[64];      // IP address to bind to
     int enable_cors;            // Enable CORS headers
     char slack_bot_token[256];  // Slack Bot OAuth Token
     char slack_app_id[64];      // Slack App ID (to ignore own messages)
     char slack_signing_secret[256]; // Slack Signing Secret (for request verification)
+    char snapshot_path[512];    // Cache snapshot written periodically and at shutdown (empty = disabled)
+    char warm_from_path[512];   // Cache snapshot loaded at startup (empty = cold start)
+    int snapshot_interval;      // Seconds between periodic snapshots (0 = only at shutdown)
+    int json_arena;             // Allocate each request's cJSON trees from a per-thread arena
+    int body_cache;             // Keep rendered response fragments with cached results
 } server_config_t;
 
 /**
@@ -220,6 +257,15 @@ typedef struct {
     int include_hourly;         // Include hourly forecast details
 } forecast_request_t;
 
+/**
+ * Layouts of forecast hours in a response
+ */
+typedef enum {
+    WEATHER_HOURLY_NONE = 0,    // No hours
+    WEATHER_HOURLY_ROWS = 1,    // One object per hour
+    WEATHER_HOURLY_COLUMNS = 2  // One array per member, in hour order (?layout=columnar)
+} weather_hourly_t;
+
 /**
  * API error response structure
  */
@@ -0,0 +1,83 @@
+#ifndef WEATHER_UPSTREAM_H
+#define WEATHER_UPSTREAM_H
+
+#include "weather_types.h"
+
+#define WEATHER_UPSTREAM_BREAKER_SECONDS 10     // Fail fast this long before probing upstream again
+#define WEATHER_UPSTREAM_MIN_LIMIT 2            // The adaptive limit never drops below this
+#define WEATHER_UPSTREAM_HEDGE_SAMPLES 20       // Latencies needed before hedging by the p95
+#define WEATHER_UPSTREAM_HEDGE_MIN_MS 10        // Never hedge sooner than this
+
+/**
+ * Circuit breaker states
+ */
+typedef enum {
+    WEATHER_BREAKER_CLOSED,             // Requests go upstream
+    WEATHER_BREAKER_OPEN,               // Requests fail fast
+    WEATHER_BREAKER_HALF_OPEN           // One probe request is upstream
+} weather_breaker_state_t;
+
+/**
+ * Outcome of an admitted upstream request
+ */
+typedef enum {
+    WEATHER_UPSTREAM_SUCCESS,           // Answered, including client errors such as an unknown location
+    WEATHER_UPSTREAM_FAILURE,           // Transport error, timeout, 429 or 5xx after every attempt
+    WEATHER_UPSTREAM_ABANDONED          // Never sent; leaves the breaker and limit as they were
+} weather_upstream_outcome_t;
+
+/**
+ * Upstream health statistics
+ */
+typedef struct {
+    int breaker;                        // weather_breaker_state_t
+    unsigned long breaker_trips;        // Times the breaker opened
+    unsigned long shed;                 // Requests refused while open or at the limit
+    unsigned long failures;             // Requests that failed upstream
+    int in_flight;                      // Admitted requests not yet finished
+    int limit;                          // Current concurrency limit (0 = unlimited)
+    long p95_ms;                        // Time to first byte, 95th percentile (0 until known)
+} weather_upstream_stats_t;
+
+/**
+ * Initialize upstream admission control
+ * The circuit breaker opens after config->breaker_threshold consecutive
+ * failures and refuses requests for WEATHER_UPSTREAM_BREAKER_SECONDS, then
+ * lets one probe through: its success closes the breaker, its failure opens
+ * it again. Independently, the number of concurrent upstream requests is
+ * capped by a limit that starts at config->max_upstream, drops by a quarter
+ * on every failure, shrinks in proportion as latency rises above twice its
+ * long-term average, and grows back while upstream keeps its usual latency
+ * and the limit is in use, never below WEATHER_UPSTREAM_MIN_LIMIT.
+ * @param config breaker_threshold (0 = never opens) and max_upstream (0 = unlimited)
+ */
+void weather_upstream_init(const weather_config_t *config);
+
+/**
+ * Ask to send a request upstream
+ * @return 0 if admitted (report it with weather_upstream_release()), -1 if
+ *         the breaker is open or the concurrency limit is reached
+ */
+int weather_upstream_acquire(void);
+
+/**
+ * Report how an admitted request ended
+ * @param outcome weather_upstream_outcome_t
+ * @param latency_seconds Time to the first byte of a 200 body (0 when there was none)
+ */
+void weather_upstream_release(weather_upstream_outcome_t outcome, double latency_seconds);
+
+/**
+ * Delay after which an upstream request is hedged
+ * @return The observed p95 time to first byte in milliseconds, or 0 until
+ *         WEATHER_UPSTREAM_HEDGE_SAMPLES requests have been measured
+ */
+long weather_upstream_hedge_delay_ms(void);
+
+/**
+ * Get upstream health statistics
+ * @param stats Filled with the current state and counters
+ */
+void weather_upstream_get_stats(weather_upstream_stats_t *stats);
+
+#endif // WEATHER_UPSTREAM_H
@@ -1,10 +1,95 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <time.h>
 #include <curl/curl.h>
 #include "http_client.h"
 
+#define HANDLE_POOL_SIZE 32          // Idle easy handles kept for reuse
+#define DEFAULT_TIMEOUT_SECONDS 30
+#define DEFAULT_CONNECT_TIMEOUT_SECONDS 5
+#define MAX_RUNNING_ATTEMPTS 2       // An attempt and its hedge
+#define MAX_BACKOFF_SHIFT 10         // Retry backoff stops doubling after this many attempts
+#define REACTOR_POLL_MS 1000         // Longest reactor sleep when no retry or hedge is due
+
 static int curl_initialized = 0;
+static long request_timeout = DEFAULT_TIMEOUT_SECONDS;
+static long connect_timeout = DEFAULT_CONNECT_TIMEOUT_SECONDS;
+
+/**
+ * Share object: DNS cache, TLS sessions and open connections shared by every handle and thread
+ */
+static CURLSH *share_handle = NULL;
+static pthread_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+/**
+ * Pool of idle easy handles (their connections live in the share object)
+ */
+static CURL *handle_pool[HANDLE_POOL_SIZE];
+static int handle_pool_count = 0;
+static pthread_mutex_t handle_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct http_async_request http_async_request_t;
+
+/**
+ * One transfer of an asynchronous request: the first, a retry or a hedge
+ */
+typedef struct {
+    CURL *curl;
+    http_response_t response;           // Buffered body (only non-200 bodies when streamed)
+    http_async_request_t *request;
+    long long started_ms;               // Monotonic start time
+    int hedge;                          // Started alongside a slow attempt
+    int cancelled;                      // Lost to the other attempt; freed by the reactor
+} http_attempt_t;
+
+/**
+ * Asynchronous request owned by the reactor
+ */
+struct http_async_request {
+    char *url;
+    char *post_body;                    // JSON body to POST (NULL for a GET)
+    struct curl_slist *headers;         // Request headers of a POST
+    http_request_policy_t policy;
+    http_attempt_t *running[MAX_RUNNING_ATTEMPTS];
+    http_attempt_t *winner;             // Attempt whose response is delivered
+    int attempts;                       // Attempts started so far
+    int hedged;                         // A hedge was started (at most one per request)
+    long long deadline_ms;              // Monotonic time every attempt must finish by
+    long long retry_ms;                 // Monotonic time the next retry is due (0 = none)
+    http_response_t failure;            // Response of the last failed attempt
+    int failure_result;                 // Its transfer result (0 = got a status, -1 = transport error)
+    int completed;                      // Callback invoked; freed by the reactor
+    http_body_callback_t body_callback;     // Receives 200 bodies instead of the buffer (optional)
+    http_completion_callback_t callback;
+    void *user_data;
+    struct http_async_request *next;
+};
+
+/**
+ * Shared curl_multi reactor state
+ */
+static CURLM *reactor_multi = NULL;
+static pthread_t reactor_thread;
+static pthread_mutex_t reactor_lock = PTHREAD_MUTEX_INITIALIZER;
+static http_async_request_t *reactor_submitted = NULL;  // Queued, not yet added to the multi handle
+static http_async_request_t *reactor_active = NULL;     // Added to the multi handle
+static int reactor_started = 0;
+static int reactor_shutdown = 0;                        // Set while cleanup is in progress
+static volatile int reactor_running = 0;
+static unsigned int reactor_random;                     // rand_r() state for retry jitter
+static http_client_stats_t client_stats;
+
+/**
+ * Milliseconds on the monotonic clock
+ */
+static long long monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
 /**
  * Callback function to write received data into our response structure
@@ -27,7 +112,161 @@ static size_t write_callback(void *contents, size_t size, size_t nmemb, http_res
     return realsize;
 }
 
-int http_client_init(void) {
+/**
+ * Make an attempt the one whose response is delivered
+ * Other running attempts are cancelled; the reactor frees them outside of
+ * libcurl callbacks.
+ */
+static void request_choose_winner(http_async_request_t *request, http_attempt_t *attempt) {
+    request->winner = attempt;
+    for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+        if (request->running[i] && request->running[i] != attempt) {
+            request->running[i]->cancelled = 1;
+        }
+    }
+    if (attempt->hedge) {
+        __atomic_add_fetch(&client_stats.hedge_wins, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Write callback for streamed requests
+ * Once the final status is known to be 200, body chunks go straight to the
+ * body callback; anything else (errors, redirect bodies) is buffered. The
+ * first attempt to start a 200 body wins, so the body callback only ever
+ * sees one attempt's bytes.
+ */
+static size_t stream_write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    http_attempt_t *attempt = userp;
+    http_async_request_t *request = attempt->request;
+    size_t realsize = size * nmemb;
+    
+    if (attempt->cancelled) {
+        return 0;
+    }
+    
+    long status_code = 0;
+    curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &status_code);
+    if (status_code != 200) {
+        return write_callback(contents, size, nmemb, &attempt->response);
+    }
+    
+    if (!request->winner) {
+        request_choose_winner(request, attempt);
+    }
+    
+    // Returning short aborts the transfer with CURLE_WRITE_ERROR
+    return request->body_callback(contents, realsize, request->user_data) == 0 ? realsize : 0;
+}
+
+/**
+ * Apply the options shared by every request to an easy handle
+ */
+static void setup_easy_handle(CURL *curl, const char *url, http_response_t *response) {
+    // Set URL
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    
+    // Set callback function to write received data
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+    
+    // Follow redirects
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    
+    // Set timeout (weather_config_t.timeout)
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, request_timeout);
+    
+    // Give up early on unreachable hosts and stalled transfers
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, connect_timeout);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)HTTP_LOW_SPEED_BYTES);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)HTTP_LOW_SPEED_SECONDS);
+    
+    // Never use signals for timeouts; requests run on several threads
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    
+    // Share DNS cache, TLS sessions and connections, keep them alive, accept compressed bodies
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_handle);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+    
+    // Set User-Agent
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Weather-Service/1.0");
+    
+    // Verify SSL certificates
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+}
+
+/**
+ * Initialize an empty response buffer
+ */
+static int response_init(http_response_t *response) {
+    response->data = malloc(1);
+    response->size = 0;
+    response->status_code = 0;
+    
+    if (!response->data) {
+        fprintf(stderr, "Failed to allocate memory for response\n");
+        return -1;
+    }
+    response->data[0] = '\0';
+    return 0;
+}
+
+/**
+ * Share object lock callbacks: one mutex per shared data type
+ */
+static void share_lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+    (void)handle;
+    (void)access;
+    (void)userptr;
+    pthread_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle, curl_lock_data data, void *userptr) {
+    (void)handle;
+    (void)userptr;
+    pthread_mutex_unlock(&share_locks[data]);
+}
+
+/**
+ * Take an idle easy handle from the pool, or create a new one
+ */
+static CURL *acquire_handle(void) {
+    CURL *curl = NULL;
+    
+    pthread_mutex_lock(&handle_pool_lock);
+    if (handle_pool_count > 0) {
+        curl = handle_pool[--handle_pool_count];
+    }
+    pthread_mutex_unlock(&handle_pool_lock);
+    
+    if (!curl) {
+        curl = curl_easy_init();
+    }
+    return curl;
+}
+
+/**
+ * Return an easy handle to the pool
+ * curl_easy_reset() clears per-request options; open connections stay in the share object.
+ */
+static void release_handle(CURL *curl) {
+    curl_easy_reset(curl);
+    
+    pthread_mutex_lock(&handle_pool_lock);
+    if (handle_pool_count < HANDLE_POOL_SIZE) {
+        handle_pool[handle_pool_count++] = curl;
+        curl = NULL;
+    }
+    pthread_mutex_unlock(&handle_pool_lock);
+    
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+}
+
+int http_client_init(int timeout_seconds, int connect_timeout_seconds) {
     if (curl_initialized) {
         return 0; // Already initialized
     }
@@ -38,12 +277,430 @@ int http_client_init(void) {
         return -1;
     }
     
+    share_handle = curl_share_init();
+    if (!share_handle) {
+        fprintf(stderr, "curl_share_init() failed\n");
+        curl_global_cleanup();
+        return -1;
+    }
+    
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&share_locks[i], NULL);
+    }
+    curl_share_setopt(share_handle, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share_handle, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    
+    request_timeout = timeout_seconds > 0 ? timeout_seconds : DEFAULT_TIMEOUT_SECONDS;
+    connect_timeout = connect_timeout_seconds > 0 ? connect_timeout_seconds : DEFAULT_CONNECT_TIMEOUT_SECONDS;
+    if (connect_timeout > request_timeout) {
+        connect_timeout = request_timeout;
+    }
     curl_initialized = 1;
+    reactor_shutdown = 0;
+    return 0;
+}
+
+/**
+ * Free an attempt, taking its transfer off the multi handle if it is on it
+ */
+static void attempt_free(http_attempt_t *attempt) {
+    if (attempt->curl) {
+        curl_multi_remove_handle(reactor_multi, attempt->curl);
+        release_handle(attempt->curl);
+    }
+    http_response_free(&attempt->response);
+    free(attempt);
+}
+
+/**
+ * Number of attempts of a request still transferring
+ */
+static int request_running(const http_async_request_t *request) {
+    int count = 0;
+    for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+        if (request->running[i]) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Start an attempt of a request with whatever is left of its deadline
+ * @param hedge Whether the attempt runs alongside a slow one
+ */
+static int attempt_start(http_async_request_t *request, long long now, int hedge) {
+    int slot = 0;
+    while (slot < MAX_RUNNING_ATTEMPTS && request->running[slot]) {
+        slot++;
+    }
+    if (slot == MAX_RUNNING_ATTEMPTS || now >= request->deadline_ms) {
+        return -1;
+    }
+    
+    http_attempt_t *attempt = calloc(1, sizeof(http_attempt_t));
+    if (!attempt) {
+        fprintf(stderr, "Failed to allocate request attempt\n");
+        return -1;
+    }
+    if (response_init(&attempt->response) != 0) {
+        free(attempt);
+        return -1;
+    }
+    attempt->curl = acquire_handle();
+    if (!attempt->curl) {
+        fprintf(stderr, "Failed to initialize curl handle\n");
+        attempt_free(attempt);
+        return -1;
+    }
+    attempt->request = request;
+    attempt->started_ms = now;
+    attempt->hedge = hedge;
+    
+    setup_easy_handle(attempt->curl, request->url, &attempt->response);
+    curl_easy_setopt(attempt->curl, CURLOPT_TIMEOUT_MS, (long)(request->deadline_ms - now));
+    curl_easy_setopt(attempt->curl, CURLOPT_PRIVATE, attempt);
+    if (request->body_callback) {
+        curl_easy_setopt(attempt->curl, CURLOPT_WRITEFUNCTION, stream_write_callback);
+        curl_easy_setopt(attempt->curl, CURLOPT_WRITEDATA, attempt);
+    }
+    if (request->post_body) {
+        curl_easy_setopt(attempt->curl, CURLOPT_POSTFIELDS, request->post_body);
+        curl_easy_setopt(attempt->curl, CURLOPT_HTTPHEADER, request->headers);
+    }
+    
+    if (curl_multi_add_handle(reactor_multi, attempt->curl) != CURLM_OK) {
+        fprintf(stderr, "Failed to add transfer to curl multi handle\n");
+        attempt_free(attempt);
+        return -1;
+    }
+    request->running[slot] = attempt;
+    request->attempts++;
+    __atomic_add_fetch(&client_stats.attempts, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * Invoke a request's completion callback and stop its other attempts
+ * The reactor frees the request on its next pass.
+ */
+static void request_complete(http_async_request_t *request, int result, http_response_t *response) {
+    request->callback(result, response, request->user_data);
+    request->completed = 1;
+    request->retry_ms = 0;
+    
+    for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+        if (request->running[i]) {
+            attempt_free(request->running[i]);
+            request->running[i] = NULL;
+        }
+    }
+}
+
+static void request_free(http_async_request_t *request) {
+    for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+        if (request->running[i]) {
+            attempt_free(request->running[i]);
+        }
+    }
+    http_response_free(&request->failure);
+    curl_slist_free_all(request->headers);
+    free(request->post_body);
+    free(request->url);
+    free(request);
+}
+
+/**
+ * Statuses worth asking again for: rate limiting and server errors
+ */
+static int http_status_retryable(long status_code) {
+    return status_code == 429 || status_code >= 500;
+}
+
+/**
+ * Delay before the next retry: exponential in the attempts made, with the
+ * lower half of it fixed and the upper half random so retries of requests
+ * that failed together spread out
+ */
+static long long retry_delay_ms(const http_async_request_t *request) {
+    int shift = request->attempts - 1;
+    if (shift > MAX_BACKOFF_SHIFT) {
+        shift = MAX_BACKOFF_SHIFT;
+    }
+    long long ceiling = (long long)request->policy.backoff_ms << shift;
+    return ceiling / 2 + rand_r(&reactor_random) % (ceiling / 2 + 1);
+}
+
+/**
+ * Handle a finished attempt: deliver its response, or retry the request
+ */
+static void attempt_done(http_attempt_t *attempt, CURLcode res, long long now) {
+    http_async_request_t *request = attempt->request;
+    for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+        if (request->running[i] == attempt) {
+            request->running[i] = NULL;
+        }
+    }
+    
+    if (attempt->cancelled || request->completed) {
+        attempt_free(attempt);
+        return;
+    }
+    
+    curl_easy_getinfo(attempt->curl, CURLINFO_RESPONSE_CODE, &attempt->response.status_code);
+    
+    // A response that retrying cannot improve, or whose body was already delivered, is final
+    int failed = res != CURLE_OK || http_status_retryable(attempt->response.status_code);
+    if (!failed || attempt == request->winner) {
+        if (res != CURLE_OK) {
+            fprintf(stderr, "Asynchronous transfer failed: %s\n", curl_easy_strerror(res));
+        } else if (!request->winner) {
+            request_choose_winner(request, attempt);
+        }
+        request_complete(request, res == CURLE_OK ? 0 : -1, &attempt->response);
+        attempt_free(attempt);
+        return;
+    }
+    
+    if (res != CURLE_OK) {
+        fprintf(stderr, "Upstream attempt failed: %s\n", curl_easy_strerror(res));
+    } else {
+        fprintf(stderr, "Upstream attempt failed with status: %ld\n", attempt->response.status_code);
+    }
+    
+    // Keep the failure to report if no attempt succeeds
+    http_response_free(&request->failure);
+    request->failure = attempt->response;
+    request->failure_result = res == CURLE_OK ? 0 : -1;
+    attempt->response.data = NULL;
+    attempt_free(attempt);
+    
+    // The other attempt may still answer
+    if (request_running(request) > 0) {
+        return;
+    }
+    
+    long long retry_ms = now + retry_delay_ms(request);
+    if (request->attempts < request->policy.max_attempts && retry_ms < request->deadline_ms) {
+        request->retry_ms = retry_ms;
+        return;
+    }
+    request_complete(request, request->failure_result, &request->failure);
+}
+
+/**
+ * Move newly submitted requests to the active list and start their first attempt
+ */
+static void reactor_add_submitted(void) {
+    pthread_mutex_lock(&reactor_lock);
+    http_async_request_t *submitted = reactor_submitted;
+    reactor_submitted = NULL;
+    pthread_mutex_unlock(&reactor_lock);
+    
+    long long now = monotonic_ms();
+    while (submitted) {
+        http_async_request_t *request = submitted;
+        submitted = submitted->next;
+        
+        request->next = reactor_active;
+        reactor_active = request;
+        if (attempt_start(request, now, 0) != 0) {
+            request_complete(request, -1, &request->failure);
+        }
+    }
+}
+
+/**
+ * Drop cancelled attempts, start due retries and hedges, free completed requests
+ * @return Milliseconds until the next retry or hedge is due (at most REACTOR_POLL_MS)
+ */
+static int reactor_service(long long now) {
+    long long wake = now + REACTOR_POLL_MS;
+    http_async_request_t **link = &reactor_active;
+    
+    while (*link) {
+        http_async_request_t *request = *link;
+        
+        for (int i = 0; i < MAX_RUNNING_ATTEMPTS; i++) {
+            if (request->running[i] && request->running[i]->cancelled) {
+                attempt_free(request->running[i]);
+                request->running[i] = NULL;
+            }
+        }
+        
+        if (!request->completed && request->retry_ms) {
+            if (now >= request->retry_ms) {
+                request->retry_ms = 0;
+                if (attempt_start(request, now, 0) == 0) {
+                    __atomic_add_fetch(&client_stats.retries, 1, __ATOMIC_RELAXED);
+                } else {
+                    request_complete(request, request->failure_result, &request->failure);
+                }
+            } else if (request->retry_ms < wake) {
+                wake = request->retry_ms;
+            }
+        }
+        
+        // Hedge a lone attempt that has gone longer than usual without a response
+        if (!request->completed && !request->winner && !request->hedged && request->policy.hedge_after_ms > 0 &&
+            request->attempts < request->policy.max_attempts && request_running(request) == 1) {
+            http_attempt_t *slow = request->running[0] ? request->running[0] : request->running[1];
+            long long hedge_ms = slow->started_ms + request->policy.hedge_after_ms;
+            if (now >= hedge_ms) {
+                request->hedged = 1;
+                if (attempt_start(request, now, 1) == 0) {
+                    __atomic_add_fetch(&client_stats.hedges, 1, __ATOMIC_RELAXED);
+                }
+            } else if (hedge_ms < wake) {
+                wake = hedge_ms;
+            }
+        }
+        
+        if (request->completed) {
+            *link = request->next;
+            request_free(request);
+            continue;
+        }
+        link = &request->next;
+    }
+    
+    return (int)(wake - now);
+}
+
+/**
+ * Reactor thread: drives every asynchronous transfer on one multi handle
+ */
+static void *reactor_main(void *arg) {
+    (void)arg;
+    
+    while (reactor_running) {
+        reactor_add_submitted();
+        
+        int still_running = 0;
+        curl_multi_perform(reactor_multi, &still_running);
+        
+        // Complete finished transfers
+        CURLMsg *msg;
+        int msgs_left = 0;
+        while ((msg = curl_multi_info_read(reactor_multi, &msgs_left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            
+            CURL *curl = msg->easy_handle;
+            CURLcode res = msg->data.result;
+            char *attempt = NULL;
+            curl_easy_getinfo(curl, CURLINFO_PRIVATE, &attempt);
+            curl_multi_remove_handle(reactor_multi, curl);
+            
+            if (attempt) {
+                attempt_done((http_attempt_t *)attempt, res, monotonic_ms());
+            }
+        }
+        
+        // Sleep until there is socket activity, a retry or hedge is due, or a wakeup
+        int timeout = reactor_service(monotonic_ms());
+        curl_multi_poll(reactor_multi, NULL, 0, timeout, NULL);
+    }
+    
+    return NULL;
+}
+
+/**
+ * Start the reactor thread (caller holds reactor_lock)
+ */
+static int reactor_start_locked(void) {
+    reactor_multi = curl_multi_init();
+    if (!reactor_multi) {
+        fprintf(stderr, "Failed to initialize curl multi handle\n");
+        return -1;
+    }
+    
+    reactor_random = (unsigned int)time(NULL);
+    reactor_running = 1;
+    if (pthread_create(&reactor_thread, NULL, reactor_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start HTTP reactor thread\n");
+        reactor_running = 0;
+        curl_multi_cleanup(reactor_multi);
+        reactor_multi = NULL;
+        return -1;
+    }
+    
+    reactor_started = 1;
     return 0;
 }
 
+/**
+ * Stop the reactor and fail every request still queued or in flight
+ */
+static void reactor_stop(void) {
+    pthread_mutex_lock(&reactor_lock);
+    int started = reactor_started;
+    reactor_shutdown = 1;
+    pthread_mutex_unlock(&reactor_lock);
+    
+    if (!started) {
+        return;
+    }
+    
+    reactor_running = 0;
+    curl_multi_wakeup(reactor_multi);
+    pthread_join(reactor_thread, NULL);
+    
+    while (reactor_active) {
+        http_async_request_t *request = reactor_active;
+        reactor_active = request->next;
+        if (!request->completed) {
+            request_complete(request, -1, &request->failure);
+        }
+        request_free(request);
+    }
+    
+    pthread_mutex_lock(&reactor_lock);
+    http_async_request_t *submitted = reactor_submitted;
+    reactor_submitted = NULL;
+    pthread_mutex_unlock(&reactor_lock);
+    
+    while (submitted) {
+        http_async_request_t *request = submitted;
+        submitted = submitted->next;
+        request_complete(request, -1, &request->failure);
+        request_free(request);
+    }
+    
+    pthread_mutex_lock(&reactor_lock);
+    curl_multi_cleanup(reactor_multi);
+    reactor_multi = NULL;
+    reactor_started = 0;
+    pthread_mutex_unlock(&reactor_lock);
+}
+
+void http_client_stop(void) {
+    if (curl_initialized) {
+        reactor_stop();
+    }
+}
+
 void http_client_cleanup(void) {
     if (curl_initialized) {
+        reactor_stop();
+        
+        // Drain the handle pool before the share object they reference
+        pthread_mutex_lock(&handle_pool_lock);
+        while (handle_pool_count > 0) {
+            curl_easy_cleanup(handle_pool[--handle_pool_count]);
+        }
+        pthread_mutex_unlock(&handle_pool_lock);
+        
+        curl_share_cleanup(share_handle);
+        share_handle = NULL;
+        for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+            pthread_mutex_destroy(&share_locks[i]);
+        }
+        
         curl_global_cleanup();
         curl_initialized = 0;
     }
@@ -61,48 +718,25 @@ int http_get(const char *url, http_response_t *response) {
     }
     
     // Initialize response
-    response->data = malloc(1);
-    response->size = 0;
-    response->status_code = 0;
-    
-    if (!response->data) {
-        fprintf(stderr, "Failed to allocate memory for response\n");
+    if (response_init(response) != 0) {
         return -1;
     }
     
-    CURL *curl = curl_easy_init();
+    CURL *curl = acquire_handle();
     if (!curl) {
         fprintf(stderr, "Failed to initialize curl handle\n");
         free(response->data);
         return -1;
     }
     
-    // Set URL
-    curl_easy_setopt(curl, CURLOPT_URL, url);
-    
-    // Set callback function to write received data
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    
-    // Follow redirects
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    
-    // Set timeout (30 seconds)
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    
-    // Set User-Agent
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Weather-Service/1.0");
-    
-    // Verify SSL certificates
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
+    setup_easy_handle(curl, url, response);
     
     // Perform the request
     CURLcode res = curl_easy_perform(curl);
     
     if (res != CURLE_OK) {
         fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
+        release_handle(curl);
         free(response->data);
         response->data = NULL;
         return -1;
@@ -111,40 +745,42 @@ int http_get(const char *url, http_response_t *response) {
     // Get HTTP status code
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response->status_code);
     
-    curl_easy_cleanup(curl);
+    release_handle(curl);
     return 0;
 }
 
 int http_post_json(const char *url, const char *json_data, http_response_t *response) {
+    return http_post_json_auth(url, json_data, NULL, 0, response);
+}
+
+int http_post_json_auth(const char *url, const char *json_data, const char *bearer_token, long timeout_seconds,
+                        http_response_t *response) {
     if (!curl_initialized) {
         fprintf(stderr, "HTTP client not initialized. Call http_client_init() first.\n");
         return -1;
     }
     
     if (!url || !json_data || !response) {
-        fprintf(stderr, "Invalid arguments to http_post_json\n");
+        fprintf(stderr, "Invalid arguments to http_post_json_auth\n");
         return -1;
     }
     
     // Initialize response
-    response->data = malloc(1);
-    response->size = 0;
-    response->status_code = 0;
-    
-    if (!response->data) {
-        fprintf(stderr, "Failed to allocate memory for response\n");
+    if (response_init(response) != 0) {
         return -1;
     }
     
-    CURL *curl = curl_easy_init();
+    CURL *curl = acquire_handle();
     if (!curl) {
         fprintf(stderr, "Failed to initialize curl handle\n");
         free(response->data);
         return -1;
     }
     
-    // Set URL
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+    setup_easy_handle(curl, url, response);
+    if (timeout_seconds > 0) {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT, timeout_seconds);
+    }
     
     // Set POST request
     curl_easy_setopt(curl, CURLOPT_POST, 1L);
@@ -154,26 +790,14 @@ int http_post_json(const char *url, const char *json_data, http_response_t *resp
     
     // Set headers
     struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    headers = curl_slist_append(headers, "Content-Type: application/json; charset=utf-8");
+    if (bearer_token) {
+        char auth_header[512];
+        snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", bearer_token);
+        headers = curl_slist_append(headers, auth_header);
+    }
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
     
-    // Set callback function to write received data
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    
-    // Follow redirects
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    
-    // Set timeout (30 seconds)
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-    
-    // Set User-Agent
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Weather-Service/1.0");
-    
-    // Verify SSL certificates
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
-    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-    
     // Perform the request
     CURLcode res = curl_easy_perform(curl);
     
@@ -182,7 +806,7 @@ int http_post_json(const char *url, const char *json_data, http_response_t *resp
     
     if (res != CURLE_OK) {
         fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        curl_easy_cleanup(curl);
+        release_handle(curl);
         free(response->data);
         response->data = NULL;
         return -1;
@@ -191,7 +815,144 @@ int http_post_json(const char *url, const char *json_data, http_response_t *resp
     // Get HTTP status code
     curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response->status_code);
     
-    curl_easy_cleanup(curl);
+    release_handle(curl);
+    return 0;
+}
+
+int http_get_async(const char *url, http_completion_callback_t callback, void *user_data) {
+    return http_get_async_stream(url, NULL, NULL, callback, user_data);
+}
+
+/**
+ * Hand a new request to the reactor, starting it on first use
+ * @return 0 if queued, -1 on error (the request is freed)
+ */
+static int request_submit(http_async_request_t *request, const http_request_policy_t *policy) {
+    if (policy) {
+        request->policy = *policy;
+    }
+    if (request->policy.max_attempts < 1) {
+        request->policy.max_attempts = 1;
+    }
+    if (request->policy.deadline_ms <= 0) {
+        request->policy.deadline_ms = request_timeout * 1000;
+    }
+    request->deadline_ms = monotonic_ms() + request->policy.deadline_ms;
+    
+    pthread_mutex_lock(&reactor_lock);
+    if (reactor_shutdown || (!reactor_started && reactor_start_locked() != 0)) {
+        pthread_mutex_unlock(&reactor_lock);
+        request_free(request);
+        return -1;
+    }
+    request->next = reactor_submitted;
+    reactor_submitted = request;
+    curl_multi_wakeup(reactor_multi);
+    pthread_mutex_unlock(&reactor_lock);
+    
+    return 0;
+}
+
+int http_get_async_stream(const char *url, const http_request_policy_t *policy,
+                          http_body_callback_t body_callback,
+                          http_completion_callback_t callback, void *user_data) {
+    if (!curl_initialized) {
+        fprintf(stderr, "HTTP client not initialized. Call http_client_init() first.\n");
+        return -1;
+    }
+    
+    if (!url || !callback) {
+        fprintf(stderr, "Invalid arguments to http_get_async\n");
+        return -1;
+    }
+    
+    http_async_request_t *request = calloc(1, sizeof(http_async_request_t));
+    if (!request) {
+        fprintf(stderr, "Failed to allocate asynchronous request\n");
+        return -1;
+    }
+    
+    request->url = strdup(url);
+    if (!request->url) {
+        fprintf(stderr, "Failed to allocate asynchronous request\n");
+        free(request);
+        return -1;
+    }
+    
+    request->body_callback = body_callback;
+    request->callback = callback;
+    request->user_data = user_data;
+    
+    return request_submit(request, policy);
+}
+
+int http_post_json_async(const char *url, const char *json_data, const http_request_policy_t *policy,
+                         http_completion_callback_t callback, void *user_data) {
+    if (!curl_initialized) {
+        fprintf(stderr, "HTTP client not initialized. Call http_client_init() first.\n");
+        return -1;
+    }
+    
+    if (!url || !json_data || !callback) {
+        fprintf(stderr, "Invalid arguments to http_post_json_async\n");
+        return -1;
+    }
+    
+    http_async_request_t *request = calloc(1, sizeof(http_async_request_t));
+    if (!request) {
+        fprintf(stderr, "Failed to allocate asynchronous request\n");
+        return -1;
+    }
+    
+    request->url = strdup(url);
+    request->post_body = strdup(json_data);
+    request->headers = curl_slist_append(NULL, "Content-Type: application/json; charset=utf-8");
+    if (!request->url || !request->post_body || !request->headers) {
+        fprintf(stderr, "Failed to allocate asynchronous request\n");
+        request_free(request);
+        return -1;
+    }
+    
+    request->callback = callback;
+    request->user_data = user_data;
+    
+    return request_submit(request, policy);
+}
+
+void http_client_get_stats(http_client_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    stats->attempts = __atomic_load_n(&client_stats.attempts, __ATOMIC_RELAXED);
+    stats->retries = __atomic_load_n(&client_stats.retries, __ATOMIC_RELAXED);
+    stats->hedges = __atomic_load_n(&client_stats.hedges, __ATOMIC_RELAXED);
+    stats->hedge_wins = __atomic_load_n(&client_stats.hedge_wins, __ATOMIC_RELAXED);
+}
+
+int http_url_encode(const char *input, char *output, size_t output_size) {
+    static const char hex[] = "0123456789ABCDEF";
+    size_t out = 0;
+    
+    if (!input || !output || output_size == 0) {
+        return -1;
+    }
+    
+    for (const unsigned char *p = (const unsigned char *)input; *p; p++) {
+        // RFC 3986 unreserved characters pass through, everything else is %XX
+        if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9') ||
+            *p == '-' || *p == '.' || *p == '_' || *p == '~') {
+            if (out + 1 >= output_size) return -1;
+            output[out++] = (char)*p;
+        } else {
+            if (out + 3 >= output_size) return -1;
+            output[out++] = '%';
+            output[out++] = hex[*p >> 4];
+            output[out++] = hex[*p & 0x0F];
+        }
+    }
+    
+    output[out] = '\0';
     return 0;
 }
 
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,16 +8,28 @@
 #include <cjson/cJSON.h>
 #include <signal.h>
 #include <unistd.h>
-#include <curl/curl.h>
 #include <openssl/hmac.h>
 #include <openssl/evp.h>
 #include <time.h>
+#include <pthread.h>
 #include "http_server.h"
 #include "weather_api.h"
 #include "http_client.h"
+#include "weather_cache.h"
+#include "weather_parser.h"
+#include "weather_json.h"
+#include "weather_arena.h"
+#include "weather_body.h"
+#include "weather_binary.h"
+#include "weather_upstream.h"
+#include "weather_location.h"
 
 #define MAX_REQUEST_SIZE 8192
 #define MAX_RESPONSE_SIZE 65536
+#define SLACK_TIMEOUT_SECONDS 10L       // Slack posts run on a worker before the event is acknowledged
+#define BATCH_MAX_LOCATIONS 1000        // Locations one batch request may name
+#define BATCH_CONCURRENCY 16            // Misses of one batch request fetched at a time
+#define BATCH_BLOCK_SIZE 16384          // Most a batch response hands MHD per read
 
 static struct MHD_Daemon *httpd = NULL;
 static server_config_t server_cfg;
@@ -24,6 +37,120 @@ static weather_config_t weather_cfg;
 static int server_verbose = 0;
 static volatile int server_running = 1;
 
+/**
+ * Progress of an asynchronous upstream request for a connection
+ */
+typedef enum {
+    UPSTREAM_IDLE,              // No upstream request started
+    UPSTREAM_PENDING,           // Connection suspended, waiting for the reactor
+    UPSTREAM_DONE               // Result available, connection resumed
+} upstream_state_t;
+
+/**
+ * Per-connection request state, stored in MHD's con_cls so that concurrent
+ * connections handled by different worker threads never share buffers
+ */
+typedef struct {
+    char *post_data;            // Accumulated request body
+    size_t post_data_len;       // Length of accumulated request body
+    struct MHD_Connection *connection; // Connection to resume when upstream completes
+    upstream_state_t upstream_state;   // Asynchronous upstream request progress
+    int upstream_result;        // 0 on success, -1 on error, or WEATHER_API_UNAVAILABLE / _UNKNOWN_LOCATION
+    int include_hourly;         // Layout of a forecast's hours (weather_hourly_t)
+    int pretty;                 // Indent weather responses (?pretty=true)
+    int precision;              // Fraction digits for numbers (?precision=N), or WEATHER_JSON_SHORTEST
+    weather_format_t format;    // Body format negotiated from the Accept header
+    int projected;              // Only the members in fields are written (?fields=...)
+    int fields_invalid;         // ?fields= names an unknown field
+    weather_fields_t fields;
+    char unknown_field[64];     // First unknown name in ?fields=
+    int is_forecast;            // Pending request is /forecast rather than /current
+    weather_result_t *result;   // Shared upstream result (one reference held)
+    int from_cache;             // Result was answered from the response cache
+    weather_cache_status_t cache_status; // Freshness of a cached result
+} connection_context_t;
+
+/**
+ * Media types of the weather body formats
+ */
+static const struct {
+    const char *type;
+    weather_format_t format;
+} body_media_types[] = {
+    { "application/json", WEATHER_FORMAT_JSON },
+    { "application/cbor", WEATHER_FORMAT_CBOR },
+    { "application/msgpack", WEATHER_FORMAT_MSGPACK },
+    { "application/vnd.msgpack", WEATHER_FORMAT_MSGPACK },
+    { "application/x-msgpack", WEATHER_FORMAT_MSGPACK }
+};
+
+/**
+ * Pick the body format from an Accept header
+ * The supported type with the highest q-value wins, the earliest listed on a
+ * tie. Wildcards, unsupported types and a missing header give JSON, as do
+ * the error responses whatever was asked for.
+ * @param accept Accept header value, or NULL
+ * @return Format to write
+ */
+static weather_format_t negotiate_format(const char *accept) {
+    weather_format_t best = WEATHER_FORMAT_JSON;
+    double best_q = 0;
+    
+    while (accept && *accept) {
+        const char *end = strchr(accept, ',');
+        size_t length = end ? (size_t)(end - accept) : strlen(accept);
+        
+        // Media range, then parameters after ';'
+        const char *p = accept;
+        while (p < accept + length && isspace((unsigned char)*p)) {
+            p++;
+        }
+        const char *type_end = p;
+        while (type_end < accept + length && *type_end != ';' && !isspace((unsigned char)*type_end)) {
+            type_end++;
+        }
+        double q = 1;
+        const char *param = memchr(type_end, ';', (size_t)(accept + length - type_end));
+        while (param) {
+            param++;
+            while (param < accept + length && isspace((unsigned char)*param)) {
+                param++;
+            }
+            if (accept + length - param > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                q = strtod(param + 2, NULL);
+            }
+            param = memchr(param, ';', (size_t)(accept + length - param));
+        }
+        
+        for (size_t i = 0; i < sizeof(body_media_types) / sizeof(body_media_types[0]); i++) {
+            size_t type_length = strlen(body_media_types[i].type);
+            if ((size_t)(type_end - p) == type_length && strncasecmp(p, body_media_types[i].type, type_length) == 0) {
+                if (q > best_q) {
+                    best = body_media_types[i].format;
+                    best_q = q;
+                }
+                break;
+            }
+        }
+        accept = end ? end + 1 : NULL;
+    }
+    return best;
+}
+
+/**
+ * Content-Type of a body format
+ */
+static const char *format_content_type(weather_format_t format) {
+    switch (format) {
+        case WEATHER_FORMAT_CBOR:
+            return "application/cbor";
+        case WEATHER_FORMAT_MSGPACK:
+            return "application/msgpack";
+        default:
+            return "application/json";
+    }
+}
+
 /**
  * Signal handler for graceful shutdown
  */
@@ -50,6 +177,22 @@ static cJSON* create_error_response(int code, const char* message, const char* d
     return error;
 }
 
+/**
+ * Print a JSON document into a new response and delete it
+ * MHD copies the body, so the document and its printed text can live in the
+ * request's cJSON arena (see weather_json.h), released when the handler returns.
+ */
+static struct MHD_Response *json_response(cJSON *json) {
+    char *json_str = cJSON_Print(json);
+    cJSON_Delete(json);
+    
+    struct MHD_Response *response = MHD_create_response_from_buffer(json_str ? strlen(json_str) : 0,
+                                                                     json_str ? json_str : "",
+                                                                     MHD_RESPMEM_MUST_COPY);
+    cJSON_free(json_str);
+    return response;
+}
+
 /**
  * Helper function to create CORS headers
  */
@@ -61,6 +204,30 @@ static void add_cors_headers(struct MHD_Response *response) {
     }
 }
 
+/**
+ * Add Age (and Warning when stale) headers to a response served from the cache,
+ * and X-Location-Match when a nearby cached point answered a coordinate query
+ */
+static void add_cache_headers(struct MHD_Response *response, const connection_context_t *ctx) {
+    if (!ctx->from_cache) {
+        return;
+    }
+    
+    char age[32];
+    snprintf(age, sizeof(age), "%ld", ctx->cache_status.age);
+    MHD_add_response_header(response, "Age", age);
+    
+    if (ctx->cache_status.stale) {
+        MHD_add_response_header(response, "Warning", "110 - \"Response is Stale\"");
+    }
+    
+    if (ctx->cache_status.nearby[0]) {
+        char match[64];
+        snprintf(match, sizeof(match), "%s; distance_km=%.2f", ctx->cache_status.nearby, ctx->cache_status.nearby_km);
+        MHD_add_response_header(response, "X-Location-Match", match);
+    }
+}
+
 /**
  * Send a message to a Slack channel
  */
@@ -82,41 +249,22 @@ static int send_slack_message(const char *channel, const char *text) {
         return -1;
     }
     
-    // Prepare URL with authorization header
-    char auth_header[512];
-    snprintf(auth_header, sizeof(auth_header), "Authorization: Bearer %s", server_cfg.slack_bot_token);
-    
     if (server_verbose) {
         printf("Sending Slack message to channel %s: %s\n", channel, text);
     }
     
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to initialize curl\n");
-        free(json_str);
-        return -1;
-    }
-    
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json; charset=utf-8");
-    headers = curl_slist_append(headers, auth_header);
-    
-    curl_easy_setopt(curl, CURLOPT_URL, "https://slack.com/api/chat.postMessage");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_str);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-    
-    CURLcode res = curl_easy_perform(curl);
+    // Post through the shared upstream client (pooled connection, cached DNS/TLS)
+    http_response_t response;
+    int result = http_post_json_auth("https://slack.com/api/chat.postMessage", json_str,
+                                     server_cfg.slack_bot_token, SLACK_TIMEOUT_SECONDS, &response);
+    cJSON_free(json_str);
     
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(json_str);
-    
-    if (res != CURLE_OK) {
-        fprintf(stderr, "Failed to send Slack message: %s\n", curl_easy_strerror(res));
+    if (result != 0) {
+        fprintf(stderr, "Failed to send Slack message\n");
         return -1;
     }
     
+    http_response_free(&response);
     return 0;
 }
 
@@ -176,205 +324,173 @@ static void handle_paros_weather_request(const char *channel) {
 }
 
 /**
- * Convert weather_response_t to JSON
+ * Upstream completion (reactor thread): record the result and resume the connection
  */
-static cJSON* weather_response_to_json(const weather_response_t *response) {
-    cJSON *json = cJSON_CreateObject();
+static void upstream_completed(int result, weather_result_t *data, void *user_data) {
+    connection_context_t *ctx = user_data;
     
-    // Location
-    cJSON *location = cJSON_CreateObject();
-    cJSON_AddStringToObject(location, "name", response->location.name);
-    cJSON_AddStringToObject(location, "region", response->location.region);
-    cJSON_AddStringToObject(location, "country", response->location.country);
-    cJSON_AddNumberToObject(location, "lat", response->location.lat);
-    cJSON_AddNumberToObject(location, "lon", response->location.lon);
-    cJSON_AddStringToObject(location, "tz_id", response->location.tz_id);
-    cJSON_AddNumberToObject(location, "localtime_epoch", response->location.localtime_epoch);
-    cJSON_AddStringToObject(location, "localtime", response->location.localtime);
-    cJSON_AddItemToObject(json, "location", location);
-    
-    // Current weather
-    cJSON *current = cJSON_CreateObject();
-    cJSON_AddNumberToObject(current, "last_updated_epoch", response->current.last_updated_epoch);
-    cJSON_AddStringToObject(current, "last_updated", response->current.last_updated);
-    cJSON_AddNumberToObject(current, "temp_c", response->current.temp_c);
-    cJSON_AddNumberToObject(current, "temp_f", response->current.temp_f);
-    cJSON_AddNumberToObject(current, "is_day", response->current.is_day);
-    
-    // Condition
-    cJSON *condition = cJSON_CreateObject();
-    cJSON_AddStringToObject(condition, "text", response->current.condition.text);
-    cJSON_AddStringToObject(condition, "icon", response->current.condition.icon);
-    cJSON_AddNumberToObject(condition, "code", response->current.condition.code);
-    cJSON_AddItemToObject(current, "condition", condition);
-    
-    cJSON_AddNumberToObject(current, "wind_mph", response->current.wind_mph);
-    cJSON_AddNumberToObject(current, "wind_kph", response->current.wind_kph);
-    cJSON_AddNumberToObject(current, "wind_degree", response->current.wind_degree);
-    cJSON_AddStringToObject(current, "wind_dir", response->current.wind_dir);
-    cJSON_AddNumberToObject(current, "pressure_mb", response->current.pressure_mb);
-    cJSON_AddNumberToObject(current, "pressure_in", response->current.pressure_in);
-    cJSON_AddNumberToObject(current, "precip_mm", response->current.precip_mm);
-    cJSON_AddNumberToObject(current, "precip_in", response->current.precip_in);
-    cJSON_AddNumberToObject(current, "humidity", response->current.humidity);
-    cJSON_AddNumberToObject(current, "cloud", response->current.cloud);
-    cJSON_AddNumberToObject(current, "feelslike_c", response->current.feelslike_c);
-    cJSON_AddNumberToObject(current, "feelslike_f", response->current.feelslike_f);
-    cJSON_AddNumberToObject(current, "vis_km", response->current.vis_km);
-    cJSON_AddNumberToObject(current, "vis_miles", response->current.vis_miles);
-    cJSON_AddNumberToObject(current, "uv", response->current.uv);
-    cJSON_AddNumberToObject(current, "gust_mph", response->current.gust_mph);
-    cJSON_AddNumberToObject(current, "gust_kph", response->current.gust_kph);
-    
-    cJSON_AddItemToObject(json, "current", current);
-    return json;
+    ctx->upstream_result = result;
+    ctx->result = data;
+    ctx->upstream_state = UPSTREAM_DONE;
+    MHD_resume_connection(ctx->connection);
 }
 
 /**
- * Convert forecast_response_t to JSON
+ * Suspend a connection until the upstream request started by the caller completes
+ * Must be called before the request is started so the completion cannot race the suspend.
  */
-static cJSON* forecast_response_to_json(const forecast_response_t *response, int include_hourly) {
-    cJSON *json = cJSON_CreateObject();
+static void suspend_for_upstream(struct MHD_Connection *connection, connection_context_t *ctx) {
+    ctx->connection = connection;
+    ctx->upstream_state = UPSTREAM_PENDING;
+    MHD_suspend_connection(connection);
+}
+
+/**
+ * Render a result's body
+ * The body is assembled from fragments rendered once per result and set of
+ * output options and kept with the result (weather_body.h), so forecasts of
+ * any length for the same place share their days; without the fragment
+ * cache (or once the result keeps no more projections) it is written whole.
+ * @param include_hourly Layout of a forecast's hours (weather_hourly_t)
+ * @param pieces Filled with the fragments, valid while the result is held
+ * @param data Set to the whole body to release with free() when 0 is returned
+ * @return Number of pieces, 0 with the body in data, or -1 on error
+ */
+static int render_result(weather_result_t *result, weather_format_t format, int pretty, int precision,
+                         const weather_fields_t *fields, int include_hourly, weather_piece_t *pieces,
+                         char **data, size_t *length) {
+    if (!result->is_forecast || !weather_fields_any(fields, WEATHER_FIELDS_HOUR)) {
+        include_hourly = WEATHER_HOURLY_NONE;
+    }
     
-    // Location (reuse function logic)
-    cJSON *location = cJSON_CreateObject();
-    cJSON_AddStringToObject(location, "name", response->location.name);
-    cJSON_AddStringToObject(location, "region", response->location.region);
-    cJSON_AddStringToObject(location, "country", response->location.country);
-    cJSON_AddNumberToObject(location, "lat", response->location.lat);
-    cJSON_AddNumberToObject(location, "lon", response->location.lon);
-    cJSON_AddStringToObject(location, "tz_id", response->location.tz_id);
-    cJSON_AddNumberToObject(location, "localtime_epoch", response->location.localtime_epoch);
-    cJSON_AddStringToObject(location, "localtime", response->location.localtime);
-    cJSON_AddItemToObject(json, "location", location);
-    
-    // Forecast
-    cJSON *forecast_obj = cJSON_CreateObject();
-    cJSON *forecastday_array = cJSON_CreateArray();
-    
-    for (int i = 0; i < response->forecast_days; i++) {
-        const forecast_daily_t *daily = &response->forecast[i];
-        cJSON *day_obj = cJSON_CreateObject();
-        
-        cJSON_AddStringToObject(day_obj, "date", daily->date);
-        cJSON_AddNumberToObject(day_obj, "date_epoch", daily->date_epoch);
-        
-        // Day data
-        cJSON *day_data = cJSON_CreateObject();
-        cJSON_AddNumberToObject(day_data, "maxtemp_c", daily->day.maxtemp_c);
-        cJSON_AddNumberToObject(day_data, "maxtemp_f", daily->day.maxtemp_f);
-        cJSON_AddNumberToObject(day_data, "mintemp_c", daily->day.mintemp_c);
-        cJSON_AddNumberToObject(day_data, "mintemp_f", daily->day.mintemp_f);
-        cJSON_AddNumberToObject(day_data, "avgtemp_c", daily->day.avgtemp_c);
-        cJSON_AddNumberToObject(day_data, "avgtemp_f", daily->day.avgtemp_f);
-        cJSON_AddNumberToObject(day_data, "maxwind_mph", daily->day.maxwind_mph);
-        cJSON_AddNumberToObject(day_data, "maxwind_kph", daily->day.maxwind_kph);
-        cJSON_AddNumberToObject(day_data, "totalprecip_mm", daily->day.totalprecip_mm);
-        cJSON_AddNumberToObject(day_data, "totalprecip_in", daily->day.totalprecip_in);
-        cJSON_AddNumberToObject(day_data, "avghumidity", daily->day.avghumidity);
-        cJSON_AddNumberToObject(day_data, "daily_will_it_rain", daily->day.daily_will_it_rain);
-        cJSON_AddNumberToObject(day_data, "daily_chance_of_rain", daily->day.daily_chance_of_rain);
-        cJSON_AddNumberToObject(day_data, "uv", daily->day.uv);
-        
-        // Day condition
-        cJSON *day_condition = cJSON_CreateObject();
-        cJSON_AddStringToObject(day_condition, "text", daily->day.condition.text);
-        cJSON_AddStringToObject(day_condition, "icon", daily->day.condition.icon);
-        cJSON_AddNumberToObject(day_condition, "code", daily->day.condition.code);
-        cJSON_AddItemToObject(day_data, "condition", day_condition);
-        
-        cJSON_AddItemToObject(day_obj, "day", day_data);
-        
-        // Astronomy
-        cJSON *astro = cJSON_CreateObject();
-        cJSON_AddStringToObject(astro, "sunrise", daily->astro.sunrise);
-        cJSON_AddStringToObject(astro, "sunset", daily->astro.sunset);
-        cJSON_AddStringToObject(astro, "moonrise", daily->astro.moonrise);
-        cJSON_AddStringToObject(astro, "moonset", daily->astro.moonset);
-        cJSON_AddStringToObject(astro, "moon_phase", daily->astro.moon_phase);
-        cJSON_AddNumberToObject(astro, "moon_illumination", daily->astro.moon_illumination);
-        cJSON_AddItemToObject(day_obj, "astro", astro);
-        
-        // Hourly data (if requested)
-        if (include_hourly && daily->hour_count > 0) {
-            cJSON *hour_array = cJSON_CreateArray();
-            for (int h = 0; h < daily->hour_count; h++) {
-                const forecast_hour_t *hour = &daily->hour[h];
-                cJSON *hour_obj = cJSON_CreateObject();
-                
-                cJSON_AddNumberToObject(hour_obj, "time_epoch", hour->time_epoch);
-                cJSON_AddStringToObject(hour_obj, "time", hour->time);
-                cJSON_AddNumberToObject(hour_obj, "temp_c", hour->temp_c);
-                cJSON_AddNumberToObject(hour_obj, "temp_f", hour->temp_f);
-                cJSON_AddNumberToObject(hour_obj, "is_day", hour->is_day);
-                
-                // Hour condition
-                cJSON *hour_condition = cJSON_CreateObject();
-                cJSON_AddStringToObject(hour_condition, "text", hour->condition.text);
-                cJSON_AddStringToObject(hour_condition, "icon", hour->condition.icon);
-                cJSON_AddNumberToObject(hour_condition, "code", hour->condition.code);
-                cJSON_AddItemToObject(hour_obj, "condition", hour_condition);
-                
-                cJSON_AddNumberToObject(hour_obj, "wind_mph", hour->wind_mph);
-                cJSON_AddNumberToObject(hour_obj, "wind_kph", hour->wind_kph);
-                cJSON_AddNumberToObject(hour_obj, "wind_degree", hour->wind_degree);
-                cJSON_AddStringToObject(hour_obj, "wind_dir", hour->wind_dir);
-                cJSON_AddNumberToObject(hour_obj, "humidity", hour->humidity);
-                cJSON_AddNumberToObject(hour_obj, "cloud", hour->cloud);
-                cJSON_AddNumberToObject(hour_obj, "precip_mm", hour->precip_mm);
-                cJSON_AddNumberToObject(hour_obj, "chance_of_rain", hour->chance_of_rain);
-                
-                cJSON_AddItemToArray(hour_array, hour_obj);
-            }
-            cJSON_AddItemToObject(day_obj, "hour", hour_array);
+    if (server_cfg.body_cache) {
+        int count = weather_body_pieces(result, weather_body_key(format, pretty, precision),
+                                        fields, include_hourly, pieces);
+        if (count != 0) {
+            return count;
         }
-        
-        cJSON_AddItemToArray(forecastday_array, day_obj);
     }
     
-    cJSON_AddItemToObject(forecast_obj, "forecastday", forecastday_array);
-    cJSON_AddItemToObject(json, "forecast", forecast_obj);
+    // Serialize straight into one buffer
+    if (result->is_forecast) {
+        // Parse the retained sections this response shows (hourly data only if asked for)
+        unsigned int sections = (weather_fields_any(fields, WEATHER_FIELDS_ASTRO) ? WEATHER_SECTION_ASTRO : 0) |
+                                (include_hourly ? WEATHER_SECTION_HOURS : 0);
+        if (weather_result_load(result, sections) != 0) {
+            return -1;
+        }
+    }
     
-    return json;
+    if (format == WEATHER_FORMAT_JSON) {
+        weather_json_writer_t writer;
+        weather_json_writer_init(&writer, pretty, precision);
+        weather_json_writer_project(&writer, fields);
+        if (result->is_forecast) {
+            weather_json_write_forecast(&writer, result, include_hourly);
+        } else {
+            weather_json_write_current(&writer, &result->current);
+        }
+        *data = weather_json_writer_finish(&writer, length);
+    } else {
+        weather_binary_writer_t writer;
+        weather_binary_writer_init(&writer, format == WEATHER_FORMAT_CBOR ? WEATHER_BINARY_CBOR
+                                                                          : WEATHER_BINARY_MSGPACK);
+        weather_binary_writer_project(&writer, fields);
+        if (result->is_forecast) {
+            weather_binary_write_forecast(&writer, result, include_hourly);
+        } else {
+            weather_binary_write_current(&writer, &result->current);
+        }
+        *data = (char *)weather_binary_writer_finish(&writer, length);
+    }
+    if (!*data) {
+        fprintf(stderr, "Failed to serialize response\n");
+        return -1;
+    }
+    return 0;
 }
 
 /**
- * Handle GET /current endpoint
+ * Response for a completed request's result
+ * Fragments are sent in place: the connection holds the result until the
+ * request completes.
+ * @return Response, or NULL if the result could not be loaded or written
  */
-static enum MHD_Result handle_current_get(struct MHD_Connection *connection, const char *location, int include_aqi) {
-    weather_response_t response;
-    char *json_str;
-    struct MHD_Response *http_response;
-    enum MHD_Result ret;
+static struct MHD_Response *result_response(connection_context_t *ctx) {
+    weather_piece_t pieces[WEATHER_BODY_MAX_PIECES];
+    char *data = NULL;
+    size_t length = 0;
+    int count = render_result(ctx->result, ctx->format, ctx->pretty, ctx->precision,
+                              ctx->projected ? &ctx->fields : NULL, ctx->include_hourly, pieces, &data, &length);
+    if (count < 0) {
+        return NULL;
+    }
     
-    if (server_verbose) {
-        printf("GET /current?location=%s&aqi=%d\n", location, include_aqi);
+    if (count > 0) {
+        struct MHD_IoVec iov[WEATHER_BODY_MAX_PIECES];
+        for (int i = 0; i < count; i++) {
+            iov[i].iov_base = pieces[i].data;
+            iov[i].iov_len = pieces[i].length;
+        }
+        return MHD_create_response_from_iovec(iov, (unsigned int)count, NULL, NULL);
     }
     
-    // Fetch weather data
-    if (weather_api_get_current(location, include_aqi, &response) != 0) {
-        cJSON *error = create_error_response(500, "Failed to fetch weather data", "Check if location exists and API is accessible");
-        json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        http_response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
-        MHD_add_response_header(http_response, "Content-Type", "application/json");
-        add_cors_headers(http_response);
-        ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, http_response);
-        MHD_destroy_response(http_response);
-        return ret;
+    struct MHD_Response *response = MHD_create_response_from_buffer(length, data, MHD_RESPMEM_MUST_FREE);
+    if (!response) {
+        free(data);
+    }
+    return response;
+}
+
+/**
+ * Send the error for a request whose upstream fetch failed
+ * A request shed while upstream is failing or saturated gets 503 with a
+ * Retry-After of one circuit breaker period instead of 500, and a location
+ * upstream cannot match gets 400.
+ */
+static enum MHD_Result send_upstream_error(struct MHD_Connection *connection, const connection_context_t *ctx,
+                                           const char *message) {
+    int unavailable = ctx->upstream_result == WEATHER_API_UNAVAILABLE;
+    int status = MHD_HTTP_INTERNAL_SERVER_ERROR;
+    cJSON *error;
+    if (unavailable) {
+        status = MHD_HTTP_SERVICE_UNAVAILABLE;
+        error = create_error_response(status, "Weather provider unavailable", "Upstream is failing or overloaded; retry later");
+    } else if (ctx->upstream_result == WEATHER_API_UNKNOWN_LOCATION) {
+        status = MHD_HTTP_BAD_REQUEST;
+        error = create_error_response(status, "Location not found", "No location matches the query");
+    } else {
+        error = create_error_response(status, message, "Check if location exists and API is accessible");
+    }
+    struct MHD_Response *http_response = json_response(error);
+    MHD_add_response_header(http_response, "Content-Type", "application/json");
+    if (unavailable) {
+        char retry_after[16];
+        snprintf(retry_after, sizeof(retry_after), "%d", WEATHER_UPSTREAM_BREAKER_SECONDS);
+        MHD_add_response_header(http_response, "Retry-After", retry_after);
     }
+    add_cors_headers(http_response);
+    enum MHD_Result ret = MHD_queue_response(connection, status, http_response);
+    MHD_destroy_response(http_response);
+    return ret;
+}
+
+/**
+ * Send the result of a completed /current request
+ */
+static enum MHD_Result send_current_result(struct MHD_Connection *connection, connection_context_t *ctx) {
+    struct MHD_Response *http_response;
+    enum MHD_Result ret;
     
-    // Convert to JSON
-    cJSON *json = weather_response_to_json(&response);
-    json_str = cJSON_Print(json);
-    cJSON_Delete(json);
-    weather_response_free(&response);
+    http_response = ctx->upstream_result == 0 ? result_response(ctx) : NULL;
+    if (!http_response) {
+        return send_upstream_error(connection, ctx, "Failed to fetch weather data");
+    }
     
-    // Send response
-    http_response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
-    MHD_add_response_header(http_response, "Content-Type", "application/json");
+    MHD_add_response_header(http_response, "Content-Type", format_content_type(ctx->format));
+    MHD_add_response_header(http_response, "Vary", "Accept");
     add_cors_headers(http_response);
+    add_cache_headers(http_response, ctx);
     ret = MHD_queue_response(connection, MHD_HTTP_OK, http_response);
     MHD_destroy_response(http_response);
     
@@ -382,33 +498,66 @@ static enum MHD_Result handle_current_get(struct MHD_Connection *connection, con
 }
 
 /**
- * Handle POST /current endpoint
+ * Handle GET /current endpoint
+ * Starts the upstream request asynchronously; the response is sent by
+ * send_current_result() once the connection is resumed.
  */
-static enum MHD_Result handle_current_post(struct MHD_Connection *connection, const char *upload_data, size_t *upload_data_size) {
-    static char *post_data = NULL;
-    static size_t post_data_len = 0;
+static enum MHD_Result handle_current_get(struct MHD_Connection *connection, connection_context_t *ctx,
+                                          const char *location, int include_aqi) {
+    if (server_verbose) {
+        printf("GET /current?location=%s&aqi=%d\n", location, include_aqi);
+    }
     
-    if (*upload_data_size != 0) {
-        // Accumulate POST data
-        post_data = realloc(post_data, post_data_len + *upload_data_size + 1);
-        if (!post_data) {
-            *upload_data_size = 0;
-            return MHD_NO;
-        }
-        memcpy(post_data + post_data_len, upload_data, *upload_data_size);
-        post_data_len += *upload_data_size;
-        post_data[post_data_len] = '\0';
+    // Answer from the response cache without suspending
+    ctx->result = weather_api_get_current_cached(location, include_aqi, &ctx->cache_status);
+    if (ctx->result) {
+        ctx->upstream_result = 0;
+        ctx->from_cache = 1;
+        return send_current_result(connection, ctx);
+    }
+    
+    // Fetch weather data
+    suspend_for_upstream(connection, ctx);
+    int status = weather_api_get_current_async(location, include_aqi, upstream_completed, ctx);
+    if (status != 0) {
+        upstream_completed(status, NULL, ctx);
+    }
+    
+    return MHD_YES;
+}
+
+/**
+ * Append a chunk of the request body to the connection's post_data
+ * @return MHD_YES, or MHD_NO to close the connection when out of memory
+ */
+static enum MHD_Result accumulate_post_data(connection_context_t *ctx, const char *upload_data,
+                                            size_t *upload_data_size) {
+    char *new_data = realloc(ctx->post_data, ctx->post_data_len + *upload_data_size + 1);
+    if (!new_data) {
         *upload_data_size = 0;
-        return MHD_YES;
+        return MHD_NO;
+    }
+    ctx->post_data = new_data;
+    memcpy(ctx->post_data + ctx->post_data_len, upload_data, *upload_data_size);
+    ctx->post_data_len += *upload_data_size;
+    ctx->post_data[ctx->post_data_len] = '\0';
+    *upload_data_size = 0;
+    return MHD_YES;
+}
+
+/**
+ * Handle POST /current endpoint
+ */
+static enum MHD_Result handle_current_post(struct MHD_Connection *connection, connection_context_t *ctx,
+                                          const char *upload_data, size_t *upload_data_size) {
+    if (*upload_data_size != 0) {
+        return accumulate_post_data(ctx, upload_data, upload_data_size);
     }
     
     // Process the complete POST data
-    if (post_data == NULL) {
+    if (ctx->post_data == NULL) {
         cJSON *error = create_error_response(400, "No JSON data provided", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         add_cors_headers(response);
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
@@ -417,21 +566,15 @@ static enum MHD_Result handle_current_post(struct MHD_Connection *connection, co
     }
     
     if (server_verbose) {
-        printf("POST /current with data: %s\n", post_data);
+        printf("POST /current with data: %s\n", ctx->post_data);
     }
     
     // Parse JSON request
-    cJSON *json = cJSON_Parse(post_data);
-    free(post_data);
-    post_data = NULL;
-    post_data_len = 0;
+    cJSON *json = cJSON_Parse(ctx->post_data);
     
     if (!json) {
         cJSON *error = create_error_response(400, "Invalid JSON", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         add_cors_headers(response);
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
@@ -446,10 +589,7 @@ static enum MHD_Result handle_current_post(struct MHD_Connection *connection, co
     if (!location_json || !cJSON_IsString(location_json)) {
         cJSON_Delete(json);
         cJSON *error = create_error_response(400, "Missing or invalid 'location' field", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         add_cors_headers(response);
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
@@ -457,23 +597,46 @@ static enum MHD_Result handle_current_post(struct MHD_Connection *connection, co
         return ret;
     }
     
-    const char *location = location_json->valuestring;
-    int include_aqi = (aqi_json && cJSON_IsBool(aqi_json)) ? cJSON_IsTrue(aqi_json) : 0;
+    // Copy parameters out before the JSON tree is released
+    current_request_t request;
+    strncpy(request.location, location_json->valuestring, sizeof(request.location) - 1);
+    request.location[sizeof(request.location) - 1] = '\0';
+    request.include_aqi = (aqi_json && cJSON_IsBool(aqi_json)) ? cJSON_IsTrue(aqi_json) : 0;
     
     cJSON_Delete(json);
     
-    return handle_current_get(connection, location, include_aqi);
+    return handle_current_get(connection, ctx, request.location, request.include_aqi);
 }
 
 /**
- * Handle forecast endpoints (both GET and POST)
+ * Send the result of a completed /forecast request
  */
-static enum MHD_Result handle_forecast(struct MHD_Connection *connection, const char *location, int days, int include_aqi, int include_alerts, int include_hourly) {
-    forecast_response_t response;
-    char *json_str;
+static enum MHD_Result send_forecast_result(struct MHD_Connection *connection, connection_context_t *ctx) {
     struct MHD_Response *http_response;
     enum MHD_Result ret;
     
+    http_response = ctx->upstream_result == 0 ? result_response(ctx) : NULL;
+    if (!http_response) {
+        return send_upstream_error(connection, ctx, "Failed to fetch forecast data");
+    }
+    
+    MHD_add_response_header(http_response, "Content-Type", format_content_type(ctx->format));
+    MHD_add_response_header(http_response, "Vary", "Accept");
+    add_cors_headers(http_response);
+    add_cache_headers(http_response, ctx);
+    ret = MHD_queue_response(connection, MHD_HTTP_OK, http_response);
+    MHD_destroy_response(http_response);
+    
+    return ret;
+}
+
+/**
+ * Handle forecast endpoints (both GET and POST)
+ * Starts the upstream request asynchronously; the response is sent by
+ * send_forecast_result() once the connection is resumed.
+ */
+static enum MHD_Result handle_forecast(struct MHD_Connection *connection, connection_context_t *ctx,
+                                       const char *location, int days, int include_aqi, int include_alerts, int include_hourly) {
     if (server_verbose) {
         printf("Forecast request: location=%s, days=%d, aqi=%d, alerts=%d, hourly=%d\n", 
                location, days, include_aqi, include_alerts, include_hourly);
@@ -482,43 +645,499 @@ static enum MHD_Result handle_forecast(struct MHD_Connection *connection, const
     // Validate days
     if (days < 1 || days > 14) {
         cJSON *error = create_error_response(400, "Invalid days parameter", "Must be between 1 and 14");
-        json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        http_response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *http_response = json_response(error);
         MHD_add_response_header(http_response, "Content-Type", "application/json");
         add_cors_headers(http_response);
-        ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, http_response);
+        enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, http_response);
         MHD_destroy_response(http_response);
         return ret;
     }
     
+    ctx->is_forecast = 1;
+    ctx->include_hourly = include_hourly;
+    
+    // Answer from the response cache without suspending
+    ctx->result = weather_api_get_forecast_cached(location, days, include_aqi, include_alerts, &ctx->cache_status);
+    if (ctx->result) {
+        ctx->upstream_result = 0;
+        ctx->from_cache = 1;
+        return send_forecast_result(connection, ctx);
+    }
+    
     // Fetch forecast data
-    if (weather_api_get_forecast(location, days, include_aqi, include_alerts, &response) != 0) {
-        cJSON *error = create_error_response(500, "Failed to fetch forecast data", "Check if location exists and API is accessible");
-        json_str = cJSON_Print(error);
-        cJSON_Delete(error);
+    suspend_for_upstream(connection, ctx);
+    int status = weather_api_get_forecast_async(location, days, include_aqi, include_alerts,
+                                                upstream_completed, ctx);
+    if (status != 0) {
+        upstream_completed(status, NULL, ctx);
+    }
+    
+    return MHD_YES;
+}
+
+/**
+ * One location of a batch request
+ */
+typedef struct batch_item {
+    struct batch_stream *stream;
+    struct batch_item *next;            // Next in the stream's ready list
+    int index;                          // Position in the request's locations array
+    int status;                         // HTTP status of its line, 0 until known
+    const char *error;                  // Message of an error line
+    weather_result_t *result;           // Result of a 200 line (one reference held)
+    char nearby[WEATHER_LOCATION_POINT_SIZE];   // Cached point that answered, if not the location itself
+    double nearby_km;
+    char location[256];
+} batch_item_t;
+
+/**
+ * State of a POST /batch/current or /batch/forecast response
+ * Items complete on the reactor thread and are queued in the ready list; the
+ * content reader (an MHD worker) writes queued items as NDJSON lines and
+ * suspends the connection while none are ready, and the next completion
+ * resumes it. The lock guards everything the two sides share.
+ */
+typedef struct batch_stream {
+    pthread_mutex_t lock;
+    int refs;                           // The response, plus one per upstream request in flight
+    struct MHD_Connection *connection;
+    int suspended;                      // Suspended by the reader until an item is ready
+    int closed;                         // Response released: start nothing more
+    batch_item_t *ready;                // Items known but not written yet, oldest first
+    batch_item_t *ready_tail;
+    int next;                           // Items below this are answered or being fetched
+    int fetching;                       // Upstream requests in flight
+    int written;                        // Lines written (reader only)
+    char *out;                          // Lines not yet copied to MHD (reader only)
+    size_t out_length;
+    size_t out_offset;
+    size_t out_capacity;
+    // Common options of every item
+    int is_forecast;
+    int days;
+    int include_aqi;
+    int include_alerts;
+    int include_hourly;
+    int precision;
+    int projected;
+    weather_fields_t fields;
+    int count;
+    batch_item_t items[];
+} batch_stream_t;
+
+/**
+ * Queue an item for the reader (caller holds the lock or is the only thread)
+ */
+static void batch_queue(batch_stream_t *stream, batch_item_t *item) {
+    item->next = NULL;
+    if (stream->ready_tail) {
+        stream->ready_tail->next = item;
+    } else {
+        stream->ready = item;
+    }
+    stream->ready_tail = item;
+}
+
+/**
+ * Drop a reference to a batch stream, freeing it with the last
+ */
+static void batch_release(batch_stream_t *stream) {
+    pthread_mutex_lock(&stream->lock);
+    int refs = --stream->refs;
+    pthread_mutex_unlock(&stream->lock);
+    if (refs > 0) {
+        return;
+    }
+    
+    for (int i = 0; i < stream->count; i++) {
+        weather_result_release(stream->items[i].result);
+    }
+    pthread_mutex_destroy(&stream->lock);
+    free(stream->out);
+    free(stream);
+}
+
+/**
+ * Record how a fetched item ended and wake the reader
+ */
+static void batch_finish(batch_item_t *item, int upstream_result, weather_result_t *result) {
+    batch_stream_t *stream = item->stream;
+    
+    pthread_mutex_lock(&stream->lock);
+    item->result = result;
+    if (result) {
+        item->status = MHD_HTTP_OK;
+    } else if (upstream_result == WEATHER_API_UNAVAILABLE) {
+        item->status = MHD_HTTP_SERVICE_UNAVAILABLE;
+        item->error = "Weather provider unavailable";
+    } else if (upstream_result == WEATHER_API_UNKNOWN_LOCATION) {
+        item->status = MHD_HTTP_BAD_REQUEST;
+        item->error = "Location not found";
+    } else {
+        item->status = MHD_HTTP_INTERNAL_SERVER_ERROR;
+        item->error = stream->is_forecast ? "Failed to fetch forecast data" : "Failed to fetch weather data";
+    }
+    stream->fetching--;
+    batch_queue(stream, item);
+    if (stream->suspended && !stream->closed) {
+        stream->suspended = 0;
+        MHD_resume_connection(stream->connection);
+    }
+    pthread_mutex_unlock(&stream->lock);
+}
+
+static void batch_completed(int result, weather_result_t *data, void *user_data);
+
+/**
+ * Look an item up in the response cache, noting a nearby point that answered it
+ * @return Result with a reference for the caller, NULL on miss
+ */
+static weather_result_t *batch_cached(const batch_stream_t *stream, batch_item_t *item) {
+    weather_cache_status_t status;
+    weather_result_t *result = stream->is_forecast
+        ? weather_api_get_forecast_cached(item->location, stream->days, stream->include_aqi,
+                                          stream->include_alerts, &status)
+        : weather_api_get_current_cached(item->location, stream->include_aqi, &status);
+    if (result && status.nearby[0]) {
+        strcpy(item->nearby, status.nearby);
+        item->nearby_km = status.nearby_km;
+    }
+    return result;
+}
+
+/**
+ * Start fetching the next misses, up to BATCH_CONCURRENCY at a time
+ * The caller holds a reference. A miss is looked up again first, since
+ * another request may have fetched it meanwhile; during shutdown the
+ * remaining misses fail without going upstream.
+ */
+static void batch_fetch(batch_stream_t *stream) {
+    for (;;) {
+        batch_item_t *item = NULL;
         
-        http_response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
-        MHD_add_response_header(http_response, "Content-Type", "application/json");
-        add_cors_headers(http_response);
-        ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, http_response);
-        MHD_destroy_response(http_response);
-        return ret;
+        pthread_mutex_lock(&stream->lock);
+        while (stream->next < stream->count && stream->items[stream->next].status != 0) {
+            stream->next++;
+        }
+        if (!stream->closed && stream->fetching < BATCH_CONCURRENCY && stream->next < stream->count) {
+            item = &stream->items[stream->next++];
+            stream->fetching++;
+            stream->refs++;
+        }
+        pthread_mutex_unlock(&stream->lock);
+        
+        if (!item) {
+            return;
+        }
+        
+        weather_result_t *result = batch_cached(stream, item);
+        int status = WEATHER_API_UNAVAILABLE;
+        if (!result && server_running) {
+            status = stream->is_forecast
+                ? weather_api_get_forecast_async(item->location, stream->days, stream->include_aqi,
+                                                 stream->include_alerts, batch_completed, item)
+                : weather_api_get_current_async(item->location, stream->include_aqi, batch_completed, item);
+            if (status == 0) {
+                continue;
+            }
+        }
+        batch_finish(item, status, result);
+        batch_release(stream);
+    }
+}
+
+/**
+ * Upstream completion of a batch item (reactor thread)
+ */
+static void batch_completed(int result, weather_result_t *data, void *user_data) {
+    batch_item_t *item = user_data;
+    batch_stream_t *stream = item->stream;
+    
+    batch_finish(item, result, data);
+    batch_fetch(stream);
+    batch_release(stream);
+}
+
+/**
+ * Append bytes to the lines waiting for MHD
+ */
+static int batch_append(batch_stream_t *stream, const char *data, size_t length) {
+    if (stream->out_length + length > stream->out_capacity) {
+        size_t capacity = stream->out_capacity ? stream->out_capacity : 4096;
+        while (capacity < stream->out_length + length) {
+            capacity *= 2;
+        }
+        char *out = realloc(stream->out, capacity);
+        if (!out) {
+            fprintf(stderr, "Failed to allocate batch response buffer\n");
+            return -1;
+        }
+        stream->out = out;
+        stream->out_capacity = capacity;
+    }
+    memcpy(stream->out + stream->out_length, data, length);
+    stream->out_length += length;
+    return 0;
+}
+
+/**
+ * Write an item's NDJSON line
+ * {"index":N,"location":"...","status":200,"data":{...}} with the body in
+ * compact JSON, or "error":"..." in place of data. A line answered from a
+ * nearby cached point also has "match":{"location":"lat,lon","distance_km":D}.
+ */
+static int batch_write_item(batch_stream_t *stream, batch_item_t *item) {
+    weather_piece_t pieces[WEATHER_BODY_MAX_PIECES];
+    char *data = NULL;
+    size_t data_length = 0;
+    int count = 0;
+    
+    if (item->status == MHD_HTTP_OK) {
+        count = render_result(item->result, WEATHER_FORMAT_JSON, 0, stream->precision,
+                              stream->projected ? &stream->fields : NULL, stream->include_hourly,
+                              pieces, &data, &data_length);
+        if (count < 0) {
+            item->status = MHD_HTTP_INTERNAL_SERVER_ERROR;
+            item->error = "Failed to serialize response";
+        }
+    }
+    
+    weather_json_writer_t writer;
+    weather_json_writer_init(&writer, 0, WEATHER_JSON_SHORTEST);
+    weather_json_begin_object(&writer, NULL);
+    weather_json_int(&writer, "index", item->index);
+    weather_json_string(&writer, "location", item->location);
+    weather_json_int(&writer, "status", item->status);
+    if (item->status == MHD_HTTP_OK && item->nearby[0]) {
+        weather_json_begin_object(&writer, "match");
+        weather_json_string(&writer, "location", item->nearby);
+        weather_json_fixed(&writer, "distance_km", (long long)(item->nearby_km * 100 + 0.5), 2);
+        weather_json_end_object(&writer);
+    }
+    if (item->status != MHD_HTTP_OK) {
+        weather_json_string(&writer, "error", item->error);
+        weather_json_end_object(&writer);
+    }
+    size_t head_length;
+    char *head = weather_json_writer_finish(&writer, &head_length);
+    int status = head ? batch_append(stream, head, head_length) : -1;
+    free(head);
+    
+    if (status == 0 && item->status == MHD_HTTP_OK) {
+        status = batch_append(stream, ",\"data\":", 8);
+        for (int i = 0; status == 0 && i < count; i++) {
+            status = batch_append(stream, pieces[i].data, pieces[i].length);
+        }
+        if (status == 0 && count == 0) {
+            status = batch_append(stream, data, data_length);
+        }
+        if (status == 0) {
+            status = batch_append(stream, "}", 1);
+        }
+    }
+    if (status == 0) {
+        status = batch_append(stream, "\n", 1);
+    }
+    free(data);
+    
+    // Written lines keep nothing alive
+    weather_result_release(item->result);
+    item->result = NULL;
+    return status;
+}
+
+/**
+ * Content reader of a batch response (MHD worker)
+ * Writes every ready item into the buffer, then hands it to MHD in as many
+ * calls as it takes. With nothing ready and items outstanding, the
+ * connection is suspended instead of being polled.
+ */
+static ssize_t batch_read(void *cls, uint64_t pos, char *buf, size_t max) {
+    batch_stream_t *stream = cls;
+    (void)pos;
+    
+    if (stream->out_offset == stream->out_length) {
+        stream->out_offset = stream->out_length = 0;
+        
+        pthread_mutex_lock(&stream->lock);
+        batch_item_t *item = stream->ready;
+        stream->ready = stream->ready_tail = NULL;
+        if (!item && stream->written < stream->count) {
+            stream->suspended = 1;
+            MHD_suspend_connection(stream->connection);
+        }
+        pthread_mutex_unlock(&stream->lock);
+        
+        if (!item) {
+            return stream->written < stream->count ? 0 : MHD_CONTENT_READER_END_OF_STREAM;
+        }
+        for (; item; item = item->next) {
+            if (batch_write_item(stream, item) != 0) {
+                return MHD_CONTENT_READER_END_WITH_ERROR;
+            }
+            stream->written++;
+        }
+    }
+    
+    size_t length = stream->out_length - stream->out_offset;
+    if (length > max) {
+        length = max;
+    }
+    memcpy(buf, stream->out + stream->out_offset, length);
+    stream->out_offset += length;
+    return (ssize_t)length;
+}
+
+/**
+ * Release a batch response's reference once MHD is done with it
+ */
+static void batch_closed(void *cls) {
+    batch_stream_t *stream = cls;
+    
+    pthread_mutex_lock(&stream->lock);
+    stream->closed = 1;
+    stream->connection = NULL;
+    pthread_mutex_unlock(&stream->lock);
+    batch_release(stream);
+}
+
+/**
+ * Send a JSON error response
+ */
+static enum MHD_Result send_error(struct MHD_Connection *connection, int status, const char *message,
+                                  const char *details) {
+    cJSON *error = create_error_response(status, message, details);
+    struct MHD_Response *response = json_response(error);
+    MHD_add_response_header(response, "Content-Type", "application/json");
+    add_cors_headers(response);
+    enum MHD_Result ret = MHD_queue_response(connection, status, response);
+    MHD_destroy_response(response);
+    return ret;
+}
+
+/**
+ * Handle POST /batch/current and POST /batch/forecast
+ * The body names the locations and the options they share:
+ * {"locations":[...],"include_aqi":bool} plus, for forecasts, "days" (1-14),
+ * "include_alerts", "include_hourly" and "layout" (rows or columnar). Each
+ * location gets one NDJSON line in the order results become known: cache
+ * hits first, then misses as upstream answers them, at most
+ * BATCH_CONCURRENCY at a time. A location that fails gets an error line;
+ * the response itself is 200 once the request is valid.
+ */
+static enum MHD_Result handle_batch(struct MHD_Connection *connection, connection_context_t *ctx, int is_forecast,
+                                    const char *upload_data, size_t *upload_data_size) {
+    if (*upload_data_size != 0) {
+        return accumulate_post_data(ctx, upload_data, upload_data_size);
+    }
+    
+    if (ctx->post_data == NULL) {
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "No JSON data provided", NULL);
+    }
+    
+    cJSON *json = cJSON_Parse(ctx->post_data);
+    if (!json) {
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "Invalid JSON", NULL);
+    }
+    
+    cJSON *locations = cJSON_GetObjectItem(json, "locations");
+    int count = cJSON_IsArray(locations) ? cJSON_GetArraySize(locations) : 0;
+    if (count == 0) {
+        cJSON_Delete(json);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "Missing or invalid 'locations' field",
+                          "Must be a non-empty array of location names");
+    }
+    if (count > BATCH_MAX_LOCATIONS) {
+        cJSON_Delete(json);
+        char details[64];
+        snprintf(details, sizeof(details), "At most %d per request", BATCH_MAX_LOCATIONS);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "Too many locations", details);
     }
     
-    // Convert to JSON
-    cJSON *json = forecast_response_to_json(&response, include_hourly);
-    json_str = cJSON_Print(json);
+    cJSON *aqi_json = cJSON_GetObjectItem(json, "include_aqi");
+    cJSON *days_json = cJSON_GetObjectItem(json, "days");
+    cJSON *alerts_json = cJSON_GetObjectItem(json, "include_alerts");
+    cJSON *hourly_json = cJSON_GetObjectItem(json, "include_hourly");
+    cJSON *layout_json = cJSON_GetObjectItem(json, "layout");
+    int days = cJSON_IsNumber(days_json) ? days_json->valueint : 0;
+    int include_hourly = cJSON_IsTrue(hourly_json) ? WEATHER_HOURLY_ROWS : WEATHER_HOURLY_NONE;
+    if (is_forecast && (days < 1 || days > 14)) {
+        cJSON_Delete(json);
+        return send_error(connection, MHD_HTTP_BAD_REQUEST, "Invalid days parameter", "Must be between 1 and 14");
+    }
+    if (is_forecast && layout_json) {
+        const char *layout = cJSON_IsString(layout_json) ? layout_json->valuestring : "";
+        if (strcmp(layout, "rows") != 0 && strcmp(layout, "columnar") != 0) {
+            cJSON_Delete(json);
+            return send_error(connection, MHD_HTTP_BAD_REQUEST, "Invalid 'layout' parameter", "Must be rows or columnar");
+        }
+        if (include_hourly && strcmp(layout, "columnar") == 0) {
+            include_hourly = WEATHER_HOURLY_COLUMNS;
+        }
+    }
+    
+    batch_stream_t *stream = calloc(1, sizeof(batch_stream_t) + (size_t)count * sizeof(batch_item_t));
+    if (!stream) {
+        cJSON_Delete(json);
+        return send_error(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, "Memory allocation failed", NULL);
+    }
+    pthread_mutex_init(&stream->lock, NULL);
+    stream->refs = 1;
+    stream->connection = connection;
+    stream->is_forecast = is_forecast;
+    stream->days = days;
+    stream->include_aqi = cJSON_IsTrue(aqi_json);
+    stream->include_alerts = is_forecast && cJSON_IsTrue(alerts_json);
+    stream->include_hourly = is_forecast ? include_hourly : WEATHER_HOURLY_NONE;
+    stream->precision = ctx->precision;
+    stream->projected = ctx->projected;
+    stream->fields = ctx->fields;
+    stream->count = count;
+    
+    // Answer invalid names and cache hits up front; the rest are misses
+    int index = 0;
+    int hits = 0;
+    cJSON *location_json;
+    cJSON_ArrayForEach(location_json, locations) {
+        batch_item_t *item = &stream->items[index];
+        item->stream = stream;
+        item->index = index++;
+        
+        const char *location = cJSON_IsString(location_json) ? location_json->valuestring : "";
+        if (!*location || strlen(location) >= sizeof(item->location)) {
+            item->status = MHD_HTTP_BAD_REQUEST;
+            item->error = "Invalid location";
+            batch_queue(stream, item);
+            continue;
+        }
+        strcpy(item->location, location);
+        
+        item->result = batch_cached(stream, item);
+        if (item->result) {
+            item->status = MHD_HTTP_OK;
+            batch_queue(stream, item);
+            hits++;
+        }
+    }
     cJSON_Delete(json);
-    forecast_response_free(&response);
     
-    // Send response
-    http_response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
-    MHD_add_response_header(http_response, "Content-Type", "application/json");
-    add_cors_headers(http_response);
-    ret = MHD_queue_response(connection, MHD_HTTP_OK, http_response);
-    MHD_destroy_response(http_response);
+    if (server_verbose) {
+        printf("POST /batch/%s: %d locations, %d cached\n", is_forecast ? "forecast" : "current", count, hits);
+    }
+    
+    // Misses complete on the reactor thread, possibly before the response is queued
+    batch_fetch(stream);
+    
+    struct MHD_Response *response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN, BATCH_BLOCK_SIZE,
+                                                                      batch_read, stream, batch_closed);
+    if (!response) {
+        batch_closed(stream);
+        return MHD_NO;
+    }
+    MHD_add_response_header(response, "Content-Type", "application/x-ndjson");
+    add_cors_headers(response);
+    enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
+    MHD_destroy_response(response);
     
     return ret;
 }
@@ -532,10 +1151,104 @@ static enum MHD_Result handle_health(struct MHD_Connection *connection) {
     cJSON_AddStringToObject(json, "service", "weather-api");
     cJSON_AddStringToObject(json, "version", "1.0.0");
     
-    char *json_str = cJSON_Print(json);
-    cJSON_Delete(json);
+    // Response cache statistics
+    if (weather_cache_enabled()) {
+        weather_cache_stats_t stats;
+        weather_cache_get_stats(&stats);
+        
+        cJSON *cache = cJSON_CreateObject();
+        cJSON_AddNumberToObject(cache, "entries", (double)stats.entries);
+        cJSON_AddNumberToObject(cache, "bytes", (double)stats.bytes);
+        cJSON_AddNumberToObject(cache, "max_bytes", (double)stats.max_bytes);
+        cJSON_AddNumberToObject(cache, "hits", (double)stats.hits);
+        cJSON_AddNumberToObject(cache, "misses", (double)stats.misses);
+        cJSON_AddNumberToObject(cache, "stale_hits", (double)stats.stale_hits);
+        cJSON_AddNumberToObject(cache, "superset_hits", (double)stats.superset_hits);
+        cJSON_AddNumberToObject(cache, "nearby_hits", (double)stats.nearby_hits);
+        cJSON_AddNumberToObject(cache, "refreshes", (double)stats.refreshes);
+        cJSON_AddNumberToObject(cache, "inserts", (double)stats.inserts);
+        cJSON_AddNumberToObject(cache, "rejections", (double)stats.rejections);
+        cJSON_AddNumberToObject(cache, "evictions", (double)stats.evictions);
+        cJSON_AddNumberToObject(cache, "expirations", (double)stats.expirations);
+        cJSON_AddItemToObject(json, "cache", cache);
+    }
     
-    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+    // Location aliases and rejections learned from upstream
+    weather_location_stats_t location_stats;
+    weather_location_get_stats(&location_stats);
+    cJSON *locations = cJSON_CreateObject();
+    cJSON_AddNumberToObject(locations, "entries", (double)location_stats.entries);
+    cJSON_AddNumberToObject(locations, "learned", (double)location_stats.learned);
+    cJSON_AddNumberToObject(locations, "alias_hits", (double)location_stats.alias_hits);
+    cJSON_AddNumberToObject(locations, "rejections", (double)location_stats.rejections);
+    cJSON_AddNumberToObject(locations, "rejected_hits", (double)location_stats.rejected_hits);
+    cJSON_AddNumberToObject(locations, "points", (double)location_stats.points);
+    cJSON_AddNumberToObject(locations, "nearby_lookups", (double)location_stats.nearby_lookups);
+    cJSON_AddItemToObject(json, "locations", locations);
+    
+    // Upstream request coalescing
+    weather_api_stats_t api_stats;
+    weather_api_get_stats(&api_stats);
+    cJSON *upstream = cJSON_CreateObject();
+    cJSON_AddNumberToObject(upstream, "leader_requests", (double)api_stats.leader_requests);
+    cJSON_AddNumberToObject(upstream, "coalesced_requests", (double)api_stats.coalesced_requests);
+    
+    // Upstream batching: locations per upstream call and the latency collecting them added
+    cJSON_AddNumberToObject(upstream, "batches", (double)api_stats.batches);
+    cJSON_AddNumberToObject(upstream, "bulk_requests", (double)api_stats.bulk_requests);
+    cJSON_AddNumberToObject(upstream, "batched_requests", (double)api_stats.batched_requests);
+    cJSON_AddNumberToObject(upstream, "batch_fill",
+                            api_stats.batches ? (double)api_stats.batched_requests / api_stats.batches : 0);
+    cJSON_AddNumberToObject(upstream, "batch_wait_ms",
+                            api_stats.batched_requests ? api_stats.batch_wait_seconds * 1000 / api_stats.batched_requests : 0);
+    
+    // Upstream resilience: attempts, circuit breaker and concurrency limit
+    static const char *breaker_names[] = {"closed", "open", "half_open"};
+    http_client_stats_t client_stats;
+    weather_upstream_stats_t upstream_stats;
+    http_client_get_stats(&client_stats);
+    weather_upstream_get_stats(&upstream_stats);
+    cJSON_AddNumberToObject(upstream, "attempts", (double)client_stats.attempts);
+    cJSON_AddNumberToObject(upstream, "retries", (double)client_stats.retries);
+    cJSON_AddNumberToObject(upstream, "hedges", (double)client_stats.hedges);
+    cJSON_AddNumberToObject(upstream, "hedge_wins", (double)client_stats.hedge_wins);
+    cJSON_AddNumberToObject(upstream, "failures", (double)upstream_stats.failures);
+    cJSON_AddNumberToObject(upstream, "shed", (double)upstream_stats.shed);
+    cJSON_AddStringToObject(upstream, "breaker", breaker_names[upstream_stats.breaker]);
+    cJSON_AddNumberToObject(upstream, "breaker_trips", (double)upstream_stats.breaker_trips);
+    cJSON_AddNumberToObject(upstream, "in_flight", upstream_stats.in_flight);
+    cJSON_AddNumberToObject(upstream, "limit", upstream_stats.limit);
+    cJSON_AddNumberToObject(upstream, "p95_ms", (double)upstream_stats.p95_ms);
+    cJSON_AddItemToObject(json, "upstream", upstream);
+    
+    // cJSON allocations (per-request arenas)
+    weather_json_stats_t json_stats;
+    weather_json_get_stats(&json_stats);
+    cJSON *json_alloc = cJSON_CreateObject();
+    cJSON_AddBoolToObject(json_alloc, "arena", server_cfg.json_arena);
+    cJSON_AddNumberToObject(json_alloc, "requests", (double)json_stats.scopes);
+    cJSON_AddNumberToObject(json_alloc, "arena_allocs", (double)json_stats.arena_allocs);
+    cJSON_AddNumberToObject(json_alloc, "heap_allocs", (double)json_stats.heap_allocs);
+    cJSON_AddItemToObject(json, "json", json_alloc);
+    
+    // Forecast arenas: how many came back from the free list instead of the heap
+    weather_arena_stats_t arena_stats;
+    weather_arena_get_stats(&arena_stats);
+    cJSON *arenas = cJSON_CreateObject();
+    cJSON_AddNumberToObject(arenas, "created", (double)arena_stats.created);
+    cJSON_AddNumberToObject(arenas, "reused", (double)arena_stats.reused);
+    cJSON_AddItemToObject(json, "arenas", arenas);
+    
+    weather_body_stats_t body_stats;
+    weather_body_get_stats(&body_stats);
+    cJSON *fragments = cJSON_CreateObject();
+    cJSON_AddBoolToObject(fragments, "enabled", server_cfg.body_cache);
+    cJSON_AddNumberToObject(fragments, "hits", (double)body_stats.hits);
+    cJSON_AddNumberToObject(fragments, "renders", (double)body_stats.renders);
+    cJSON_AddNumberToObject(fragments, "bytes", (double)body_stats.bytes);
+    cJSON_AddItemToObject(json, "fragments", fragments);
+    
+    struct MHD_Response *response = json_response(json);
     MHD_add_response_header(response, "Content-Type", "application/json");
     add_cors_headers(response);
     enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
@@ -644,47 +1357,33 @@ static int verify_slack_signature(struct MHD_Connection *connection,
  * Handle Slack events endpoint
  */
 static enum MHD_Result handle_slack_events(struct MHD_Connection *connection, 
+                                          connection_context_t *ctx,
                                           const char *upload_data,
                                           size_t *upload_data_size) {
-    static char *post_data = NULL;
-    static size_t post_data_size = 0;
-    
     // Accumulate POST data
     if (*upload_data_size > 0) {
-        char *new_data = realloc(post_data, post_data_size + *upload_data_size + 1);
+        char *new_data = realloc(ctx->post_data, ctx->post_data_len + *upload_data_size + 1);
         if (!new_data) {
-            free(post_data);
-            post_data = NULL;
-            post_data_size = 0;
-            
             cJSON *error = create_error_response(500, "Memory allocation failed", NULL);
-            char *json_str = cJSON_Print(error);
-            cJSON_Delete(error);
-            
-            struct MHD_Response *response = MHD_create_response_from_buffer(
-                strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+            struct MHD_Response *response = json_response(error);
             MHD_add_response_header(response, "Content-Type", "application/json");
             enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_INTERNAL_SERVER_ERROR, response);
             MHD_destroy_response(response);
             return ret;
         }
         
-        post_data = new_data;
-        memcpy(post_data + post_data_size, upload_data, *upload_data_size);
-        post_data_size += *upload_data_size;
-        post_data[post_data_size] = '\0';
+        ctx->post_data = new_data;
+        memcpy(ctx->post_data + ctx->post_data_len, upload_data, *upload_data_size);
+        ctx->post_data_len += *upload_data_size;
+        ctx->post_data[ctx->post_data_len] = '\0';
         *upload_data_size = 0;
         return MHD_YES;
     }
     
     // Process the complete request
-    if (post_data == NULL || post_data_size == 0) {
+    if (ctx->post_data == NULL || ctx->post_data_len == 0) {
         cJSON *error = create_error_response(400, "Empty request body", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
@@ -692,23 +1391,15 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
     }
     
     // Verify Slack signature
-    if (!verify_slack_signature(connection, post_data, post_data_size)) {
+    if (!verify_slack_signature(connection, ctx->post_data, ctx->post_data_len)) {
         // Log the failed verification attempt
         fprintf(stderr, "[SECURITY] Slack signature verification failed - request discarded\n");
         fprintf(stderr, "[SECURITY] Remote IP: %s\n", 
                 MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "X-Forwarded-For") ?: 
                 MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "X-Real-IP") ?: "unknown");
         
-        free(post_data);
-        post_data = NULL;
-        post_data_size = 0;
-        
         cJSON *error = create_error_response(401, "Unauthorized", "Invalid request signature");
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_UNAUTHORIZED, response);
         MHD_destroy_response(response);
@@ -716,22 +1407,14 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
     }
     
     if (server_verbose) {
-        printf("POST /slack/events - Body: %s\n", post_data);
+        printf("POST /slack/events - Body: %s\n", ctx->post_data);
     }
     
     // Parse the JSON request
-    cJSON *request = cJSON_Parse(post_data);
+    cJSON *request = cJSON_Parse(ctx->post_data);
     if (!request) {
-        free(post_data);
-        post_data = NULL;
-        post_data_size = 0;
-        
         cJSON *error = create_error_response(400, "Invalid JSON", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
@@ -742,16 +1425,9 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
     cJSON *type_item = cJSON_GetObjectItem(request, "type");
     if (!type_item || !cJSON_IsString(type_item)) {
         cJSON_Delete(request);
-        free(post_data);
-        post_data = NULL;
-        post_data_size = 0;
         
         cJSON *error = create_error_response(400, "Missing 'type' field", NULL);
-        char *json_str = cJSON_Print(error);
-        cJSON_Delete(error);
-        
-        struct MHD_Response *response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        struct MHD_Response *response = json_response(error);
         MHD_add_response_header(response, "Content-Type", "application/json");
         enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
         MHD_destroy_response(response);
@@ -761,23 +1437,15 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
     const char *event_type = type_item->valuestring;
     struct MHD_Response *response;
     enum MHD_Result ret;
-    char *json_str;
     
     // Handle URL verification challenge
     if (strcmp(event_type, "url_verification") == 0) {
         cJSON *challenge_item = cJSON_GetObjectItem(request, "challenge");
         if (!challenge_item || !cJSON_IsString(challenge_item)) {
             cJSON_Delete(request);
-            free(post_data);
-            post_data = NULL;
-            post_data_size = 0;
             
             cJSON *error = create_error_response(400, "Missing 'challenge' field", NULL);
-            json_str = cJSON_Print(error);
-            cJSON_Delete(error);
-            
-            response = MHD_create_response_from_buffer(
-                strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+            response = json_response(error);
             MHD_add_response_header(response, "Content-Type", "application/json");
             ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
             MHD_destroy_response(response);
@@ -793,19 +1461,12 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
         // Create response with just the challenge string
         cJSON *response_json = cJSON_CreateObject();
         cJSON_AddStringToObject(response_json, "challenge", challenge);
-        json_str = cJSON_Print(response_json);
-        cJSON_Delete(response_json);
-        
-        response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        response = json_response(response_json);
         MHD_add_response_header(response, "Content-Type", "application/json");
         ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
         MHD_destroy_response(response);
         
         cJSON_Delete(request);
-        free(post_data);
-        post_data = NULL;
-        post_data_size = 0;
         
         return ret;
     }
@@ -829,19 +1490,12 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
                 
                 cJSON *ack_response = cJSON_CreateObject();
                 cJSON_AddStringToObject(ack_response, "status", "ok");
-                json_str = cJSON_Print(ack_response);
-                cJSON_Delete(ack_response);
-                
-                response = MHD_create_response_from_buffer(
-                    strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+                response = json_response(ack_response);
                 MHD_add_response_header(response, "Content-Type", "application/json");
                 ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
                 MHD_destroy_response(response);
                 
                 cJSON_Delete(request);
-                free(post_data);
-                post_data = NULL;
-                post_data_size = 0;
                 
                 return ret;
             }
@@ -856,19 +1510,12 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
                     
                     cJSON *ack_response = cJSON_CreateObject();
                     cJSON_AddStringToObject(ack_response, "status", "ok");
-                    json_str = cJSON_Print(ack_response);
-                    cJSON_Delete(ack_response);
-                    
-                    response = MHD_create_response_from_buffer(
-                        strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+                    response = json_response(ack_response);
                     MHD_add_response_header(response, "Content-Type", "application/json");
                     ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
                     MHD_destroy_response(response);
                     
                     cJSON_Delete(request);
-                    free(post_data);
-                    post_data = NULL;
-                    post_data_size = 0;
                     
                     return ret;
                 }
@@ -903,19 +1550,12 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
         // Acknowledge the event
         cJSON *ack_response = cJSON_CreateObject();
         cJSON_AddStringToObject(ack_response, "status", "ok");
-        json_str = cJSON_Print(ack_response);
-        cJSON_Delete(ack_response);
-        
-        response = MHD_create_response_from_buffer(
-            strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+        response = json_response(ack_response);
         MHD_add_response_header(response, "Content-Type", "application/json");
         ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
         MHD_destroy_response(response);
         
         cJSON_Delete(request);
-        free(post_data);
-        post_data = NULL;
-        post_data_size = 0;
         
         return ret;
     }
@@ -928,39 +1568,60 @@ static enum MHD_Result handle_slack_events(struct MHD_Connection *connection,
     // For now, acknowledge other events
     cJSON *ack_response = cJSON_CreateObject();
     cJSON_AddStringToObject(ack_response, "status", "ok");
-    json_str = cJSON_Print(ack_response);
-    cJSON_Delete(ack_response);
-    
-    response = MHD_create_response_from_buffer(
-        strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+    response = json_response(ack_response);
     MHD_add_response_header(response, "Content-Type", "application/json");
     ret = MHD_queue_response(connection, MHD_HTTP_OK, response);
     MHD_destroy_response(response);
     
     cJSON_Delete(request);
-    free(post_data);
-    post_data = NULL;
-    post_data_size = 0;
     
     return ret;
 }
 
 /**
- * Main HTTP request handler
+ * Route a request to its endpoint handler
  */
-static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connection,
-                                      const char *url, const char *method,
-                                      const char *version, const char *upload_data,
-                                      size_t *upload_data_size, void **con_cls) {
-    (void)cls;
-    (void)version;
-    static int aptr;
-    
+static enum MHD_Result dispatch_request(struct MHD_Connection *connection, const char *url, const char *method,
+                                        const char *upload_data, size_t *upload_data_size, void **con_cls) {
+    // First call for a new request: attach per-connection state
     if (*con_cls == NULL) {
-        *con_cls = &aptr;
+        connection_context_t *ctx = calloc(1, sizeof(connection_context_t));
+        if (!ctx) {
+            return MHD_NO;
+        }
+        
+        // Output options shared by the weather endpoints
+        const char *pretty_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "pretty");
+        const char *precision_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "precision");
+        const char *fields_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "fields");
+        ctx->format = negotiate_format(MHD_lookup_connection_value(connection, MHD_HEADER_KIND, "Accept"));
+        ctx->pretty = (pretty_str && (strcmp(pretty_str, "true") == 0 || strcmp(pretty_str, "1") == 0)) ? 1 : 0;
+        ctx->precision = WEATHER_JSON_SHORTEST;
+        if (precision_str && *precision_str) {
+            char *end;
+            long precision = strtol(precision_str, &end, 10);
+            if (*end == '\0' && precision >= 0 && precision <= WEATHER_JSON_MAX_PRECISION) {
+                ctx->precision = (int)precision;
+            }
+        }
+        if (fields_str) {
+            // Compiled once; the writers test bits of the mask
+            ctx->projected = 1;
+            ctx->fields_invalid = weather_fields_parse(fields_str, &ctx->fields, ctx->unknown_field,
+                                                       sizeof(ctx->unknown_field)) != 0;
+        }
+        
+        *con_cls = ctx;
         return MHD_YES;
     }
     
+    connection_context_t *ctx = *con_cls;
+    
+    // Resumed after an asynchronous upstream request: send its result
+    if (ctx->upstream_state == UPSTREAM_DONE) {
+        return ctx->is_forecast ? send_forecast_result(connection, ctx) : send_current_result(connection, ctx);
+    }
+    
     // Handle CORS preflight
     if (strcmp(method, "OPTIONS") == 0) {
         struct MHD_Response *response = MHD_create_response_from_buffer(0, "", MHD_RESPMEM_PERSISTENT);
@@ -977,7 +1638,25 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
     
     // Slack events endpoint
     if (strcmp(url, "/slack/events") == 0 && strcmp(method, "POST") == 0) {
-        return handle_slack_events(connection, upload_data, upload_data_size);
+        return handle_slack_events(connection, ctx, upload_data, upload_data_size);
+    }
+    
+    // Weather endpoints reject a projection naming unknown fields
+    if (ctx->fields_invalid && (strcmp(url, "/current") == 0 || strncmp(url, "/forecast", 9) == 0 ||
+                                strncmp(url, "/batch/", 7) == 0)) {
+        char details[128];
+        if (ctx->unknown_field[0]) {
+            snprintf(details, sizeof(details), "Unknown field '%s'", ctx->unknown_field);
+        } else {
+            snprintf(details, sizeof(details), "No fields selected");
+        }
+        cJSON *error = create_error_response(400, "Invalid 'fields' parameter", details);
+        struct MHD_Response *response = json_response(error);
+        MHD_add_response_header(response, "Content-Type", "application/json");
+        add_cors_headers(response);
+        enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+        MHD_destroy_response(response);
+        return ret;
     }
     
     // Current weather endpoints
@@ -988,10 +1667,7 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
             
             if (!location) {
                 cJSON *error = create_error_response(400, "Missing 'location' parameter", NULL);
-                char *json_str = cJSON_Print(error);
-                cJSON_Delete(error);
-                
-                struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+                struct MHD_Response *response = json_response(error);
                 MHD_add_response_header(response, "Content-Type", "application/json");
                 add_cors_headers(response);
                 enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
@@ -1000,9 +1676,9 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
             }
             
             int include_aqi = (aqi_str && (strcmp(aqi_str, "true") == 0 || strcmp(aqi_str, "1") == 0)) ? 1 : 0;
-            return handle_current_get(connection, location, include_aqi);
+            return handle_current_get(connection, ctx, location, include_aqi);
         } else if (strcmp(method, "POST") == 0) {
-            return handle_current_post(connection, upload_data, upload_data_size);
+            return handle_current_post(connection, ctx, upload_data, upload_data_size);
         }
     }
     
@@ -1014,13 +1690,11 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
             const char *aqi_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_aqi");
             const char *alerts_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_alerts");
             const char *hourly_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "include_hourly");
+            const char *layout_str = MHD_lookup_connection_value(connection, MHD_GET_ARGUMENT_KIND, "layout");
             
             if (!location || !days_str) {
                 cJSON *error = create_error_response(400, "Missing 'location' or 'days' parameter", NULL);
-                char *json_str = cJSON_Print(error);
-                cJSON_Delete(error);
-                
-                struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+                struct MHD_Response *response = json_response(error);
                 MHD_add_response_header(response, "Content-Type", "application/json");
                 add_cors_headers(response);
                 enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
@@ -1033,17 +1707,33 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
             int include_alerts = (alerts_str && (strcmp(alerts_str, "true") == 0 || strcmp(alerts_str, "1") == 0)) ? 1 : 0;
             int include_hourly = (hourly_str && (strcmp(hourly_str, "true") == 0 || strcmp(hourly_str, "1") == 0)) ? 1 : 0;
             
-            return handle_forecast(connection, location, days, include_aqi, include_alerts, include_hourly);
+            // Hours as one object each (default) or as one array per member
+            if (layout_str && strcmp(layout_str, "rows") != 0 && strcmp(layout_str, "columnar") != 0) {
+                cJSON *error = create_error_response(400, "Invalid 'layout' parameter", "Must be rows or columnar");
+                struct MHD_Response *response = json_response(error);
+                MHD_add_response_header(response, "Content-Type", "application/json");
+                add_cors_headers(response);
+                enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_BAD_REQUEST, response);
+                MHD_destroy_response(response);
+                return ret;
+            }
+            if (include_hourly && layout_str && strcmp(layout_str, "columnar") == 0) {
+                include_hourly = WEATHER_HOURLY_COLUMNS;
+            }
+            
+            return handle_forecast(connection, ctx, location, days, include_aqi, include_alerts, include_hourly);
         }
         // POST forecast handling would go here if needed
     }
     
+    // Batch endpoints: many locations, one NDJSON line each
+    if (strcmp(method, "POST") == 0 && (strcmp(url, "/batch/current") == 0 || strcmp(url, "/batch/forecast") == 0)) {
+        return handle_batch(connection, ctx, strcmp(url, "/batch/forecast") == 0, upload_data, upload_data_size);
+    }
+    
     // 404 Not Found
     cJSON *error = create_error_response(404, "Endpoint not found", NULL);
-    char *json_str = cJSON_Print(error);
-    cJSON_Delete(error);
-    
-    struct MHD_Response *response = MHD_create_response_from_buffer(strlen(json_str), json_str, MHD_RESPMEM_MUST_FREE);
+    struct MHD_Response *response = json_response(error);
     MHD_add_response_header(response, "Content-Type", "application/json");
     add_cors_headers(response);
     enum MHD_Result ret = MHD_queue_response(connection, MHD_HTTP_NOT_FOUND, response);
@@ -1052,6 +1742,43 @@ static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connect
     return ret;
 }
 
+/**
+ * Main HTTP request handler
+ * Each call runs in a cJSON scope: the JSON trees and text it builds are
+ * released together once its response has been queued.
+ */
+static enum MHD_Result request_handler(void *cls, struct MHD_Connection *connection,
+                                      const char *url, const char *method,
+                                      const char *version, const char *upload_data,
+                                      size_t *upload_data_size, void **con_cls) {
+    (void)cls;
+    (void)version;
+    
+    weather_json_scope_begin();
+    enum MHD_Result ret = dispatch_request(connection, url, method, upload_data, upload_data_size, con_cls);
+    weather_json_scope_end();
+    
+    return ret;
+}
+
+/**
+ * Release per-connection state once MHD has finished with a request
+ */
+static void request_completed(void *cls, struct MHD_Connection *connection,
+                              void **con_cls, enum MHD_RequestTerminationCode toe) {
+    (void)cls;
+    (void)connection;
+    (void)toe;
+    
+    connection_context_t *ctx = *con_cls;
+    if (ctx) {
+        free(ctx->post_data);
+        weather_result_release(ctx->result);
+        free(ctx);
+        *con_cls = NULL;
+    }
+}
+
 int http_server_init(const server_config_t *server_config, const weather_config_t *weather_config) {
     if (!server_config || !weather_config) {
         fprintf(stderr, "Invalid configuration provided to http_server_init\n");
@@ -1062,15 +1789,48 @@ int http_server_init(const server_config_t *server_config, const weather_config_
     memcpy(&server_cfg, server_config, sizeof(server_config_t));
     memcpy(&weather_cfg, weather_config, sizeof(weather_config_t));
     
+    // Per-request cJSON arenas (or plain heap allocations, still counted)
+    weather_json_init(server_cfg.json_arena);
+    
     // Initialize weather API
     if (weather_api_init(weather_config) != 0) {
         fprintf(stderr, "Failed to initialize weather API\n");
         return -1;
     }
     
+    // Warm the response cache from a previous snapshot
+    if (strlen(server_cfg.warm_from_path) > 0 && weather_cache_enabled()) {
+        struct timespec started, finished;
+        clock_gettime(CLOCK_MONOTONIC, &started);
+        int loaded = weather_cache_load(server_cfg.warm_from_path);
+        clock_gettime(CLOCK_MONOTONIC, &finished);
+        
+        double elapsed_ms = (finished.tv_sec - started.tv_sec) * 1000.0 +
+                            (finished.tv_nsec - started.tv_nsec) / 1000000.0;
+        if (loaded >= 0) {
+            printf("Cache warmed from %s: %d entries in %.1f ms\n", server_cfg.warm_from_path, loaded, elapsed_ms);
+        } else {
+            printf("Cache warm start skipped, starting cold\n");
+        }
+    }
+    
     return 0;
 }
 
+/**
+ * Write the cache snapshot if one is configured
+ */
+static void save_cache_snapshot(void) {
+    if (strlen(server_cfg.snapshot_path) == 0 || !weather_cache_enabled()) {
+        return;
+    }
+    
+    int saved = weather_cache_save(server_cfg.snapshot_path);
+    if (saved >= 0 && server_verbose) {
+        printf("Cache snapshot written to %s: %d entries\n", server_cfg.snapshot_path, saved);
+    }
+}
+
 int http_server_start(void) {
     // Set up signal handlers
     signal(SIGINT, signal_handler);
@@ -1080,13 +1840,17 @@ int http_server_start(void) {
            strlen(server_cfg.bind_address) > 0 ? server_cfg.bind_address : "0.0.0.0", 
            server_cfg.port);
     
-    // Start HTTP daemon
+    // Start HTTP daemon, with a worker pool when more than one thread is configured
+    unsigned int thread_pool_size = server_cfg.thread_pool_size > 1 ? (unsigned int)server_cfg.thread_pool_size : 1;
+    
     httpd = MHD_start_daemon(
-        MHD_USE_SELECT_INTERNALLY,
+        MHD_USE_SELECT_INTERNALLY | MHD_ALLOW_SUSPEND_RESUME,
         server_cfg.port,
         NULL, NULL,
         &request_handler, NULL,
         MHD_OPTION_CONNECTION_LIMIT, server_cfg.max_connections,
+        MHD_OPTION_NOTIFY_COMPLETED, &request_completed, NULL,
+        MHD_OPTION_THREAD_POOL_SIZE, thread_pool_size,
         MHD_OPTION_END
     );
     
@@ -1098,25 +1862,38 @@ int http_server_start(void) {
     printf("Weather API server running at http://%s:%d\n", 
            strlen(server_cfg.bind_address) > 0 ? server_cfg.bind_address : "localhost", 
            server_cfg.port);
+    printf("Worker threads: %u\n", thread_pool_size);
     printf("Available endpoints:\n");
     printf("  GET  /health\n");
     printf("  POST /slack/events (Slack events webhook)\n");
     printf("  GET  /current?location=<location>&include_aqi=<true|false>\n");
     printf("  POST /current (JSON body)\n");
-    printf("  GET  /forecast?location=<location>&days=<1-14>&include_aqi=<true|false>&include_alerts=<true|false>&include_hourly=<true|false>\n");
+    printf("  GET  /forecast?location=<location>&days=<1-14>&include_aqi=<true|false>&include_alerts=<true|false>&include_hourly=<true|false>&layout=<rows|columnar>\n");
+    printf("  POST /batch/current, /batch/forecast (JSON body, NDJSON response)\n");
     printf("Press Ctrl+C to stop the server\n\n");
     
-    // Server loop
+    // Server loop, snapshotting the cache periodically
+    time_t next_snapshot = time(NULL) + server_cfg.snapshot_interval;
     while (server_running) {
         sleep(1);
+        if (server_cfg.snapshot_interval > 0 && time(NULL) >= next_snapshot) {
+            save_cache_snapshot();
+            next_snapshot = time(NULL) + server_cfg.snapshot_interval;
+        }
     }
     
+    // Final snapshot on SIGTERM/SIGINT so the next instance starts warm
+    save_cache_snapshot();
+    
     return 0;
 }
 
 void http_server_stop(void) {
     server_running = 0;
     if (httpd) {
+        // Fail in-flight upstream requests first so every suspended connection is
+        // resumed; the cache and curl stay up until the workers have exited
+        weather_api_stop();
         MHD_stop_daemon(httpd);
         httpd = NULL;
     }
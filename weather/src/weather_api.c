@@ -1,367 +1,990 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <curl/curl.h>
-#include <cjson/cJSON.h>
+#include <pthread.h>
+#include <time.h>
 #include "weather_api.h"
 #include "http_client.h"
+#include "weather_cache.h"
+#include "weather_parser.h"
+#include "weather_arena.h"
+#include "weather_body.h"
+#include "weather_upstream.h"
+#include "weather_location.h"
+
+#define FLIGHT_BUCKETS 64           // In-flight request table size
+#define RETRY_BACKOFF_MS 100        // First upstream retry waits 50-100 ms, then doubling
+#define BATCH_LOCATION_SIZE 256     // Longer locations are never batched
+#define UPSTREAM_NO_MATCH 1006      // WeatherAPI error code: no location matches the query
 
 static weather_config_t api_config;
 static int api_initialized = 0;
 
+static int batch_start(void);
+static void batch_stop(void);
+
+int weather_api_init(const weather_config_t *config) {
+    if (!config) {
+        fprintf(stderr, "Invalid configuration provided to weather_api_init\n");
+        return -1;
+    }
+    
+    if (http_client_init(config->timeout, config->connect_timeout) != 0) {
+        fprintf(stderr, "Failed to initialize HTTP client\n");
+        return -1;
+    }
+    
+    // The spatial index is sized before the cache can fill it
+    weather_location_set_radius(config->nearby_km);
+    if (weather_cache_init(config->cache_bytes) != 0) {
+        fprintf(stderr, "Failed to initialize response cache\n");
+        http_client_cleanup();
+        return -1;
+    }
+    
+    weather_upstream_init(config);
+    
+    // Copy configuration
+    memcpy(&api_config, config, sizeof(weather_config_t));
+    if (api_config.batch_max < 2 || api_config.batch_max > WEATHER_API_BULK_MAX) {
+        api_config.batch_max = WEATHER_API_BULK_MAX;
+    }
+    
+    if (batch_start() != 0) {
+        weather_cache_cleanup();
+        http_client_cleanup();
+        return -1;
+    }
+    api_initialized = 1;
+    
+    return 0;
+}
+
+void weather_api_stop(void) {
+    if (api_initialized) {
+        // Waiting batches fail first, then whatever is still in flight
+        batch_stop();
+        http_client_stop();
+    }
+}
+
+void weather_api_cleanup(void) {
+    if (api_initialized) {
+        weather_api_stop();
+        http_client_cleanup();
+        weather_cache_cleanup();
+        weather_location_cleanup();
+        weather_arena_cleanup();
+        api_initialized = 0;
+    }
+}
+
 /**
- * Helper function to safely extract string from JSON object
+ * URL encode a location and build the current.json request URL
  */
-static void json_get_string(const cJSON *json, const char *key, char *dest, size_t dest_size) {
-    const cJSON *item = cJSON_GetObjectItem(json, key);
-    if (cJSON_IsString(item) && item->valuestring) {
-        strncpy(dest, item->valuestring, dest_size - 1);
-        dest[dest_size - 1] = '\0';
-    } else {
-        dest[0] = '\0';
+static int build_current_url(const char *location, int include_aqi, char *url, size_t url_size) {
+    // URL encode the location parameter
+    char encoded_location[768];
+    if (http_url_encode(location, encoded_location, sizeof(encoded_location)) != 0) {
+        fprintf(stderr, "Failed to URL encode location\n");
+        return -1;
     }
+    
+    // Build URL
+    int written = snprintf(url, url_size, "%s/current.json?key=%s&q=%s&aqi=%s",
+                           api_config.base_url,
+                           api_config.api_key,
+                           encoded_location,
+                           include_aqi ? "yes" : "no");
+    if (written < 0 || (size_t)written >= url_size) {
+        fprintf(stderr, "Request URL too long for location: %s\n", location);
+        return -1;
+    }
+    
+    return 0;
 }
 
 /**
- * Helper function to safely extract double from JSON object
+ * Check the HTTP status of an upstream response
  */
-static double json_get_double(const cJSON *json, const char *key) {
-    const cJSON *item = cJSON_GetObjectItem(json, key);
-    if (cJSON_IsNumber(item)) {
-        return item->valuedouble;
+static int check_http_status(const http_response_t *http_response) {
+    if (http_response->status_code != 200) {
+        fprintf(stderr, "HTTP request failed with status: %ld\n", http_response->status_code);
+        if (http_response->data) {
+            fprintf(stderr, "Response: %s\n", http_response->data);
+        }
+        return -1;
     }
-    return 0.0;
+    return 0;
+}
+
+void weather_response_free(weather_response_t *response) {
+    // Currently no dynamic memory allocation in response structure
+    // This function is provided for future extensibility
+    if (response) {
+        memset(response, 0, sizeof(weather_response_t));
+    }
+}
+
+void weather_print_current(const weather_response_t *response) {
+    if (!response) return;
+    
+    const location_t *loc = &response->location;
+    const current_weather_t *cur = &response->current;
+    
+    printf("=== Weather Information ===\n");
+    printf("Location: %s, %s, %s\n", loc->name, loc->region, loc->country);
+    printf("Coordinates: %.4f, %.4f\n", loc->lat, loc->lon);
+    printf("Local Time: %s\n", loc->localtime);
+    printf("Timezone: %s\n\n", loc->tz_id);
+    
+    printf("=== Current Conditions ===\n");
+    printf("Condition: %s\n", cur->condition.text);
+    printf("Temperature: %.1f°C (%.1f°F)\n", cur->temp_c, cur->temp_f);
+    printf("Feels Like: %.1f°C (%.1f°F)\n", cur->feelslike_c, cur->feelslike_f);
+    printf("Humidity: %d%%\n", cur->humidity);
+    printf("Wind: %.1f kph (%.1f mph) %s\n", cur->wind_kph, cur->wind_mph, cur->wind_dir);
+    printf("Pressure: %.1f mb (%.2f in)\n", cur->pressure_mb, cur->pressure_in);
+    printf("Visibility: %.1f km (%.1f miles)\n", cur->vis_km, cur->vis_miles);
+    printf("UV Index: %.1f\n", cur->uv);
+    printf("Cloud Cover: %d%%\n", cur->cloud);
+    
+    if (cur->precip_mm > 0 || cur->precip_in > 0) {
+        printf("Precipitation: %.1f mm (%.2f in)\n", cur->precip_mm, cur->precip_in);
+    }
+    
+    printf("Last Updated: %s\n", cur->last_updated);
 }
 
 /**
- * Helper function to safely extract integer from JSON object
+ * URL encode a location and build the forecast.json request URL
  */
-static int json_get_int(const cJSON *json, const char *key) {
-    const cJSON *item = cJSON_GetObjectItem(json, key);
-    if (cJSON_IsNumber(item)) {
-        return item->valueint;
+static int build_forecast_url(const char *location, int days, int include_aqi, int include_alerts,
+                              char *url, size_t url_size) {
+    // URL encode the location parameter
+    char encoded_location[768];
+    if (http_url_encode(location, encoded_location, sizeof(encoded_location)) != 0) {
+        fprintf(stderr, "Failed to URL encode location\n");
+        return -1;
+    }
+    
+    // Build URL
+    int written = snprintf(url, url_size, "%s/forecast.json?key=%s&q=%s&days=%d&aqi=%s&alerts=%s",
+                           api_config.base_url,
+                           api_config.api_key,
+                           encoded_location,
+                           days,
+                           include_aqi ? "yes" : "no",
+                           include_alerts ? "yes" : "no");
+    if (written < 0 || (size_t)written >= url_size) {
+        fprintf(stderr, "Request URL too long for location: %s\n", location);
+        return -1;
     }
+    
     return 0;
 }
 
+weather_result_t *weather_result_retain(weather_result_t *result) {
+    if (result) {
+        __atomic_add_fetch(&result->refcount, 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+void weather_result_release(weather_result_t *result) {
+    if (result && __atomic_sub_fetch(&result->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        if (result->source) {
+            weather_result_release(result->source);
+        } else {
+            forecast_response_free(&result->forecast);
+            weather_lazy_free(result->lazy);
+            weather_body_free_all(result);
+        }
+        free(result);
+    }
+}
+
 /**
- * Helper function to safely extract long from JSON object
+ * What a flight asks upstream for
  */
-static long json_get_long(const cJSON *json, const char *key) {
-    const cJSON *item = cJSON_GetObjectItem(json, key);
-    if (cJSON_IsNumber(item)) {
-        return (long)item->valuedouble;
+typedef struct {
+    const char *location;
+    int is_forecast;
+    int days;
+    int include_aqi;
+    int include_alerts;
+} upstream_query_t;
+
+/**
+ * Build the request URL of a query for a location ("bulk" for a bulk request)
+ */
+static int build_query_url(const upstream_query_t *query, const char *location, char *url, size_t url_size) {
+    if (query->is_forecast) {
+        return build_forecast_url(location, query->days, query->include_aqi, query->include_alerts, url, url_size);
     }
-    return 0;
+    return build_current_url(location, query->include_aqi, url, url_size);
+}
+
+/**
+ * Caller waiting on an in-flight upstream request
+ */
+typedef struct flight_waiter {
+    weather_api_callback_t callback;
+    void *user_data;
+    struct flight_waiter *next;
+} flight_waiter_t;
+
+/**
+ * In-flight upstream request shared by every caller asking for the same key
+ */
+typedef struct flight {
+    char key[WEATHER_CACHE_KEY_SIZE];
+    int is_forecast;
+    int days;
+    int include_aqi;
+    int include_alerts;
+    char location[BATCH_LOCATION_SIZE]; // Query sent upstream (empty if too long to keep)
+    struct timespec started;            // Upstream latency feeds early refresh
+    double first_byte_seconds;          // Time to the first body byte (0 until it arrives)
+    weather_result_t *result;           // Filled by the parser as the body arrives
+    weather_parser_t *parser;
+    flight_waiter_t *waiters;           // Leader first, then coalesced callers
+    flight_waiter_t **waiters_tail;
+    struct flight *next;                // Bucket chain
+} flight_t;
+
+static flight_t *flights[FLIGHT_BUCKETS];
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long leader_requests = 0;
+static unsigned long coalesced_requests = 0;
+
+/**
+ * Leader requests for the same endpoint and options collected into one bulk request
+ */
+typedef struct batch {
+    char url[1024];                     // Bulk request URL (q=bulk)
+    upstream_query_t query;             // Endpoint and options (no location)
+    struct timespec closes;             // End of the collection window
+    int count;
+    struct batch *next;
+    flight_t *flights[];                // api_config.batch_max slots; custom_id is the index
+} batch_t;
+
+static batch_t *batches_open = NULL;    // Collecting until their window closes
+static batch_t *batches_full = NULL;    // Full before their window closed
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_cond;
+static pthread_t batch_thread;
+static int batch_running = 0;
+static unsigned long batches_sent = 0;
+static unsigned long bulk_requests = 0;
+static unsigned long batched_requests = 0;
+static double batch_wait_seconds = 0;
+
+static unsigned int flight_bucket(const char *key) {
+    unsigned int hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash % FLIGHT_BUCKETS;
 }
 
 /**
- * Parse location data from JSON
+ * Remove a flight from the table (caller holds flights_lock)
  */
-static void parse_location(const cJSON *location_json, location_t *location) {
-    if (!location_json || !location) return;
+static void flight_unlink(flight_t *flight) {
+    flight_t **link = &flights[flight_bucket(flight->key)];
+    while (*link && *link != flight) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = flight->next;
+    }
+}
+
+/**
+ * Seconds since a point on the monotonic clock
+ */
+static double elapsed_seconds(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+/**
+ * Allocate the result of a flight and the parser that fills it
+ */
+static int flight_parser_create(flight_t *flight) {
+    flight->result = calloc(1, sizeof(weather_result_t));
+    if (!flight->result) {
+        fprintf(stderr, "Failed to allocate weather result\n");
+        return -1;
+    }
+    flight->result->refcount = 1;
+    flight->result->is_forecast = flight->is_forecast;
     
-    json_get_string(location_json, "name", location->name, sizeof(location->name));
-    json_get_string(location_json, "region", location->region, sizeof(location->region));
-    json_get_string(location_json, "country", location->country, sizeof(location->country));
-    location->lat = json_get_double(location_json, "lat");
-    location->lon = json_get_double(location_json, "lon");
-    json_get_string(location_json, "tz_id", location->tz_id, sizeof(location->tz_id));
-    location->localtime_epoch = json_get_long(location_json, "localtime_epoch");
-    json_get_string(location_json, "localtime", location->localtime, sizeof(location->localtime));
+    // Forecast sections most requests never look at are parsed on first use.
+    // Hours are packed as they arrive: compact they are far smaller than raw.
+    unsigned int lazy_sections = WEATHER_SECTION_CURRENT | WEATHER_SECTION_ASTRO;
+    flight->parser = weather_parser_create(flight->result, flight->is_forecast ? lazy_sections : 0);
+    if (!flight->parser) {
+        weather_result_release(flight->result);
+        flight->result = NULL;
+        return -1;
+    }
+    return 0;
 }
 
 /**
- * Parse weather condition from JSON
+ * Free the parser of a flight, taking its result if the whole body was parsed
+ * @param body_ok Whether the body arrived and every chunk was accepted
+ * @return Result holding the flight's reference, or NULL
  */
-static void parse_condition(const cJSON *condition_json, weather_condition_t *condition) {
-    if (!condition_json || !condition) return;
+static weather_result_t *flight_parser_finish(flight_t *flight, int body_ok) {
+    weather_result_t *result = NULL;
+    
+    if (body_ok) {
+        if (weather_parser_finish(flight->parser) == 0) {
+            result = flight->result;
+            flight->result = NULL;
+        } else {
+            fprintf(stderr, "Failed to parse JSON response\n");
+        }
+    }
+    weather_parser_free(flight->parser);
+    weather_result_release(flight->result);
+    flight->parser = NULL;
+    flight->result = NULL;
     
-    json_get_string(condition_json, "text", condition->text, sizeof(condition->text));
-    json_get_string(condition_json, "icon", condition->icon, sizeof(condition->icon));
-    condition->code = json_get_int(condition_json, "code");
+    return result;
 }
 
 /**
- * Parse current weather data from JSON
+ * Hand every waiter a reference to the result (or the status), then free the flight
+ * @param status Passed to the waiters when there is no result
  */
-static void parse_current_weather(const cJSON *current_json, current_weather_t *current) {
-    if (!current_json || !current) return;
+static void flight_finish(flight_t *flight, weather_result_t *result, int status) {
+    // Publish before the flight disappears so later callers hit the cache,
+    // keyed by where upstream resolved the query once that is learned
+    if (result) {
+        char key[WEATHER_CACHE_KEY_SIZE];
+        strcpy(key, flight->key);
+        if (flight->location[0]) {
+            weather_location_learn(flight->location, result->is_forecast ? &result->forecast.location
+                                                                         : &result->current.location);
+            if (flight->is_forecast) {
+                weather_cache_forecast_key(flight->location, flight->days, flight->include_aqi,
+                                           flight->include_alerts, key, sizeof(key));
+            } else {
+                weather_cache_current_key(flight->location, flight->include_aqi, key, sizeof(key));
+            }
+        }
+        weather_cache_put(key, result, elapsed_seconds(&flight->started));
+    } else if (status == WEATHER_API_UNKNOWN_LOCATION && flight->location[0]) {
+        weather_location_reject(flight->location);
+    }
     
-    current->last_updated_epoch = json_get_long(current_json, "last_updated_epoch");
-    json_get_string(current_json, "last_updated", current->last_updated, sizeof(current->last_updated));
-    current->temp_c = json_get_double(current_json, "temp_c");
-    current->temp_f = json_get_double(current_json, "temp_f");
-    current->is_day = json_get_int(current_json, "is_day");
+    pthread_mutex_lock(&flights_lock);
+    flight_unlink(flight);
+    pthread_mutex_unlock(&flights_lock);
     
-    // Parse condition
-    const cJSON *condition_json = cJSON_GetObjectItem(current_json, "condition");
-    parse_condition(condition_json, &current->condition);
+    // Unlinked: no new waiters can join, walk the list without the lock
+    flight_waiter_t *waiter = flight->waiters;
+    while (waiter) {
+        flight_waiter_t *next = waiter->next;
+        if (result) {
+            waiter->callback(0, weather_result_retain(result), waiter->user_data);
+        } else {
+            waiter->callback(status, NULL, waiter->user_data);
+        }
+        free(waiter);
+        waiter = next;
+    }
     
-    current->wind_mph = json_get_double(current_json, "wind_mph");
-    current->wind_kph = json_get_double(current_json, "wind_kph");
-    current->wind_degree = json_get_int(current_json, "wind_degree");
-    json_get_string(current_json, "wind_dir", current->wind_dir, sizeof(current->wind_dir));
-    current->pressure_mb = json_get_double(current_json, "pressure_mb");
-    current->pressure_in = json_get_double(current_json, "pressure_in");
-    current->precip_mm = json_get_double(current_json, "precip_mm");
-    current->precip_in = json_get_double(current_json, "precip_in");
-    current->humidity = json_get_int(current_json, "humidity");
-    current->cloud = json_get_int(current_json, "cloud");
-    current->feelslike_c = json_get_double(current_json, "feelslike_c");
-    current->feelslike_f = json_get_double(current_json, "feelslike_f");
-    current->windchill_c = json_get_double(current_json, "windchill_c");
-    current->windchill_f = json_get_double(current_json, "windchill_f");
-    current->heatindex_c = json_get_double(current_json, "heatindex_c");
-    current->heatindex_f = json_get_double(current_json, "heatindex_f");
-    current->dewpoint_c = json_get_double(current_json, "dewpoint_c");
-    current->dewpoint_f = json_get_double(current_json, "dewpoint_f");
-    current->vis_km = json_get_double(current_json, "vis_km");
-    current->vis_miles = json_get_double(current_json, "vis_miles");
-    current->uv = json_get_double(current_json, "uv");
-    current->gust_mph = json_get_double(current_json, "gust_mph");
-    current->gust_kph = json_get_double(current_json, "gust_kph");
-    current->short_rad = json_get_double(current_json, "short_rad");
-    current->diff_rad = json_get_double(current_json, "diff_rad");
-    current->dni = json_get_double(current_json, "dni");
-    current->gti = json_get_double(current_json, "gti");
+    weather_result_release(result);
+    free(flight);
 }
 
-int weather_api_init(const weather_config_t *config) {
-    if (!config) {
-        fprintf(stderr, "Invalid configuration provided to weather_api_init\n");
-        return -1;
+/**
+ * HTTP body chunk: parse it into the result while the rest is still downloading
+ */
+static int flight_body(const char *data, size_t length, void *user_data) {
+    flight_t *flight = user_data;
+    
+    if (flight->first_byte_seconds == 0) {
+        flight->first_byte_seconds = elapsed_seconds(&flight->started);
     }
     
-    if (http_client_init() != 0) {
-        fprintf(stderr, "Failed to initialize HTTP client\n");
+    if (weather_parser_feed(flight->parser, data, length) != 0) {
+        fprintf(stderr, "Failed to parse JSON response\n");
         return -1;
     }
+    return 0;
+}
+
+/**
+ * Whether upstream answered, unless every attempt failed in transport or with 429/5xx
+ */
+static int upstream_healthy(int status, const http_response_t *http_response) {
+    long status_code = status == 0 ? http_response->status_code : 0;
+    return status == 0 && status_code < 500 && status_code != 429;
+}
+
+/**
+ * Status for the waiters of a request that produced no result
+ */
+static int failure_status(int status, const http_response_t *http_response) {
+    if (status == 0 && http_response->status_code == 400 &&
+        weather_parser_error_code(http_response->data, http_response->size) == UPSTREAM_NO_MATCH) {
+        return WEATHER_API_UNKNOWN_LOCATION;
+    }
+    return -1;
+}
+
+/**
+ * HTTP completion: hand every waiter a reference to the parsed result
+ */
+static void flight_completed(int status, http_response_t *http_response, void *user_data) {
+    flight_t *flight = user_data;
+    
+    int ok = status == 0 && http_response->status_code == 200;
+    weather_upstream_release(upstream_healthy(status, http_response) ? WEATHER_UPSTREAM_SUCCESS : WEATHER_UPSTREAM_FAILURE,
+                             ok ? flight->first_byte_seconds : 0);
+    
+    weather_result_t *result = flight_parser_finish(flight, status == 0 && check_http_status(http_response) == 0);
+    flight_finish(flight, result, failure_status(status, http_response));
+}
+
+/**
+ * Send the upstream request of a flight on its own, streaming its body into a parser
+ * Upstream GETs are idempotent, so failed attempts are retried and slow ones
+ * hedged, all within the configured timeout.
+ * @return 0 on success, WEATHER_API_UNAVAILABLE if upstream admission refused it, -1 on error
+ */
+static int flight_send(flight_t *flight, const char *url) {
+    if (weather_upstream_acquire() != 0) {
+        return WEATHER_API_UNAVAILABLE;
+    }
     
-    // Copy configuration
-    memcpy(&api_config, config, sizeof(weather_config_t));
-    api_initialized = 1;
+    // Time spent waiting in a batch is not upstream latency
+    clock_gettime(CLOCK_MONOTONIC, &flight->started);
+    
+    http_request_policy_t policy;
+    policy.deadline_ms = api_config.timeout * 1000L;
+    policy.max_attempts = 1 + api_config.retries + (api_config.hedge ? 1 : 0);
+    policy.backoff_ms = RETRY_BACKOFF_MS;
+    policy.hedge_after_ms = api_config.hedge ? weather_upstream_hedge_delay_ms() : 0;
+    
+    if (flight_parser_create(flight) != 0 ||
+        http_get_async_stream(url, &policy, flight_body, flight_completed, flight) != 0) {
+        flight_parser_finish(flight, 0);
+        weather_upstream_release(WEATHER_UPSTREAM_ABANDONED, 0);
+        return -1;
+    }
     
     return 0;
 }
 
-void weather_api_cleanup(void) {
-    if (api_initialized) {
-        http_client_cleanup();
-        api_initialized = 0;
+/**
+ * Bulk response location: parse it into its flight's result
+ */
+static void batch_item(const char *custom_id, size_t id_length, const char *data, size_t length,
+                       int failed, void *user_data) {
+    batch_t *batch = user_data;
+    
+    int index = 0;
+    for (size_t i = 0; i < id_length; i++) {
+        if (custom_id[i] < '0' || custom_id[i] > '9' || index >= batch->count) {
+            return;
+        }
+        index = index * 10 + (custom_id[i] - '0');
+    }
+    if (id_length == 0 || index >= batch->count || !batch->flights[index]) {
+        return;
     }
+    flight_t *flight = batch->flights[index];
+    batch->flights[index] = NULL;
+    
+    weather_result_t *result = NULL;
+    int status = -1;
+    if (failed) {
+        fprintf(stderr, "Bulk request failed for location: %s\n", flight->location);
+        if (weather_parser_error_code(data, length) == UPSTREAM_NO_MATCH) {
+            status = WEATHER_API_UNKNOWN_LOCATION;
+        }
+    } else if (flight_parser_create(flight) == 0) {
+        int body_ok = weather_parser_feed(flight->parser, data, length) == 0;
+        if (!body_ok) {
+            fprintf(stderr, "Failed to parse JSON response\n");
+        }
+        result = flight_parser_finish(flight, body_ok);
+    }
+    flight_finish(flight, result, status);
 }
 
-int weather_api_get_current(const char *location, int include_aqi, weather_response_t *response) {
-    if (!api_initialized) {
-        fprintf(stderr, "Weather API not initialized. Call weather_api_init() first.\n");
-        return -1;
+/**
+ * Bulk HTTP completion: split the response between the batch's flights
+ */
+static void batch_completed(int status, http_response_t *http_response, void *user_data) {
+    batch_t *batch = user_data;
+    
+    // A bulk request takes longer the more locations it carries; keep it out
+    // of the latency that sets the hedge delay and the concurrency limit
+    weather_upstream_release(upstream_healthy(status, http_response) ? WEATHER_UPSTREAM_SUCCESS : WEATHER_UPSTREAM_FAILURE, 0);
+    
+    if (status == 0 && check_http_status(http_response) == 0 &&
+        weather_parser_split_bulk(http_response->data, http_response->size, batch_item, batch) != 0) {
+        fprintf(stderr, "Failed to parse bulk response\n");
     }
     
-    if (!location || !response) {
-        fprintf(stderr, "Invalid arguments to weather_api_get_current\n");
-        return -1;
+    // Locations the response did not answer fail
+    for (int i = 0; i < batch->count; i++) {
+        if (batch->flights[i]) {
+            flight_finish(batch->flights[i], NULL, -1);
+        }
+    }
+    free(batch);
+}
+
+/**
+ * Build the body of a bulk request: every location with its index as custom_id
+ */
+static char *batch_body(const batch_t *batch) {
+    // Escaping at most sextuples a location
+    char *body = malloc(32 + (size_t)batch->count * (BATCH_LOCATION_SIZE * 6 + 48));
+    if (!body) {
+        fprintf(stderr, "Failed to allocate bulk request body\n");
+        return NULL;
     }
     
-    // URL encode the location parameter
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to initialize curl for URL encoding\n");
-        return -1;
+    char *out = body + sprintf(body, "{\"locations\":[");
+    for (int i = 0; i < batch->count; i++) {
+        out += sprintf(out, "%s{\"q\":\"", i > 0 ? "," : "");
+        for (const unsigned char *p = (const unsigned char *)batch->flights[i]->location; *p; p++) {
+            if (*p == '"' || *p == '\\') {
+                *out++ = '\\';
+                *out++ = (char)*p;
+            } else if (*p < 0x20) {
+                out += sprintf(out, "\\u%04x", *p);
+            } else {
+                *out++ = (char)*p;
+            }
+        }
+        out += sprintf(out, "\",\"custom_id\":\"%d\"}", i);
+    }
+    strcpy(out, "]}");
+    return body;
+}
+
+/**
+ * Send a closed batch upstream (batcher thread)
+ * A batch of one goes as an ordinary request. Bulk requests only read, so
+ * they are retried like GETs, but never hedged: a duplicate would cost as
+ * many upstream calls as the batch has locations.
+ */
+static void batch_send(batch_t *batch) {
+    double waited = 0;
+    for (int i = 0; i < batch->count; i++) {
+        waited += elapsed_seconds(&batch->flights[i]->started);
     }
     
-    char *encoded_location = curl_easy_escape(curl, location, 0);
-    if (!encoded_location) {
-        fprintf(stderr, "Failed to URL encode location\n");
-        curl_easy_cleanup(curl);
-        return -1;
+    pthread_mutex_lock(&batch_lock);
+    batches_sent++;
+    bulk_requests += batch->count > 1;
+    batched_requests += batch->count;
+    batch_wait_seconds += waited;
+    pthread_mutex_unlock(&batch_lock);
+    
+    int status = 0;
+    if (batch->count == 1) {
+        char url[1024];
+        status = build_query_url(&batch->query, batch->flights[0]->location, url, sizeof(url)) == 0 ?
+                 flight_send(batch->flights[0], url) : -1;
+        if (status != 0) {
+            flight_finish(batch->flights[0], NULL, status);
+        }
+        free(batch);
+        return;
     }
     
-    // Build URL
-    char url[1024];
-    snprintf(url, sizeof(url), "%s/current.json?key=%s&q=%s&aqi=%s",
-             api_config.base_url,
-             api_config.api_key,
-             encoded_location,
-             include_aqi ? "yes" : "no");
-    
-    // Clean up encoded location
-    curl_free(encoded_location);
-    curl_easy_cleanup(curl);
-    
-    // Make HTTP request
-    http_response_t http_response;
-    if (http_get(url, &http_response) != 0) {
-        fprintf(stderr, "Failed to make HTTP request\n");
-        return -1;
+    if (weather_upstream_acquire() != 0) {
+        status = WEATHER_API_UNAVAILABLE;
+    } else {
+        http_request_policy_t policy;
+        policy.deadline_ms = api_config.timeout * 1000L;
+        policy.max_attempts = 1 + api_config.retries;
+        policy.backoff_ms = RETRY_BACKOFF_MS;
+        policy.hedge_after_ms = 0;
+        
+        char *body = batch_body(batch);
+        if (body && http_post_json_async(batch->url, body, &policy, batch_completed, batch) == 0) {
+            free(body);
+            return;
+        }
+        free(body);
+        fprintf(stderr, "Failed to start bulk HTTP request\n");
+        weather_upstream_release(WEATHER_UPSTREAM_ABANDONED, 0);
+        status = -1;
     }
     
-    // Check HTTP status
-    if (http_response.status_code != 200) {
-        fprintf(stderr, "HTTP request failed with status: %ld\n", http_response.status_code);
-        if (http_response.data) {
-            fprintf(stderr, "Response: %s\n", http_response.data);
+    for (int i = 0; i < batch->count; i++) {
+        flight_finish(batch->flights[i], NULL, status);
+    }
+    free(batch);
+}
+
+/**
+ * Batcher thread: sends batches that filled up or whose window closed
+ */
+static void *batch_main(void *arg) {
+    (void)arg;
+    
+    pthread_mutex_lock(&batch_lock);
+    while (batch_running) {
+        batch_t *due = batches_full;
+        batches_full = NULL;
+        
+        const struct timespec *wake = NULL;
+        batch_t **link = &batches_open;
+        while (*link) {
+            batch_t *batch = *link;
+            if (elapsed_seconds(&batch->closes) >= 0) {
+                *link = batch->next;
+                batch->next = due;
+                due = batch;
+                continue;
+            }
+            if (!wake || batch->closes.tv_sec < wake->tv_sec ||
+                (batch->closes.tv_sec == wake->tv_sec && batch->closes.tv_nsec < wake->tv_nsec)) {
+                wake = &batch->closes;
+            }
+            link = &batch->next;
+        }
+        
+        if (due) {
+            pthread_mutex_unlock(&batch_lock);
+            while (due) {
+                batch_t *batch = due;
+                due = due->next;
+                batch_send(batch);
+            }
+            pthread_mutex_lock(&batch_lock);
+        } else if (wake) {
+            struct timespec until = *wake;
+            pthread_cond_timedwait(&batch_cond, &batch_lock, &until);
+        } else {
+            pthread_cond_wait(&batch_cond, &batch_lock);
         }
-        http_response_free(&http_response);
+    }
+    pthread_mutex_unlock(&batch_lock);
+    
+    return NULL;
+}
+
+/**
+ * Start the batcher thread if batching is configured
+ */
+static int batch_start(void) {
+    if (api_config.batch_window_ms <= 0) {
+        return 0;
+    }
+    
+    // Window deadlines are on the monotonic clock
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&batch_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    
+    batch_running = 1;
+    if (pthread_create(&batch_thread, NULL, batch_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start upstream batcher thread\n");
+        batch_running = 0;
+        pthread_cond_destroy(&batch_cond);
         return -1;
     }
+    return 0;
+}
+
+/**
+ * Stop the batcher thread and fail every request still waiting in a batch
+ */
+static void batch_stop(void) {
+    pthread_mutex_lock(&batch_lock);
+    int running = batch_running;
+    batch_running = 0;
+    pthread_cond_signal(&batch_cond);
+    pthread_mutex_unlock(&batch_lock);
     
-    // Parse JSON response
-    cJSON *json = cJSON_Parse(http_response.data);
-    if (!json) {
-        fprintf(stderr, "Failed to parse JSON response\n");
-        http_response_free(&http_response);
+    if (!running) {
+        return;
+    }
+    pthread_join(batch_thread, NULL);
+    pthread_cond_destroy(&batch_cond);
+    
+    batch_t *lists[] = {batches_open, batches_full};
+    batches_open = batches_full = NULL;
+    for (int l = 0; l < 2; l++) {
+        while (lists[l]) {
+            batch_t *batch = lists[l];
+            lists[l] = batch->next;
+            for (int i = 0; i < batch->count; i++) {
+                flight_finish(batch->flights[i], NULL, -1);
+            }
+            free(batch);
+        }
+    }
+}
+
+/**
+ * Add a leader to the open batch for its endpoint and options, opening one if needed
+ * @return 0 if the batch now owns the flight, -1 if it must be sent on its own
+ */
+static int batch_add(flight_t *flight, const upstream_query_t *query) {
+    char url[1024];
+    if (!flight->location[0] || build_query_url(query, "bulk", url, sizeof(url)) != 0) {
         return -1;
     }
     
-    // Clear response structure
-    memset(response, 0, sizeof(weather_response_t));
+    pthread_mutex_lock(&batch_lock);
+    if (!batch_running) {
+        pthread_mutex_unlock(&batch_lock);
+        return -1;
+    }
     
-    // Parse location
-    const cJSON *location_json = cJSON_GetObjectItem(json, "location");
-    if (location_json) {
-        parse_location(location_json, &response->location);
+    batch_t **link = &batches_open;
+    while (*link && strcmp((*link)->url, url) != 0) {
+        link = &(*link)->next;
     }
     
-    // Parse current weather
-    const cJSON *current_json = cJSON_GetObjectItem(json, "current");
-    if (current_json) {
-        parse_current_weather(current_json, &response->current);
+    batch_t *batch = *link;
+    if (!batch) {
+        batch = calloc(1, sizeof(batch_t) + api_config.batch_max * sizeof(flight_t *));
+        if (!batch) {
+            pthread_mutex_unlock(&batch_lock);
+            fprintf(stderr, "Failed to allocate upstream batch\n");
+            return -1;
+        }
+        strcpy(batch->url, url);
+        batch->query = *query;
+        batch->query.location = NULL;
+        clock_gettime(CLOCK_MONOTONIC, &batch->closes);
+        batch->closes.tv_nsec += api_config.batch_window_ms % 1000 * 1000000L;
+        batch->closes.tv_sec += api_config.batch_window_ms / 1000 + batch->closes.tv_nsec / 1000000000L;
+        batch->closes.tv_nsec %= 1000000000L;
+        batch->next = batches_open;
+        batches_open = batch;
+        link = &batches_open;
+        pthread_cond_signal(&batch_cond);
     }
     
-    // Cleanup
-    cJSON_Delete(json);
-    http_response_free(&http_response);
+    batch->flights[batch->count++] = flight;
+    if (batch->count == api_config.batch_max) {
+        // Full: the batcher sends it without waiting for the window
+        *link = batch->next;
+        batch->next = batches_full;
+        batches_full = batch;
+        pthread_cond_signal(&batch_cond);
+    }
+    pthread_mutex_unlock(&batch_lock);
     
     return 0;
 }
 
-void weather_response_free(weather_response_t *response) {
-    // Currently no dynamic memory allocation in response structure
-    // This function is provided for future extensibility
-    if (response) {
-        memset(response, 0, sizeof(weather_response_t));
+/**
+ * Start the upstream request for a new flight: in a batch when batching is
+ * on, otherwise on its own
+ * @return 0 on success, WEATHER_API_UNAVAILABLE if upstream admission refused it, -1 on error
+ */
+static int flight_start(flight_t *flight, const upstream_query_t *query) {
+    if (api_config.batch_window_ms > 0 && batch_add(flight, query) == 0) {
+        return 0;
     }
+    
+    char url[1024];
+    if (build_query_url(query, query->location, url, sizeof(url)) != 0) {
+        return -1;
+    }
+    return flight_send(flight, url);
 }
 
-void weather_print_current(const weather_response_t *response) {
-    if (!response) return;
+/**
+ * Join the in-flight request for a key, or become its leader and start it
+ * @return 0 if the callback will be invoked, -1, WEATHER_API_UNAVAILABLE or
+ *         WEATHER_API_UNKNOWN_LOCATION if not
+ */
+static int join_flight(const char *key, const upstream_query_t *query,
+                       weather_api_callback_t callback, void *user_data) {
+    // Upstream said recently that nothing matches; do not ask again
+    if (weather_location_rejected(query->location)) {
+        return WEATHER_API_UNKNOWN_LOCATION;
+    }
     
-    const location_t *loc = &response->location;
-    const current_weather_t *cur = &response->current;
+    flight_waiter_t *waiter = calloc(1, sizeof(flight_waiter_t));
+    if (!waiter) {
+        fprintf(stderr, "Failed to allocate request waiter\n");
+        return -1;
+    }
+    waiter->callback = callback;
+    waiter->user_data = user_data;
     
-    printf("=== Weather Information ===\n");
-    printf("Location: %s, %s, %s\n", loc->name, loc->region, loc->country);
-    printf("Coordinates: %.4f, %.4f\n", loc->lat, loc->lon);
-    printf("Local Time: %s\n", loc->localtime);
-    printf("Timezone: %s\n\n", loc->tz_id);
+    unsigned int bucket = flight_bucket(key);
     
-    printf("=== Current Conditions ===\n");
-    printf("Condition: %s\n", cur->condition.text);
-    printf("Temperature: %.1f°C (%.1f°F)\n", cur->temp_c, cur->temp_f);
-    printf("Feels Like: %.1f°C (%.1f°F)\n", cur->feelslike_c, cur->feelslike_f);
-    printf("Humidity: %d%%\n", cur->humidity);
-    printf("Wind: %.1f kph (%.1f mph) %s\n", cur->wind_kph, cur->wind_mph, cur->wind_dir);
-    printf("Pressure: %.1f mb (%.2f in)\n", cur->pressure_mb, cur->pressure_in);
-    printf("Visibility: %.1f km (%.1f miles)\n", cur->vis_km, cur->vis_miles);
-    printf("UV Index: %.1f\n", cur->uv);
-    printf("Cloud Cover: %d%%\n", cur->cloud);
+    pthread_mutex_lock(&flights_lock);
+    flight_t *flight = flights[bucket];
+    while (flight && strcmp(flight->key, key) != 0) {
+        flight = flight->next;
+    }
     
-    if (cur->precip_mm > 0 || cur->precip_in > 0) {
-        printf("Precipitation: %.1f mm (%.2f in)\n", cur->precip_mm, cur->precip_in);
+    if (flight) {
+        // Coalesce with the request already in flight
+        *flight->waiters_tail = waiter;
+        flight->waiters_tail = &waiter->next;
+        coalesced_requests++;
+        pthread_mutex_unlock(&flights_lock);
+        return 0;
     }
     
-    printf("Last Updated: %s\n", cur->last_updated);
+    flight = calloc(1, sizeof(flight_t));
+    if (!flight) {
+        pthread_mutex_unlock(&flights_lock);
+        fprintf(stderr, "Failed to allocate in-flight request\n");
+        free(waiter);
+        return -1;
+    }
+    strncpy(flight->key, key, sizeof(flight->key) - 1);
+    flight->is_forecast = query->is_forecast;
+    flight->days = query->days;
+    flight->include_aqi = query->include_aqi;
+    flight->include_alerts = query->include_alerts;
+    if (strlen(query->location) < sizeof(flight->location)) {
+        strcpy(flight->location, query->location);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &flight->started);
+    flight->waiters = waiter;
+    flight->waiters_tail = &waiter->next;
+    flight->next = flights[bucket];
+    flights[bucket] = flight;
+    leader_requests++;
+    pthread_mutex_unlock(&flights_lock);
+    
+    int status = flight_start(flight, query);
+    if (status != 0) {
+        if (status != WEATHER_API_UNAVAILABLE) {
+            fprintf(stderr, "Failed to start asynchronous HTTP request\n");
+        }
+        
+        pthread_mutex_lock(&flights_lock);
+        flight_unlink(flight);
+        pthread_mutex_unlock(&flights_lock);
+        
+        // The leader sees the return value; callers that joined meanwhile get it in a failed callback
+        waiter = flight->waiters->next;
+        free(flight->waiters);
+        while (waiter) {
+            flight_waiter_t *next = waiter->next;
+            waiter->callback(status, NULL, waiter->user_data);
+            free(waiter);
+            waiter = next;
+        }
+        free(flight);
+        return status;
+    }
+    
+    return 0;
+}
+
+/**
+ * Background refresh completion: the flight already stored the result
+ */
+static void refresh_completed(int status, weather_result_t *result, void *user_data) {
+    (void)status;
+    (void)user_data;
+    weather_result_release(result);
 }
 
 /**
- * Parse astronomy data from JSON
- */
-static void parse_astronomy(const cJSON *astro_json, astronomy_t *astro) {
-    if (!astro_json || !astro) return;
-    
-    json_get_string(astro_json, "sunrise", astro->sunrise, sizeof(astro->sunrise));
-    json_get_string(astro_json, "sunset", astro->sunset, sizeof(astro->sunset));
-    json_get_string(astro_json, "moonrise", astro->moonrise, sizeof(astro->moonrise));
-    json_get_string(astro_json, "moonset", astro->moonset, sizeof(astro->moonset));
-    json_get_string(astro_json, "moon_phase", astro->moon_phase, sizeof(astro->moon_phase));
-    astro->moon_illumination = json_get_int(astro_json, "moon_illumination");
-}
-
-/**
- * Parse forecast day data from JSON
- */
-static void parse_forecast_day(const cJSON *day_json, forecast_day_t *day) {
-    if (!day_json || !day) return;
-    
-    day->maxtemp_c = json_get_double(day_json, "maxtemp_c");
-    day->maxtemp_f = json_get_double(day_json, "maxtemp_f");
-    day->mintemp_c = json_get_double(day_json, "mintemp_c");
-    day->mintemp_f = json_get_double(day_json, "mintemp_f");
-    day->avgtemp_c = json_get_double(day_json, "avgtemp_c");
-    day->avgtemp_f = json_get_double(day_json, "avgtemp_f");
-    day->maxwind_mph = json_get_double(day_json, "maxwind_mph");
-    day->maxwind_kph = json_get_double(day_json, "maxwind_kph");
-    day->totalprecip_mm = json_get_double(day_json, "totalprecip_mm");
-    day->totalprecip_in = json_get_double(day_json, "totalprecip_in");
-    day->totalsnow_cm = json_get_double(day_json, "totalsnow_cm");
-    day->avgvis_km = json_get_double(day_json, "avgvis_km");
-    day->avgvis_miles = json_get_double(day_json, "avgvis_miles");
-    day->avghumidity = json_get_int(day_json, "avghumidity");
-    day->daily_will_it_rain = json_get_int(day_json, "daily_will_it_rain");
-    day->daily_chance_of_rain = json_get_int(day_json, "daily_chance_of_rain");
-    day->daily_will_it_snow = json_get_int(day_json, "daily_will_it_snow");
-    day->daily_chance_of_snow = json_get_int(day_json, "daily_chance_of_snow");
-    day->uv = json_get_double(day_json, "uv");
-    
-    // Parse condition
-    const cJSON *condition_json = cJSON_GetObjectItem(day_json, "condition");
-    parse_condition(condition_json, &day->condition);
-}
-
-/**
- * Parse hourly forecast data from JSON
- */
-static void parse_forecast_hour(const cJSON *hour_json, forecast_hour_t *hour) {
-    if (!hour_json || !hour) return;
-    
-    hour->time_epoch = json_get_long(hour_json, "time_epoch");
-    json_get_string(hour_json, "time", hour->time, sizeof(hour->time));
-    hour->temp_c = json_get_double(hour_json, "temp_c");
-    hour->temp_f = json_get_double(hour_json, "temp_f");
-    hour->is_day = json_get_int(hour_json, "is_day");
-    
-    // Parse condition
-    const cJSON *condition_json = cJSON_GetObjectItem(hour_json, "condition");
-    parse_condition(condition_json, &hour->condition);
-    
-    hour->wind_mph = json_get_double(hour_json, "wind_mph");
-    hour->wind_kph = json_get_double(hour_json, "wind_kph");
-    hour->wind_degree = json_get_int(hour_json, "wind_degree");
-    json_get_string(hour_json, "wind_dir", hour->wind_dir, sizeof(hour->wind_dir));
-    hour->pressure_mb = json_get_double(hour_json, "pressure_mb");
-    hour->pressure_in = json_get_double(hour_json, "pressure_in");
-    hour->precip_mm = json_get_double(hour_json, "precip_mm");
-    hour->precip_in = json_get_double(hour_json, "precip_in");
-    hour->humidity = json_get_int(hour_json, "humidity");
-    hour->cloud = json_get_int(hour_json, "cloud");
-    hour->feelslike_c = json_get_double(hour_json, "feelslike_c");
-    hour->feelslike_f = json_get_double(hour_json, "feelslike_f");
-    hour->windchill_c = json_get_double(hour_json, "windchill_c");
-    hour->windchill_f = json_get_double(hour_json, "windchill_f");
-    hour->heatindex_c = json_get_double(hour_json, "heatindex_c");
-    hour->heatindex_f = json_get_double(hour_json, "heatindex_f");
-    hour->dewpoint_c = json_get_double(hour_json, "dewpoint_c");
-    hour->dewpoint_f = json_get_double(hour_json, "dewpoint_f");
-    hour->will_it_rain = json_get_int(hour_json, "will_it_rain");
-    hour->chance_of_rain = json_get_int(hour_json, "chance_of_rain");
-    hour->will_it_snow = json_get_int(hour_json, "will_it_snow");
-    hour->chance_of_snow = json_get_int(hour_json, "chance_of_snow");
-    hour->vis_km = json_get_double(hour_json, "vis_km");
-    hour->vis_miles = json_get_double(hour_json, "vis_miles");
-    hour->gust_mph = json_get_double(hour_json, "gust_mph");
-    hour->gust_kph = json_get_double(hour_json, "gust_kph");
-    hour->uv = json_get_double(hour_json, "uv");
+ * Refresh a cached entry in the background (stale, or XFetch early expiry)
+ * Failure leaves the entry in place; the cache asks again after a retry delay.
+ */
+static void start_refresh(const char *key, const upstream_query_t *query) {
+    join_flight(key, query, refresh_completed, NULL);
+}
+
+/**
+ * Rendezvous for synchronous callers waiting on a flight
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int done;
+    weather_result_t *result;
+} sync_wait_t;
+
+static void sync_completed(int status, weather_result_t *result, void *user_data) {
+    sync_wait_t *wait = user_data;
+    
+    pthread_mutex_lock(&wait->lock);
+    wait->result = status == 0 ? result : NULL;
+    wait->done = 1;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+/**
+ * Fetch a result through a (possibly shared) upstream request and wait for it
+ * @return Result holding one reference for the caller, or NULL on error
+ */
+static weather_result_t *fetch_result(const char *key, const upstream_query_t *query) {
+    weather_result_t *result = NULL;
+    sync_wait_t wait;
+    memset(&wait, 0, sizeof(wait));
+    pthread_mutex_init(&wait.lock, NULL);
+    pthread_cond_init(&wait.cond, NULL);
+    
+    if (join_flight(key, query, sync_completed, &wait) == 0) {
+        pthread_mutex_lock(&wait.lock);
+        while (!wait.done) {
+            pthread_cond_wait(&wait.cond, &wait.lock);
+        }
+        pthread_mutex_unlock(&wait.lock);
+        result = wait.result;
+    }
+    
+    pthread_cond_destroy(&wait.cond);
+    pthread_mutex_destroy(&wait.lock);
+    return result;
+}
+
+int weather_api_get_current(const char *location, int include_aqi, weather_response_t *response) {
+    if (!api_initialized) {
+        fprintf(stderr, "Weather API not initialized. Call weather_api_init() first.\n");
+        return -1;
+    }
+    
+    if (!location || !response) {
+        fprintf(stderr, "Invalid arguments to weather_api_get_current\n");
+        return -1;
+    }
+    
+    upstream_query_t query = {location, 0, 0, include_aqi, 0};
+    char cache_key[WEATHER_CACHE_KEY_SIZE];
+    weather_cache_current_key(location, include_aqi, cache_key, sizeof(cache_key));
+    
+    weather_result_t *result = weather_api_get_current_cached(location, include_aqi, NULL);
+    if (!result) {
+        result = fetch_result(cache_key, &query);
+    }
+    if (!result) {
+        fprintf(stderr, "Failed to fetch current weather\n");
+        return -1;
+    }
+    
+    *response = result->current;
+    weather_result_release(result);
+    
+    return 0;
 }
 
 int weather_api_get_forecast(const char *location, int days, int include_aqi, int include_alerts, forecast_response_t *response) {
@@ -380,153 +1003,135 @@ int weather_api_get_forecast(const char *location, int days, int include_aqi, in
         return -1;
     }
     
-    // URL encode the location parameter
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to initialize curl for URL encoding\n");
+    upstream_query_t query = {location, 1, days, include_aqi, include_alerts};
+    char cache_key[WEATHER_CACHE_KEY_SIZE];
+    weather_cache_forecast_key(location, days, include_aqi, include_alerts, cache_key, sizeof(cache_key));
+    
+    weather_result_t *result = weather_api_get_forecast_cached(location, days, include_aqi, include_alerts, NULL);
+    if (!result) {
+        result = fetch_result(cache_key, &query);
+    }
+    if (!result) {
+        fprintf(stderr, "Failed to fetch forecast\n");
         return -1;
     }
     
-    char *encoded_location = curl_easy_escape(curl, location, 0);
-    if (!encoded_location) {
-        fprintf(stderr, "Failed to URL encode location\n");
-        curl_easy_cleanup(curl);
+    // The shared result is read-only; give the caller its own copy
+    int status = weather_result_copy_forecast(result, response);
+    weather_result_release(result);
+    
+    return status;
+}
+
+int weather_api_get_current_async(const char *location, int include_aqi,
+                                  weather_api_callback_t callback, void *user_data) {
+    if (!api_initialized) {
+        fprintf(stderr, "Weather API not initialized. Call weather_api_init() first.\n");
         return -1;
     }
     
-    // Build URL
-    char url[1024];
-    snprintf(url, sizeof(url), "%s/forecast.json?key=%s&q=%s&days=%d&aqi=%s&alerts=%s",
-             api_config.base_url,
-             api_config.api_key,
-             encoded_location,
-             days,
-             include_aqi ? "yes" : "no",
-             include_alerts ? "yes" : "no");
-    
-    // Clean up encoded location
-    curl_free(encoded_location);
-    curl_easy_cleanup(curl);
-    
-    // Make HTTP request
-    http_response_t http_response;
-    if (http_get(url, &http_response) != 0) {
-        fprintf(stderr, "Failed to make HTTP request\n");
+    if (!location || !callback) {
+        fprintf(stderr, "Invalid arguments to weather_api_get_current_async\n");
         return -1;
     }
     
-    // Check HTTP status
-    if (http_response.status_code != 200) {
-        fprintf(stderr, "HTTP request failed with status: %ld\n", http_response.status_code);
-        if (http_response.data) {
-            fprintf(stderr, "Response: %s\n", http_response.data);
-        }
-        http_response_free(&http_response);
+    upstream_query_t query = {location, 0, 0, include_aqi, 0};
+    char cache_key[WEATHER_CACHE_KEY_SIZE];
+    weather_cache_current_key(location, include_aqi, cache_key, sizeof(cache_key));
+    
+    return join_flight(cache_key, &query, callback, user_data);
+}
+
+weather_result_t *weather_api_get_current_cached(const char *location, int include_aqi,
+                                                 weather_cache_status_t *status) {
+    if (!api_initialized || !location) {
+        return NULL;
+    }
+    
+    weather_cache_status_t local_status;
+    if (!status) {
+        status = &local_status;
+    }
+    
+    weather_result_t *result = weather_cache_get_current(location, include_aqi, status);
+    if (result && status->refresh) {
+        upstream_query_t query = {location, 0, 0, include_aqi, 0};
+        char cache_key[WEATHER_CACHE_KEY_SIZE];
+        weather_cache_current_key(location, include_aqi, cache_key, sizeof(cache_key));
+        start_refresh(cache_key, &query);
+    }
+    
+    return result;
+}
+
+int weather_api_get_forecast_async(const char *location, int days, int include_aqi, int include_alerts,
+                                   weather_api_callback_t callback, void *user_data) {
+    if (!api_initialized) {
+        fprintf(stderr, "Weather API not initialized. Call weather_api_init() first.\n");
         return -1;
     }
     
-    // Parse JSON response
-    cJSON *json = cJSON_Parse(http_response.data);
-    if (!json) {
-        fprintf(stderr, "Failed to parse JSON response\n");
-        http_response_free(&http_response);
+    if (!location || !callback) {
+        fprintf(stderr, "Invalid arguments to weather_api_get_forecast_async\n");
         return -1;
     }
     
-    // Clear response structure
-    memset(response, 0, sizeof(forecast_response_t));
-    
-    // Parse location
-    const cJSON *location_json = cJSON_GetObjectItem(json, "location");
-    if (location_json) {
-        parse_location(location_json, &response->location);
-    }
-    
-    // Parse current weather
-    const cJSON *current_json = cJSON_GetObjectItem(json, "current");
-    if (current_json) {
-        parse_current_weather(current_json, &response->current);
-    }
-    
-    // Parse forecast
-    const cJSON *forecast_json = cJSON_GetObjectItem(json, "forecast");
-    if (forecast_json) {
-        const cJSON *forecastday_array = cJSON_GetObjectItem(forecast_json, "forecastday");
-        if (cJSON_IsArray(forecastday_array)) {
-            int array_size = cJSON_GetArraySize(forecastday_array);
-            if (array_size > 0) {
-                response->forecast = malloc(array_size * sizeof(forecast_daily_t));
-                if (!response->forecast) {
-                    fprintf(stderr, "Failed to allocate memory for forecast days\n");
-                    cJSON_Delete(json);
-                    http_response_free(&http_response);
-                    return -1;
-                }
-                
-                response->forecast_days = array_size;
-                
-                for (int i = 0; i < array_size; i++) {
-                    const cJSON *day_json = cJSON_GetArrayItem(forecastday_array, i);
-                    if (day_json) {
-                        forecast_daily_t *daily = &response->forecast[i];
-                        memset(daily, 0, sizeof(forecast_daily_t));
-                        
-                        // Parse date
-                        json_get_string(day_json, "date", daily->date, sizeof(daily->date));
-                        daily->date_epoch = json_get_long(day_json, "date_epoch");
-                        
-                        // Parse day data
-                        const cJSON *day_data = cJSON_GetObjectItem(day_json, "day");
-                        if (day_data) {
-                            parse_forecast_day(day_data, &daily->day);
-                        }
-                        
-                        // Parse astronomy
-                        const cJSON *astro_json = cJSON_GetObjectItem(day_json, "astro");
-                        if (astro_json) {
-                            parse_astronomy(astro_json, &daily->astro);
-                        }
-                        
-                        // Parse hourly data
-                        const cJSON *hour_array = cJSON_GetObjectItem(day_json, "hour");
-                        if (cJSON_IsArray(hour_array)) {
-                            int hour_count = cJSON_GetArraySize(hour_array);
-                            if (hour_count > 0) {
-                                daily->hour = malloc(hour_count * sizeof(forecast_hour_t));
-                                if (daily->hour) {
-                                    daily->hour_count = hour_count;
-                                    for (int h = 0; h < hour_count; h++) {
-                                        const cJSON *hour_json = cJSON_GetArrayItem(hour_array, h);
-                                        if (hour_json) {
-                                            parse_forecast_hour(hour_json, &daily->hour[h]);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    if (days < 1 || days > 14) {
+        fprintf(stderr, "Invalid forecast days: %d. Must be between 1 and 14.\n", days);
+        return -1;
     }
     
-    // Cleanup
-    cJSON_Delete(json);
-    http_response_free(&http_response);
+    upstream_query_t query = {location, 1, days, include_aqi, include_alerts};
+    char cache_key[WEATHER_CACHE_KEY_SIZE];
+    weather_cache_forecast_key(location, days, include_aqi, include_alerts, cache_key, sizeof(cache_key));
     
-    return 0;
+    return join_flight(cache_key, &query, callback, user_data);
+}
+
+weather_result_t *weather_api_get_forecast_cached(const char *location, int days, int include_aqi, int include_alerts,
+                                                  weather_cache_status_t *status) {
+    if (!api_initialized || !location || days < 1 || days > 14) {
+        return NULL;
+    }
+    
+    weather_cache_status_t local_status;
+    if (!status) {
+        status = &local_status;
+    }
+    
+    weather_result_t *result = weather_cache_get_forecast(location, days, include_aqi, include_alerts, status);
+    if (result && status->refresh) {
+        upstream_query_t query = {location, 1, days, include_aqi, include_alerts};
+        char cache_key[WEATHER_CACHE_KEY_SIZE];
+        weather_cache_forecast_key(location, days, include_aqi, include_alerts, cache_key, sizeof(cache_key));
+        start_refresh(cache_key, &query);
+    }
+    
+    return result;
+}
+
+void weather_api_get_stats(weather_api_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&flights_lock);
+    stats->leader_requests = leader_requests;
+    stats->coalesced_requests = coalesced_requests;
+    pthread_mutex_unlock(&flights_lock);
+    
+    pthread_mutex_lock(&batch_lock);
+    stats->batches = batches_sent;
+    stats->bulk_requests = bulk_requests;
+    stats->batched_requests = batched_requests;
+    stats->batch_wait_seconds = batch_wait_seconds;
+    pthread_mutex_unlock(&batch_lock);
 }
 
 void forecast_response_free(forecast_response_t *response) {
     if (response) {
-        if (response->forecast) {
-            for (int i = 0; i < response->forecast_days; i++) {
-                if (response->forecast[i].hour) {
-                    free(response->forecast[i].hour);
-                }
-            }
-            free(response->forecast);
-        }
+        // Days and hours share one arena that starts with the days array
+        weather_arena_free(weather_arena_of(response->forecast));
         memset(response, 0, sizeof(forecast_response_t));
     }
 }
@@ -0,0 +1,134 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "weather_arena.h"
+
+#define ARENA_GRANULE 4096                  // Block sizes are rounded to this so freed blocks fit again
+#define ARENA_CACHE_BLOCKS 32               // Freed blocks kept for reuse...
+#define ARENA_CACHE_MAX (1024 * 1024)       // ...each at most this large
+
+struct weather_arena {
+    size_t capacity;                        // Usable bytes after the header
+    size_t used;
+    struct weather_arena *next;             // Free list link
+};
+
+#define ARENA_HEADER WEATHER_ARENA_SIZE(sizeof(struct weather_arena))
+
+/**
+ * Freed blocks, shared by all threads
+ * Arenas are often created on one thread and freed on another (parsers on an
+ * MHD worker and the reactor, results on the reactor and whichever worker
+ * drops the last reference), so a single list is what lets blocks come back.
+ */
+static weather_arena_t *free_head = NULL;
+static int free_count = 0;
+static pthread_mutex_t free_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long arenas_created = 0;
+static unsigned long arenas_reused = 0;
+
+weather_arena_t *weather_arena_create(size_t size) {
+    size_t capacity = (ARENA_HEADER + WEATHER_ARENA_SIZE(size) + ARENA_GRANULE - 1) / ARENA_GRANULE * ARENA_GRANULE -
+                      ARENA_HEADER;
+    weather_arena_t *arena = NULL;
+    
+    // Smallest cached block that fits without wasting more than a quarter of it
+    pthread_mutex_lock(&free_lock);
+    weather_arena_t **best = NULL;
+    for (weather_arena_t **link = &free_head; *link; link = &(*link)->next) {
+        size_t cached = (*link)->capacity;
+        if (cached >= capacity && cached - cached / 4 <= capacity && (!best || cached < (*best)->capacity)) {
+            best = link;
+        }
+    }
+    if (best) {
+        arena = *best;
+        *best = arena->next;
+        free_count--;
+    }
+    pthread_mutex_unlock(&free_lock);
+    if (arena) {
+        __atomic_add_fetch(&arenas_reused, 1, __ATOMIC_RELAXED);
+    }
+    
+    if (!arena) {
+        arena = malloc(ARENA_HEADER + capacity);
+        if (!arena) {
+            fprintf(stderr, "Failed to allocate arena of %zu bytes\n", size);
+            return NULL;
+        }
+        arena->capacity = capacity;
+    }
+    
+    arena->used = 0;
+    arena->next = NULL;
+    __atomic_add_fetch(&arenas_created, 1, __ATOMIC_RELAXED);
+    return arena;
+}
+
+void *weather_arena_alloc(weather_arena_t *arena, size_t size) {
+    size = WEATHER_ARENA_SIZE(size);
+    if (!arena || size > arena->capacity - arena->used) {
+        return NULL;
+    }
+    void *block = (char *)arena + ARENA_HEADER + arena->used;
+    arena->used += size;
+    return block;
+}
+
+weather_arena_t *weather_arena_of(void *first) {
+    return first ? (weather_arena_t *)((char *)first - ARENA_HEADER) : NULL;
+}
+
+size_t weather_arena_size(const weather_arena_t *arena) {
+    return arena ? ARENA_HEADER + arena->capacity : 0;
+}
+
+void weather_arena_free(weather_arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+    if (arena->capacity > ARENA_CACHE_MAX) {
+        free(arena);
+        return;
+    }
+    
+    pthread_mutex_lock(&free_lock);
+    arena->next = free_head;
+    free_head = arena;
+    arena = NULL;
+    if (++free_count > ARENA_CACHE_BLOCKS) {
+        // Full: drop the block freed longest ago, which no recent size has matched
+        weather_arena_t **link = &free_head;
+        while ((*link)->next) {
+            link = &(*link)->next;
+        }
+        arena = *link;
+        *link = NULL;
+        free_count--;
+    }
+    pthread_mutex_unlock(&free_lock);
+    
+    free(arena);
+}
+
+void weather_arena_cleanup(void) {
+    pthread_mutex_lock(&free_lock);
+    while (free_head) {
+        weather_arena_t *next = free_head->next;
+        free(free_head);
+        free_head = next;
+    }
+    free_count = 0;
+    pthread_mutex_unlock(&free_lock);
+}
+
+void weather_arena_get_stats(weather_arena_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->created = __atomic_load_n(&arenas_created, __ATOMIC_RELAXED);
+    stats->reused = __atomic_load_n(&arenas_reused, __ATOMIC_RELAXED);
+}
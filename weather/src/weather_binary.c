@@ -0,0 +1,489 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "weather_binary.h"
+#include "weather_compact.h"
+
+#define BINARY_WRITER_MIN 1024              // First buffer size
+
+// CBOR major types (RFC 8949 section 3.1)
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+
+static const double binary_pow10[] = { 1, 1e1, 1e2 };
+static const long long binary_pow10_int[] = { 1, 10, 100 };
+
+void weather_binary_writer_init(weather_binary_writer_t *writer, weather_binary_format_t format) {
+    memset(writer, 0, sizeof(*writer));
+    writer->format = format;
+}
+
+void weather_binary_writer_project(weather_binary_writer_t *writer, const weather_fields_t *fields) {
+    writer->fields = fields;
+}
+
+/**
+ * Make room for n more bytes in a writer's buffer
+ */
+static int binary_reserve(weather_binary_writer_t *writer, size_t n) {
+    if (writer->failed) {
+        return -1;
+    }
+    if (writer->length + n <= writer->capacity) {
+        return 0;
+    }
+    
+    size_t capacity = writer->capacity ? writer->capacity * 2 : BINARY_WRITER_MIN;
+    while (capacity < writer->length + n) {
+        capacity *= 2;
+    }
+    unsigned char *data = realloc(writer->data, capacity);
+    if (!data) {
+        fprintf(stderr, "Failed to grow binary output to %zu bytes\n", capacity);
+        writer->failed = 1;
+        return -1;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+    return 0;
+}
+
+unsigned char *weather_binary_writer_finish(weather_binary_writer_t *writer, size_t *length) {
+    // Reserving nothing still allocates the first buffer of an empty writer
+    if (binary_reserve(writer, writer->data ? 0 : 1) != 0) {
+        free(writer->data);
+        writer->data = NULL;
+        return NULL;
+    }
+    
+    unsigned char *data = writer->data;
+    if (length) {
+        *length = writer->length;
+    }
+    writer->data = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    return data;
+}
+
+/**
+ * Write a type byte followed by a big-endian value of 0, 1, 2, 4 or 8 bytes
+ */
+static void binary_put(weather_binary_writer_t *writer, unsigned char type, uint64_t value, int bytes) {
+    if (binary_reserve(writer, 1 + (size_t)bytes) != 0) {
+        return;
+    }
+    unsigned char *p = writer->data + writer->length;
+    *p++ = type;
+    for (int i = bytes - 1; i >= 0; i--) {
+        *p++ = (unsigned char)(value >> (8 * i));
+    }
+    writer->length += 1 + (size_t)bytes;
+}
+
+static void binary_put_bytes(weather_binary_writer_t *writer, const void *bytes, size_t n) {
+    if (binary_reserve(writer, n) == 0) {
+        memcpy(writer->data + writer->length, bytes, n);
+        writer->length += n;
+    }
+}
+
+/**
+ * Write a CBOR head: major type and argument in the shortest form
+ */
+static void cbor_put_head(weather_binary_writer_t *writer, int major, uint64_t value) {
+    unsigned char type = (unsigned char)(major << 5);
+    if (value < 24) {
+        binary_put(writer, type | (unsigned char)value, 0, 0);
+    } else if (value <= 0xff) {
+        binary_put(writer, type | 24, value, 1);
+    } else if (value <= 0xffff) {
+        binary_put(writer, type | 25, value, 2);
+    } else if (value <= 0xffffffff) {
+        binary_put(writer, type | 26, value, 4);
+    } else {
+        binary_put(writer, type | 27, value, 8);
+    }
+}
+
+static void binary_put_uint(weather_binary_writer_t *writer, uint64_t value) {
+    if (writer->format == WEATHER_BINARY_CBOR) {
+        cbor_put_head(writer, CBOR_UINT, value);
+    } else if (value <= 0x7f) {
+        binary_put(writer, (unsigned char)value, 0, 0);
+    } else if (value <= 0xff) {
+        binary_put(writer, 0xcc, value, 1);
+    } else if (value <= 0xffff) {
+        binary_put(writer, 0xcd, value, 2);
+    } else if (value <= 0xffffffff) {
+        binary_put(writer, 0xce, value, 4);
+    } else {
+        binary_put(writer, 0xcf, value, 8);
+    }
+}
+
+static void binary_put_int(weather_binary_writer_t *writer, long long value) {
+    if (value >= 0) {
+        binary_put_uint(writer, (uint64_t)value);
+    } else if (writer->format == WEATHER_BINARY_CBOR) {
+        cbor_put_head(writer, CBOR_NEGINT, (uint64_t)(-1 - value));
+    } else if (value >= -32) {
+        binary_put(writer, (unsigned char)(value & 0xff), 0, 0);
+    } else if (value >= -128) {
+        binary_put(writer, 0xd0, (uint64_t)value, 1);
+    } else if (value >= -32768) {
+        binary_put(writer, 0xd1, (uint64_t)value, 2);
+    } else if (value >= -2147483647LL - 1) {
+        binary_put(writer, 0xd2, (uint64_t)value, 4);
+    } else {
+        binary_put(writer, 0xd3, (uint64_t)value, 8);
+    }
+}
+
+static void binary_put_string(weather_binary_writer_t *writer, const char *value) {
+    size_t length = strlen(value);
+    if (writer->format == WEATHER_BINARY_CBOR) {
+        cbor_put_head(writer, CBOR_TEXT, length);
+    } else if (length < 32) {
+        binary_put(writer, (unsigned char)(0xa0 | length), 0, 0);
+    } else if (length <= 0xff) {
+        binary_put(writer, 0xd9, length, 1);
+    } else if (length <= 0xffff) {
+        binary_put(writer, 0xda, length, 2);
+    } else {
+        binary_put(writer, 0xdb, length, 4);
+    }
+    binary_put_bytes(writer, value, length);
+}
+
+/**
+ * Write an array or map header
+ * @param map 1 for a map of count pairs, 0 for an array
+ */
+static void binary_put_container(weather_binary_writer_t *writer, int map, size_t count) {
+    if (writer->format == WEATHER_BINARY_CBOR) {
+        cbor_put_head(writer, map ? CBOR_MAP : CBOR_ARRAY, count);
+    } else if (count < 16) {
+        binary_put(writer, (unsigned char)((map ? 0x80 : 0x90) | count), 0, 0);
+    } else if (count <= 0xffff) {
+        binary_put(writer, map ? 0xde : 0xdc, count, 2);
+    } else {
+        binary_put(writer, map ? 0xdf : 0xdd, count, 4);
+    }
+}
+
+static void binary_put_float(weather_binary_writer_t *writer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    binary_put(writer, writer->format == WEATHER_BINARY_CBOR ? 0xfa : 0xca, bits, 4);
+}
+
+static void binary_put_double(weather_binary_writer_t *writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    binary_put(writer, writer->format == WEATHER_BINARY_CBOR ? 0xfb : 0xcb, bits, 8);
+}
+
+/**
+ * Write a double in the smallest form it reads back from (see weather_binary.h)
+ */
+static void binary_put_number(weather_binary_writer_t *writer, double value) {
+    if (value == trunc(value) && fabs(value) < 9007199254740992.0) {
+        binary_put_int(writer, (long long)value);
+        return;
+    }
+    if (fabs(value) < WEATHER_BINARY_FLOAT_MAX && round(value * 100) / 100 == value) {
+        binary_put_float(writer, (float)value);
+        return;
+    }
+    binary_put_double(writer, value);
+}
+
+/**
+ * Write a scaled integer (at most two fraction digits) as binary_put_number() writes its value
+ */
+static void binary_put_fixed(weather_binary_writer_t *writer, long long value, int decimals) {
+    if (value % binary_pow10_int[decimals] == 0) {
+        binary_put_int(writer, value / binary_pow10_int[decimals]);
+    } else {
+        binary_put_float(writer, (float)(value / binary_pow10[decimals]));
+    }
+}
+
+const unsigned char *weather_binary_days_header(weather_binary_format_t format, int days, size_t *length) {
+    // One-byte array heads: CBOR 0x80 + n (n < 24), MessagePack fixarray 0x90 + n (n < 16)
+    static const unsigned char heads[] = {
+        0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+        0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+    };
+    
+    if (days < 0 || days > 15) {
+        *length = 0;
+        return NULL;
+    }
+    *length = 1;
+    return &heads[(format == WEATHER_BINARY_MSGPACK ? 16 : 0) + days];
+}
+
+static int binary_selected(const weather_binary_writer_t *writer, int field) {
+    return !writer->fields || (writer->fields->bits[field / 64] >> (field % 64) & 1);
+}
+
+/**
+ * Count the map entries a struct's members take
+ * @param field Field id of the first member
+ */
+static int binary_count(const weather_binary_writer_t *writer, const weather_schema_t *schema, int field) {
+    int count = 0;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            count += binary_count(writer, &weather_schema_condition, field);
+            field += weather_schema_condition.width;
+            continue;
+        }
+        if (member->type != WEATHER_MEMBER_TIME) {
+            count += binary_selected(writer, field);
+        }
+        field++;
+    }
+    return count;
+}
+
+/**
+ * Write one member that is not a condition or a time string
+ * @param value Member in the struct
+ */
+static void binary_write_value(weather_binary_writer_t *writer, const weather_member_t *member, const char *value) {
+    switch (member->type) {
+        case WEATHER_MEMBER_STRING:
+            binary_put_string(writer, value);
+            break;
+        case WEATHER_MEMBER_DOUBLE:
+            binary_put_number(writer, *(const double *)value);
+            break;
+        case WEATHER_MEMBER_INT:
+            binary_put_int(writer, *(const int *)value);
+            break;
+        case WEATHER_MEMBER_LONG:
+            binary_put_int(writer, *(const long *)value);
+            break;
+    }
+}
+
+/**
+ * Write the members of a struct as map entries keyed by field id
+ * @param base Struct to read
+ * @param field Field id of the first member
+ */
+static void binary_write_members(weather_binary_writer_t *writer, const weather_schema_t *schema, const void *base,
+                                 int field) {
+    const char *bytes = base;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        const char *value = bytes + member->offset;
+        
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            binary_write_members(writer, &weather_schema_condition, value, field);
+            field += weather_schema_condition.width;
+            continue;
+        }
+        if (member->type != WEATHER_MEMBER_TIME && binary_selected(writer, field)) {
+            binary_put_uint(writer, (uint64_t)field);
+            binary_write_value(writer, member, value);
+        }
+        field++;
+    }
+}
+
+void weather_binary_write_current(weather_binary_writer_t *writer, const weather_response_t *response) {
+    binary_put_container(writer, 1, 1 + (size_t)binary_count(writer, &weather_schema_location, WEATHER_FIELD_LOCATION) +
+                                    (size_t)binary_count(writer, &weather_schema_current, WEATHER_FIELD_CURRENT));
+    binary_put_uint(writer, WEATHER_BINARY_KEY_SCHEMA);
+    binary_put_uint(writer, WEATHER_BINARY_SCHEMA);
+    binary_write_members(writer, &weather_schema_location, &response->location, WEATHER_FIELD_LOCATION);
+    binary_write_members(writer, &weather_schema_current, &response->current, WEATHER_FIELD_CURRENT);
+}
+
+/**
+ * Hour member a day's hours are written with
+ */
+typedef struct {
+    const weather_member_t *member;
+    const weather_column_t *column;         // NULL if unpacked
+    int field;                              // Field id of the member
+} binary_hour_plan_t;
+
+/**
+ * Look up the selected hour members (time strings left out) once per day
+ * @return Number of members
+ */
+static int binary_plan_hours(const weather_binary_writer_t *writer, binary_hour_plan_t *plan) {
+    const weather_schema_t *schema = &weather_schema_hour;
+    int planned = 0;
+    int field = WEATHER_FIELD_HOUR;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        int width = member->type == WEATHER_MEMBER_CONDITION ? weather_schema_condition.width : 1;
+        if (member->type != WEATHER_MEMBER_TIME && weather_fields_any(writer->fields, field, field + width - 1)) {
+            plan[planned].member = member;
+            plan[planned].column = weather_hours_column(member->offset);
+            plan[planned].field = field;
+            planned++;
+        }
+        field += width;
+    }
+    return planned;
+}
+
+/**
+ * Read one hour of a compact column
+ */
+static long long binary_column_value(const weather_hours_t *hours, const weather_column_t *column, int index) {
+    const char *base = (const char *)hours + column->offset;
+    switch (column->type) {
+        case WEATHER_COLUMN_INT64:
+            return ((const int64_t *)base)[index];
+        case WEATHER_COLUMN_INT16:
+            return ((const int16_t *)base)[index];
+        case WEATHER_COLUMN_UINT16:
+            return ((const uint16_t *)base)[index];
+        case WEATHER_COLUMN_INT8:
+            return ((const int8_t *)base)[index];
+        default:
+            return ((const uint8_t *)base)[index];
+    }
+}
+
+/**
+ * Write one day's hours straight from the compact layout, one map per hour
+ * Like the JSON writer: stored members are written from their columns,
+ * conditions from the shared table, and the others are unpacked one at a time.
+ */
+static void binary_write_hour_rows(weather_binary_writer_t *writer, const weather_hours_t *hours) {
+    binary_hour_plan_t plan[WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR];
+    int planned = binary_plan_hours(writer, plan);
+    size_t entries = (size_t)binary_count(writer, &weather_schema_hour, WEATHER_FIELD_HOUR);
+    forecast_hour_t hour;
+    
+    binary_put_container(writer, 0, (size_t)hours->count);
+    for (int h = 0; h < hours->count; h++) {
+        binary_put_container(writer, 1, entries);
+        for (int i = 0; i < planned; i++) {
+            const weather_member_t *member = plan[i].member;
+            
+            if (member->type == WEATHER_MEMBER_CONDITION) {
+                binary_write_members(writer, &weather_schema_condition, weather_condition_lookup(hours->condition[h]),
+                                     plan[i].field);
+                continue;
+            }
+            binary_put_uint(writer, (uint64_t)plan[i].field);
+            if (plan[i].column) {
+                binary_put_fixed(writer, binary_column_value(hours, plan[i].column, h), plan[i].column->decimals);
+                continue;
+            }
+            weather_hours_get_member(hours, h, member->offset, &hour);
+            binary_write_value(writer, member, (const char *)&hour + member->offset);
+        }
+    }
+}
+
+/**
+ * Write one day's hours as a map of field id to an array of values (WEATHER_HOURLY_COLUMNS)
+ */
+static void binary_write_hour_columns(weather_binary_writer_t *writer, const weather_hours_t *hours) {
+    binary_hour_plan_t plan[WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR];
+    int planned = binary_plan_hours(writer, plan);
+    forecast_hour_t hour;
+    
+    binary_put_container(writer, 1, (size_t)binary_count(writer, &weather_schema_hour, WEATHER_FIELD_HOUR));
+    for (int i = 0; i < planned; i++) {
+        const weather_member_t *member = plan[i].member;
+        
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            for (int c = 0; c < weather_schema_condition.count; c++) {
+                const weather_member_t *part = &weather_schema_condition.members[c];
+                if (!binary_selected(writer, plan[i].field + c)) {
+                    continue;
+                }
+                binary_put_uint(writer, (uint64_t)(plan[i].field + c));
+                binary_put_container(writer, 0, (size_t)hours->count);
+                for (int h = 0; h < hours->count; h++) {
+                    const char *condition = (const char *)weather_condition_lookup(hours->condition[h]);
+                    binary_write_value(writer, part, condition + part->offset);
+                }
+            }
+            continue;
+        }
+        
+        binary_put_uint(writer, (uint64_t)plan[i].field);
+        binary_put_container(writer, 0, (size_t)hours->count);
+        if (plan[i].column) {
+            for (int h = 0; h < hours->count; h++) {
+                binary_put_fixed(writer, binary_column_value(hours, plan[i].column, h), plan[i].column->decimals);
+            }
+        } else {
+            for (int h = 0; h < hours->count; h++) {
+                weather_hours_get_member(hours, h, member->offset, &hour);
+                binary_write_value(writer, member, (const char *)&hour + member->offset);
+            }
+        }
+    }
+}
+
+void weather_binary_write_forecast_head(weather_binary_writer_t *writer, const weather_result_t *result) {
+    int days = weather_fields_any(writer->fields, WEATHER_FIELDS_FORECAST);
+    
+    binary_put_container(writer, 1, 1 + (size_t)binary_count(writer, &weather_schema_location, WEATHER_FIELD_LOCATION) +
+                                    (size_t)days);
+    binary_put_uint(writer, WEATHER_BINARY_KEY_SCHEMA);
+    binary_put_uint(writer, WEATHER_BINARY_SCHEMA);
+    binary_write_members(writer, &weather_schema_location, &result->forecast.location, WEATHER_FIELD_LOCATION);
+    if (days) {
+        binary_put_uint(writer, WEATHER_BINARY_KEY_DAYS);
+    }
+}
+
+void weather_binary_write_forecast_day(weather_binary_writer_t *writer, const weather_result_t *result, int day,
+                                       int include_hourly) {
+    const forecast_daily_t *daily = &result->forecast.forecast[day];
+    
+    const weather_hours_t *hours = NULL;
+    if (include_hourly && weather_fields_any(writer->fields, WEATHER_FIELDS_HOUR)) {
+        hours = weather_result_hours(result, day);
+    }
+    
+    binary_put_container(writer, 1, (size_t)binary_count(writer, &weather_schema_daily, WEATHER_FIELD_DAILY) +
+                                    (size_t)binary_count(writer, &weather_schema_day, WEATHER_FIELD_DAY) +
+                                    (size_t)binary_count(writer, &weather_schema_astro, WEATHER_FIELD_ASTRO) +
+                                    (hours ? 1 : 0));
+    binary_write_members(writer, &weather_schema_daily, daily, WEATHER_FIELD_DAILY);
+    binary_write_members(writer, &weather_schema_day, &daily->day, WEATHER_FIELD_DAY);
+    binary_write_members(writer, &weather_schema_astro, &daily->astro, WEATHER_FIELD_ASTRO);
+    if (hours) {
+        binary_put_uint(writer, WEATHER_BINARY_KEY_HOURS);
+        if (include_hourly == WEATHER_HOURLY_COLUMNS) {
+            binary_write_hour_columns(writer, hours);
+        } else {
+            binary_write_hour_rows(writer, hours);
+        }
+    }
+}
+
+void weather_binary_write_forecast(weather_binary_writer_t *writer, const weather_result_t *result,
+                                   int include_hourly) {
+    weather_binary_write_forecast_head(writer, result);
+    if (!weather_fields_any(writer->fields, WEATHER_FIELDS_FORECAST)) {
+        return;
+    }
+    
+    binary_put_container(writer, 0, (size_t)result->forecast.forecast_days);
+    for (int i = 0; i < result->forecast.forecast_days; i++) {
+        weather_binary_write_forecast_day(writer, result, i, include_hourly);
+    }
+}
@@ -0,0 +1,339 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "weather_body.h"
+#include "weather_json.h"
+#include "weather_binary.h"
+#include "weather_parser.h"
+
+#define SLOT_WHOLE 0                        // Complete /current body
+#define SLOT_HEAD 0                         // Forecast up to its first day
+#define SLOT_TAIL 1                         // Forecast after its last day
+#define SLOT_DAY(day, hourly) (2 + (hourly) * WEATHER_BODY_DAYS + (day)) // hourly: weather_hourly_t
+#define SLOT_COUNT (2 + 3 * WEATHER_BODY_DAYS)
+#define BODY_PROJECTIONS 8                  // Projected sets a result keeps
+
+/**
+ * One rendered fragment
+ */
+typedef struct {
+    size_t length;
+    char *data;
+} body_fragment_t;
+
+/**
+ * Fragments rendered with one set of output options
+ * Slots go from NULL to a fragment once and never change again.
+ */
+struct weather_body {
+    unsigned int key;
+    int projected;                          // Only the members in fields are written
+    weather_fields_t fields;
+    body_fragment_t *slots[SLOT_COUNT];
+    struct weather_body *next;
+};
+
+static unsigned long body_hits = 0;
+static unsigned long body_renders = 0;
+static unsigned long body_bytes = 0;
+
+/**
+ * Result that owns the data a result or view shows
+ */
+static weather_result_t *body_owner(weather_result_t *result) {
+    return result->source ? result->source : result;
+}
+
+unsigned int weather_body_key(weather_format_t format, int pretty, int precision) {
+    if (format != WEATHER_FORMAT_JSON) {
+        pretty = 0;
+        precision = WEATHER_JSON_SHORTEST;
+    }
+    // precision + 1 keeps WEATHER_JSON_SHORTEST at 0
+    return (unsigned int)format << 8 | (unsigned int)(precision + 1) << 1 | (unsigned int)(pretty ? 1 : 0);
+}
+
+/**
+ * Check whether a set was rendered with the given options
+ */
+static int body_matches(const struct weather_body *set, unsigned int key, const weather_fields_t *fields) {
+    if (set->key != key || set->projected != (fields != NULL)) {
+        return 0;
+    }
+    return !fields || memcmp(&set->fields, fields, sizeof(*fields)) == 0;
+}
+
+/**
+ * Find or add the fragments of one set of options
+ * Sets without a projection are bounded by the option combinations; a result
+ * keeps up to BODY_PROJECTIONS projected ones. Sets are never dropped.
+ * @param full Set to 1 if the projection is not cached because the result has enough
+ */
+static struct weather_body *body_set(weather_result_t *owner, unsigned int key, const weather_fields_t *fields,
+                                     int *full) {
+    struct weather_body *head = __atomic_load_n(&owner->bodies, __ATOMIC_ACQUIRE);
+    int projections = 0;
+    for (struct weather_body *set = head; set; set = set->next) {
+        if (body_matches(set, key, fields)) {
+            return set;
+        }
+        projections += set->projected;
+    }
+    if (fields && projections >= BODY_PROJECTIONS) {
+        *full = 1;
+        return NULL;
+    }
+    
+    struct weather_body *added = calloc(1, sizeof(struct weather_body));
+    if (!added) {
+        fprintf(stderr, "Failed to allocate response fragments\n");
+        return NULL;
+    }
+    added->key = key;
+    if (fields) {
+        added->projected = 1;
+        added->fields = *fields;
+    }
+    __atomic_add_fetch(&body_bytes, sizeof(struct weather_body), __ATOMIC_RELAXED);
+    
+    // Publish at the head; if another thread got there first, look at the list again
+    do {
+        for (struct weather_body *set = head; set; set = set->next) {
+            if (body_matches(set, key, fields)) {
+                __atomic_sub_fetch(&body_bytes, sizeof(struct weather_body), __ATOMIC_RELAXED);
+                free(added);
+                return set;
+            }
+        }
+        added->next = head;
+    } while (!__atomic_compare_exchange_n(&owner->bodies, &head, added, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    
+    return added;
+}
+
+/**
+ * Render one binary fragment (there is no tail)
+ */
+static char *fragment_render_binary(const struct weather_body *set, const weather_result_t *result, int slot,
+                                    size_t *length) {
+    weather_binary_writer_t writer;
+    weather_binary_writer_init(&writer, (set->key >> 8) == WEATHER_FORMAT_CBOR ? WEATHER_BINARY_CBOR
+                                                                              : WEATHER_BINARY_MSGPACK);
+    weather_binary_writer_project(&writer, set->projected ? &set->fields : NULL);
+    if (!result->is_forecast) {
+        weather_binary_write_current(&writer, &result->current);
+    } else if (slot == SLOT_HEAD) {
+        weather_binary_write_forecast_head(&writer, result);
+    } else if (slot != SLOT_TAIL) {
+        int day = (slot - 2) % WEATHER_BODY_DAYS;
+        weather_binary_write_forecast_day(&writer, result, day, (slot - 2) / WEATHER_BODY_DAYS);
+    }
+    return (char *)weather_binary_writer_finish(&writer, length);
+}
+
+/**
+ * Render one JSON fragment
+ */
+static char *fragment_render_json(const struct weather_body *set, const weather_result_t *result, int slot,
+                                  size_t *length) {
+    int pretty = set->key & 1;
+    int precision = (int)(set->key >> 1 & 0x7f) - 1;
+    const weather_fields_t *fields = set->projected ? &set->fields : NULL;
+    
+    weather_json_writer_t writer;
+    weather_json_writer_init(&writer, pretty, precision);
+    weather_json_writer_project(&writer, fields);
+    if (!result->is_forecast) {
+        weather_json_write_current(&writer, &result->current);
+    } else if (slot == SLOT_HEAD) {
+        weather_json_write_forecast_head(&writer, result);
+    } else {
+        int days = weather_fields_any(fields, WEATHER_FIELDS_FORECAST);
+        weather_json_writer_enter(&writer, days ? WEATHER_JSON_DAY_CONTEXT : WEATHER_JSON_ROOT_CONTEXT);
+        if (slot == SLOT_TAIL) {
+            weather_json_write_forecast_tail(&writer);
+        } else {
+            int day = (slot - 2) % WEATHER_BODY_DAYS;
+            weather_json_write_forecast_day(&writer, result, day, (slot - 2) / WEATHER_BODY_DAYS);
+        }
+    }
+    return weather_json_writer_finish(&writer, length);
+}
+
+/**
+ * Render one fragment
+ */
+static body_fragment_t *fragment_render(const struct weather_body *set, const weather_result_t *result, int slot) {
+    size_t length;
+    char *data = (set->key >> 8) == WEATHER_FORMAT_JSON ? fragment_render_json(set, result, slot, &length)
+                                                        : fragment_render_binary(set, result, slot, &length);
+    body_fragment_t *fragment = data ? malloc(sizeof(body_fragment_t)) : NULL;
+    if (!fragment) {
+        fprintf(stderr, "Failed to render response fragment\n");
+        free(data);
+        return NULL;
+    }
+    fragment->length = length;
+    fragment->data = data;
+    return fragment;
+}
+
+/**
+ * Get a fragment, rendering and storing it if it is missing
+ * @param rendered Set to 1 if the fragment had to be rendered
+ */
+static const body_fragment_t *fragment_get(struct weather_body *set, const weather_result_t *result, int slot,
+                                           int *rendered) {
+    body_fragment_t *fragment = __atomic_load_n(&set->slots[slot], __ATOMIC_ACQUIRE);
+    if (fragment) {
+        return fragment;
+    }
+    
+    fragment = fragment_render(set, result, slot);
+    if (!fragment) {
+        return NULL;
+    }
+    *rendered = 1;
+    
+    // Another thread may have rendered the same fragment meanwhile; keep the first
+    body_fragment_t *expected = NULL;
+    if (!__atomic_compare_exchange_n(&set->slots[slot], &expected, fragment, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(fragment->data);
+        free(fragment);
+        return expected;
+    }
+    
+    __atomic_add_fetch(&body_renders, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&body_bytes, sizeof(body_fragment_t) + fragment->length + 1, __ATOMIC_RELAXED);
+    return fragment;
+}
+
+static void piece_set(weather_piece_t *piece, const body_fragment_t *fragment) {
+    piece->data = fragment->data;
+    piece->length = fragment->length;
+}
+
+int weather_body_pieces(weather_result_t *result, unsigned int key, const weather_fields_t *fields,
+                        int include_hourly, weather_piece_t *pieces) {
+    int full = 0;
+    struct weather_body *set = body_set(body_owner(result), key, fields, &full);
+    if (!set) {
+        return full ? 0 : -1;
+    }
+    
+    int rendered = 0;
+    const body_fragment_t *fragment;
+    
+    if (!result->is_forecast) {
+        fragment = fragment_get(set, result, SLOT_WHOLE, &rendered);
+        if (!fragment) {
+            return -1;
+        }
+        piece_set(&pieces[0], fragment);
+        if (!rendered) {
+            __atomic_add_fetch(&body_hits, 1, __ATOMIC_RELAXED);
+        }
+        return 1;
+    }
+    
+    int days = weather_fields_any(fields, WEATHER_FIELDS_FORECAST) ? result->forecast.forecast_days : 0;
+    if (days > WEATHER_BODY_DAYS) {
+        fprintf(stderr, "Forecast of %d days has too many to cache\n", days);
+        return -1;
+    }
+    if (!weather_fields_any(fields, WEATHER_FIELDS_HOUR)) {
+        include_hourly = WEATHER_HOURLY_NONE;
+    }
+    
+    // Parse the sections the days show before rendering the first missing one
+    for (int i = 0; i < days; i++) {
+        if (!__atomic_load_n(&set->slots[SLOT_DAY(i, include_hourly)], __ATOMIC_ACQUIRE)) {
+            unsigned int sections = (weather_fields_any(fields, WEATHER_FIELDS_ASTRO) ? WEATHER_SECTION_ASTRO : 0) |
+                                    (include_hourly ? WEATHER_SECTION_HOURS : 0);
+            if (weather_result_load(result, sections) != 0) {
+                return -1;
+            }
+            break;
+        }
+    }
+    
+    int count = 0;
+    int binary = (key >> 8) != WEATHER_FORMAT_JSON;
+    const char *separator = binary ? "" : weather_json_day_separator(key & 1);
+    size_t separator_length = strlen(separator);
+    
+    if (!(fragment = fragment_get(set, result, SLOT_HEAD, &rendered))) {
+        return -1;
+    }
+    piece_set(&pieces[count++], fragment);
+    if (binary && weather_fields_any(fields, WEATHER_FIELDS_FORECAST)) {
+        // Binary arrays are counted, so the days header goes between the shared head and the days
+        size_t header_length;
+        pieces[count].data = (const char *)weather_binary_days_header(
+            (key >> 8) == WEATHER_FORMAT_CBOR ? WEATHER_BINARY_CBOR : WEATHER_BINARY_MSGPACK, days, &header_length);
+        pieces[count++].length = header_length;
+    }
+    for (int i = 0; i < days; i++) {
+        if (i > 0 && separator_length > 0) {
+            pieces[count].data = separator;
+            pieces[count++].length = separator_length;
+        }
+        if (!(fragment = fragment_get(set, result, SLOT_DAY(i, include_hourly), &rendered))) {
+            return -1;
+        }
+        piece_set(&pieces[count++], fragment);
+    }
+    if (!binary) {
+        if (!(fragment = fragment_get(set, result, SLOT_TAIL, &rendered))) {
+            return -1;
+        }
+        piece_set(&pieces[count++], fragment);
+    }
+    
+    if (!rendered) {
+        __atomic_add_fetch(&body_hits, 1, __ATOMIC_RELAXED);
+    }
+    return count;
+}
+
+size_t weather_body_bytes(const weather_result_t *result) {
+    size_t bytes = 0;
+    for (struct weather_body *set = __atomic_load_n(&result->bodies, __ATOMIC_ACQUIRE); set; set = set->next) {
+        bytes += sizeof(struct weather_body);
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            body_fragment_t *fragment = __atomic_load_n(&set->slots[slot], __ATOMIC_ACQUIRE);
+            if (fragment) {
+                bytes += sizeof(body_fragment_t) + fragment->length + 1;
+            }
+        }
+    }
+    return bytes;
+}
+
+void weather_body_free_all(weather_result_t *result) {
+    size_t bytes = weather_body_bytes(result);
+    struct weather_body *set = result->bodies;
+    while (set) {
+        struct weather_body *next = set->next;
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            if (set->slots[slot]) {
+                free(set->slots[slot]->data);
+                free(set->slots[slot]);
+            }
+        }
+        free(set);
+        set = next;
+    }
+    result->bodies = NULL;
+    __atomic_sub_fetch(&body_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void weather_body_get_stats(weather_body_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->hits = __atomic_load_n(&body_hits, __ATOMIC_RELAXED);
+    stats->renders = __atomic_load_n(&body_renders, __ATOMIC_RELAXED);
+    stats->bytes = __atomic_load_n(&body_bytes, __ATOMIC_RELAXED);
+}
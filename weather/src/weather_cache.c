@@ -0,0 +1,1739 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "weather_cache.h"
+#include "weather_api.h"
+#include "weather_parser.h"
+#include "weather_compact.h"
+#include "weather_fields.h"
+#include "weather_arena.h"
+#include "weather_body.h"
+#include "weather_location.h"
+
+#define CACHE_SHARDS 16             // Lock stripes (power of two)
+#define CACHE_INITIAL_BUCKETS 64    // Hash buckets per shard before growth
+#define SKETCH_DEPTH 4              // Count-min rows
+#define SKETCH_MAX_COUNT 15         // Saturating 4-bit counters
+#define SKETCH_MIN_WIDTH 64
+#define SKETCH_MAX_WIDTH 65536
+#define EXPECTED_ENTRY_BYTES 4096   // Sizing hint for the sketch
+
+#define SNAPSHOT_MAGIC "WXCACHE"    // 8 bytes including the terminator
+#define SNAPSHOT_VERSION 2          // Bump when the encoding changes; members are matched by name
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+/**
+ * Cached response with its hash chain and LRU links
+ */
+typedef struct cache_entry {
+    struct cache_entry *hash_next;
+    struct cache_entry *lru_prev;   // Towards most recently used
+    struct cache_entry *lru_next;   // Towards least recently used
+    uint64_t hash;
+    time_t stored_at;               // When the result was fetched
+    time_t fresh_until;             // Soft TTL
+    time_t stale_until;             // Hard TTL
+    time_t next_refresh_at;         // Earliest time to ask for another refresh
+    double fetch_seconds;           // Upstream latency, scales early refresh
+    size_t bytes;                   // Accounted size including the key
+    weather_result_t *result;       // One reference held by the cache
+    char key[];
+} cache_entry_t;
+
+/**
+ * Count-min sketch approximating how often each key was requested
+ * Counters are halved every sample_size increments so old popularity decays.
+ */
+typedef struct {
+    uint8_t *counters;              // SKETCH_DEPTH rows of width counters
+    size_t width;                   // Counters per row (power of two)
+    size_t additions;
+    size_t sample_size;
+} frequency_sketch_t;
+
+/**
+ * One lock stripe: hash table, LRU list and admission sketch
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    cache_entry_t **buckets;
+    size_t bucket_count;            // Power of two
+    cache_entry_t *lru_head;
+    cache_entry_t *lru_tail;
+    size_t entries;
+    size_t bytes;
+    size_t max_bytes;
+    frequency_sketch_t sketch;
+    unsigned int random_state;      // rand_r() state for early refresh
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long stale_hits;
+    unsigned long superset_hits;
+    unsigned long nearby_hits;
+    unsigned long refreshes;
+    unsigned long inserts;
+    unsigned long rejections;
+    unsigned long evictions;
+    unsigned long expirations;
+} cache_shard_t;
+
+/**
+ * Snapshot file header
+ * Followed by the layout: each member table as (type, name) pairs in
+ * snapshot_schemas order, then the compact hour columns as (type, decimals,
+ * name). The loader matches members and columns by name, so a build that adds,
+ * drops or reorders them still loads the fields both know.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t entry_count;
+    uint64_t conditions_offset;     // Condition table, after the last record
+    int64_t created_at;
+} snapshot_header_t;
+
+/**
+ * Snapshot record header, followed by the key and payload
+ * Payload: location and current members, and for a forecast the day count
+ * then each day's daily, day and astro members and its hour columns. Strings
+ * are length-prefixed, conditions are ids into the condition table.
+ */
+typedef struct {
+    uint32_t key_size;              // Key bytes including the terminator
+    uint32_t is_forecast;
+    int64_t stored_at;
+    int64_t fresh_until;
+    int64_t stale_until;
+    double fetch_seconds;
+    uint64_t payload_size;
+} snapshot_record_t;
+
+/**
+ * Member tables of the layout, in the order it lists them
+ */
+enum {
+    SNAPSHOT_CONDITION,
+    SNAPSHOT_LOCATION,
+    SNAPSHOT_CURRENT,
+    SNAPSHOT_DAILY,
+    SNAPSHOT_DAY,
+    SNAPSHOT_ASTRO,
+    SNAPSHOT_TABLES
+};
+
+static const weather_schema_t *const snapshot_schemas[SNAPSHOT_TABLES] = {
+    &weather_schema_condition,
+    &weather_schema_location,
+    &weather_schema_current,
+    &weather_schema_daily,
+    &weather_schema_day,
+    &weather_schema_astro
+};
+
+static cache_shard_t cache_shards[CACHE_SHARDS];
+static size_t cache_max_bytes = 0;
+static int cache_initialized = 0;
+
+/**
+ * FNV-1a 64-bit hash of a key
+ */
+static uint64_t hash_key(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static size_t next_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static size_t sketch_index(const frequency_sketch_t *sketch, uint64_t hash, int row) {
+    // Double hashing: row i probes h1 + i * h2
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    return row * sketch->width + ((h1 + (uint32_t)row * h2) & (sketch->width - 1));
+}
+
+static void sketch_increment(frequency_sketch_t *sketch, uint64_t hash) {
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        uint8_t *counter = &sketch->counters[sketch_index(sketch, hash, row)];
+        if (*counter < SKETCH_MAX_COUNT) {
+            (*counter)++;
+        }
+    }
+    
+    // Age all counters so keys that were hot long ago lose their advantage
+    if (++sketch->additions >= sketch->sample_size) {
+        for (size_t i = 0; i < SKETCH_DEPTH * sketch->width; i++) {
+            sketch->counters[i] >>= 1;
+        }
+        sketch->additions /= 2;
+    }
+}
+
+static int sketch_estimate(const frequency_sketch_t *sketch, uint64_t hash) {
+    int estimate = SKETCH_MAX_COUNT;
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        int count = sketch->counters[sketch_index(sketch, hash, row)];
+        if (count < estimate) {
+            estimate = count;
+        }
+    }
+    return estimate;
+}
+
+static void current_key(const char *canonical, int include_aqi, char *key, size_t key_size) {
+    snprintf(key, key_size, "current|%s|aqi=%d", canonical, include_aqi ? 1 : 0);
+}
+
+static void forecast_key(const char *canonical, int days, int include_aqi, int include_alerts,
+                         char *key, size_t key_size) {
+    snprintf(key, key_size, "forecast|%s|days=%d|aqi=%d|alerts=%d",
+             canonical, days, include_aqi ? 1 : 0, include_alerts ? 1 : 0);
+}
+
+void weather_cache_current_key(const char *location, int include_aqi, char *key, size_t key_size) {
+    char canonical[WEATHER_LOCATION_SIZE];
+    weather_location_canonical(location, canonical, sizeof(canonical));
+    current_key(canonical, include_aqi, key, key_size);
+}
+
+void weather_cache_forecast_key(const char *location, int days, int include_aqi, int include_alerts,
+                                char *key, size_t key_size) {
+    char canonical[WEATHER_LOCATION_SIZE];
+    weather_location_canonical(location, canonical, sizeof(canonical));
+    forecast_key(canonical, days, include_aqi, include_alerts, key, key_size);
+}
+
+/**
+ * Register or unregister an entry in the spatial index, by the canonical
+ * location between the first two '|' of its key
+ */
+static void entry_index(const cache_entry_t *entry, int add) {
+    const char *location = strchr(entry->key, '|');
+    const char *end = location ? strchr(location + 1, '|') : NULL;
+    if (!end) {
+        return;
+    }
+    
+    location++;
+    if (add) {
+        weather_location_point_add(location, (size_t)(end - location));
+    } else {
+        weather_location_point_remove(location, (size_t)(end - location));
+    }
+}
+
+static size_t result_bytes(const weather_result_t *result) {
+    size_t bytes = sizeof(weather_result_t);
+    if (result->is_forecast) {
+        const forecast_response_t *forecast = &result->forecast;
+        // Days and their compact hours share one arena
+        bytes += weather_arena_size(weather_arena_of(forecast->forecast));
+        bytes += weather_lazy_bytes(result->lazy);
+    }
+    return bytes + weather_body_bytes(result);
+}
+
+static void entry_free(cache_entry_t *entry) {
+    // Callers still holding the result keep it alive
+    weather_result_release(entry->result);
+    free(entry);
+}
+
+static cache_shard_t *shard_for(uint64_t hash) {
+    // High bits pick the shard, low bits pick the bucket
+    return &cache_shards[hash >> 60 & (CACHE_SHARDS - 1)];
+}
+
+static void lru_unlink(cache_shard_t *shard, cache_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        shard->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        shard->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(cache_shard_t *shard, cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) {
+        shard->lru_head->lru_prev = entry;
+    } else {
+        shard->lru_tail = entry;
+    }
+    shard->lru_head = entry;
+}
+
+static cache_entry_t *shard_find(cache_shard_t *shard, uint64_t hash, const char *key) {
+    cache_entry_t *entry = shard->buckets[hash & (shard->bucket_count - 1)];
+    while (entry) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+/**
+ * Unlink an entry from its bucket and the LRU list, and free it
+ */
+static void shard_remove(cache_shard_t *shard, cache_entry_t *entry) {
+    cache_entry_t **link = &shard->buckets[entry->hash & (shard->bucket_count - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+    
+    lru_unlink(shard, entry);
+    shard->entries--;
+    shard->bytes -= entry->bytes;
+    entry_index(entry, 0);
+    entry_free(entry);
+}
+
+/**
+ * Double the bucket array once the load factor exceeds 1
+ */
+static void shard_grow(cache_shard_t *shard) {
+    size_t new_count = shard->bucket_count * 2;
+    cache_entry_t **new_buckets = calloc(new_count, sizeof(cache_entry_t *));
+    if (!new_buckets) {
+        return; // Keep the longer chains
+    }
+    
+    for (size_t i = 0; i < shard->bucket_count; i++) {
+        cache_entry_t *entry = shard->buckets[i];
+        while (entry) {
+            cache_entry_t *next = entry->hash_next;
+            size_t index = entry->hash & (new_count - 1);
+            entry->hash_next = new_buckets[index];
+            new_buckets[index] = entry;
+            entry = next;
+        }
+    }
+    
+    free(shard->buckets);
+    shard->buckets = new_buckets;
+    shard->bucket_count = new_count;
+}
+
+int weather_cache_init(size_t max_bytes) {
+    if (cache_initialized) {
+        return 0; // Already initialized
+    }
+    
+    if (max_bytes == 0) {
+        return 0; // Cache disabled
+    }
+    
+    size_t shard_bytes = max_bytes / CACHE_SHARDS;
+    size_t width = next_power_of_two(shard_bytes / EXPECTED_ENTRY_BYTES);
+    if (width < SKETCH_MIN_WIDTH) width = SKETCH_MIN_WIDTH;
+    if (width > SKETCH_MAX_WIDTH) width = SKETCH_MAX_WIDTH;
+    
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        cache_shard_t *shard = &cache_shards[i];
+        memset(shard, 0, sizeof(cache_shard_t));
+        
+        shard->buckets = calloc(CACHE_INITIAL_BUCKETS, sizeof(cache_entry_t *));
+        shard->sketch.counters = calloc(SKETCH_DEPTH * width, sizeof(uint8_t));
+        if (!shard->buckets || !shard->sketch.counters) {
+            fprintf(stderr, "Failed to allocate response cache shard\n");
+            free(shard->buckets);
+            free(shard->sketch.counters);
+            for (int j = 0; j < i; j++) {
+                free(cache_shards[j].buckets);
+                free(cache_shards[j].sketch.counters);
+                pthread_mutex_destroy(&cache_shards[j].lock);
+            }
+            return -1;
+        }
+        
+        pthread_mutex_init(&shard->lock, NULL);
+        shard->bucket_count = CACHE_INITIAL_BUCKETS;
+        shard->max_bytes = shard_bytes;
+        shard->sketch.width = width;
+        shard->sketch.sample_size = 10 * width;
+        shard->random_state = (unsigned int)time(NULL) ^ (unsigned int)(i * 2654435761u);
+    }
+    
+    cache_max_bytes = max_bytes;
+    cache_initialized = 1;
+    return 0;
+}
+
+void weather_cache_cleanup(void) {
+    if (!cache_initialized) {
+        return;
+    }
+    
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        cache_shard_t *shard = &cache_shards[i];
+        cache_entry_t *entry = shard->lru_head;
+        while (entry) {
+            cache_entry_t *next = entry->lru_next;
+            entry_index(entry, 0);
+            entry_free(entry);
+            entry = next;
+        }
+        free(shard->buckets);
+        free(shard->sketch.counters);
+        pthread_mutex_destroy(&shard->lock);
+        memset(shard, 0, sizeof(cache_shard_t));
+    }
+    
+    cache_max_bytes = 0;
+    cache_initialized = 0;
+}
+
+int weather_cache_enabled(void) {
+    return cache_initialized;
+}
+
+/**
+ * XFetch: decide whether a still-fresh entry should be refreshed early
+ * The probability rises as the soft TTL approaches, scaled by how long the
+ * upstream request takes, so hot keys are renewed one at a time rather than
+ * all expiring together.
+ */
+static int xfetch_due(cache_shard_t *shard, const cache_entry_t *entry, time_t now) {
+    double random = (rand_r(&shard->random_state) + 1.0) / ((double)RAND_MAX + 2.0);
+    double early = -entry->fetch_seconds * WEATHER_CACHE_XFETCH_BETA * log(random);
+    return (double)now + early >= (double)entry->fresh_until;
+}
+
+/**
+ * shard_lookup() modes
+ */
+#define LOOKUP_RECORD_ACCESS 0x1    // Count the access in the frequency sketch
+#define LOOKUP_FRESH_ONLY 0x2       // Ignore stale entries without counting a miss
+
+/**
+ * Find a usable entry
+ * Must be called with the shard lock held.
+ */
+static cache_entry_t *shard_lookup(cache_shard_t *shard, uint64_t hash, const char *key,
+                                   weather_cache_status_t *status, int mode) {
+    if (mode & LOOKUP_RECORD_ACCESS) {
+        sketch_increment(&shard->sketch, hash);
+    }
+    
+    time_t now = time(NULL);
+    cache_entry_t *entry = shard_find(shard, hash, key);
+    if (entry && entry->stale_until <= now) {
+        shard_remove(shard, entry);
+        shard->expirations++;
+        entry = NULL;
+    }
+    
+    if ((mode & LOOKUP_FRESH_ONLY) && (!entry || now >= entry->fresh_until)) {
+        return NULL;
+    }
+    
+    if (!entry) {
+        shard->misses++;
+        return NULL;
+    }
+    
+    lru_unlink(shard, entry);
+    lru_push_front(shard, entry);
+    shard->hits++;
+    
+    // Sections parsed and bodies stored since the last hit grow the entry; the next insert evicts for it
+    if (entry->result->lazy || __atomic_load_n(&entry->result->bodies, __ATOMIC_RELAXED)) {
+        size_t bytes = sizeof(cache_entry_t) + strlen(entry->key) + 1 + result_bytes(entry->result);
+        shard->bytes += bytes - entry->bytes;
+        entry->bytes = bytes;
+    }
+    
+    int stale = now >= entry->fresh_until;
+    int refresh = 0;
+    if (stale) {
+        shard->stale_hits++;
+    }
+    
+    // Hand the refresh to a single caller; retry later if it does not land
+    if (now >= entry->next_refresh_at && (stale || xfetch_due(shard, entry, now))) {
+        refresh = 1;
+        entry->next_refresh_at = now + WEATHER_CACHE_REFRESH_RETRY;
+        shard->refreshes++;
+    }
+    
+    if (status) {
+        status->stale = stale;
+        status->refresh = refresh;
+        status->age = (long)(now - entry->stored_at);
+    }
+    
+    return entry;
+}
+
+static weather_result_t *cache_get(const char *key, weather_cache_status_t *status, int mode) {
+    uint64_t hash = hash_key(key);
+    cache_shard_t *shard = shard_for(hash);
+    weather_result_t *result = NULL;
+    
+    if (status) {
+        memset(status, 0, sizeof(weather_cache_status_t));
+    }
+    
+    pthread_mutex_lock(&shard->lock);
+    cache_entry_t *entry = shard_lookup(shard, hash, key, status, mode);
+    if (entry) {
+        result = weather_result_retain(entry->result);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    return result;
+}
+
+weather_result_t *weather_cache_get(const char *key, weather_cache_status_t *status) {
+    if (!cache_initialized || !key) {
+        return NULL;
+    }
+    
+    return cache_get(key, status, LOOKUP_RECORD_ACCESS);
+}
+
+/**
+ * Best fresh superset entry found so far
+ */
+typedef struct {
+    weather_result_t *result;
+    time_t stored_at;
+} superset_match_t;
+
+/**
+ * Consider a candidate key for a superset answer, keeping the most recently
+ * fetched fresh entry
+ * The candidate is touched in the LRU and sketch, since it is serving traffic.
+ */
+static void superset_probe(const char *key, time_t now, superset_match_t *match) {
+    uint64_t hash = hash_key(key);
+    cache_shard_t *shard = shard_for(hash);
+    
+    pthread_mutex_lock(&shard->lock);
+    cache_entry_t *entry = shard_find(shard, hash, key);
+    if (entry && now < entry->fresh_until && (!match->result || entry->stored_at > match->stored_at)) {
+        sketch_increment(&shard->sketch, hash);
+        lru_unlink(shard, entry);
+        lru_push_front(shard, entry);
+        
+        weather_result_release(match->result);
+        match->result = weather_result_retain(entry->result);
+        match->stored_at = entry->stored_at;
+    }
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/**
+ * Count a superset or nearby answer against the shard of the requested key
+ * @param nearby The cached point that answered, or NULL for the requested location
+ */
+static void superset_hit(const char *key, const superset_match_t *match, const weather_location_match_t *nearby,
+                         time_t now, weather_cache_status_t *status) {
+    cache_shard_t *shard = shard_for(hash_key(key));
+    pthread_mutex_lock(&shard->lock);
+    shard->hits++;
+    if (nearby) {
+        shard->nearby_hits++;
+    } else {
+        shard->superset_hits++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    if (status) {
+        memset(status, 0, sizeof(weather_cache_status_t));
+        status->age = (long)(now - match->stored_at);
+        if (nearby) {
+            strcpy(status->nearby, nearby->location);
+            status->nearby_km = nearby->distance_km;
+        }
+    }
+}
+
+/**
+ * Probe every fresh entry that can answer a current weather request
+ * @param exact Whether to probe the requested key itself
+ */
+static void probe_current(const char *canonical, int include_aqi, int exact, time_t now, superset_match_t *match) {
+    char candidate[WEATHER_CACHE_KEY_SIZE];
+    
+    for (int aqi = include_aqi ? 1 : 0; aqi <= 1; aqi++) {
+        if (exact || aqi != (include_aqi ? 1 : 0)) {
+            current_key(canonical, aqi, candidate, sizeof(candidate));
+            superset_probe(candidate, now, match);
+        }
+    }
+    
+    // Any fresh forecast for the location carries the same current block
+    for (int days = 1; days <= 14; days++) {
+        for (int aqi = include_aqi ? 1 : 0; aqi <= 1; aqi++) {
+            for (int alerts = 0; alerts <= 1; alerts++) {
+                forecast_key(canonical, days, aqi, alerts, candidate, sizeof(candidate));
+                superset_probe(candidate, now, match);
+            }
+        }
+    }
+}
+
+/**
+ * Probe every fresh entry that can answer a forecast request: more days, or
+ * more optional data
+ * @param exact Whether to probe the requested key itself
+ */
+static void probe_forecast(const char *canonical, int days, int include_aqi, int include_alerts, int exact,
+                           time_t now, superset_match_t *match) {
+    char candidate[WEATHER_CACHE_KEY_SIZE];
+    
+    for (int candidate_days = days; candidate_days <= 14; candidate_days++) {
+        for (int aqi = include_aqi ? 1 : 0; aqi <= 1; aqi++) {
+            for (int alerts = include_alerts ? 1 : 0; alerts <= 1; alerts++) {
+                if (!exact && candidate_days == days && aqi == (include_aqi ? 1 : 0) &&
+                    alerts == (include_alerts ? 1 : 0)) {
+                    continue; // The exact key, already known not to be fresh
+                }
+                forecast_key(canonical, candidate_days, aqi, alerts, candidate, sizeof(candidate));
+                superset_probe(candidate, now, match);
+            }
+        }
+    }
+}
+
+/**
+ * Build a current weather result from the current block of a forecast
+ */
+static weather_result_t *current_from_forecast(weather_result_t *forecast) {
+    if (weather_result_load(forecast, WEATHER_SECTION_CURRENT) != 0) {
+        return NULL;
+    }
+    
+    weather_result_t *result = calloc(1, sizeof(weather_result_t));
+    if (!result) {
+        return NULL;
+    }
+    
+    result->refcount = 1;
+    result->current.location = forecast->forecast.location;
+    result->current.current = forecast->forecast.current;
+    return result;
+}
+
+/**
+ * Build a view of the first days of a longer forecast, sharing its day arrays
+ */
+static weather_result_t *forecast_view(weather_result_t *forecast, int days) {
+    if (forecast->forecast.forecast_days <= days) {
+        return weather_result_retain(forecast);
+    }
+    
+    weather_result_t *result = calloc(1, sizeof(weather_result_t));
+    if (!result) {
+        return NULL;
+    }
+    
+    result->refcount = 1;
+    result->is_forecast = 1;
+    result->forecast = forecast->forecast;
+    result->forecast.forecast_days = days;
+    result->source = weather_result_retain(forecast->source ? forecast->source : forecast);
+    return result;
+}
+
+weather_result_t *weather_cache_get_current(const char *location, int include_aqi,
+                                            weather_cache_status_t *status) {
+    if (!cache_initialized || !location) {
+        return NULL;
+    }
+    
+    // Canonicalize once; the superset probes below reuse it
+    char canonical[WEATHER_LOCATION_SIZE];
+    char key[WEATHER_CACHE_KEY_SIZE];
+    weather_location_canonical(location, canonical, sizeof(canonical));
+    current_key(canonical, include_aqi, key, sizeof(key));
+    
+    weather_result_t *result = cache_get(key, status, LOOKUP_RECORD_ACCESS | LOOKUP_FRESH_ONLY);
+    if (result) {
+        return result;
+    }
+    
+    superset_match_t match = {NULL, 0};
+    time_t now = time(NULL);
+    probe_current(canonical, include_aqi, 0, now, &match);
+    
+    // A coordinate query can be answered by the nearest cached point with a fresh entry
+    weather_location_match_t nearby[WEATHER_LOCATION_NEARBY_MAX];
+    int nearby_count = match.result ? 0 : weather_location_nearby(location, canonical, nearby, WEATHER_LOCATION_NEARBY_MAX);
+    int nearest = 0;
+    for (; nearest < nearby_count; nearest++) {
+        probe_current(nearby[nearest].location, include_aqi, 1, now, &match);
+        if (match.result) {
+            break;
+        }
+    }
+    
+    if (match.result) {
+        result = match.result->is_forecast ? current_from_forecast(match.result)
+                                           : weather_result_retain(match.result);
+        if (result) {
+            superset_hit(key, &match, nearest < nearby_count ? &nearby[nearest] : NULL, now, status);
+        }
+        weather_result_release(match.result);
+        if (result) {
+            return result;
+        }
+    }
+    
+    // Fall back to the exact entry, stale or not
+    return cache_get(key, status, 0);
+}
+
+weather_result_t *weather_cache_get_forecast(const char *location, int days, int include_aqi, int include_alerts,
+                                             weather_cache_status_t *status) {
+    if (!cache_initialized || !location) {
+        return NULL;
+    }
+    
+    char canonical[WEATHER_LOCATION_SIZE];
+    char key[WEATHER_CACHE_KEY_SIZE];
+    weather_location_canonical(location, canonical, sizeof(canonical));
+    forecast_key(canonical, days, include_aqi, include_alerts, key, sizeof(key));
+    
+    weather_result_t *result = cache_get(key, status, LOOKUP_RECORD_ACCESS | LOOKUP_FRESH_ONLY);
+    if (result) {
+        return result;
+    }
+    
+    superset_match_t match = {NULL, 0};
+    time_t now = time(NULL);
+    probe_forecast(canonical, days, include_aqi, include_alerts, 0, now, &match);
+    
+    weather_location_match_t nearby[WEATHER_LOCATION_NEARBY_MAX];
+    int nearby_count = match.result ? 0 : weather_location_nearby(location, canonical, nearby, WEATHER_LOCATION_NEARBY_MAX);
+    int nearest = 0;
+    for (; nearest < nearby_count; nearest++) {
+        probe_forecast(nearby[nearest].location, days, include_aqi, include_alerts, 1, now, &match);
+        if (match.result) {
+            break;
+        }
+    }
+    
+    if (match.result) {
+        result = forecast_view(match.result, days);
+        if (result) {
+            superset_hit(key, &match, nearest < nearby_count ? &nearby[nearest] : NULL, now, status);
+        }
+        weather_result_release(match.result);
+        if (result) {
+            return result;
+        }
+    }
+    
+    return cache_get(key, status, 0);
+}
+
+/**
+ * Insert a prepared entry, evicting LRU victims the sketch ranks lower
+ * Takes ownership of the entry. Must be called with the shard lock held.
+ */
+static int shard_insert(cache_shard_t *shard, cache_entry_t *entry, int force) {
+    // Replace an existing entry for the same key unconditionally
+    cache_entry_t *existing = shard_find(shard, entry->hash, entry->key);
+    int replacing = existing != NULL;
+    if (existing) {
+        shard_remove(shard, existing);
+    }
+    
+    if (entry->bytes > shard->max_bytes) {
+        shard->rejections++;
+        entry_free(entry);
+        return -1;
+    }
+    
+    int candidate_frequency = sketch_estimate(&shard->sketch, entry->hash);
+    time_t now = time(NULL);
+    
+    while (shard->bytes + entry->bytes > shard->max_bytes && shard->lru_tail) {
+        cache_entry_t *victim = shard->lru_tail;
+        
+        if (victim->stale_until <= now) {
+            shard_remove(shard, victim);
+            shard->expirations++;
+            continue;
+        }
+        
+        // TinyLFU admission: a one-off key cannot displace a hotter one
+        if (!replacing && !force && candidate_frequency <= sketch_estimate(&shard->sketch, victim->hash)) {
+            shard->rejections++;
+            entry_free(entry);
+            return -1;
+        }
+        
+        shard_remove(shard, victim);
+        shard->evictions++;
+    }
+    
+    size_t index = entry->hash & (shard->bucket_count - 1);
+    entry->hash_next = shard->buckets[index];
+    shard->buckets[index] = entry;
+    lru_push_front(shard, entry);
+    shard->entries++;
+    shard->bytes += entry->bytes;
+    shard->inserts++;
+    entry_index(entry, 1);
+    
+    if (shard->entries > shard->bucket_count) {
+        shard_grow(shard);
+    }
+    
+    return 0;
+}
+
+/**
+ * Soft TTL: fresh until the next upstream observation is due
+ */
+static time_t fresh_until(const weather_result_t *result, time_t now) {
+    long last_updated = result->is_forecast ? result->forecast.current.last_updated_epoch
+                                            : result->current.current.last_updated_epoch;
+    
+    if (last_updated <= 0 || last_updated > now) {
+        return now + WEATHER_CACHE_UPDATE_INTERVAL;
+    }
+    
+    time_t next_update = (time_t)last_updated + WEATHER_CACHE_UPDATE_INTERVAL;
+    if (next_update < now + WEATHER_CACHE_MIN_FRESH) {
+        next_update = now + WEATHER_CACHE_MIN_FRESH;
+    }
+    return next_update;
+}
+
+/**
+ * Allocate an entry holding a new reference to a result
+ */
+static cache_entry_t *entry_create(const char *key, weather_result_t *result, double fetch_seconds) {
+    size_t key_len = strlen(key) + 1;
+    cache_entry_t *entry = calloc(1, sizeof(cache_entry_t) + key_len);
+    if (!entry) {
+        return NULL;
+    }
+    
+    memcpy(entry->key, key, key_len);
+    entry->hash = hash_key(key);
+    entry->fetch_seconds = fetch_seconds;
+    entry->bytes = sizeof(cache_entry_t) + key_len + result_bytes(result);
+    entry->result = weather_result_retain(result);
+    return entry;
+}
+
+int weather_cache_put(const char *key, weather_result_t *result, double fetch_seconds) {
+    if (!cache_initialized || !key || !result) {
+        return -1;
+    }
+    
+    cache_entry_t *entry = entry_create(key, result, fetch_seconds);
+    if (!entry) {
+        return -1;
+    }
+    
+    entry->stored_at = time(NULL);
+    entry->fresh_until = fresh_until(result, entry->stored_at);
+    entry->stale_until = entry->fresh_until + WEATHER_CACHE_STALE_SECONDS;
+    entry->next_refresh_at = entry->stored_at;
+    
+    cache_shard_t *shard = shard_for(entry->hash);
+    pthread_mutex_lock(&shard->lock);
+    int status = shard_insert(shard, entry, 0);
+    pthread_mutex_unlock(&shard->lock);
+    
+    return status;
+}
+
+/**
+ * Entry captured for writing outside the shard lock
+ */
+typedef struct {
+    char *key;
+    weather_result_t *result;
+    snapshot_record_t record;
+} snapshot_item_t;
+
+/**
+ * Snapshot being written: one record is encoded into buffer at a time
+ */
+typedef struct {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+    int failed;                     // Out of memory
+    uint8_t conditions[WEATHER_CONDITIONS_MAX / 8]; // Condition ids the records use
+} snapshot_writer_t;
+
+static void snapshot_put(snapshot_writer_t *writer, const void *bytes, size_t n) {
+    if (writer->failed) {
+        return;
+    }
+    if (n > writer->capacity - writer->length) {
+        size_t capacity = writer->capacity ? writer->capacity : 4096;
+        while (n > capacity - writer->length) {
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(writer->data, capacity);
+        if (!data) {
+            writer->failed = 1;
+            return;
+        }
+        writer->data = data;
+        writer->capacity = capacity;
+    }
+    memcpy(writer->data + writer->length, bytes, n);
+    writer->length += n;
+}
+
+static void snapshot_put_u8(snapshot_writer_t *writer, uint8_t value) {
+    snapshot_put(writer, &value, sizeof(value));
+}
+
+static void snapshot_put_u16(snapshot_writer_t *writer, uint16_t value) {
+    snapshot_put(writer, &value, sizeof(value));
+}
+
+static void snapshot_put_name(snapshot_writer_t *writer, const char *name) {
+    size_t length = strlen(name);
+    snapshot_put_u8(writer, (uint8_t)length);
+    snapshot_put(writer, name, length);
+}
+
+/**
+ * Bytes one value of a compact column takes (0 for an unknown type)
+ */
+static size_t column_width(int type) {
+    switch (type) {
+        case WEATHER_COLUMN_INT64:
+            return sizeof(int64_t);
+        case WEATHER_COLUMN_INT16:
+        case WEATHER_COLUMN_UINT16:
+            return sizeof(uint16_t);
+        case WEATHER_COLUMN_UINT8:
+        case WEATHER_COLUMN_INT8:
+            return sizeof(uint8_t);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Encode the layout: every member table, then the compact hour columns
+ */
+static void snapshot_put_layout(snapshot_writer_t *writer) {
+    for (int t = 0; t < SNAPSHOT_TABLES; t++) {
+        const weather_schema_t *schema = snapshot_schemas[t];
+        snapshot_put_u16(writer, (uint16_t)schema->count);
+        for (int i = 0; i < schema->count; i++) {
+            snapshot_put_u8(writer, schema->members[i].type);
+            snapshot_put_name(writer, schema->members[i].name);
+        }
+    }
+    
+    int count;
+    const weather_hours_field_t *fields = weather_hours_fields(&count);
+    snapshot_put_u16(writer, (uint16_t)count);
+    for (int i = 0; i < count; i++) {
+        snapshot_put_u8(writer, fields[i].column.type);
+        snapshot_put_u8(writer, fields[i].column.decimals);
+        snapshot_put_name(writer, fields[i].name);
+    }
+}
+
+static void snapshot_use_condition(snapshot_writer_t *writer, uint16_t id) {
+    writer->conditions[id / 8] |= (uint8_t)(1u << (id % 8));
+}
+
+/**
+ * Encode the members of a struct through its member table
+ */
+static void snapshot_put_members(snapshot_writer_t *writer, const weather_schema_t *schema, const void *base) {
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        const char *field = (const char *)base + member->offset;
+        switch (member->type) {
+            case WEATHER_MEMBER_STRING:
+            case WEATHER_MEMBER_TIME: {
+                size_t length = strnlen(field, member->size);
+                snapshot_put_u16(writer, (uint16_t)length);
+                snapshot_put(writer, field, length);
+                break;
+            }
+            case WEATHER_MEMBER_DOUBLE:
+                snapshot_put(writer, field, sizeof(double));
+                break;
+            case WEATHER_MEMBER_INT: {
+                int32_t value = *(const int *)field;
+                snapshot_put(writer, &value, sizeof(value));
+                break;
+            }
+            case WEATHER_MEMBER_LONG: {
+                int64_t value = *(const long *)field;
+                snapshot_put(writer, &value, sizeof(value));
+                break;
+            }
+            case WEATHER_MEMBER_CONDITION: {
+                uint16_t id = weather_condition_intern((const weather_condition_t *)field);
+                snapshot_use_condition(writer, id);
+                snapshot_put_u16(writer, id);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Encode a day's hours: the count, then each column as it is stored
+ */
+static void snapshot_put_hours(snapshot_writer_t *writer, const weather_hours_t *hours) {
+    int count = hours ? hours->count : 0;
+    snapshot_put_u8(writer, (uint8_t)count);
+    if (count == 0) {
+        return;
+    }
+    
+    int columns;
+    const weather_hours_field_t *fields = weather_hours_fields(&columns);
+    for (int i = 0; i < columns; i++) {
+        const weather_column_t *column = &fields[i].column;
+        snapshot_put(writer, (const char *)hours + column->offset, count * column_width(column->type));
+    }
+    for (int h = 0; h < count; h++) {
+        snapshot_use_condition(writer, hours->condition[h]);
+    }
+}
+
+/**
+ * Encode the payload of a cached result
+ * @return 0 on success, -1 if a retained section does not parse
+ */
+static int snapshot_put_result(snapshot_writer_t *writer, weather_result_t *result) {
+    if (!result->is_forecast) {
+        snapshot_put_members(writer, &weather_schema_location, &result->current.location);
+        snapshot_put_members(writer, &weather_schema_current, &result->current.current);
+        return 0;
+    }
+    
+    // Retained sections are parsed into the result, as the first request showing them would
+    if (weather_result_load(result, WEATHER_SECTION_ALL) != 0) {
+        return -1;
+    }
+    
+    const forecast_response_t *forecast = &result->forecast;
+    snapshot_put_members(writer, &weather_schema_location, &forecast->location);
+    snapshot_put_members(writer, &weather_schema_current, &forecast->current);
+    snapshot_put_u8(writer, (uint8_t)forecast->forecast_days);
+    for (int i = 0; i < forecast->forecast_days; i++) {
+        const forecast_daily_t *daily = &forecast->forecast[i];
+        snapshot_put_members(writer, &weather_schema_daily, daily);
+        snapshot_put_members(writer, &weather_schema_day, &daily->day);
+        snapshot_put_members(writer, &weather_schema_astro, &daily->astro);
+        snapshot_put_hours(writer, weather_result_hours(result, i));
+    }
+    return 0;
+}
+
+/**
+ * Encode the conditions the records used
+ */
+static void snapshot_put_conditions(snapshot_writer_t *writer) {
+    uint16_t count = 0;
+    for (int id = 1; id < WEATHER_CONDITIONS_MAX; id++) {
+        count += (writer->conditions[id / 8] >> (id % 8)) & 1;
+    }
+    
+    snapshot_put_u16(writer, count);
+    for (int id = 1; id < WEATHER_CONDITIONS_MAX; id++) {
+        if ((writer->conditions[id / 8] >> (id % 8)) & 1) {
+            snapshot_put_u16(writer, (uint16_t)id);
+            snapshot_put_members(writer, &weather_schema_condition, weather_condition_lookup((uint16_t)id));
+        }
+    }
+}
+
+/**
+ * Write the encoded bytes to the file and empty the buffer
+ */
+static int snapshot_flush(snapshot_writer_t *writer, FILE *file) {
+    int status = !writer->failed && fwrite(writer->data, 1, writer->length, file) == writer->length ? 0 : -1;
+    writer->length = 0;
+    return status;
+}
+
+/**
+ * Write one record
+ * @return 1 if written, 0 if the entry was skipped, -1 on a write error
+ */
+static int write_snapshot_item(FILE *file, snapshot_writer_t *writer, snapshot_item_t *item) {
+    writer->length = 0;
+    if (snapshot_put_result(writer, item->result) != 0 || writer->failed) {
+        writer->failed = 0;
+        writer->length = 0;
+        return 0;
+    }
+    
+    item->record.payload_size = writer->length;
+    if (fwrite(&item->record, sizeof(snapshot_record_t), 1, file) != 1 ||
+        fwrite(item->key, 1, item->record.key_size, file) != item->record.key_size) {
+        return -1;
+    }
+    return snapshot_flush(writer, file) == 0 ? 1 : -1;
+}
+
+int weather_cache_save(const char *path) {
+    if (!cache_initialized || !path) {
+        return -1;
+    }
+    
+    // Write to a temporary file and rename, so readers never see a partial snapshot
+    char tmp_path[1024];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    
+    snapshot_writer_t *writer = calloc(1, sizeof(snapshot_writer_t));
+    if (!writer) {
+        fprintf(stderr, "Failed to allocate snapshot writer\n");
+        return -1;
+    }
+    
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to open snapshot file %s: %s\n", tmp_path, strerror(errno));
+        free(writer);
+        return -1;
+    }
+    
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.created_at = time(NULL);
+    
+    int status = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+    if (status == 0) {
+        snapshot_put_layout(writer);
+        status = snapshot_flush(writer, file);
+    }
+    
+    for (int i = 0; i < CACHE_SHARDS && status == 0; i++) {
+        cache_shard_t *shard = &cache_shards[i];
+        
+        // Capture references under the lock, write without it
+        pthread_mutex_lock(&shard->lock);
+        size_t count = shard->entries;
+        snapshot_item_t *items = calloc(count > 0 ? count : 1, sizeof(snapshot_item_t));
+        size_t captured = 0;
+        if (items) {
+            // Least recently used first, so loading with push-front restores the order
+            for (cache_entry_t *entry = shard->lru_tail; entry && captured < count; entry = entry->lru_prev) {
+                snapshot_item_t *item = &items[captured];
+                item->key = strdup(entry->key);
+                if (!item->key) {
+                    break;
+                }
+                item->result = weather_result_retain(entry->result);
+                item->record.key_size = (uint32_t)strlen(entry->key) + 1;
+                item->record.is_forecast = (uint32_t)entry->result->is_forecast;
+                item->record.stored_at = entry->stored_at;
+                item->record.fresh_until = entry->fresh_until;
+                item->record.stale_until = entry->stale_until;
+                item->record.fetch_seconds = entry->fetch_seconds;
+                captured++;
+            }
+        }
+        pthread_mutex_unlock(&shard->lock);
+        
+        if (!items) {
+            status = -1;
+            break;
+        }
+        
+        for (size_t j = 0; j < captured; j++) {
+            int written = status == 0 ? write_snapshot_item(file, writer, &items[j]) : 0;
+            if (written < 0) {
+                status = -1;
+            }
+            header.entry_count += written > 0;
+            weather_result_release(items[j].result);
+            free(items[j].key);
+        }
+        free(items);
+    }
+    
+    // Conditions follow the records, so every id they use is known
+    if (status == 0) {
+        long offset = ftell(file);
+        header.conditions_offset = offset > 0 ? (uint64_t)offset : 0;
+        snapshot_put_conditions(writer);
+        status = offset > 0 ? snapshot_flush(writer, file) : -1;
+    }
+    free(writer->data);
+    free(writer);
+    
+    // Patch the entry count and condition table offset into the header
+    if (status == 0 && (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)) {
+        status = -1;
+    }
+    if (status == 0 && (fflush(file) != 0 || fsync(fileno(file)) != 0)) {
+        status = -1;
+    }
+    if (fclose(file) != 0) {
+        status = -1;
+    }
+    
+    if (status != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to write snapshot file %s: %s\n", path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    
+    return (int)header.entry_count;
+}
+
+/**
+ * Bounds-checked cursor over part of a mapped snapshot
+ */
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t offset;
+    int failed;                     // Read past the end or found a malformed value
+} snapshot_reader_t;
+
+static const void *snapshot_take(snapshot_reader_t *reader, size_t n) {
+    if (reader->failed || n > reader->length - reader->offset) {
+        reader->failed = 1;
+        return NULL;
+    }
+    const void *bytes = reader->data + reader->offset;
+    reader->offset += n;
+    return bytes;
+}
+
+static uint8_t snapshot_get_u8(snapshot_reader_t *reader) {
+    const uint8_t *bytes = snapshot_take(reader, sizeof(uint8_t));
+    return bytes ? *bytes : 0;
+}
+
+static uint16_t snapshot_get_u16(snapshot_reader_t *reader) {
+    uint16_t value = 0;
+    const void *bytes = snapshot_take(reader, sizeof(value));
+    if (bytes) {
+        memcpy(&value, bytes, sizeof(value));
+    }
+    return value;
+}
+
+/**
+ * A member as the snapshot stores it, and where it goes in this build
+ */
+typedef struct {
+    uint8_t type;                   // weather_member_type_t in the file
+    const weather_member_t *target; // Member of the same name and type, NULL to skip
+} snapshot_member_t;
+
+/**
+ * A compact hour column as the snapshot stores it, and where it goes in this build
+ */
+typedef struct {
+    uint8_t type;                   // weather_column_type_t in the file
+    uint8_t decimals;
+    const weather_column_t *target; // Column of the same name, NULL to skip
+} snapshot_column_t;
+
+/**
+ * Layout of a snapshot mapped onto this build's member tables
+ */
+typedef struct {
+    snapshot_member_t *members[SNAPSHOT_TABLES];
+    int member_count[SNAPSHOT_TABLES];
+    snapshot_column_t *columns;
+    int column_count;
+    uint16_t conditions[WEATHER_CONDITIONS_MAX]; // Condition id in the file -> id here
+} snapshot_layout_t;
+
+static void snapshot_layout_free(snapshot_layout_t *layout) {
+    for (int t = 0; t < SNAPSHOT_TABLES; t++) {
+        free(layout->members[t]);
+    }
+    free(layout->columns);
+    free(layout);
+}
+
+/**
+ * Check a name read from the layout against a C string
+ */
+static int snapshot_name_is(snapshot_reader_t *reader, const unsigned char *name, size_t length, const char *expected) {
+    return !reader->failed && strlen(expected) == length && memcmp(name, expected, length) == 0;
+}
+
+/**
+ * Read the layout and match its members and columns by name
+ * @return Layout to free with snapshot_layout_free(), or NULL if it is malformed
+ */
+static snapshot_layout_t *snapshot_get_layout(snapshot_reader_t *reader) {
+    snapshot_layout_t *layout = calloc(1, sizeof(snapshot_layout_t));
+    if (!layout) {
+        return NULL;
+    }
+    
+    for (int t = 0; t < SNAPSHOT_TABLES && !reader->failed; t++) {
+        const weather_schema_t *schema = snapshot_schemas[t];
+        int count = snapshot_get_u16(reader);
+        layout->members[t] = calloc(count > 0 ? count : 1, sizeof(snapshot_member_t));
+        if (!layout->members[t]) {
+            reader->failed = 1;
+            break;
+        }
+        layout->member_count[t] = count;
+        
+        for (int i = 0; i < count && !reader->failed; i++) {
+            snapshot_member_t *member = &layout->members[t][i];
+            member->type = snapshot_get_u8(reader);
+            size_t length = snapshot_get_u8(reader);
+            const unsigned char *name = snapshot_take(reader, length);
+            if (member->type > WEATHER_MEMBER_CONDITION) {
+                reader->failed = 1; // Cannot be skipped without knowing its size
+            }
+            for (int j = 0; j < schema->count; j++) {
+                const weather_member_t *target = &schema->members[j];
+                if (target->type == member->type && snapshot_name_is(reader, name, length, target->name)) {
+                    member->target = target;
+                    break;
+                }
+            }
+        }
+    }
+    
+    int fields_count;
+    const weather_hours_field_t *fields = weather_hours_fields(&fields_count);
+    int count = reader->failed ? 0 : snapshot_get_u16(reader);
+    layout->columns = calloc(count > 0 ? count : 1, sizeof(snapshot_column_t));
+    layout->column_count = count;
+    if (!layout->columns) {
+        reader->failed = 1;
+    }
+    for (int i = 0; i < count && !reader->failed; i++) {
+        snapshot_column_t *column = &layout->columns[i];
+        column->type = snapshot_get_u8(reader);
+        column->decimals = snapshot_get_u8(reader);
+        size_t length = snapshot_get_u8(reader);
+        const unsigned char *name = snapshot_take(reader, length);
+        if (column_width(column->type) == 0) {
+            reader->failed = 1;
+        }
+        for (int j = 0; j < fields_count; j++) {
+            if (snapshot_name_is(reader, name, length, fields[j].name)) {
+                column->target = &fields[j].column;
+                break;
+            }
+        }
+    }
+    
+    if (reader->failed) {
+        snapshot_layout_free(layout);
+        return NULL;
+    }
+    return layout;
+}
+
+/**
+ * Decode the members of a struct written with one of the layout's tables
+ * Members this build does not have are skipped; strings are cut to fit and
+ * always terminated.
+ */
+static void snapshot_get_members(snapshot_reader_t *reader, const snapshot_layout_t *layout, int table, void *base) {
+    for (int i = 0; i < layout->member_count[table] && !reader->failed; i++) {
+        const snapshot_member_t *member = &layout->members[table][i];
+        char *field = member->target ? (char *)base + member->target->offset : NULL;
+        switch (member->type) {
+            case WEATHER_MEMBER_STRING:
+            case WEATHER_MEMBER_TIME: {
+                size_t length = snapshot_get_u16(reader);
+                const void *bytes = snapshot_take(reader, length);
+                if (field && bytes) {
+                    size_t size = length < member->target->size ? length : member->target->size - 1u;
+                    memcpy(field, bytes, size);
+                    field[size] = '\0';
+                }
+                break;
+            }
+            case WEATHER_MEMBER_DOUBLE: {
+                const void *bytes = snapshot_take(reader, sizeof(double));
+                if (field && bytes) {
+                    memcpy(field, bytes, sizeof(double));
+                }
+                break;
+            }
+            case WEATHER_MEMBER_INT: {
+                int32_t value = 0;
+                const void *bytes = snapshot_take(reader, sizeof(value));
+                if (field && bytes) {
+                    memcpy(&value, bytes, sizeof(value));
+                    *(int *)field = value;
+                }
+                break;
+            }
+            case WEATHER_MEMBER_LONG: {
+                int64_t value = 0;
+                const void *bytes = snapshot_take(reader, sizeof(value));
+                if (field && bytes) {
+                    memcpy(&value, bytes, sizeof(value));
+                    *(long *)field = (long)value;
+                }
+                break;
+            }
+            case WEATHER_MEMBER_CONDITION: {
+                uint16_t id = snapshot_get_u16(reader);
+                if (field) {
+                    *(weather_condition_t *)field =
+                        *weather_condition_lookup(id < WEATHER_CONDITIONS_MAX ? layout->conditions[id] : 0);
+                }
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Read one value of a compact column
+ */
+static long long column_get(const unsigned char *bytes, int type) {
+    switch (type) {
+        case WEATHER_COLUMN_INT64: {
+            int64_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+        case WEATHER_COLUMN_INT16: {
+            int16_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+        case WEATHER_COLUMN_UINT16: {
+            uint16_t value;
+            memcpy(&value, bytes, sizeof(value));
+            return value;
+        }
+        case WEATHER_COLUMN_INT8:
+            return (int8_t)*bytes;
+        default:
+            return *bytes;
+    }
+}
+
+/**
+ * Store one value into a compact column, saturating at its range
+ */
+static void column_set(weather_hours_t *hours, const weather_column_t *column, int index, long long value) {
+    char *base = (char *)hours + column->offset;
+    switch (column->type) {
+        case WEATHER_COLUMN_INT64:
+            ((int64_t *)base)[index] = value;
+            break;
+        case WEATHER_COLUMN_INT16:
+            ((int16_t *)base)[index] = (int16_t)(value < INT16_MIN ? INT16_MIN : value > INT16_MAX ? INT16_MAX : value);
+            break;
+        case WEATHER_COLUMN_UINT16:
+            ((uint16_t *)base)[index] = (uint16_t)(value < 0 ? 0 : value > UINT16_MAX ? UINT16_MAX : value);
+            break;
+        case WEATHER_COLUMN_INT8:
+            ((int8_t *)base)[index] = (int8_t)(value < INT8_MIN ? INT8_MIN : value > INT8_MAX ? INT8_MAX : value);
+            break;
+        default:
+            ((uint8_t *)base)[index] = (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+            break;
+    }
+}
+
+/**
+ * Decode a day's hours into its compact columns
+ * A column stored as this build stores it is copied as is; one whose type or
+ * precision changed is converted value by value.
+ */
+static void snapshot_get_hours(snapshot_reader_t *reader, const snapshot_layout_t *layout, weather_hours_t *hours) {
+    int count = snapshot_get_u8(reader);
+    if (count > WEATHER_HOURS_MAX) {
+        reader->failed = 1;
+        return;
+    }
+    
+    for (int i = 0; i < layout->column_count && !reader->failed && count > 0; i++) {
+        const snapshot_column_t *column = &layout->columns[i];
+        size_t width = column_width(column->type);
+        const unsigned char *bytes = snapshot_take(reader, count * width);
+        const weather_column_t *target = column->target;
+        if (!bytes || !target) {
+            continue;
+        }
+        
+        int is_condition = target->offset == offsetof(weather_hours_t, condition);
+        if (target->type == column->type && target->decimals == column->decimals && !is_condition) {
+            memcpy((char *)hours + target->offset, bytes, count * width);
+            continue;
+        }
+        for (int h = 0; h < count; h++) {
+            long long value = column_get(bytes + h * width, column->type);
+            if (is_condition) {
+                value = value >= 0 && value < WEATHER_CONDITIONS_MAX ? layout->conditions[value] : 0;
+            }
+            for (int d = column->decimals; d < target->decimals; d++) {
+                value *= 10;
+            }
+            for (int d = target->decimals; d < column->decimals; d++) {
+                value = (value + (value < 0 ? -5 : 5)) / 10;
+            }
+            column_set(hours, target, h, value);
+        }
+    }
+    hours->count = count;
+}
+
+/**
+ * Read the condition table and intern each condition
+ */
+static int snapshot_get_conditions(snapshot_reader_t *reader, snapshot_layout_t *layout) {
+    int count = snapshot_get_u16(reader);
+    for (int i = 0; i < count && !reader->failed; i++) {
+        uint16_t id = snapshot_get_u16(reader);
+        weather_condition_t condition;
+        memset(&condition, 0, sizeof(condition));
+        snapshot_get_members(reader, layout, SNAPSHOT_CONDITION, &condition);
+        if (!reader->failed && id < WEATHER_CONDITIONS_MAX) {
+            layout->conditions[id] = weather_condition_intern(&condition);
+        }
+    }
+    return reader->failed ? -1 : 0;
+}
+
+/**
+ * Rebuild a result from a snapshot payload
+ * @return New result with one reference, or NULL if the payload is malformed
+ */
+static weather_result_t *load_snapshot_result(const snapshot_record_t *record, const unsigned char *payload,
+                                              const snapshot_layout_t *layout) {
+    snapshot_reader_t reader = {payload, (size_t)record->payload_size, 0, 0};
+    weather_result_t *result = calloc(1, sizeof(weather_result_t));
+    if (!result) {
+        return NULL;
+    }
+    result->refcount = 1;
+    result->is_forecast = record->is_forecast ? 1 : 0;
+    
+    if (!result->is_forecast) {
+        snapshot_get_members(&reader, layout, SNAPSHOT_LOCATION, &result->current.location);
+        snapshot_get_members(&reader, layout, SNAPSHOT_CURRENT, &result->current.current);
+        if (reader.failed) {
+            weather_result_release(result);
+            return NULL;
+        }
+        return result;
+    }
+    
+    forecast_response_t *forecast = &result->forecast;
+    snapshot_get_members(&reader, layout, SNAPSHOT_LOCATION, &forecast->location);
+    snapshot_get_members(&reader, layout, SNAPSHOT_CURRENT, &forecast->current);
+    int days = snapshot_get_u8(&reader);
+    if (reader.failed || days > WEATHER_BODY_DAYS) {
+        weather_result_release(result);
+        return NULL;
+    }
+    
+    if (days > 0) {
+        // One arena for the days and their hours, as the parser builds them
+        weather_arena_t *arena = weather_arena_create(WEATHER_ARENA_SIZE(days * sizeof(forecast_daily_t)) +
+                                                      WEATHER_ARENA_SIZE(days * sizeof(weather_hours_t)));
+        forecast->forecast = weather_arena_alloc(arena, days * sizeof(forecast_daily_t));
+        result->hours = weather_arena_alloc(arena, days * sizeof(weather_hours_t));
+        if (!forecast->forecast || !result->hours) {
+            weather_arena_free(arena);
+            forecast->forecast = NULL;
+            result->hours = NULL;
+            weather_result_release(result);
+            return NULL;
+        }
+        memset(forecast->forecast, 0, days * sizeof(forecast_daily_t));
+        memset(result->hours, 0, days * sizeof(weather_hours_t));
+        forecast->forecast_days = days;
+    }
+    
+    for (int i = 0; i < days && !reader.failed; i++) {
+        forecast_daily_t *daily = &forecast->forecast[i];
+        snapshot_get_members(&reader, layout, SNAPSHOT_DAILY, daily);
+        snapshot_get_members(&reader, layout, SNAPSHOT_DAY, &daily->day);
+        snapshot_get_members(&reader, layout, SNAPSHOT_ASTRO, &daily->astro);
+        snapshot_get_hours(&reader, layout, &result->hours[i]);
+    }
+    
+    if (reader.failed) {
+        weather_result_release(result);
+        return NULL;
+    }
+    return result;
+}
+
+int weather_cache_load(const char *path) {
+    if (!cache_initialized || !path) {
+        return -1;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open snapshot file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshot_header_t)) {
+        fprintf(stderr, "Snapshot file %s is too small\n", path);
+        close(fd);
+        return -1;
+    }
+    
+    size_t size = (size_t)st.st_size;
+    const unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Failed to map snapshot file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    
+    snapshot_header_t header;
+    memcpy(&header, data, sizeof(header));
+    snapshot_reader_t reader = {data, size, sizeof(header), 0};
+    snapshot_layout_t *layout = NULL;
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+        header.version == SNAPSHOT_VERSION &&
+        header.byte_order == SNAPSHOT_BYTE_ORDER &&
+        header.conditions_offset >= sizeof(header) && header.conditions_offset < size) {
+        layout = snapshot_get_layout(&reader);
+    }
+    
+    // The condition table follows the records; read it first to map their ids
+    snapshot_reader_t conditions = {data, size, (size_t)header.conditions_offset, 0};
+    if (!layout || snapshot_get_conditions(&conditions, layout) != 0) {
+        fprintf(stderr, "Snapshot file %s has an incompatible format, ignoring it\n", path);
+        if (layout) {
+            snapshot_layout_free(layout);
+        }
+        munmap((void *)data, size);
+        return -1;
+    }
+    
+    time_t now = time(NULL);
+    size_t end = (size_t)header.conditions_offset;
+    size_t offset = reader.offset;
+    int loaded = 0;
+    
+    for (uint64_t n = 0; n < header.entry_count; n++) {
+        if (offset + sizeof(snapshot_record_t) > end) {
+            break;
+        }
+        
+        snapshot_record_t record;
+        memcpy(&record, data + offset, sizeof(record));
+        size_t key_offset = offset + sizeof(snapshot_record_t);
+        size_t payload_offset = key_offset + record.key_size;
+        if (record.key_size == 0 || record.key_size > WEATHER_CACHE_KEY_SIZE ||
+            record.payload_size > end || payload_offset + record.payload_size > end) {
+            break; // Truncated or corrupt: keep what was loaded so far
+        }
+        offset = payload_offset + record.payload_size;
+        
+        const char *key = (const char *)(data + key_offset);
+        if (key[record.key_size - 1] != '\0' || record.stale_until <= now) {
+            continue; // Malformed key or past the hard TTL
+        }
+        
+        weather_result_t *result = load_snapshot_result(&record, data + payload_offset, layout);
+        if (!result) {
+            continue;
+        }
+        
+        cache_entry_t *entry = entry_create(key, result, record.fetch_seconds);
+        weather_result_release(result);
+        if (!entry) {
+            continue;
+        }
+        entry->stored_at = (time_t)record.stored_at;
+        entry->fresh_until = (time_t)record.fresh_until;
+        entry->stale_until = (time_t)record.stale_until;
+        entry->next_refresh_at = now;
+        
+        // Warm entries bypass admission; give each one sighting in the sketch
+        cache_shard_t *shard = shard_for(entry->hash);
+        pthread_mutex_lock(&shard->lock);
+        sketch_increment(&shard->sketch, entry->hash);
+        if (shard_insert(shard, entry, 1) == 0) {
+            loaded++;
+        }
+        pthread_mutex_unlock(&shard->lock);
+    }
+    
+    snapshot_layout_free(layout);
+    munmap((void *)data, size);
+    return loaded;
+}
+
+void weather_cache_get_stats(weather_cache_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    memset(stats, 0, sizeof(weather_cache_stats_t));
+    if (!cache_initialized) {
+        return;
+    }
+    
+    for (int i = 0; i < CACHE_SHARDS; i++) {
+        cache_shard_t *shard = &cache_shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->stale_hits += shard->stale_hits;
+        stats->superset_hits += shard->superset_hits;
+        stats->nearby_hits += shard->nearby_hits;
+        stats->refreshes += shard->refreshes;
+        stats->inserts += shard->inserts;
+        stats->rejections += shard->rejections;
+        stats->evictions += shard->evictions;
+        stats->expirations += shard->expirations;
+        stats->entries += shard->entries;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+    stats->max_bytes = cache_max_bytes;
+}
@@ -0,0 +1,453 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "weather_compact.h"
+#include "weather_fields.h"
+
+#define CONDITION_BLOCK 64                              // Entries allocated together
+#define CONDITION_BLOCKS (WEATHER_CONDITIONS_MAX / CONDITION_BLOCK)
+#define CONDITION_INDEX_SIZE (2 * WEATHER_CONDITIONS_MAX) // Open addressing, power of two
+
+#define WIND_DIR_UNKNOWN 0xFF
+#define UTC_OFFSET_UNKNOWN INT8_MIN                     // Time string did not parse
+
+static const char *wind_dir_names[] = {
+    "N", "NNE", "NE", "ENE", "E", "ESE", "SE", "SSE",
+    "S", "SSW", "SW", "WSW", "W", "WNW", "NW", "NNW"
+};
+
+// Shared condition table; entries are immutable once published by condition_count
+static const weather_condition_t empty_condition;
+static weather_condition_t *condition_blocks[CONDITION_BLOCKS];
+static uint16_t condition_count = 1;                    // Id 0 is the empty condition
+static uint16_t condition_index[CONDITION_INDEX_SIZE];  // Ids by hash, 0 = free
+static pthread_mutex_t condition_lock = PTHREAD_MUTEX_INITIALIZER;
+static int condition_table_full = 0;
+
+static uint32_t condition_hash(const weather_condition_t *condition) {
+    uint32_t hash = 2166136261u ^ (uint32_t)condition->code;
+    for (const char *s = condition->text; *s; s++) {
+        hash = (hash ^ (unsigned char)*s) * 16777619u;
+    }
+    for (const char *s = condition->icon; *s; s++) {
+        hash = (hash ^ (unsigned char)*s) * 16777619u;
+    }
+    return hash;
+}
+
+static const weather_condition_t *condition_entry(uint16_t id) {
+    return &condition_blocks[id / CONDITION_BLOCK][id % CONDITION_BLOCK];
+}
+
+uint16_t weather_condition_intern(const weather_condition_t *condition) {
+    if (!condition || (condition->code == 0 && !condition->text[0] && !condition->icon[0])) {
+        return 0;
+    }
+    
+    uint32_t slot = condition_hash(condition) & (CONDITION_INDEX_SIZE - 1);
+    uint16_t id = 0;
+    
+    pthread_mutex_lock(&condition_lock);
+    while (condition_index[slot]) {
+        const weather_condition_t *entry = condition_entry(condition_index[slot]);
+        if (entry->code == condition->code && strcmp(entry->text, condition->text) == 0 &&
+            strcmp(entry->icon, condition->icon) == 0) {
+            id = condition_index[slot];
+            break;
+        }
+        slot = (slot + 1) & (CONDITION_INDEX_SIZE - 1);
+    }
+    
+    if (!id && condition_count < WEATHER_CONDITIONS_MAX) {
+        int block = condition_count / CONDITION_BLOCK;
+        if (!condition_blocks[block]) {
+            condition_blocks[block] = calloc(CONDITION_BLOCK, sizeof(weather_condition_t));
+        }
+        if (condition_blocks[block]) {
+            id = condition_count;
+            condition_blocks[block][id % CONDITION_BLOCK] = *condition;
+            condition_index[slot] = id;
+            __atomic_store_n(&condition_count, (uint16_t)(id + 1), __ATOMIC_RELEASE);
+        }
+    }
+    
+    if (!id && !condition_table_full) {
+        fprintf(stderr, "Condition table full; further conditions are dropped\n");
+        condition_table_full = 1;
+    }
+    pthread_mutex_unlock(&condition_lock);
+    return id;
+}
+
+const weather_condition_t *weather_condition_lookup(uint16_t id) {
+    if (id == 0 || id >= __atomic_load_n(&condition_count, __ATOMIC_ACQUIRE)) {
+        return &empty_condition;
+    }
+    return condition_entry(id);
+}
+
+/**
+ * Days since 1970-01-01 of a proleptic Gregorian date
+ */
+static long days_from_civil(long year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civil_from_days(long days, long *year, int *month, int *day) {
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    long doe = days - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+/**
+ * Offset of a local "YYYY-MM-DD HH:MM" time from its epoch, in quarter hours
+ */
+static int8_t utc_offset_of(const char *time, long time_epoch) {
+    long year;
+    int month, day, hour, minute;
+    if (sscanf(time, "%ld-%d-%d %d:%d", &year, &month, &day, &hour, &minute) != 5) {
+        return UTC_OFFSET_UNKNOWN;
+    }
+    
+    long local = days_from_civil(year, month, day) * 86400 + hour * 3600L + minute * 60L;
+    long offset = local - time_epoch;
+    if (offset % 900 != 0 || offset / 900 <= INT8_MIN || offset / 900 > INT8_MAX) {
+        return UTC_OFFSET_UNKNOWN;
+    }
+    return (int8_t)(offset / 900);
+}
+
+static uint8_t wind_dir_index(const char *name) {
+    for (size_t i = 0; i < sizeof(wind_dir_names) / sizeof(wind_dir_names[0]); i++) {
+        if (strcmp(wind_dir_names[i], name) == 0) {
+            return (uint8_t)i;
+        }
+    }
+    return WIND_DIR_UNKNOWN;
+}
+
+/**
+ * Scale and round a value, saturating at the field's range
+ */
+static long scaled(double value, double scale, long min, long max) {
+    double v = round(value * scale);
+    return v <= (double)min ? min : v >= (double)max ? max : (long)v;
+}
+
+static uint8_t clamp_u8(int value) {
+    return (uint8_t)(value < 0 ? 0 : value > UINT8_MAX ? UINT8_MAX : value);
+}
+
+int weather_hours_append(weather_hours_t *hours, const forecast_hour_t *hour) {
+    if (hours->count == WEATHER_HOURS_MAX) {
+        return -1;
+    }
+    
+    int i = hours->count++;
+    hours->time_epoch[i] = hour->time_epoch;
+    hours->utc_offset[i] = utc_offset_of(hour->time, hour->time_epoch);
+    hours->temp_c[i] = (int16_t)scaled(hour->temp_c, 10, INT16_MIN, INT16_MAX);
+    hours->feelslike_c[i] = (int16_t)scaled(hour->feelslike_c, 10, INT16_MIN, INT16_MAX);
+    hours->windchill_c[i] = (int16_t)scaled(hour->windchill_c, 10, INT16_MIN, INT16_MAX);
+    hours->heatindex_c[i] = (int16_t)scaled(hour->heatindex_c, 10, INT16_MIN, INT16_MAX);
+    hours->dewpoint_c[i] = (int16_t)scaled(hour->dewpoint_c, 10, INT16_MIN, INT16_MAX);
+    hours->temp_f[i] = (int16_t)scaled(hour->temp_f, 10, INT16_MIN, INT16_MAX);
+    hours->feelslike_f[i] = (int16_t)scaled(hour->feelslike_f, 10, INT16_MIN, INT16_MAX);
+    hours->windchill_f[i] = (int16_t)scaled(hour->windchill_f, 10, INT16_MIN, INT16_MAX);
+    hours->heatindex_f[i] = (int16_t)scaled(hour->heatindex_f, 10, INT16_MIN, INT16_MAX);
+    hours->dewpoint_f[i] = (int16_t)scaled(hour->dewpoint_f, 10, INT16_MIN, INT16_MAX);
+    hours->wind_kph[i] = (uint16_t)scaled(hour->wind_kph, 10, 0, UINT16_MAX);
+    hours->gust_kph[i] = (uint16_t)scaled(hour->gust_kph, 10, 0, UINT16_MAX);
+    hours->wind_mph[i] = (uint16_t)scaled(hour->wind_mph, 10, 0, UINT16_MAX);
+    hours->gust_mph[i] = (uint16_t)scaled(hour->gust_mph, 10, 0, UINT16_MAX);
+    hours->pressure_mb[i] = (uint16_t)scaled(hour->pressure_mb, 10, 0, UINT16_MAX);
+    hours->pressure_in[i] = (uint16_t)scaled(hour->pressure_in, 100, 0, UINT16_MAX);
+    hours->precip_mm[i] = (uint16_t)scaled(hour->precip_mm, 100, 0, UINT16_MAX);
+    hours->precip_in[i] = (uint16_t)scaled(hour->precip_in, 100, 0, UINT16_MAX);
+    hours->vis_km[i] = (uint16_t)scaled(hour->vis_km, 10, 0, UINT16_MAX);
+    hours->vis_miles[i] = (uint16_t)scaled(hour->vis_miles, 10, 0, UINT16_MAX);
+    hours->uv[i] = (uint16_t)scaled(hour->uv, 10, 0, UINT16_MAX);
+    hours->wind_degree[i] = (uint16_t)scaled(hour->wind_degree, 1, 0, UINT16_MAX);
+    hours->condition[i] = weather_condition_intern(&hour->condition);
+    hours->wind_dir[i] = wind_dir_index(hour->wind_dir);
+    hours->is_day[i] = clamp_u8(hour->is_day);
+    hours->humidity[i] = clamp_u8(hour->humidity);
+    hours->cloud[i] = clamp_u8(hour->cloud);
+    hours->will_it_rain[i] = clamp_u8(hour->will_it_rain);
+    hours->chance_of_rain[i] = clamp_u8(hour->chance_of_rain);
+    hours->will_it_snow[i] = clamp_u8(hour->will_it_snow);
+    hours->chance_of_snow[i] = clamp_u8(hour->chance_of_snow);
+    return 0;
+}
+
+const weather_hours_t *weather_result_hours(const weather_result_t *result, int day) {
+    const weather_result_t *owner = result->source ? result->source : result;
+    if (!owner->hours || day < 0 || day >= result->forecast.forecast_days || owner->hours[day].count == 0) {
+        return NULL;
+    }
+    return &owner->hours[day];
+}
+
+/**
+ * Write a number as a fixed count of digits, zero padded
+ */
+static char *put_digits(char *p, long value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    return p + digits;
+}
+
+void weather_hours_time(const weather_hours_t *hours, int index, char *buffer, size_t size) {
+    if (hours->utc_offset[index] == UTC_OFFSET_UNKNOWN) {
+        snprintf(buffer, size, "%s", "");
+        return;
+    }
+    
+    long local = (long)hours->time_epoch[index] + hours->utc_offset[index] * 900L;
+    long days = local >= 0 ? local / 86400 : -((-local + 86399) / 86400);
+    long seconds = local - days * 86400;
+    long year;
+    int month, day;
+    civil_from_days(days, &year, &month, &day);
+    if (year < 0 || year > 9999 || size < sizeof("YYYY-MM-DD HH:MM")) {
+        snprintf(buffer, size, "%04ld-%02d-%02d %02ld:%02ld", year, month, day, seconds / 3600, seconds % 3600 / 60);
+        return;
+    }
+    
+    // Written by hand: this runs for every hour of every forecast body
+    char *p = put_digits(buffer, year, 4);
+    *p++ = '-';
+    p = put_digits(p, month, 2);
+    *p++ = '-';
+    p = put_digits(p, day, 2);
+    *p++ = ' ';
+    p = put_digits(p, seconds / 3600, 2);
+    *p++ = ':';
+    p = put_digits(p, seconds % 3600 / 60, 2);
+    *p = '\0';
+}
+
+const char *weather_wind_dir_name(uint8_t index) {
+    return index < sizeof(wind_dir_names) / sizeof(wind_dir_names[0]) ? wind_dir_names[index] : "";
+}
+
+void weather_hours_get_member(const weather_hours_t *hours, int index, size_t offset, forecast_hour_t *hour) {
+    switch (offset) {
+        case offsetof(forecast_hour_t, time_epoch):
+            hour->time_epoch = (long)hours->time_epoch[index];
+            break;
+        case offsetof(forecast_hour_t, time):
+            weather_hours_time(hours, index, hour->time, sizeof(hour->time));
+            break;
+        case offsetof(forecast_hour_t, temp_c):
+            hour->temp_c = hours->temp_c[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, temp_f):
+            hour->temp_f = hours->temp_f[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, is_day):
+            hour->is_day = hours->is_day[index];
+            break;
+        case offsetof(forecast_hour_t, condition):
+            hour->condition = *weather_condition_lookup(hours->condition[index]);
+            break;
+        case offsetof(forecast_hour_t, wind_mph):
+            hour->wind_mph = hours->wind_mph[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, wind_kph):
+            hour->wind_kph = hours->wind_kph[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, wind_degree):
+            hour->wind_degree = hours->wind_degree[index];
+            break;
+        case offsetof(forecast_hour_t, wind_dir):
+            // Names are at most 3 characters, so this always fits
+            strcpy(hour->wind_dir, weather_wind_dir_name(hours->wind_dir[index]));
+            break;
+        case offsetof(forecast_hour_t, pressure_mb):
+            hour->pressure_mb = hours->pressure_mb[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, pressure_in):
+            hour->pressure_in = hours->pressure_in[index] / 100.0;
+            break;
+        case offsetof(forecast_hour_t, precip_mm):
+            hour->precip_mm = hours->precip_mm[index] / 100.0;
+            break;
+        case offsetof(forecast_hour_t, precip_in):
+            hour->precip_in = hours->precip_in[index] / 100.0;
+            break;
+        case offsetof(forecast_hour_t, humidity):
+            hour->humidity = hours->humidity[index];
+            break;
+        case offsetof(forecast_hour_t, cloud):
+            hour->cloud = hours->cloud[index];
+            break;
+        case offsetof(forecast_hour_t, feelslike_c):
+            hour->feelslike_c = hours->feelslike_c[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, feelslike_f):
+            hour->feelslike_f = hours->feelslike_f[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, windchill_c):
+            hour->windchill_c = hours->windchill_c[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, windchill_f):
+            hour->windchill_f = hours->windchill_f[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, heatindex_c):
+            hour->heatindex_c = hours->heatindex_c[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, heatindex_f):
+            hour->heatindex_f = hours->heatindex_f[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, dewpoint_c):
+            hour->dewpoint_c = hours->dewpoint_c[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, dewpoint_f):
+            hour->dewpoint_f = hours->dewpoint_f[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, will_it_rain):
+            hour->will_it_rain = hours->will_it_rain[index];
+            break;
+        case offsetof(forecast_hour_t, chance_of_rain):
+            hour->chance_of_rain = hours->chance_of_rain[index];
+            break;
+        case offsetof(forecast_hour_t, will_it_snow):
+            hour->will_it_snow = hours->will_it_snow[index];
+            break;
+        case offsetof(forecast_hour_t, chance_of_snow):
+            hour->chance_of_snow = hours->chance_of_snow[index];
+            break;
+        case offsetof(forecast_hour_t, vis_km):
+            hour->vis_km = hours->vis_km[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, vis_miles):
+            hour->vis_miles = hours->vis_miles[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, gust_mph):
+            hour->gust_mph = hours->gust_mph[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, gust_kph):
+            hour->gust_kph = hours->gust_kph[index] / 10.0;
+            break;
+        case offsetof(forecast_hour_t, uv):
+            hour->uv = hours->uv[index] / 10.0;
+            break;
+    }
+}
+
+/**
+ * Every column of weather_hours_t, in layout order: X(name, type, decimals)
+ * Columns of hour members are named after the member. condition,
+ * utc_offset and wind_dir hold encoded values and are not returned by
+ * weather_hours_column().
+ */
+#define HOURS_COLUMNS(X) \
+    X(time_epoch, INT64, 0) \
+    X(temp_c, INT16, 1) \
+    X(feelslike_c, INT16, 1) \
+    X(windchill_c, INT16, 1) \
+    X(heatindex_c, INT16, 1) \
+    X(dewpoint_c, INT16, 1) \
+    X(temp_f, INT16, 1) \
+    X(feelslike_f, INT16, 1) \
+    X(windchill_f, INT16, 1) \
+    X(heatindex_f, INT16, 1) \
+    X(dewpoint_f, INT16, 1) \
+    X(wind_kph, UINT16, 1) \
+    X(gust_kph, UINT16, 1) \
+    X(wind_mph, UINT16, 1) \
+    X(gust_mph, UINT16, 1) \
+    X(pressure_mb, UINT16, 1) \
+    X(pressure_in, UINT16, 2) \
+    X(precip_mm, UINT16, 2) \
+    X(precip_in, UINT16, 2) \
+    X(vis_km, UINT16, 1) \
+    X(vis_miles, UINT16, 1) \
+    X(uv, UINT16, 1) \
+    X(wind_degree, UINT16, 0) \
+    X(condition, UINT16, 0) \
+    X(utc_offset, INT8, 0) \
+    X(wind_dir, UINT8, 0) \
+    X(is_day, UINT8, 0) \
+    X(humidity, UINT8, 0) \
+    X(cloud, UINT8, 0) \
+    X(will_it_rain, UINT8, 0) \
+    X(chance_of_rain, UINT8, 0) \
+    X(will_it_snow, UINT8, 0) \
+    X(chance_of_snow, UINT8, 0)
+
+#define COLUMN_INDEX(name, type, decimals) COLUMN_INDEX_##name,
+#define COLUMN_FIELD(name, type, decimals) \
+    {#name, {offsetof(weather_hours_t, name), WEATHER_COLUMN_##type, decimals}},
+
+enum { HOURS_COLUMNS(COLUMN_INDEX) COLUMN_COUNT };
+
+static const weather_hours_field_t hours_fields[COLUMN_COUNT] = { HOURS_COLUMNS(COLUMN_FIELD) };
+
+const weather_hours_field_t *weather_hours_fields(int *count) {
+    *count = COLUMN_COUNT;
+    return hours_fields;
+}
+
+#define COLUMN_CASE(name) case offsetof(forecast_hour_t, name): return &hours_fields[COLUMN_INDEX_##name].column;
+
+const weather_column_t *weather_hours_column(size_t offset) {
+    switch (offset) {
+        COLUMN_CASE(time_epoch)
+        COLUMN_CASE(temp_c)
+        COLUMN_CASE(temp_f)
+        COLUMN_CASE(is_day)
+        COLUMN_CASE(wind_kph)
+        COLUMN_CASE(wind_mph)
+        COLUMN_CASE(wind_degree)
+        COLUMN_CASE(pressure_mb)
+        COLUMN_CASE(pressure_in)
+        COLUMN_CASE(precip_mm)
+        COLUMN_CASE(precip_in)
+        COLUMN_CASE(humidity)
+        COLUMN_CASE(cloud)
+        COLUMN_CASE(feelslike_c)
+        COLUMN_CASE(feelslike_f)
+        COLUMN_CASE(windchill_c)
+        COLUMN_CASE(windchill_f)
+        COLUMN_CASE(heatindex_c)
+        COLUMN_CASE(heatindex_f)
+        COLUMN_CASE(dewpoint_c)
+        COLUMN_CASE(dewpoint_f)
+        COLUMN_CASE(will_it_rain)
+        COLUMN_CASE(chance_of_rain)
+        COLUMN_CASE(will_it_snow)
+        COLUMN_CASE(chance_of_snow)
+        COLUMN_CASE(vis_km)
+        COLUMN_CASE(vis_miles)
+        COLUMN_CASE(gust_kph)
+        COLUMN_CASE(gust_mph)
+        COLUMN_CASE(uv)
+    }
+    return NULL;
+}
+
+#define HOUR_MEMBER_GET(arg, s, m, type) weather_hours_get_member(hours, index, offsetof(s, m), hour);
+
+void weather_hours_get(const weather_hours_t *hours, int index, forecast_hour_t *hour) {
+    memset(hour, 0, sizeof(forecast_hour_t));
+    WEATHER_HOUR_MEMBERS(HOUR_MEMBER_GET, 0)
+}
@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "weather_binary.h"
+
+/*
+ * Decoder for the binary bodies of weather_binary.c. It depends on nothing
+ * but the member tables (weather_fields.c), so clients can build it into
+ * their own programs.
+ */
+
+#define DECODE_MAX_DEPTH 32                 // Deepest nesting skipped over
+
+/**
+ * Structs a field id belongs to
+ */
+typedef enum {
+    DECODE_LOCATION,
+    DECODE_CURRENT,
+    DECODE_DAILY,
+    DECODE_DAY,
+    DECODE_ASTRO,
+    DECODE_HOUR
+} decode_container_t;
+
+/**
+ * Where the value of a field id goes
+ */
+typedef struct {
+    uint8_t container;          // decode_container_t
+    uint8_t type;               // weather_member_type_t (not CONDITION)
+    uint16_t size;              // Buffer size (strings)
+    uint32_t offset;            // Offset in the container struct
+} decode_field_t;
+
+/**
+ * Kinds of items
+ */
+typedef enum {
+    ITEM_UINT,
+    ITEM_NEGINT,
+    ITEM_STRING,
+    ITEM_ARRAY,
+    ITEM_MAP,
+    ITEM_FLOAT,
+    ITEM_DOUBLE,
+    ITEM_OTHER                  // Booleans, null, byte strings and extensions (skipped)
+} decode_kind_t;
+
+/**
+ * One decoded item head
+ */
+typedef struct {
+    int kind;                   // decode_kind_t
+    uint64_t value;             // Unsigned value, string length, or element count
+    double number;              // ITEM_FLOAT and ITEM_DOUBLE
+    const char *string;         // ITEM_STRING
+} decode_item_t;
+
+/**
+ * Input being decoded
+ */
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    int format;                 // weather_binary_format_t
+    decode_field_t fields[WEATHER_FIELD_COUNT];
+} decode_reader_t;
+
+/**
+ * Fill the field id table from the member tables
+ * @return Next field id
+ */
+static int decode_add_fields(decode_reader_t *reader, const weather_schema_t *schema, int container, int field,
+                             uint32_t base) {
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            field = decode_add_fields(reader, &weather_schema_condition, container, field, base + member->offset);
+            continue;
+        }
+        reader->fields[field].container = (uint8_t)container;
+        reader->fields[field].type = member->type;
+        reader->fields[field].size = member->size;
+        reader->fields[field].offset = base + member->offset;
+        field++;
+    }
+    return field;
+}
+
+static void decode_init(decode_reader_t *reader, const void *data, size_t length, weather_binary_format_t format) {
+    reader->p = data;
+    reader->end = reader->p + length;
+    reader->format = format;
+    decode_add_fields(reader, &weather_schema_location, DECODE_LOCATION, WEATHER_FIELD_LOCATION, 0);
+    decode_add_fields(reader, &weather_schema_current, DECODE_CURRENT, WEATHER_FIELD_CURRENT, 0);
+    decode_add_fields(reader, &weather_schema_daily, DECODE_DAILY, WEATHER_FIELD_DAILY, 0);
+    decode_add_fields(reader, &weather_schema_day, DECODE_DAY, WEATHER_FIELD_DAY, 0);
+    decode_add_fields(reader, &weather_schema_astro, DECODE_ASTRO, WEATHER_FIELD_ASTRO, 0);
+    decode_add_fields(reader, &weather_schema_hour, DECODE_HOUR, WEATHER_FIELD_HOUR, 0);
+}
+
+/**
+ * Read a big-endian value of 1, 2, 4 or 8 bytes
+ */
+static int decode_be(decode_reader_t *reader, int bytes, uint64_t *value) {
+    if (reader->end - reader->p < bytes) {
+        return -1;
+    }
+    *value = 0;
+    for (int i = 0; i < bytes; i++) {
+        *value = *value << 8 | *reader->p++;
+    }
+    return 0;
+}
+
+static double decode_float_bits(uint64_t bits) {
+    uint32_t narrow = (uint32_t)bits;
+    float value;
+    memcpy(&value, &narrow, sizeof(value));
+    return value;
+}
+
+static double decode_double_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * Half-precision float (CBOR major type 7, argument 25)
+ */
+static double decode_half_bits(uint64_t bits) {
+    int exponent = (int)(bits >> 10 & 0x1f);
+    double mantissa = (double)(bits & 0x3ff);
+    double value;
+    if (exponent == 0) {
+        value = ldexp(mantissa, -24);
+    } else if (exponent == 31) {
+        value = mantissa == 0 ? INFINITY : NAN;
+    } else {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    }
+    return bits & 0x8000 ? -value : value;
+}
+
+static int cbor_read_item(decode_reader_t *reader, decode_item_t *item) {
+    for (;;) {
+        if (reader->p >= reader->end) {
+            return -1;
+        }
+        int major = *reader->p >> 5;
+        int info = *reader->p++ & 0x1f;
+        uint64_t value = (uint64_t)info;
+        
+        if (info >= 24 && info <= 27) {
+            if (decode_be(reader, 1 << (info - 24), &value) != 0) {
+                return -1;
+            }
+        } else if (info > 27) {
+            return -1;              // Indefinite lengths are never written
+        }
+        
+        switch (major) {
+            case 0:
+                item->kind = ITEM_UINT;
+                break;
+            case 1:
+                item->kind = ITEM_NEGINT;
+                break;
+            case 2:
+            case 3:
+                if ((uint64_t)(reader->end - reader->p) < value) {
+                    return -1;
+                }
+                item->kind = major == 3 ? ITEM_STRING : ITEM_OTHER;
+                item->string = (const char *)reader->p;
+                reader->p += value;
+                break;
+            case 4:
+                item->kind = ITEM_ARRAY;
+                break;
+            case 5:
+                item->kind = ITEM_MAP;
+                break;
+            case 6:
+                continue;           // Tags: the tagged item follows
+            default:
+                if (info == 25) {
+                    item->kind = ITEM_FLOAT;
+                    item->number = decode_half_bits(value);
+                } else if (info == 26) {
+                    item->kind = ITEM_FLOAT;
+                    item->number = decode_float_bits(value);
+                } else if (info == 27) {
+                    item->kind = ITEM_DOUBLE;
+                    item->number = decode_double_bits(value);
+                } else {
+                    item->kind = ITEM_OTHER;
+                }
+                break;
+        }
+        item->value = value;
+        return 0;
+    }
+}
+
+static int msgpack_read_item(decode_reader_t *reader, decode_item_t *item) {
+    if (reader->p >= reader->end) {
+        return -1;
+    }
+    unsigned char type = *reader->p++;
+    uint64_t value = 0;
+    int bytes = 0;
+    
+    if (type <= 0x7f) {
+        item->kind = ITEM_UINT;
+        item->value = type;
+        return 0;
+    }
+    if (type >= 0xe0) {
+        item->kind = ITEM_NEGINT;
+        item->value = (uint64_t)(-1 - (int)(signed char)type);
+        return 0;
+    }
+    if (type <= 0x8f || (type >= 0x90 && type <= 0x9f)) {
+        item->kind = type <= 0x8f ? ITEM_MAP : ITEM_ARRAY;
+        item->value = type & 0x0f;
+        return 0;
+    }
+    if (type <= 0xbf) {
+        item->kind = ITEM_STRING;
+        value = type & 0x1f;
+    } else {
+        switch (type) {
+            case 0xcc: case 0xcd: case 0xce: case 0xcf:
+                if (decode_be(reader, 1 << (type - 0xcc), &value) != 0) {
+                    return -1;
+                }
+                item->kind = ITEM_UINT;
+                item->value = value;
+                return 0;
+            case 0xd0: case 0xd1: case 0xd2: case 0xd3: {
+                bytes = 1 << (type - 0xd0);
+                if (decode_be(reader, bytes, &value) != 0) {
+                    return -1;
+                }
+                // Sign-extend, then store negatives as -1 - n like CBOR
+                int shift = 64 - 8 * bytes;
+                long long signed_value = (long long)(value << shift) >> shift;
+                item->kind = signed_value < 0 ? ITEM_NEGINT : ITEM_UINT;
+                item->value = signed_value < 0 ? (uint64_t)(-1 - signed_value) : (uint64_t)signed_value;
+                return 0;
+            }
+            case 0xca: case 0xcb:
+                if (decode_be(reader, type == 0xca ? 4 : 8, &value) != 0) {
+                    return -1;
+                }
+                item->kind = type == 0xca ? ITEM_FLOAT : ITEM_DOUBLE;
+                item->number = type == 0xca ? decode_float_bits(value) : decode_double_bits(value);
+                return 0;
+            case 0xdc: case 0xdd: case 0xde: case 0xdf:
+                if (decode_be(reader, type & 1 ? 4 : 2, &value) != 0) {
+                    return -1;
+                }
+                item->kind = type <= 0xdd ? ITEM_ARRAY : ITEM_MAP;
+                item->value = value;
+                return 0;
+            case 0xd9: case 0xda: case 0xdb:
+                if (decode_be(reader, 1 << (type - 0xd9), &value) != 0) {
+                    return -1;
+                }
+                item->kind = ITEM_STRING;
+                break;
+            case 0xc4: case 0xc5: case 0xc6:
+                if (decode_be(reader, 1 << (type - 0xc4), &value) != 0) {
+                    return -1;
+                }
+                item->kind = ITEM_OTHER;
+                break;
+            case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+                value = 1 + ((uint64_t)1 << (type - 0xd4));     // Fixed extensions: type byte and data
+                item->kind = ITEM_OTHER;
+                break;
+            case 0xc7: case 0xc8: case 0xc9:
+                if (decode_be(reader, 1 << (type - 0xc7), &value) != 0) {
+                    return -1;
+                }
+                value += 1;
+                item->kind = ITEM_OTHER;
+                break;
+            default:
+                item->kind = ITEM_OTHER;    // nil, false, true
+                item->value = 0;
+                return 0;
+        }
+    }
+    
+    // Items followed by value bytes
+    if ((uint64_t)(reader->end - reader->p) < value) {
+        return -1;
+    }
+    item->string = (const char *)reader->p;
+    item->value = value;
+    reader->p += value;
+    return 0;
+}
+
+static int decode_item(decode_reader_t *reader, decode_item_t *item) {
+    return reader->format == WEATHER_BINARY_CBOR ? cbor_read_item(reader, item) : msgpack_read_item(reader, item);
+}
+
+/**
+ * Skip the elements of an array or map whose head was just read
+ */
+static int decode_skip_children(decode_reader_t *reader, const decode_item_t *item, int depth) {
+    if (item->kind != ITEM_ARRAY && item->kind != ITEM_MAP) {
+        return 0;
+    }
+    if (depth >= DECODE_MAX_DEPTH) {
+        return -1;
+    }
+    
+    uint64_t count = item->kind == ITEM_MAP ? item->value * 2 : item->value;
+    for (uint64_t i = 0; i < count; i++) {
+        decode_item_t child;
+        if (decode_item(reader, &child) != 0 || decode_skip_children(reader, &child, depth + 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Read a container head of the given kind
+ * The count is checked against the bytes left, each element taking at least one.
+ */
+static int decode_container(decode_reader_t *reader, int kind, uint64_t *count) {
+    decode_item_t item;
+    if (decode_item(reader, &item) != 0 || item.kind != kind) {
+        return -1;
+    }
+    if (item.value > (uint64_t)(reader->end - reader->p)) {
+        return -1;
+    }
+    *count = item.value;
+    return 0;
+}
+
+static int decode_key(decode_reader_t *reader, uint64_t *key) {
+    decode_item_t item;
+    if (decode_item(reader, &item) != 0 || item.kind != ITEM_UINT) {
+        return -1;
+    }
+    *key = item.value;
+    return 0;
+}
+
+/**
+ * Store a value into the member a field id names
+ * Values of an unexpected kind are skipped.
+ */
+static int decode_value(decode_reader_t *reader, const decode_field_t *field, void *base) {
+    decode_item_t item;
+    if (decode_item(reader, &item) != 0) {
+        return -1;
+    }
+    char *target = (char *)base + field->offset;
+    int integer = item.kind == ITEM_UINT || item.kind == ITEM_NEGINT;
+    long long value = item.kind == ITEM_NEGINT ? -1 - (long long)item.value : (long long)item.value;
+    
+    switch (field->type) {
+        case WEATHER_MEMBER_STRING:
+        case WEATHER_MEMBER_TIME:
+            if (item.kind == ITEM_STRING && field->size > 0) {
+                size_t length = item.value < field->size ? (size_t)item.value : field->size - 1u;
+                memcpy(target, item.string, length);
+                target[length] = '\0';
+            }
+            break;
+        case WEATHER_MEMBER_INT:
+            if (integer) {
+                *(int *)target = (int)value;
+            }
+            break;
+        case WEATHER_MEMBER_LONG:
+            if (integer) {
+                *(long *)target = (long)value;
+            }
+            break;
+        case WEATHER_MEMBER_DOUBLE:
+            if (integer) {
+                *(double *)target = (double)value;
+            } else if (item.kind == ITEM_FLOAT) {
+                // Written from a double with at most two fraction digits
+                *(double *)target = round(item.number * 100) / 100;
+            } else if (item.kind == ITEM_DOUBLE) {
+                *(double *)target = item.number;
+            }
+            break;
+    }
+    return decode_skip_children(reader, &item, 0);
+}
+
+static int decode_map(decode_reader_t *reader, void *const targets[], forecast_daily_t *hours, int *schema);
+
+/**
+ * Allocate a day's hours
+ */
+static int decode_hours_alloc(forecast_daily_t *daily, uint64_t count) {
+    daily->hour = calloc(count ? (size_t)count : 1, sizeof(forecast_hour_t));
+    if (!daily->hour) {
+        fprintf(stderr, "Failed to allocate decoded hours\n");
+        return -1;
+    }
+    daily->hour_count = (int)count;
+    return 0;
+}
+
+/**
+ * Decode a day's hours: an array of hour maps, or a map of field id to one
+ * array of values per member (WEATHER_HOURLY_COLUMNS)
+ */
+static int decode_hours(decode_reader_t *reader, forecast_daily_t *daily) {
+    decode_item_t item;
+    if (decode_item(reader, &item) != 0 || (item.kind != ITEM_ARRAY && item.kind != ITEM_MAP) ||
+        item.value > (uint64_t)(reader->end - reader->p)) {
+        return -1;
+    }
+    
+    if (item.kind == ITEM_ARRAY) {
+        if (decode_hours_alloc(daily, item.value) != 0) {
+            return -1;
+        }
+        for (int h = 0; h < daily->hour_count; h++) {
+            void *const targets[] = { NULL, NULL, NULL, NULL, NULL, &daily->hour[h] };
+            if (decode_map(reader, targets, NULL, NULL) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+    
+    // Columns: every one holds a value per hour, so the first sets the count
+    for (uint64_t i = 0; i < item.value; i++) {
+        uint64_t key, count;
+        if (decode_key(reader, &key) != 0 || decode_container(reader, ITEM_ARRAY, &count) != 0) {
+            return -1;
+        }
+        if (!daily->hour && decode_hours_alloc(daily, count) != 0) {
+            return -1;
+        }
+        if (count != (uint64_t)daily->hour_count) {
+            return -1;
+        }
+        
+        const decode_field_t *field = key < WEATHER_FIELD_COUNT && reader->fields[key].container == DECODE_HOUR
+                                      ? &reader->fields[key] : NULL;
+        for (int h = 0; h < daily->hour_count; h++) {
+            decode_item_t value;
+            if (field && decode_value(reader, field, &daily->hour[h]) != 0) {
+                return -1;
+            }
+            if (!field && (decode_item(reader, &value) != 0 || decode_skip_children(reader, &value, 0) != 0)) {
+                return -1;
+            }
+        }
+    }
+    if (!daily->hour) {
+        return decode_hours_alloc(daily, 0);
+    }
+    return 0;
+}
+
+/**
+ * Decode one map whose field ids go into the given structs
+ * @param targets Struct per decode_container_t, NULL where the map has none
+ * @param hours Day whose hours WEATHER_BINARY_KEY_HOURS holds (day maps only, may be NULL)
+ */
+static int decode_map(decode_reader_t *reader, void *const targets[], forecast_daily_t *hours, int *schema) {
+    uint64_t count;
+    if (decode_container(reader, ITEM_MAP, &count) != 0) {
+        return -1;
+    }
+    
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t key;
+        if (decode_key(reader, &key) != 0) {
+            return -1;
+        }
+        
+        if (key < WEATHER_FIELD_COUNT && targets[reader->fields[key].container]) {
+            if (decode_value(reader, &reader->fields[key], targets[reader->fields[key].container]) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        
+        if (key == WEATHER_BINARY_KEY_SCHEMA && schema) {
+            decode_item_t item;
+            if (decode_item(reader, &item) != 0 || item.kind != ITEM_UINT || item.value != WEATHER_BINARY_SCHEMA) {
+                fprintf(stderr, "Binary body is not of schema %d\n", WEATHER_BINARY_SCHEMA);
+                return -1;
+            }
+            *schema = 1;
+            continue;
+        }
+        
+        if (key == WEATHER_BINARY_KEY_HOURS && hours && !hours->hour) {
+            if (decode_hours(reader, hours) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        
+        // Unknown keys (and the days array, read by the caller) are skipped here
+        decode_item_t item;
+        if (decode_item(reader, &item) != 0 || decode_skip_children(reader, &item, 0) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int weather_binary_decode_current(const void *data, size_t length, weather_binary_format_t format,
+                                  weather_response_t *response) {
+    decode_reader_t reader;
+    decode_init(&reader, data, length, format);
+    memset(response, 0, sizeof(*response));
+    
+    int schema = 0;
+    void *const targets[] = { &response->location, &response->current, NULL, NULL, NULL, NULL };
+    if (decode_map(&reader, targets, NULL, &schema) != 0 || !schema || reader.p != reader.end) {
+        fprintf(stderr, "Malformed binary current weather body\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Decode the days array of a forecast
+ */
+static int decode_days(decode_reader_t *reader, forecast_response_t *response) {
+    uint64_t count;
+    if (decode_container(reader, ITEM_ARRAY, &count) != 0) {
+        return -1;
+    }
+    response->forecast = calloc(count ? (size_t)count : 1, sizeof(forecast_daily_t));
+    if (!response->forecast) {
+        fprintf(stderr, "Failed to allocate decoded forecast days\n");
+        return -1;
+    }
+    response->forecast_days = (int)count;
+    
+    for (uint64_t i = 0; i < count; i++) {
+        forecast_daily_t *daily = &response->forecast[i];
+        void *const targets[] = { NULL, NULL, daily, &daily->day, &daily->astro, NULL };
+        if (decode_map(reader, targets, daily, NULL) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int weather_binary_decode_forecast(const void *data, size_t length, weather_binary_format_t format,
+                                   forecast_response_t *response) {
+    decode_reader_t reader;
+    decode_init(&reader, data, length, format);
+    memset(response, 0, sizeof(*response));
+    
+    // The body map is read here rather than by decode_map() to pick out the days array
+    uint64_t count;
+    int schema = 0;
+    int failed = decode_container(&reader, ITEM_MAP, &count) != 0;
+    for (uint64_t i = 0; !failed && i < count; i++) {
+        uint64_t key;
+        if (decode_key(&reader, &key) != 0) {
+            failed = 1;
+        } else if (key == WEATHER_BINARY_KEY_DAYS && !response->forecast) {
+            failed = decode_days(&reader, response) != 0;
+        } else if (key == WEATHER_BINARY_KEY_SCHEMA) {
+            decode_item_t item;
+            failed = decode_item(&reader, &item) != 0 || item.kind != ITEM_UINT || item.value != WEATHER_BINARY_SCHEMA;
+            schema = !failed;
+        } else if (key < WEATHER_FIELD_COUNT && reader.fields[key].container == DECODE_LOCATION) {
+            failed = decode_value(&reader, &reader.fields[key], &response->location) != 0;
+        } else if (key < WEATHER_FIELD_COUNT && reader.fields[key].container == DECODE_CURRENT) {
+            failed = decode_value(&reader, &reader.fields[key], &response->current) != 0;
+        } else {
+            decode_item_t item;
+            failed = decode_item(&reader, &item) != 0 || decode_skip_children(&reader, &item, 0) != 0;
+        }
+    }
+    
+    if (failed || !schema || reader.p != reader.end) {
+        fprintf(stderr, "Malformed binary forecast body\n");
+        weather_binary_forecast_free(response);
+        return -1;
+    }
+    return 0;
+}
+
+void weather_binary_forecast_free(forecast_response_t *response) {
+    if (!response) {
+        return;
+    }
+    for (int i = 0; i < response->forecast_days; i++) {
+        free(response->forecast[i].hour);
+    }
+    free(response->forecast);
+    response->forecast = NULL;
+    response->forecast_days = 0;
+}
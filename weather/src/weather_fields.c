@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include "weather_fields.h"
+
+#define FIELD_PATH_MAX 128          // Longest field path
+
+#define MEMBER_SIZE_STRING(s, m) sizeof(((s *)0)->m)
+#define MEMBER_SIZE_TIME(s, m) sizeof(((s *)0)->m)
+#define MEMBER_SIZE_DOUBLE(s, m) 0
+#define MEMBER_SIZE_INT(s, m) 0
+#define MEMBER_SIZE_LONG(s, m) 0
+#define MEMBER_SIZE_CONDITION(s, m) 0
+#define MEMBER_ENTRY(arg, s, m, type) {#m, WEATHER_MEMBER_##type, MEMBER_SIZE_##type(s, m), offsetof(s, m)},
+
+static const weather_member_t condition_members[] = {WEATHER_CONDITION_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t location_members[] = {WEATHER_LOCATION_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t current_members[] = {WEATHER_CURRENT_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t daily_members[] = {WEATHER_DAILY_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t day_members[] = {WEATHER_DAY_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t astro_members[] = {WEATHER_ASTRO_MEMBERS(MEMBER_ENTRY, 0)};
+static const weather_member_t hour_members[] = {WEATHER_HOUR_MEMBERS(MEMBER_ENTRY, 0)};
+
+const weather_schema_t weather_schema_condition = {
+    NULL, condition_members, sizeof(condition_members) / sizeof(condition_members[0]),
+    0 WEATHER_CONDITION_MEMBERS(WEATHER_MEMBER_WIDTH, 0), 0
+};
+const weather_schema_t weather_schema_location = {
+    "location", location_members, sizeof(location_members) / sizeof(location_members[0]),
+    WEATHER_FIELD_CURRENT - WEATHER_FIELD_LOCATION, WEATHER_FIELD_LOCATION
+};
+const weather_schema_t weather_schema_current = {
+    "current", current_members, sizeof(current_members) / sizeof(current_members[0]),
+    WEATHER_FIELD_DAILY - WEATHER_FIELD_CURRENT, WEATHER_FIELD_CURRENT
+};
+const weather_schema_t weather_schema_daily = {
+    "forecast", daily_members, sizeof(daily_members) / sizeof(daily_members[0]),
+    WEATHER_FIELD_DAY - WEATHER_FIELD_DAILY, WEATHER_FIELD_DAILY
+};
+const weather_schema_t weather_schema_day = {
+    "forecast.day", day_members, sizeof(day_members) / sizeof(day_members[0]),
+    WEATHER_FIELD_ASTRO - WEATHER_FIELD_DAY, WEATHER_FIELD_DAY
+};
+const weather_schema_t weather_schema_astro = {
+    "forecast.astro", astro_members, sizeof(astro_members) / sizeof(astro_members[0]),
+    WEATHER_FIELD_HOUR - WEATHER_FIELD_ASTRO, WEATHER_FIELD_ASTRO
+};
+const weather_schema_t weather_schema_hour = {
+    "forecast.hour", hour_members, sizeof(hour_members) / sizeof(hour_members[0]),
+    WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR, WEATHER_FIELD_HOUR
+};
+
+/**
+ * Structs with projection fields, in field id order
+ */
+static const weather_schema_t *const projected_schemas[] = {
+    &weather_schema_location,
+    &weather_schema_current,
+    &weather_schema_daily,
+    &weather_schema_day,
+    &weather_schema_astro,
+    &weather_schema_hour,
+};
+
+/**
+ * Check whether a name selects a field path: the path itself, or a container on it
+ */
+static int path_selects(const char *path, const char *name, size_t length) {
+    return strncmp(path, name, length) == 0 && (path[length] == '\0' || path[length] == '.');
+}
+
+/**
+ * Select the fields a name matches
+ * @return 1 if it matched any, 0 otherwise
+ */
+static int fields_select(weather_fields_t *fields, const char *name, size_t length) {
+    int matched = 0;
+    char path[FIELD_PATH_MAX];
+    
+    for (size_t s = 0; s < sizeof(projected_schemas) / sizeof(projected_schemas[0]); s++) {
+        const weather_schema_t *schema = projected_schemas[s];
+        int field = schema->first;
+        for (int i = 0; i < schema->count; i++) {
+            const weather_member_t *member = &schema->members[i];
+            if (member->type != WEATHER_MEMBER_CONDITION) {
+                snprintf(path, sizeof(path), "%s.%s", schema->path, member->name);
+                if (path_selects(path, name, length)) {
+                    fields->bits[field / 64] |= (uint64_t)1 << (field % 64);
+                    matched = 1;
+                }
+                field++;
+                continue;
+            }
+            
+            for (int c = 0; c < weather_schema_condition.count; c++, field++) {
+                snprintf(path, sizeof(path), "%s.%s.%s", schema->path, member->name,
+                         weather_schema_condition.members[c].name);
+                if (path_selects(path, name, length)) {
+                    fields->bits[field / 64] |= (uint64_t)1 << (field % 64);
+                    matched = 1;
+                }
+            }
+        }
+    }
+    return matched;
+}
+
+int weather_fields_parse(const char *list, weather_fields_t *fields, char *unknown, size_t unknown_size) {
+    memset(fields, 0, sizeof(*fields));
+    if (unknown && unknown_size > 0) {
+        unknown[0] = '\0';
+    }
+    
+    int selected = 0;
+    const char *p = list;
+    while (*p) {
+        // Next name, without surrounding spaces
+        while (*p == ' ') {
+            p++;
+        }
+        const char *end = strchr(p, ',');
+        if (!end) {
+            end = p + strlen(p);
+        }
+        size_t length = (size_t)(end - p);
+        while (length > 0 && p[length - 1] == ' ') {
+            length--;
+        }
+        
+        if (length > 0) {
+            if (!fields_select(fields, p, length)) {
+                if (unknown && unknown_size > 0) {
+                    snprintf(unknown, unknown_size, "%.*s", (int)length, p);
+                }
+                return -1;
+            }
+            selected = 1;
+        }
+        
+        p = *end ? end + 1 : end;
+    }
+    
+    return selected ? 0 : -1;
+}
+
+int weather_fields_has(const weather_fields_t *fields, int field) {
+    return !fields || (fields->bits[field / 64] >> (field % 64) & 1);
+}
+
+int weather_fields_any(const weather_fields_t *fields, int first, int last) {
+    if (!fields) {
+        return 1;
+    }
+    for (int field = first; field <= last; field++) {
+        if (fields->bits[field / 64] >> (field % 64) & 1) {
+            return 1;
+        }
+    }
+    return 0;
+}
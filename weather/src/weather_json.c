@@ -0,0 +1,782 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <pthread.h>
+#include <cjson/cJSON.h>
+#include "weather_json.h"
+#include "weather_compact.h"
+
+#define JSON_BLOCK_MIN (64 * 1024)          // First block of a thread's arena
+#define JSON_BLOCK_KEEP (8 * 1024 * 1024)   // Largest block a thread keeps between scopes
+#define JSON_ALIGN 16
+#define JSON_WRITER_MIN 4096                // First buffer of a writer
+#define JSON_NUMBER_MAX 32                  // Longest number text
+#define JSON_FIXED_LIMIT 1e15               // Scaled values below this keep 15 significant digits
+
+/**
+ * Arena block; a scope grows by chaining blocks of doubling size
+ */
+typedef struct json_block {
+    struct json_block *next;                // Previous (smaller) block
+    size_t size;                            // Usable bytes after the header
+    size_t used;
+} json_block_t;
+
+#define JSON_BLOCK_HEADER ((sizeof(json_block_t) + JSON_ALIGN - 1) & ~(size_t)(JSON_ALIGN - 1))
+
+/**
+ * Scope state of one thread
+ */
+typedef struct {
+    int active;
+    json_block_t *blocks;                   // Newest (largest) first
+    unsigned long arena_allocs;             // Counted locally, added to the totals when the scope ends
+    unsigned long heap_allocs;
+} json_scope_t;
+
+static pthread_key_t json_scope_key;
+static pthread_once_t json_scope_once = PTHREAD_ONCE_INIT;
+static int json_scope_ready = 0;
+static int json_use_arena = 0;
+static unsigned long json_scopes = 0;
+static unsigned long json_arena_allocs = 0;
+static unsigned long json_heap_allocs = 0;
+
+static void json_blocks_free(json_block_t *block) {
+    while (block) {
+        json_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+}
+
+static void json_scope_destroy(void *data) {
+    json_scope_t *scope = data;
+    json_blocks_free(scope->blocks);
+    free(scope);
+}
+
+static void json_scope_init(void) {
+    json_scope_ready = pthread_key_create(&json_scope_key, json_scope_destroy) == 0;
+}
+
+/**
+ * Active scope of the calling thread, or NULL
+ */
+static json_scope_t *json_scope_active(void) {
+    if (!json_scope_ready) {
+        return NULL;
+    }
+    json_scope_t *scope = pthread_getspecific(json_scope_key);
+    return scope && scope->active ? scope : NULL;
+}
+
+static int json_scope_owns(const json_scope_t *scope, const void *ptr) {
+    for (const json_block_t *block = scope->blocks; block; block = block->next) {
+        const char *data = (const char *)block + JSON_BLOCK_HEADER;
+        if ((const char *)ptr >= data && (const char *)ptr < data + block->size) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void *json_malloc(size_t size) {
+    json_scope_t *scope = json_scope_active();
+    if (!scope || !json_use_arena) {
+        if (scope) {
+            scope->heap_allocs++;
+        } else {
+            __atomic_add_fetch(&json_heap_allocs, 1, __ATOMIC_RELAXED);
+        }
+        return malloc(size);
+    }
+    
+    size = (size + JSON_ALIGN - 1) & ~(size_t)(JSON_ALIGN - 1);
+    json_block_t *block = scope->blocks;
+    if (!block || size > block->size - block->used) {
+        // Chain a block twice the size of the last so a large document needs few of them
+        size_t capacity = block ? block->size * 2 : JSON_BLOCK_MIN;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        json_block_t *grown = malloc(JSON_BLOCK_HEADER + capacity);
+        if (!grown) {
+            fprintf(stderr, "Failed to allocate JSON arena block of %zu bytes\n", capacity);
+            return NULL;
+        }
+        grown->next = block;
+        grown->size = capacity;
+        grown->used = 0;
+        scope->blocks = grown;
+        scope->heap_allocs++;
+        block = grown;
+    }
+    
+    void *ptr = (char *)block + JSON_BLOCK_HEADER + block->used;
+    block->used += size;
+    scope->arena_allocs++;
+    return ptr;
+}
+
+static void json_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    
+    // Arena allocations are released when their scope ends
+    json_scope_t *scope = json_scope_active();
+    if (scope && json_scope_owns(scope, ptr)) {
+        return;
+    }
+    free(ptr);
+}
+
+void weather_json_init(int use_arena) {
+    pthread_once(&json_scope_once, json_scope_init);
+    json_use_arena = use_arena;
+    
+    cJSON_Hooks hooks = { json_malloc, json_free };
+    cJSON_InitHooks(&hooks);
+}
+
+void weather_json_scope_begin(void) {
+    if (!json_scope_ready) {
+        return;
+    }
+    
+    json_scope_t *scope = pthread_getspecific(json_scope_key);
+    if (!scope) {
+        scope = calloc(1, sizeof(json_scope_t));
+        if (!scope || pthread_setspecific(json_scope_key, scope) != 0) {
+            free(scope);
+            return;
+        }
+    }
+    scope->active = 1;
+}
+
+void weather_json_scope_end(void) {
+    json_scope_t *scope = json_scope_active();
+    if (!scope) {
+        return;
+    }
+    scope->active = 0;
+    
+    // Keep the newest block, which is the largest, unless it is too large to sit idle
+    json_block_t *keep = scope->blocks;
+    if (keep && keep->size <= JSON_BLOCK_KEEP) {
+        json_blocks_free(keep->next);
+        keep->next = NULL;
+        keep->used = 0;
+    } else {
+        json_blocks_free(keep);
+        keep = NULL;
+    }
+    scope->blocks = keep;
+    
+    __atomic_add_fetch(&json_scopes, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&json_arena_allocs, scope->arena_allocs, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&json_heap_allocs, scope->heap_allocs, __ATOMIC_RELAXED);
+    scope->arena_allocs = 0;
+    scope->heap_allocs = 0;
+}
+
+void weather_json_get_stats(weather_json_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->scopes = __atomic_load_n(&json_scopes, __ATOMIC_RELAXED);
+    stats->arena_allocs = __atomic_load_n(&json_arena_allocs, __ATOMIC_RELAXED);
+    stats->heap_allocs = __atomic_load_n(&json_heap_allocs, __ATOMIC_RELAXED);
+}
+
+static const double json_pow10[] = { 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6 };
+
+/**
+ * Make room for n more bytes (plus a NUL) in a writer's buffer
+ */
+static int json_reserve(weather_json_writer_t *writer, size_t n) {
+    if (writer->failed) {
+        return -1;
+    }
+    if (writer->length + n + 1 <= writer->capacity) {
+        return 0;
+    }
+    
+    size_t capacity = writer->capacity ? writer->capacity * 2 : JSON_WRITER_MIN;
+    while (capacity < writer->length + n + 1) {
+        capacity *= 2;
+    }
+    char *data = realloc(writer->data, capacity);
+    if (!data) {
+        fprintf(stderr, "Failed to grow JSON output to %zu bytes\n", capacity);
+        writer->failed = 1;
+        return -1;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+    return 0;
+}
+
+static void json_put(weather_json_writer_t *writer, const char *text, size_t n) {
+    if (json_reserve(writer, n) == 0) {
+        memcpy(writer->data + writer->length, text, n);
+        writer->length += n;
+    }
+}
+
+static void json_put_char(weather_json_writer_t *writer, char c) {
+    if (json_reserve(writer, 1) == 0) {
+        writer->data[writer->length++] = c;
+    }
+}
+
+static void json_indent(weather_json_writer_t *writer, int depth) {
+    if (depth > 0 && json_reserve(writer, (size_t)depth) == 0) {
+        memset(writer->data + writer->length, '\t', (size_t)depth);
+        writer->length += (size_t)depth;
+    }
+}
+
+/**
+ * Write a quoted string, escaped as cJSON does
+ */
+static void json_put_string(weather_json_writer_t *writer, const char *value) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *p = (const unsigned char *)(value ? value : "");
+    
+    json_put_char(writer, '"');
+    while (*p) {
+        // Copy the run of characters that need no escaping in one go
+        const unsigned char *run = p;
+        while (*p >= 32 && *p != '"' && *p != '\\') {
+            p++;
+        }
+        json_put(writer, (const char *)run, (size_t)(p - run));
+        if (!*p) {
+            break;
+        }
+        
+        char escape[6] = { '\\', 0 };
+        size_t n = 2;
+        switch (*p) {
+            case '"': escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[*p >> 4];
+                escape[5] = hex[*p & 15];
+                n = 6;
+                break;
+        }
+        json_put(writer, escape, n);
+        p++;
+    }
+    json_put_char(writer, '"');
+}
+
+/**
+ * Separator, indentation and key before a value
+ */
+static void json_value_start(weather_json_writer_t *writer, const char *key) {
+    if (writer->depth == 0) {
+        return;
+    }
+    
+    if (writer->containers[writer->depth - 1] == '[') {
+        if (!writer->first) {
+            json_put(writer, writer->pretty ? ", " : ",", writer->pretty ? 2 : 1);
+        }
+    } else {
+        if (!writer->first) {
+            json_put_char(writer, ',');
+        }
+        if (writer->pretty) {
+            json_put_char(writer, '\n');
+            json_indent(writer, writer->depth);
+        }
+        json_put_string(writer, key);
+        json_put(writer, writer->pretty ? ":\t" : ":", writer->pretty ? 2 : 1);
+    }
+    writer->first = 0;
+}
+
+/**
+ * Format value / 10^decimals, dropping trailing zeros in the fraction
+ */
+static size_t json_format_fixed(char *buffer, long long value, int decimals) {
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    while (decimals > 0 && magnitude % 10 == 0) {
+        magnitude /= 10;
+        decimals--;
+    }
+    
+    // Digits are produced backwards into the end of a scratch buffer
+    char digits[JSON_NUMBER_MAX];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+    int place = 0;
+    do {
+        if (decimals > 0 && place == decimals) {
+            *--p = '.';
+        }
+        *--p = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+        place++;
+    } while (magnitude > 0 || place <= decimals);
+    if (value < 0 && !(p[0] == '0' && p + 1 == end)) {
+        *--p = '-';
+    }
+    
+    size_t n = (size_t)(end - p);
+    memcpy(buffer, p, n);
+    return n;
+}
+
+/**
+ * Format a double as cJSON does: integral values as integers, otherwise
+ * %1.15g, or %1.17g when that does not read back as (about) the same value
+ */
+static size_t json_format_cjson(char *buffer, double value) {
+    int n = snprintf(buffer, JSON_NUMBER_MAX, "%1.15g", value);
+    double test = strtod(buffer, NULL);
+    double larger = fabs(test) > fabs(value) ? fabs(test) : fabs(value);
+    if (!(fabs(test - value) <= larger * DBL_EPSILON)) {
+        n = snprintf(buffer, JSON_NUMBER_MAX, "%1.17g", value);
+    }
+    return (size_t)n;
+}
+
+/**
+ * Format a number for a writer
+ */
+static size_t json_format_number(char *buffer, double value, int precision) {
+    if (isnan(value) || isinf(value)) {
+        memcpy(buffer, "null", 4);
+        return 4;
+    }
+    
+    if (precision >= 0) {
+        double scaled = value * json_pow10[precision];
+        if (fabs(scaled) < JSON_FIXED_LIMIT) {
+            return json_format_fixed(buffer, llround(scaled), precision);
+        }
+        return json_format_cjson(buffer, value);
+    }
+    
+    // Shortest decimal with up to 6 fraction digits that is exactly this double; with at most
+    // 15 significant digits that is also what %1.15g prints (small values %g writes as 1e-05 aside)
+    for (int decimals = 0; decimals <= WEATHER_JSON_MAX_PRECISION; decimals++) {
+        double scaled = value * json_pow10[decimals];
+        if (fabs(scaled) >= JSON_FIXED_LIMIT || (decimals > 0 && fabs(value) < 1e-4)) {
+            break;
+        }
+        long long rounded = llround(scaled);
+        if ((double)rounded / json_pow10[decimals] == value) {
+            return json_format_fixed(buffer, rounded, decimals);
+        }
+    }
+    return json_format_cjson(buffer, value);
+}
+
+void weather_json_writer_init(weather_json_writer_t *writer, int pretty, int precision) {
+    memset(writer, 0, sizeof(*writer));
+    writer->pretty = pretty;
+    writer->precision = precision > WEATHER_JSON_MAX_PRECISION ? WEATHER_JSON_MAX_PRECISION
+                                                              : (precision < 0 ? WEATHER_JSON_SHORTEST : precision);
+    writer->first = 1;
+}
+
+char *weather_json_writer_finish(weather_json_writer_t *writer, size_t *length) {
+    if (json_reserve(writer, 0) != 0) {
+        weather_json_writer_free(writer);
+        return NULL;
+    }
+    
+    char *data = writer->data;
+    data[writer->length] = '\0';
+    if (length) {
+        *length = writer->length;
+    }
+    writer->data = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+    return data;
+}
+
+void weather_json_writer_project(weather_json_writer_t *writer, const weather_fields_t *fields) {
+    writer->fields = fields;
+}
+
+void weather_json_writer_enter(weather_json_writer_t *writer, const char *containers) {
+    size_t depth = strlen(containers);
+    if (writer->depth != 0 || depth > WEATHER_JSON_MAX_DEPTH) {
+        writer->failed = 1;
+        return;
+    }
+    memcpy(writer->containers, containers, depth);
+    writer->depth = (int)depth;
+    writer->first = 1;
+}
+
+void weather_json_writer_free(weather_json_writer_t *writer) {
+    free(writer->data);
+    writer->data = NULL;
+    writer->length = 0;
+    writer->capacity = 0;
+}
+
+static void json_begin(weather_json_writer_t *writer, const char *key, char open) {
+    json_value_start(writer, key);
+    if (writer->depth >= WEATHER_JSON_MAX_DEPTH) {
+        writer->failed = 1;
+        return;
+    }
+    json_put_char(writer, open);
+    writer->containers[writer->depth++] = open;
+    writer->first = 1;
+}
+
+void weather_json_begin_object(weather_json_writer_t *writer, const char *key) {
+    json_begin(writer, key, '{');
+}
+
+void weather_json_end_object(weather_json_writer_t *writer) {
+    if (writer->depth == 0) {
+        writer->failed = 1;
+        return;
+    }
+    writer->depth--;
+    if (writer->pretty) {
+        json_put_char(writer, '\n');
+        json_indent(writer, writer->depth);
+    }
+    json_put_char(writer, '}');
+    writer->first = 0;
+}
+
+void weather_json_begin_array(weather_json_writer_t *writer, const char *key) {
+    json_begin(writer, key, '[');
+}
+
+void weather_json_end_array(weather_json_writer_t *writer) {
+    if (writer->depth == 0) {
+        writer->failed = 1;
+        return;
+    }
+    writer->depth--;
+    json_put_char(writer, ']');
+    writer->first = 0;
+}
+
+void weather_json_string(weather_json_writer_t *writer, const char *key, const char *value) {
+    json_value_start(writer, key);
+    json_put_string(writer, value);
+}
+
+void weather_json_number(weather_json_writer_t *writer, const char *key, double value) {
+    char buffer[JSON_NUMBER_MAX];
+    json_value_start(writer, key);
+    json_put(writer, buffer, json_format_number(buffer, value, writer->precision));
+}
+
+void weather_json_int(weather_json_writer_t *writer, const char *key, long long value) {
+    char buffer[JSON_NUMBER_MAX];
+    json_value_start(writer, key);
+    json_put(writer, buffer, json_format_fixed(buffer, value, 0));
+}
+
+void weather_json_fixed(weather_json_writer_t *writer, const char *key, long long value, int decimals) {
+    char buffer[JSON_NUMBER_MAX];
+    
+    // Round away the digits beyond the writer's precision (half away from zero)
+    if (writer->precision >= 0 && decimals > writer->precision) {
+        long long divisor = (long long)json_pow10[decimals - writer->precision];
+        value = (value + (value < 0 ? -divisor / 2 : divisor / 2)) / divisor;
+        decimals = writer->precision;
+    }
+    
+    json_value_start(writer, key);
+    json_put(writer, buffer, json_format_fixed(buffer, value, decimals));
+}
+
+/**
+ * Check whether the writer's projection selects a field
+ * The bit test is done here rather than through weather_fields_has() so it
+ * inlines into the member loop.
+ */
+static int json_selected(const weather_json_writer_t *writer, int field) {
+    return !writer->fields || (writer->fields->bits[field / 64] >> (field % 64) & 1);
+}
+
+static void json_write_object(weather_json_writer_t *writer, const char *key, const weather_schema_t *schema,
+                              const void *base, int field);
+
+/**
+ * Write one member that is not an object
+ * @param value Member in the struct
+ */
+static void json_write_value(weather_json_writer_t *writer, const char *key, const weather_member_t *member,
+                             const char *value) {
+    switch (member->type) {
+        case WEATHER_MEMBER_STRING:
+        case WEATHER_MEMBER_TIME:
+            weather_json_string(writer, key, value);
+            break;
+        case WEATHER_MEMBER_DOUBLE:
+            weather_json_number(writer, key, *(const double *)value);
+            break;
+        case WEATHER_MEMBER_INT:
+            weather_json_int(writer, key, *(const int *)value);
+            break;
+        case WEATHER_MEMBER_LONG:
+            weather_json_int(writer, key, *(const long *)value);
+            break;
+    }
+}
+
+/**
+ * Write the members of a struct from its table (weather_fields.h)
+ * @param base Struct to read
+ * @param field Field id of the first member
+ */
+static void json_write_members(weather_json_writer_t *writer, const weather_schema_t *schema, const void *base,
+                               int field) {
+    const char *bytes = base;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        const char *value = bytes + member->offset;
+        
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            json_write_object(writer, member->name, &weather_schema_condition, value, field);
+            field += weather_schema_condition.width;
+            continue;
+        }
+        if (json_selected(writer, field++)) {
+            json_write_value(writer, member->name, member, value);
+        }
+    }
+}
+
+/**
+ * Write a struct as an object, omitted if the projection selects none of its members
+ * @param field Field id of the first member
+ */
+static void json_write_object(weather_json_writer_t *writer, const char *key, const weather_schema_t *schema,
+                              const void *base, int field) {
+    if (!weather_fields_any(writer->fields, field, field + schema->width - 1)) {
+        return;
+    }
+    weather_json_begin_object(writer, key);
+    json_write_members(writer, schema, base, field);
+    weather_json_end_object(writer);
+}
+
+void weather_json_write_current(weather_json_writer_t *writer, const weather_response_t *response) {
+    weather_json_begin_object(writer, NULL);
+    json_write_object(writer, "location", &weather_schema_location, &response->location, WEATHER_FIELD_LOCATION);
+    json_write_object(writer, "current", &weather_schema_current, &response->current, WEATHER_FIELD_CURRENT);
+    weather_json_end_object(writer);
+}
+
+/**
+ * Read one hour of a compact column
+ */
+static long long json_column_value(const weather_hours_t *hours, const weather_column_t *column, int index) {
+    const char *base = (const char *)hours + column->offset;
+    switch (column->type) {
+        case WEATHER_COLUMN_INT64:
+            return ((const int64_t *)base)[index];
+        case WEATHER_COLUMN_INT16:
+            return ((const int16_t *)base)[index];
+        case WEATHER_COLUMN_UINT16:
+            return ((const uint16_t *)base)[index];
+        case WEATHER_COLUMN_INT8:
+            return ((const int8_t *)base)[index];
+        default:
+            return ((const uint8_t *)base)[index];
+    }
+}
+
+/**
+ * Hour member a day's hours are written with
+ */
+typedef struct {
+    const weather_member_t *member;
+    const weather_column_t *column;         // NULL if unpacked
+    int field;                              // Field id of the member
+} json_hour_plan_t;
+
+/**
+ * Look up the selected hour members once per day
+ * @param plan Filled with up to WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR members
+ * @return Number of members
+ */
+static int json_plan_hours(const weather_json_writer_t *writer, json_hour_plan_t *plan) {
+    const weather_schema_t *schema = &weather_schema_hour;
+    int planned = 0;
+    int field = WEATHER_FIELD_HOUR;
+    for (int i = 0; i < schema->count; i++) {
+        const weather_member_t *member = &schema->members[i];
+        int width = member->type == WEATHER_MEMBER_CONDITION ? weather_schema_condition.width : 1;
+        if (weather_fields_any(writer->fields, field, field + width - 1)) {
+            plan[planned].member = member;
+            plan[planned].column = weather_hours_column(member->offset);
+            plan[planned].field = field;
+            planned++;
+        }
+        field += width;
+    }
+    return planned;
+}
+
+/**
+ * Write one day's hours straight from the compact layout, one object per hour
+ * Members stored as scaled integers are written from their columns,
+ * conditions from the shared table; the others are unpacked one at a time.
+ */
+static void json_write_hour_rows(weather_json_writer_t *writer, const weather_hours_t *hours) {
+    json_hour_plan_t plan[WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR];
+    int planned = json_plan_hours(writer, plan);
+    forecast_hour_t hour;
+    
+    weather_json_begin_array(writer, "hour");
+    for (int h = 0; h < hours->count; h++) {
+        weather_json_begin_object(writer, NULL);
+        for (int i = 0; i < planned; i++) {
+            const weather_member_t *member = plan[i].member;
+            const char *value = (const char *)&hour + member->offset;
+            
+            if (plan[i].column) {
+                weather_json_fixed(writer, member->name, json_column_value(hours, plan[i].column, h),
+                                   plan[i].column->decimals);
+                continue;
+            }
+            if (member->type == WEATHER_MEMBER_CONDITION) {
+                // Written from the shared table rather than copied out of it
+                json_write_object(writer, member->name, &weather_schema_condition,
+                                  weather_condition_lookup(hours->condition[h]), plan[i].field);
+                continue;
+            }
+            weather_hours_get_member(hours, h, member->offset, &hour);
+            json_write_value(writer, member->name, member, value);
+        }
+        weather_json_end_object(writer);
+    }
+    weather_json_end_array(writer);
+}
+
+/**
+ * Write one day's hours as one array per member (WEATHER_HOURLY_COLUMNS)
+ * Each array is filled from the member's compact column in one pass;
+ * conditions become an object of text, icon and code arrays.
+ */
+static void json_write_hour_columns(weather_json_writer_t *writer, const weather_hours_t *hours) {
+    json_hour_plan_t plan[WEATHER_FIELD_COUNT - WEATHER_FIELD_HOUR];
+    int planned = json_plan_hours(writer, plan);
+    forecast_hour_t hour;
+    
+    weather_json_begin_object(writer, "hour");
+    for (int i = 0; i < planned; i++) {
+        const weather_member_t *member = plan[i].member;
+        
+        if (member->type == WEATHER_MEMBER_CONDITION) {
+            weather_json_begin_object(writer, member->name);
+            for (int c = 0; c < weather_schema_condition.count; c++) {
+                const weather_member_t *part = &weather_schema_condition.members[c];
+                if (!json_selected(writer, plan[i].field + c)) {
+                    continue;
+                }
+                weather_json_begin_array(writer, part->name);
+                for (int h = 0; h < hours->count; h++) {
+                    const char *condition = (const char *)weather_condition_lookup(hours->condition[h]);
+                    json_write_value(writer, NULL, part, condition + part->offset);
+                }
+                weather_json_end_array(writer);
+            }
+            weather_json_end_object(writer);
+            continue;
+        }
+        
+        weather_json_begin_array(writer, member->name);
+        if (plan[i].column) {
+            for (int h = 0; h < hours->count; h++) {
+                weather_json_fixed(writer, NULL, json_column_value(hours, plan[i].column, h),
+                                   plan[i].column->decimals);
+            }
+        } else {
+            for (int h = 0; h < hours->count; h++) {
+                weather_hours_get_member(hours, h, member->offset, &hour);
+                json_write_value(writer, NULL, member, (const char *)&hour + member->offset);
+            }
+        }
+        weather_json_end_array(writer);
+    }
+    weather_json_end_object(writer);
+}
+
+void weather_json_write_forecast_head(weather_json_writer_t *writer, const weather_result_t *result) {
+    weather_json_begin_object(writer, NULL);
+    json_write_object(writer, "location", &weather_schema_location, &result->forecast.location,
+                      WEATHER_FIELD_LOCATION);
+    
+    if (weather_fields_any(writer->fields, WEATHER_FIELDS_FORECAST)) {
+        weather_json_begin_object(writer, "forecast");
+        weather_json_begin_array(writer, "forecastday");
+    }
+}
+
+void weather_json_write_forecast_day(weather_json_writer_t *writer, const weather_result_t *result, int day,
+                                     int include_hourly) {
+    const forecast_daily_t *daily = &result->forecast.forecast[day];
+    
+    weather_json_begin_object(writer, NULL);
+    json_write_members(writer, &weather_schema_daily, daily, WEATHER_FIELD_DAILY);
+    json_write_object(writer, "day", &weather_schema_day, &daily->day, WEATHER_FIELD_DAY);
+    json_write_object(writer, "astro", &weather_schema_astro, &daily->astro, WEATHER_FIELD_ASTRO);
+    
+    const weather_hours_t *hours = NULL;
+    if (include_hourly && weather_fields_any(writer->fields, WEATHER_FIELDS_HOUR)) {
+        hours = weather_result_hours(result, day);
+    }
+    if (hours && include_hourly == WEATHER_HOURLY_COLUMNS) {
+        json_write_hour_columns(writer, hours);
+    } else if (hours) {
+        json_write_hour_rows(writer, hours);
+    }
+    
+    weather_json_end_object(writer);
+}
+
+void weather_json_write_forecast_tail(weather_json_writer_t *writer) {
+    if (weather_fields_any(writer->fields, WEATHER_FIELDS_FORECAST)) {
+        weather_json_end_array(writer);
+        weather_json_end_object(writer);
+    }
+    
+    weather_json_end_object(writer);
+}
+
+const char *weather_json_day_separator(int pretty) {
+    return pretty ? ", " : ",";
+}
+
+void weather_json_write_forecast(weather_json_writer_t *writer, const weather_result_t *result, int include_hourly) {
+    weather_json_write_forecast_head(writer, result);
+    int days = weather_fields_any(writer->fields, WEATHER_FIELDS_FORECAST) ? result->forecast.forecast_days : 0;
+    for (int i = 0; i < days; i++) {
+        weather_json_write_forecast_day(writer, result, i, include_hourly);
+    }
+    weather_json_write_forecast_tail(writer);
+}
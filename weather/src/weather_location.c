@@ -0,0 +1,644 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "weather_location.h"
+
+#define LOCATION_BUCKETS 16384          // Hash chains (power of two)
+#define CANONICAL_SIZE WEATHER_LOCATION_POINT_SIZE
+#define POINT_BUCKETS 65536             // Grid cell chains (power of two)
+#define CELLS_PER_RADIUS 2              // Grid cells are half a radius wide
+#define MIN_CELL_DEGREES 0.01           // The coordinate quantum
+#define EARTH_RADIUS_KM 6371.0088       // Mean radius
+#define RADIANS_PER_DEGREE 0.017453292519943295
+#define KM_PER_DEGREE (EARTH_RADIUS_KM * RADIANS_PER_DEGREE)
+
+/**
+ * Base letters of U+00C0 to U+017F, 32 per line; '*' marks the ligatures
+ * spelled out by fold_letter() and '-' the two signs (× and ÷) kept as they are
+ */
+static const char latin_fold[] =
+    "aaaaaa*ceeeeiiiidnooooo-ouuuuy**"      // U+00C0
+    "aaaaaa*ceeeeiiiidnooooo-ouuuuy*y"      // U+00E0
+    "aaaaaaccccccccddddeeeeeeeeeegggg"      // U+0100
+    "gggghhhhiiiiiiiiii**jjkkklllllll"      // U+0120
+    "lllnnnnnnnnnoooooo**rrrrrrssssss"      // U+0140
+    "ssttttttuuuuuuuuuuuuwwyyyzzzzzzs";     // U+0160
+
+/**
+ * Alias or rejection learned for a normalized query
+ */
+typedef struct location_entry {
+    struct location_entry *hash_next;
+    struct location_entry *fifo_next;   // Next younger entry
+    uint64_t hash;
+    time_t expires;
+    int rejected;                       // Upstream has no match (canonical is unused)
+    char canonical[CANONICAL_SIZE];
+    char query[];                       // Normalized query
+} location_entry_t;
+
+static location_entry_t *buckets[LOCATION_BUCKETS];
+static location_entry_t *fifo_head = NULL;     // Oldest entry, dropped first when full
+static location_entry_t *fifo_tail = NULL;
+static size_t entry_count = 0;
+static pthread_rwlock_t index_lock = PTHREAD_RWLOCK_INITIALIZER;
+static unsigned long learned = 0;
+static unsigned long alias_hits = 0;
+static unsigned long rejections = 0;
+static unsigned long rejected_hits = 0;
+
+/**
+ * Coordinates some cache entries are keyed by
+ */
+typedef struct location_point {
+    struct location_point *next;        // Bucket chain
+    long row;                           // Grid cell
+    long column;
+    double lat;
+    double lon;
+    int refs;                           // Cache entries at this point
+    char canonical[CANONICAL_SIZE];
+} location_point_t;
+
+static location_point_t *point_buckets[POINT_BUCKETS];
+static pthread_rwlock_t points_lock = PTHREAD_RWLOCK_INITIALIZER;
+static double radius_km = 0;            // 0: no spatial index
+static double cell_degrees = 1;
+static long cell_rows = 180;
+static long cell_columns = 360;
+static size_t point_count = 0;
+static unsigned long nearby_lookups = 0;
+
+/**
+ * FNV-1a 64-bit hash of a normalized query
+ */
+static uint64_t hash_query(const char *query) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)query; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * ASCII spelling of a Latin letter
+ * @param code_point Code point of the letter
+ * @param single Buffer of two bytes for a single base letter
+ * @return Base letter(s), or NULL to keep the character as it is
+ */
+static const char *fold_letter(unsigned int code_point, char *single) {
+    if (code_point < 0xC0 || code_point > 0x17F) {
+        return NULL;
+    }
+    
+    char letter = latin_fold[code_point - 0xC0];
+    if (letter != '*') {
+        single[0] = letter;
+        single[1] = '\0';
+        return letter == '-' ? NULL : single;
+    }
+    
+    switch (code_point) {
+        case 0xC6:
+        case 0xE6:
+            return "ae";
+        case 0xDE:
+        case 0xFE:
+            return "th";
+        case 0xDF:
+            return "ss";
+        case 0x132:
+        case 0x133:
+            return "ij";
+        default:
+            return "oe";                // U+0152, U+0153
+    }
+}
+
+/**
+ * Write coordinates rounded to WEATHER_LOCATION_DECIMALS, as "lat,lon"
+ * @return 0 on success, -1 if they are out of range or do not fit
+ */
+static int format_coordinates(double lat, double lon, char *out, size_t out_size) {
+    if (!(fabs(lat) <= 90.0) || !(fabs(lon) <= 180.0)) {
+        return -1;
+    }
+    
+    double scale = pow(10.0, WEATHER_LOCATION_DECIMALS);
+    lat = round(lat * scale) / scale;
+    lon = round(lon * scale) / scale;
+    
+    // No "-0.00": both signs of zero are the same place
+    if (lat == 0) {
+        lat = 0;
+    }
+    if (lon == 0) {
+        lon = 0;
+    }
+    
+    int length = snprintf(out, out_size, "%.*f,%.*f", WEATHER_LOCATION_DECIMALS, lat, WEATHER_LOCATION_DECIMALS, lon);
+    return length > 0 && (size_t)length < out_size ? 0 : -1;
+}
+
+/**
+ * Read a "lat,lon" query, with optional spaces around the comma
+ * @return 0 if the query is a coordinate pair, -1 otherwise
+ */
+static int parse_coordinates(const char *query, double *lat_out, double *lon_out) {
+    char *end;
+    double lat = strtod(query, &end);
+    if (end == query) {
+        return -1;
+    }
+    while (isspace((unsigned char)*end)) {
+        end++;
+    }
+    if (*end != ',') {
+        return -1;
+    }
+    
+    const char *lon_start = end + 1;
+    double lon = strtod(lon_start, &end);
+    if (end == lon_start) {
+        return -1;
+    }
+    while (isspace((unsigned char)*end)) {
+        end++;
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    
+    *lat_out = lat;
+    *lon_out = lon;
+    return 0;
+}
+
+/**
+ * Rewrite a "lat,lon" query with WEATHER_LOCATION_DECIMALS fraction digits
+ * @return 0 if the query was a coordinate pair, -1 otherwise
+ */
+static int normalize_coordinates(const char *query, char *out, size_t out_size) {
+    double lat, lon;
+    if (parse_coordinates(query, &lat, &lon) != 0) {
+        return -1;
+    }
+    return format_coordinates(lat, lon, out, out_size);
+}
+
+void weather_location_normalize(const char *query, char *out, size_t out_size) {
+    if (out_size == 0) {
+        return;
+    }
+    if (normalize_coordinates(query, out, out_size) == 0) {
+        return;
+    }
+    
+    size_t len = 0;
+    int pending_space = 0;
+    const unsigned char *p = (const unsigned char *)query;
+    
+    while (*p) {
+        if (isspace(*p)) {
+            pending_space = len > 0;
+            p++;
+            continue;
+        }
+        
+        // Two-byte UTF-8 sequences cover U+0080 to U+07FF; fold U+00C0 to U+017F
+        char single[2];
+        const char *text = NULL;
+        size_t consumed = 1;
+        if (*p >= 0xC3 && *p <= 0xC5 && (p[1] & 0xC0) == 0x80) {
+            text = fold_letter(((unsigned int)(*p & 0x1F) << 6) | (p[1] & 0x3F), single);
+            consumed = text ? 2 : 1;
+        }
+        if (!text) {
+            single[0] = (char)tolower(*p);
+            single[1] = '\0';
+            text = single;
+        }
+        
+        int space = *p != ',' && pending_space && out[len - 1] != ',';
+        size_t text_length = strlen(text);
+        if (len + (space ? 1 : 0) + text_length + 1 > out_size) {
+            break;
+        }
+        if (space) {
+            out[len++] = ' ';
+        }
+        memcpy(out + len, text, text_length);
+        len += text_length;
+        pending_space = 0;
+        p += consumed;
+    }
+    
+    out[len] = '\0';
+}
+
+/**
+ * Find the entry of a normalized query (caller holds index_lock)
+ */
+static location_entry_t *index_find(uint64_t hash, const char *query) {
+    location_entry_t *entry = buckets[hash & (LOCATION_BUCKETS - 1)];
+    while (entry && (entry->hash != hash || strcmp(entry->query, query) != 0)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+/**
+ * Drop the oldest entry (caller holds index_lock for writing)
+ */
+static void index_evict(void) {
+    location_entry_t *entry = fifo_head;
+    fifo_head = entry->fifo_next;
+    if (!fifo_head) {
+        fifo_tail = NULL;
+    }
+    
+    location_entry_t **link = &buckets[entry->hash & (LOCATION_BUCKETS - 1)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    entry_count--;
+    free(entry);
+}
+
+/**
+ * Record an alias or a rejection for a normalized query
+ * @return 1 if the entry is new or changed, 0 if it only had its expiry renewed
+ */
+static int index_store(const char *query, const char *canonical, int rejected, time_t expires) {
+    uint64_t hash = hash_query(query);
+    int changed = 1;
+    
+    pthread_rwlock_wrlock(&index_lock);
+    location_entry_t *entry = index_find(hash, query);
+    if (entry) {
+        changed = entry->rejected != rejected || strcmp(entry->canonical, canonical) != 0;
+    } else {
+        size_t query_size = strlen(query) + 1;
+        entry = calloc(1, sizeof(location_entry_t) + query_size);
+        if (!entry) {
+            pthread_rwlock_unlock(&index_lock);
+            fprintf(stderr, "Failed to allocate location index entry\n");
+            return 0;
+        }
+        if (entry_count >= WEATHER_LOCATION_MAX_ENTRIES) {
+            index_evict();
+        }
+        
+        memcpy(entry->query, query, query_size);
+        entry->hash = hash;
+        location_entry_t **bucket = &buckets[hash & (LOCATION_BUCKETS - 1)];
+        entry->hash_next = *bucket;
+        *bucket = entry;
+        if (fifo_tail) {
+            fifo_tail->fifo_next = entry;
+        } else {
+            fifo_head = entry;
+        }
+        fifo_tail = entry;
+        entry_count++;
+    }
+    
+    snprintf(entry->canonical, sizeof(entry->canonical), "%s", canonical);
+    entry->rejected = rejected;
+    entry->expires = expires;
+    pthread_rwlock_unlock(&index_lock);
+    
+    return changed;
+}
+
+void weather_location_canonical(const char *query, char *out, size_t out_size) {
+    char normalized[WEATHER_LOCATION_SIZE];
+    weather_location_normalize(query, normalized, sizeof(normalized));
+    
+    uint64_t hash = hash_query(normalized);
+    time_t now = time(NULL);
+    
+    pthread_rwlock_rdlock(&index_lock);
+    const location_entry_t *entry = index_find(hash, normalized);
+    int aliased = entry && !entry->rejected && entry->expires > now;
+    snprintf(out, out_size, "%s", aliased ? entry->canonical : normalized);
+    pthread_rwlock_unlock(&index_lock);
+    
+    if (aliased) {
+        __atomic_add_fetch(&alias_hits, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void weather_location_learn(const char *query, const location_t *location) {
+    if (!query || !location || !location->name[0]) {
+        return;
+    }
+    
+    char normalized[WEATHER_LOCATION_SIZE];
+    char canonical[CANONICAL_SIZE];
+    weather_location_normalize(query, normalized, sizeof(normalized));
+    if (format_coordinates(location->lat, location->lon, canonical, sizeof(canonical)) != 0) {
+        return;
+    }
+    
+    // A coordinate query upstream answered in place needs no alias
+    if (strcmp(normalized, canonical) == 0) {
+        return;
+    }
+    
+    if (index_store(normalized, canonical, 0, time(NULL) + WEATHER_LOCATION_ALIAS_SECONDS)) {
+        __atomic_add_fetch(&learned, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void weather_location_reject(const char *query) {
+    if (!query) {
+        return;
+    }
+    
+    char normalized[WEATHER_LOCATION_SIZE];
+    weather_location_normalize(query, normalized, sizeof(normalized));
+    index_store(normalized, "", 1, time(NULL) + WEATHER_LOCATION_REJECT_SECONDS);
+    __atomic_add_fetch(&rejections, 1, __ATOMIC_RELAXED);
+}
+
+int weather_location_rejected(const char *query) {
+    if (!query) {
+        return 0;
+    }
+    
+    char normalized[WEATHER_LOCATION_SIZE];
+    weather_location_normalize(query, normalized, sizeof(normalized));
+    
+    uint64_t hash = hash_query(normalized);
+    time_t now = time(NULL);
+    
+    pthread_rwlock_rdlock(&index_lock);
+    const location_entry_t *entry = index_find(hash, normalized);
+    int rejected = entry && entry->rejected && entry->expires > now;
+    pthread_rwlock_unlock(&index_lock);
+    
+    if (rejected) {
+        __atomic_add_fetch(&rejected_hits, 1, __ATOMIC_RELAXED);
+    }
+    return rejected;
+}
+
+/**
+ * Great-circle (haversine) distance between two points
+ */
+static double distance_km(double lat1, double lon1, double lat2, double lon2) {
+    double dlat = (lat2 - lat1) * RADIANS_PER_DEGREE;
+    double dlon = (lon2 - lon1) * RADIANS_PER_DEGREE;
+    double a = sin(dlat / 2) * sin(dlat / 2) +
+               cos(lat1 * RADIANS_PER_DEGREE) * cos(lat2 * RADIANS_PER_DEGREE) * sin(dlon / 2) * sin(dlon / 2);
+    return 2 * EARTH_RADIUS_KM * asin(sqrt(a < 1 ? a : 1));
+}
+
+static long cell_row(double lat) {
+    long row = (long)floor((lat + 90.0) / cell_degrees);
+    return row < cell_rows ? row : cell_rows - 1;
+}
+
+/**
+ * Grid column of a longitude, wrapping around the antimeridian
+ */
+static long cell_column(double lon) {
+    long column = (long)floor((lon + 180.0) / cell_degrees) % cell_columns;
+    return column < 0 ? column + cell_columns : column;
+}
+
+static size_t cell_bucket(long row, long column) {
+    uint64_t hash = (uint64_t)row * 0x9E3779B97F4A7C15ULL ^ (uint64_t)column * 0xC2B2AE3D27D4EB4FULL;
+    return (size_t)(hash >> 32) & (POINT_BUCKETS - 1);
+}
+
+void weather_location_set_radius(double radius) {
+    pthread_rwlock_wrlock(&points_lock);
+    if (point_count == 0) {
+        radius_km = radius > 0 ? fmin(radius, WEATHER_LOCATION_MAX_RADIUS_KM) : 0;
+        cell_degrees = radius_km > 0 ? fmax(radius_km / KM_PER_DEGREE / CELLS_PER_RADIUS, MIN_CELL_DEGREES) : 1;
+        cell_rows = (long)ceil(180.0 / cell_degrees);
+        cell_columns = (long)ceil(360.0 / cell_degrees);
+    }
+    pthread_rwlock_unlock(&points_lock);
+}
+
+/**
+ * Copy a canonical form that is a normalized coordinate pair
+ * @return 0 with its coordinates, -1 for anything else
+ */
+static int point_parse(const char *canonical, size_t length, char *out, double *lat, double *lon) {
+    char formatted[CANONICAL_SIZE];
+    if (length == 0 || length >= CANONICAL_SIZE) {
+        return -1;
+    }
+    memcpy(out, canonical, length);
+    out[length] = '\0';
+    
+    // Only exactly what normalization writes, so cache keys can be rebuilt from it
+    if (parse_coordinates(out, lat, lon) != 0 ||
+        format_coordinates(*lat, *lon, formatted, sizeof(formatted)) != 0 || strcmp(formatted, out) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+void weather_location_point_add(const char *canonical, size_t length) {
+    char text[CANONICAL_SIZE];
+    double lat, lon;
+    // The radius is set once at startup
+    if (radius_km == 0 || point_parse(canonical, length, text, &lat, &lon) != 0) {
+        return;
+    }
+    
+    pthread_rwlock_wrlock(&points_lock);
+    long row = cell_row(lat);
+    long column = cell_column(lon);
+    location_point_t **bucket = &point_buckets[cell_bucket(row, column)];
+    location_point_t *point = *bucket;
+    while (point && strcmp(point->canonical, text) != 0) {
+        point = point->next;
+    }
+    
+    if (!point) {
+        point = calloc(1, sizeof(location_point_t));
+        if (!point) {
+            pthread_rwlock_unlock(&points_lock);
+            fprintf(stderr, "Failed to allocate location point\n");
+            return;
+        }
+        strcpy(point->canonical, text);
+        point->row = row;
+        point->column = column;
+        point->lat = lat;
+        point->lon = lon;
+        point->next = *bucket;
+        *bucket = point;
+        point_count++;
+    }
+    point->refs++;
+    pthread_rwlock_unlock(&points_lock);
+}
+
+void weather_location_point_remove(const char *canonical, size_t length) {
+    char text[CANONICAL_SIZE];
+    double lat, lon;
+    if (radius_km == 0 || point_parse(canonical, length, text, &lat, &lon) != 0) {
+        return;
+    }
+    
+    pthread_rwlock_wrlock(&points_lock);
+    location_point_t **link = &point_buckets[cell_bucket(cell_row(lat), cell_column(lon))];
+    while (*link && strcmp((*link)->canonical, text) != 0) {
+        link = &(*link)->next;
+    }
+    
+    location_point_t *point = *link;
+    if (point && --point->refs == 0) {
+        *link = point->next;
+        point_count--;
+        free(point);
+    }
+    pthread_rwlock_unlock(&points_lock);
+}
+
+/**
+ * Keep a point if it is among the nearest found so far (sorted by distance)
+ */
+static void nearby_insert(weather_location_match_t *matches, int *count, int max_matches,
+                          const location_point_t *point, double distance) {
+    int i = *count;
+    if (i == max_matches) {
+        if (matches[i - 1].distance_km <= distance) {
+            return;
+        }
+        i--;
+    } else {
+        (*count)++;
+    }
+    
+    while (i > 0 && matches[i - 1].distance_km > distance) {
+        matches[i] = matches[i - 1];
+        i--;
+    }
+    strcpy(matches[i].location, point->canonical);
+    matches[i].distance_km = distance;
+}
+
+int weather_location_nearby(const char *query, const char *exclude,
+                            weather_location_match_t *matches, int max_matches) {
+    double lat, lon;
+    if (radius_km == 0 || !query || max_matches <= 0 || parse_coordinates(query, &lat, &lon) != 0 ||
+        !(fabs(lat) <= 90.0) || !(fabs(lon) <= 180.0)) {
+        return 0;
+    }
+    __atomic_add_fetch(&nearby_lookups, 1, __ATOMIC_RELAXED);
+    
+    // Rows covering the radius, and enough columns to cover it on the row nearest a pole
+    double radius_degrees = radius_km / KM_PER_DEGREE;
+    long first_row = cell_row(fmax(lat - radius_degrees, -90.0));
+    long last_row = cell_row(fmin(lat + radius_degrees, 90.0));
+    long first_column = 0;
+    long columns = cell_columns;
+    double widest = fabs(lat) + radius_degrees;
+    if (widest < 89.0) {
+        long half = (long)ceil(radius_degrees / cos(widest * RADIANS_PER_DEGREE) / cell_degrees);
+        if (2 * half + 1 < cell_columns) {
+            first_column = cell_column(lon) - half;
+            columns = 2 * half + 1;
+        }
+    }
+    
+    // Rows are read outward from the query's so the nearest points come early;
+    // the latitude gap alone is a lower bound on distance, which skips whole
+    // rows and most points once max_matches are found
+    int count = 0;
+    long center = cell_row(lat);
+    pthread_rwlock_rdlock(&points_lock);
+    for (long k = 0; k <= 2 * (last_row - first_row); k++) {
+        long row = center + (k % 2 ? (k + 1) / 2 : -k / 2);
+        if (row < first_row || row > last_row) {
+            continue;
+        }
+        double limit = count == max_matches ? matches[count - 1].distance_km : radius_km;
+        double south = row * cell_degrees - 90.0;
+        if (fmax(south - lat, lat - (south + cell_degrees)) * KM_PER_DEGREE > limit) {
+            continue;
+        }
+        for (long i = 0; i < columns; i++) {
+            long column = (first_column + i + cell_columns) % cell_columns;
+            const location_point_t *point = point_buckets[cell_bucket(row, column)];
+            for (; point; point = point->next) {
+                if (point->row != row || point->column != column ||
+                    (exclude && strcmp(point->canonical, exclude) == 0)) {
+                    continue;
+                }
+                limit = count == max_matches ? matches[count - 1].distance_km : radius_km;
+                if (fabs(point->lat - lat) * KM_PER_DEGREE > limit) {
+                    continue;
+                }
+                double distance = distance_km(lat, lon, point->lat, point->lon);
+                if (distance <= radius_km) {
+                    nearby_insert(matches, &count, max_matches, point, distance);
+                }
+            }
+        }
+    }
+    pthread_rwlock_unlock(&points_lock);
+    
+    return count;
+}
+
+void weather_location_cleanup(void) {
+    pthread_rwlock_wrlock(&points_lock);
+    for (size_t i = 0; i < POINT_BUCKETS; i++) {
+        while (point_buckets[i]) {
+            location_point_t *next = point_buckets[i]->next;
+            free(point_buckets[i]);
+            point_buckets[i] = next;
+        }
+    }
+    point_count = 0;
+    nearby_lookups = 0;
+    pthread_rwlock_unlock(&points_lock);
+    
+    pthread_rwlock_wrlock(&index_lock);
+    while (fifo_head) {
+        location_entry_t *next = fifo_head->fifo_next;
+        free(fifo_head);
+        fifo_head = next;
+    }
+    fifo_tail = NULL;
+    memset(buckets, 0, sizeof(buckets));
+    entry_count = 0;
+    learned = alias_hits = rejections = rejected_hits = 0;
+    pthread_rwlock_unlock(&index_lock);
+}
+
+void weather_location_get_stats(weather_location_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    pthread_rwlock_rdlock(&index_lock);
+    stats->entries = entry_count;
+    pthread_rwlock_unlock(&index_lock);
+    stats->learned = __atomic_load_n(&learned, __ATOMIC_RELAXED);
+    stats->alias_hits = __atomic_load_n(&alias_hits, __ATOMIC_RELAXED);
+    stats->rejections = __atomic_load_n(&rejections, __ATOMIC_RELAXED);
+    stats->rejected_hits = __atomic_load_n(&rejected_hits, __ATOMIC_RELAXED);
+    
+    pthread_rwlock_rdlock(&points_lock);
+    stats->points = point_count;
+    pthread_rwlock_unlock(&points_lock);
+    stats->nearby_lookups = __atomic_load_n(&nearby_lookups, __ATOMIC_RELAXED);
+}
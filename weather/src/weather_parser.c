@@ -0,0 +1,1500 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <pthread.h>
+#include "weather_parser.h"
+#include "weather_compact.h"
+#include "weather_arena.h"
+#include "weather_fields.h"
+
+#define PARSER_MAX_DEPTH 64         // Deepest nesting accepted
+#define PARSER_TOKEN_SIZE 512       // Longest string kept (largest field is 256 bytes)
+#define PARSER_NUMBER_SIZE 64       // Longest number kept, as cJSON
+#define PARSER_MAX_DAYS 14          // WeatherAPI returns at most 14 days...
+#define PARSER_MAX_HOURS WEATHER_HOURS_MAX // ...of 24 hours; extra entries are skipped
+
+#define FIELD_SLOTS 256             // Perfect hash table size (power of two)
+#define FIELD_BUCKETS 64            // First-level buckets for the displacements
+
+/**
+ * Objects whose fields are parsed into a struct
+ */
+typedef enum {
+    KIND_SKIP,                      // Unknown object or array, skipped
+    KIND_CURRENT_ROOT,              // current.json body (weather_response_t)
+    KIND_FORECAST_ROOT,             // forecast.json body (forecast_response_t)
+    KIND_FORECAST,                  // "forecast" (forecast_response_t)
+    KIND_FORECASTDAY,               // "forecastday" element (forecast_daily_t)
+    KIND_LOCATION,
+    KIND_CURRENT,
+    KIND_CONDITION,
+    KIND_DAY,
+    KIND_ASTRO,
+    KIND_HOUR,
+    KIND_CURRENT_STAMP,             // Retained "current": only its timestamp is parsed
+    KIND_COUNT
+} object_kind_t;
+
+typedef enum {
+    FIELD_STRING,
+    FIELD_DOUBLE,
+    FIELD_INT,
+    FIELD_LONG,
+    FIELD_OBJECT,                   // Nested object parsed as kind "child"
+    FIELD_DAYS,                     // forecastday array of forecast_daily_t
+    FIELD_HOURS                     // hour array, packed into weather_hours_t
+} field_type_t;
+
+/**
+ * Where a JSON field lands in its struct
+ */
+typedef struct {
+    const char *name;
+    uint8_t type;
+    uint8_t child;                  // Object kind (FIELD_OBJECT)
+    uint16_t size;                  // Buffer size (FIELD_STRING)
+    uint32_t offset;                // Offset in the struct of the enclosing object
+} field_spec_t;
+
+#define STRING_FIELD(s, f) {#f, FIELD_STRING, KIND_SKIP, sizeof(((s *)0)->f), offsetof(s, f)}
+#define DOUBLE_FIELD(s, f) {#f, FIELD_DOUBLE, KIND_SKIP, 0, offsetof(s, f)}
+#define INT_FIELD(s, f) {#f, FIELD_INT, KIND_SKIP, 0, offsetof(s, f)}
+#define LONG_FIELD(s, f) {#f, FIELD_LONG, KIND_SKIP, 0, offsetof(s, f)}
+#define OBJECT_FIELD(s, f, kind) {#f, FIELD_OBJECT, kind, 0, offsetof(s, f)}
+
+// Struct members, from the tables in weather_fields.h
+#define MEMBER_FIELD(arg, s, f, type) MEMBER_FIELD_##type(s, f),
+#define MEMBER_FIELD_STRING(s, f) STRING_FIELD(s, f)
+#define MEMBER_FIELD_TIME(s, f) STRING_FIELD(s, f)
+#define MEMBER_FIELD_DOUBLE(s, f) DOUBLE_FIELD(s, f)
+#define MEMBER_FIELD_INT(s, f) INT_FIELD(s, f)
+#define MEMBER_FIELD_LONG(s, f) LONG_FIELD(s, f)
+#define MEMBER_FIELD_CONDITION(s, f) OBJECT_FIELD(s, f, KIND_CONDITION)
+
+static const field_spec_t current_root_fields[] = {
+    OBJECT_FIELD(weather_response_t, location, KIND_LOCATION),
+    OBJECT_FIELD(weather_response_t, current, KIND_CURRENT),
+};
+
+static const field_spec_t forecast_root_fields[] = {
+    OBJECT_FIELD(forecast_response_t, location, KIND_LOCATION),
+    OBJECT_FIELD(forecast_response_t, current, KIND_CURRENT),
+    {"forecast", FIELD_OBJECT, KIND_FORECAST, 0, 0},
+};
+
+static const field_spec_t forecast_fields[] = {
+    {"forecastday", FIELD_DAYS, KIND_FORECASTDAY, 0, 0},
+};
+
+static const field_spec_t forecastday_fields[] = {
+    WEATHER_DAILY_MEMBERS(MEMBER_FIELD, 0)
+    OBJECT_FIELD(forecast_daily_t, day, KIND_DAY),
+    OBJECT_FIELD(forecast_daily_t, astro, KIND_ASTRO),
+    {"hour", FIELD_HOURS, KIND_HOUR, 0, 0},
+};
+
+static const field_spec_t location_fields[] = {WEATHER_LOCATION_MEMBERS(MEMBER_FIELD, 0)};
+static const field_spec_t current_fields[] = {WEATHER_CURRENT_MEMBERS(MEMBER_FIELD, 0)};
+static const field_spec_t condition_fields[] = {WEATHER_CONDITION_MEMBERS(MEMBER_FIELD, 0)};
+static const field_spec_t day_fields[] = {WEATHER_DAY_MEMBERS(MEMBER_FIELD, 0)};
+static const field_spec_t astro_fields[] = {WEATHER_ASTRO_MEMBERS(MEMBER_FIELD, 0)};
+static const field_spec_t hour_fields[] = {WEATHER_HOUR_MEMBERS(MEMBER_FIELD, 0)};
+
+static const field_spec_t current_stamp_fields[] = {
+    LONG_FIELD(current_weather_t, last_updated_epoch),
+};
+
+#define FIELD_TABLE(table) {table, sizeof(table) / sizeof(table[0])}
+
+static const struct {
+    const field_spec_t *fields;
+    size_t count;
+} kind_tables[KIND_COUNT] = {
+    [KIND_SKIP] = {NULL, 0},
+    [KIND_CURRENT_ROOT] = FIELD_TABLE(current_root_fields),
+    [KIND_FORECAST_ROOT] = FIELD_TABLE(forecast_root_fields),
+    [KIND_FORECAST] = FIELD_TABLE(forecast_fields),
+    [KIND_FORECASTDAY] = FIELD_TABLE(forecastday_fields),
+    [KIND_LOCATION] = FIELD_TABLE(location_fields),
+    [KIND_CURRENT] = FIELD_TABLE(current_fields),
+    [KIND_CONDITION] = FIELD_TABLE(condition_fields),
+    [KIND_DAY] = FIELD_TABLE(day_fields),
+    [KIND_ASTRO] = FIELD_TABLE(astro_fields),
+    [KIND_HOUR] = FIELD_TABLE(hour_fields),
+    [KIND_CURRENT_STAMP] = FIELD_TABLE(current_stamp_fields),
+};
+
+/**
+ * Perfect hash slot: one distinct field name and its meaning in every kind
+ */
+typedef struct {
+    const char *name;               // NULL for an empty slot
+    uint8_t length;
+    uint8_t field[KIND_COUNT];      // 1-based index into kind_tables, 0 = not a field there
+} field_slot_t;
+
+static field_slot_t field_slots[FIELD_SLOTS];
+static uint16_t field_displacements[FIELD_BUCKETS];
+static int field_table_status = -1;
+static pthread_once_t field_table_once = PTHREAD_ONCE_INIT;
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * Slot for a name hash under a bucket displacement
+ * The high half of the hash is forced odd so the probe sequence visits
+ * every slot of the power-of-two table.
+ */
+static unsigned int field_slot_index(uint64_t hash, unsigned int displacement) {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1u;
+    return (h1 + displacement * h2) & (FIELD_SLOTS - 1);
+}
+
+static uint64_t field_name_hash(const char *name, size_t length) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * Build the perfect hash over every field name (hash and displace)
+ * Names are grouped into buckets by hash; the largest buckets are placed
+ * first, each with the smallest displacement that lands all its names on
+ * free slots. A lookup is then one hash, one probe and one compare.
+ */
+static void field_table_build(void) {
+    const char *names[FIELD_SLOTS];
+    uint64_t hashes[FIELD_SLOTS];
+    size_t name_count = 0;
+    
+    // Collect distinct names
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        for (size_t i = 0; i < kind_tables[kind].count; i++) {
+            const char *name = kind_tables[kind].fields[i].name;
+            size_t n = 0;
+            while (n < name_count && strcmp(names[n], name) != 0) {
+                n++;
+            }
+            if (n == name_count) {
+                if (name_count == FIELD_SLOTS) {
+                    fprintf(stderr, "Too many JSON field names for the parser table\n");
+                    return;
+                }
+                names[name_count] = name;
+                hashes[name_count] = field_name_hash(name, strlen(name));
+                name_count++;
+            }
+        }
+    }
+    
+    // Place buckets, largest first
+    int bucket_size[FIELD_BUCKETS] = {0};
+    for (size_t n = 0; n < name_count; n++) {
+        bucket_size[hashes[n] & (FIELD_BUCKETS - 1)]++;
+    }
+    
+    int placed[FIELD_BUCKETS] = {0};
+    for (int round = 0; round < FIELD_BUCKETS; round++) {
+        int bucket = -1;
+        for (int b = 0; b < FIELD_BUCKETS; b++) {
+            if (!placed[b] && (bucket < 0 || bucket_size[b] > bucket_size[bucket])) {
+                bucket = b;
+            }
+        }
+        placed[bucket] = 1;
+        if (bucket_size[bucket] == 0) {
+            continue;
+        }
+        
+        unsigned int displacement;
+        for (displacement = 0; displacement < 65536; displacement++) {
+            unsigned int slots[FIELD_SLOTS];
+            int count = 0;
+            int fits = 1;
+            for (size_t n = 0; n < name_count && fits; n++) {
+                if ((hashes[n] & (FIELD_BUCKETS - 1)) != (uint64_t)bucket) {
+                    continue;
+                }
+                unsigned int slot = field_slot_index(hashes[n], displacement);
+                fits = field_slots[slot].name == NULL;
+                for (int i = 0; i < count && fits; i++) {
+                    fits = slots[i] != slot;
+                }
+                slots[count++] = slot;
+            }
+            if (fits) {
+                break;
+            }
+        }
+        if (displacement == 65536) {
+            fprintf(stderr, "Failed to build the parser field table\n");
+            return;
+        }
+        
+        field_displacements[bucket] = (uint16_t)displacement;
+        for (size_t n = 0; n < name_count; n++) {
+            if ((hashes[n] & (FIELD_BUCKETS - 1)) == (uint64_t)bucket) {
+                field_slot_t *slot = &field_slots[field_slot_index(hashes[n], displacement)];
+                slot->name = names[n];
+                slot->length = (uint8_t)strlen(names[n]);
+            }
+        }
+    }
+    
+    // Record what each name means in each kind
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        for (size_t i = 0; i < kind_tables[kind].count; i++) {
+            const char *name = kind_tables[kind].fields[i].name;
+            uint64_t hash = field_name_hash(name, strlen(name));
+            unsigned int slot = field_slot_index(hash, field_displacements[hash & (FIELD_BUCKETS - 1)]);
+            field_slots[slot].field[kind] = (uint8_t)(i + 1);
+        }
+    }
+    
+    field_table_status = 0;
+}
+
+/**
+ * Look up a field of an object kind by its name and precomputed hash
+ */
+static const field_spec_t *field_lookup(int kind, uint64_t hash, const char *name, size_t length) {
+    const field_slot_t *slot = &field_slots[field_slot_index(hash, field_displacements[hash & (FIELD_BUCKETS - 1)])];
+    if (slot->length != length || !slot->name || memcmp(slot->name, name, length) != 0) {
+        return NULL;
+    }
+    int index = slot->field[kind];
+    return index ? &kind_tables[kind].fields[index - 1] : NULL;
+}
+
+static const field_spec_t *field_named(int kind, const char *name) {
+    size_t length = strlen(name);
+    return field_lookup(kind, field_name_hash(name, length), name, length);
+}
+
+/**
+ * Retained sections, numbered by their bit in weather_lazy.pending
+ */
+#define LAZY_HOURS(day) (day)                           // Day's "hour" array
+#define LAZY_ASTRO(day) (PARSER_MAX_DAYS + (day))       // Day's "astro" object
+#define LAZY_CURRENT (2 * PARSER_MAX_DAYS)              // Top-level "current" object
+#define LAZY_SECTIONS (2 * PARSER_MAX_DAYS + 1)
+
+#define LAZY_MIN_CAPACITY 16384     // First raw buffer allocation
+
+typedef struct {
+    uint32_t offset;                // Into weather_lazy.raw
+    uint32_t length;
+} lazy_span_t;
+
+struct weather_lazy {
+    pthread_mutex_t lock;           // Held while sections are parsed
+    uint32_t pending;               // Bits of sections not parsed yet
+    lazy_span_t spans[LAZY_SECTIONS];
+    char *raw;                      // Section bytes, copied as received (freed once all are parsed)
+    size_t raw_length;
+    size_t raw_capacity;
+};
+
+/**
+ * Tokenizer states
+ */
+typedef enum {
+    STATE_VALUE,                    // Expecting a value
+    STATE_VALUE_OR_END,             // After '[': a value or ']'
+    STATE_KEY_OR_END,               // After '{': a key or '}'
+    STATE_KEY,                      // After ',' in an object
+    STATE_COLON,                    // After a key
+    STATE_NEXT,                     // After a value: ',' or a closing bracket
+    STATE_STRING,
+    STATE_ESCAPE,                   // After a backslash in a string
+    STATE_UNICODE,                  // Inside \uXXXX
+    STATE_NUMBER,
+    STATE_LITERAL,                  // Inside true, false or null
+    STATE_RAW,                      // Inside a kept section: only brackets and strings matter
+    STATE_DONE,
+    STATE_ERROR
+} parser_state_t;
+
+/**
+ * Open object or array
+ */
+typedef struct {
+    uint8_t kind;                   // Object kind, or element kind for arrays
+    uint8_t is_array;
+    void *target;                   // Struct being filled (arrays: the struct owning the array,
+                                    // or the weather_hours_t an hour array is packed into)
+} parser_frame_t;
+
+struct weather_parser {
+    weather_result_t *result;
+    parser_state_t state;
+    parser_frame_t stack[PARSER_MAX_DEPTH];
+    int depth;
+    const field_spec_t *pending;    // Field the next value belongs to (NULL = skip)
+    forecast_daily_t *days;         // Days being filled...
+    weather_hours_t *hours;         // ...and their compact hours, index for index
+    forecast_hour_t hour;           // Hour being parsed, packed when it ends
+    
+    // Current string or number token
+    char token[PARSER_TOKEN_SIZE];
+    size_t token_length;
+    int token_truncated;
+    int string_is_key;
+    int string_capture;             // Keep the bytes (keys and wanted strings only)
+    uint64_t key_hash;              // FNV-1a of the key, built while scanning
+    
+    // \uXXXX escapes
+    uint32_t unicode;
+    int unicode_digits;
+    uint32_t high_surrogate;        // Waiting for the low half of a surrogate pair
+    
+    const char *literal;
+    size_t literal_position;
+    
+    // Sections kept as raw bytes for weather_result_load()
+    unsigned int lazy_sections;     // WEATHER_SECTION_* to keep
+    weather_lazy_t *lazy;
+    int capture_depth;              // Depth of the frame being kept (0 = none)
+    int capture_section;            // Its LAZY_* number
+    int raw_depth;                  // STATE_RAW: brackets open inside the section
+    int raw_in_string;
+    int raw_escape;
+};
+
+weather_parser_t *weather_parser_create(weather_result_t *result, unsigned int lazy_sections) {
+    if (!result) {
+        return NULL;
+    }
+    
+    pthread_once(&field_table_once, field_table_build);
+    if (field_table_status != 0) {
+        return NULL;
+    }
+    
+    // The parser comes first in its arena so weather_parser_free() can find it.
+    // Forecast days are parsed into room for the most days WeatherAPI
+    // returns, then copied into an arena of the right size by finish.
+    size_t scratch = result->is_forecast ? WEATHER_ARENA_SIZE(PARSER_MAX_DAYS * sizeof(forecast_daily_t)) +
+                                           WEATHER_ARENA_SIZE(PARSER_MAX_DAYS * sizeof(weather_hours_t)) : 0;
+    weather_arena_t *arena = weather_arena_create(WEATHER_ARENA_SIZE(sizeof(weather_parser_t)) + scratch);
+    weather_parser_t *parser = weather_arena_alloc(arena, sizeof(weather_parser_t));
+    if (!parser) {
+        fprintf(stderr, "Failed to allocate JSON parser\n");
+        weather_arena_free(arena);
+        return NULL;
+    }
+    memset(parser, 0, sizeof(weather_parser_t));
+    if (scratch) {
+        parser->days = weather_arena_alloc(arena, PARSER_MAX_DAYS * sizeof(forecast_daily_t));
+        parser->hours = weather_arena_alloc(arena, PARSER_MAX_DAYS * sizeof(weather_hours_t));
+    }
+    
+    parser->result = result;
+    parser->state = STATE_VALUE;
+    parser->lazy_sections = result->is_forecast ? lazy_sections : 0;
+    return parser;
+}
+
+void weather_parser_free(weather_parser_t *parser) {
+    if (parser) {
+        // Days not handed over by weather_parser_finish() live in the parser's arena
+        forecast_response_t *forecast = &parser->result->forecast;
+        if (parser->days && forecast->forecast == parser->days) {
+            forecast->forecast = NULL;
+            forecast->forecast_days = 0;
+            parser->result->hours = NULL;
+        }
+        weather_lazy_free(parser->lazy);
+        weather_arena_free(weather_arena_of(parser));
+    }
+}
+
+static int parser_fail(weather_parser_t *parser) {
+    parser->state = STATE_ERROR;
+    return -1;
+}
+
+/**
+ * A value finished: the enclosing container decides what comes next
+ */
+static void value_end(weather_parser_t *parser) {
+    parser->pending = NULL;
+    parser->state = parser->depth == 0 ? STATE_DONE : STATE_NEXT;
+}
+
+static int push_frame(weather_parser_t *parser, int kind, int is_array, void *target) {
+    if (parser->depth == PARSER_MAX_DEPTH) {
+        return -1;
+    }
+    parser_frame_t *frame = &parser->stack[parser->depth++];
+    frame->kind = (uint8_t)kind;
+    frame->is_array = (uint8_t)is_array;
+    frame->target = target;
+    return 0;
+}
+
+/**
+ * Append a zeroed element to the forecast days (caller checks PARSER_MAX_DAYS)
+ */
+static forecast_daily_t *append_day(weather_parser_t *parser, forecast_response_t *forecast) {
+    forecast->forecast = parser->days;
+    parser->result->hours = parser->hours;
+    memset(&parser->hours[forecast->forecast_days], 0, sizeof(weather_hours_t));
+    forecast_daily_t *daily = &forecast->forecast[forecast->forecast_days++];
+    memset(daily, 0, sizeof(forecast_daily_t));
+    return daily;
+}
+
+/**
+ * Compact hours of a day being filled
+ */
+static weather_hours_t *day_hours(const weather_parser_t *parser, const forecast_daily_t *daily) {
+    return &parser->hours[daily - parser->days];
+}
+
+static int lazy_append(weather_lazy_t *lazy, const char *data, size_t length) {
+    if (lazy->raw_length + length > UINT32_MAX) {
+        return -1;
+    }
+    if (lazy->raw_length + length > lazy->raw_capacity) {
+        size_t capacity = lazy->raw_capacity ? lazy->raw_capacity : LAZY_MIN_CAPACITY;
+        while (capacity < lazy->raw_length + length) {
+            capacity *= 2;
+        }
+        char *raw = realloc(lazy->raw, capacity);
+        if (!raw) {
+            return -1;
+        }
+        lazy->raw = raw;
+        lazy->raw_capacity = capacity;
+    }
+    memcpy(lazy->raw + lazy->raw_length, data, length);
+    lazy->raw_length += length;
+    return 0;
+}
+
+/**
+ * Section a new object or array belongs to, if it is kept instead of parsed
+ * @return LAZY_* number, or -1 to parse it now
+ */
+static int capture_section(const weather_parser_t *parser, const parser_frame_t *top, int kind) {
+    if (!parser->lazy_sections || parser->capture_depth || top->is_array) {
+        return -1;
+    }
+    if (kind == KIND_CURRENT && top->kind == KIND_FORECAST_ROOT) {
+        return (parser->lazy_sections & WEATHER_SECTION_CURRENT) ? LAZY_CURRENT : -1;
+    }
+    if (top->kind != KIND_FORECASTDAY) {
+        return -1;
+    }
+    
+    int day = (int)((forecast_daily_t *)top->target - parser->result->forecast.forecast);
+    if (kind == KIND_ASTRO && (parser->lazy_sections & WEATHER_SECTION_ASTRO)) {
+        return LAZY_ASTRO(day);
+    }
+    if (kind == KIND_HOUR && (parser->lazy_sections & WEATHER_SECTION_HOURS)) {
+        return LAZY_HOURS(day);
+    }
+    return -1;
+}
+
+/**
+ * Start keeping a section; its frame is pushed next
+ */
+static int capture_begin(weather_parser_t *parser, int section) {
+    if (!parser->lazy) {
+        parser->lazy = calloc(1, sizeof(weather_lazy_t));
+        if (!parser->lazy) {
+            fprintf(stderr, "Failed to allocate memory for forecast data\n");
+            return -1;
+        }
+        pthread_mutex_init(&parser->lazy->lock, NULL);
+    }
+    
+    parser->lazy->spans[section].offset = (uint32_t)parser->lazy->raw_length;
+    parser->capture_depth = parser->depth + 1;
+    parser->capture_section = section;
+    parser->raw_depth = 0;
+    parser->raw_in_string = 0;
+    parser->raw_escape = 0;
+    return 0;
+}
+
+/**
+ * Keep the last bytes of a section, up to its closing bracket
+ */
+static int capture_end(weather_parser_t *parser, const char *data, size_t length) {
+    weather_lazy_t *lazy = parser->lazy;
+    if (lazy_append(lazy, data, length) != 0) {
+        fprintf(stderr, "Failed to allocate memory for forecast data\n");
+        return -1;
+    }
+    
+    lazy_span_t *span = &lazy->spans[parser->capture_section];
+    span->length = (uint32_t)(lazy->raw_length - span->offset);
+    lazy->pending |= 1u << parser->capture_section;
+    parser->capture_depth = 0;
+    return 0;
+}
+
+static int begin_object(weather_parser_t *parser) {
+    int kind = KIND_SKIP;
+    void *target = NULL;
+    
+    if (parser->depth == 0) {
+        kind = parser->result->is_forecast ? KIND_FORECAST_ROOT : KIND_CURRENT_ROOT;
+        target = parser->result->is_forecast ? (void *)&parser->result->forecast : (void *)&parser->result->current;
+    } else {
+        parser_frame_t *top = &parser->stack[parser->depth - 1];
+        if (top->is_array && top->kind == KIND_FORECASTDAY &&
+            ((forecast_response_t *)top->target)->forecast_days < PARSER_MAX_DAYS) {
+            kind = KIND_FORECASTDAY;
+            target = append_day(parser, top->target);
+        } else if (top->is_array && top->kind == KIND_HOUR &&
+                   ((weather_hours_t *)top->target)->count < PARSER_MAX_HOURS) {
+            kind = KIND_HOUR;
+            target = &parser->hour;
+            memset(&parser->hour, 0, sizeof(forecast_hour_t));
+        } else if (!top->is_array && parser->pending && parser->pending->type == FIELD_OBJECT) {
+            kind = parser->pending->child;
+            target = (char *)top->target + parser->pending->offset;
+            
+            int section = capture_section(parser, top, kind);
+            if (section >= 0) {
+                if (capture_begin(parser, section) != 0) {
+                    return -1;
+                }
+                // Only the timestamp of a kept current block is needed up front
+                kind = section == LAZY_CURRENT ? KIND_CURRENT_STAMP : KIND_SKIP;
+            }
+        }
+    }
+    
+    if (kind != KIND_SKIP && !target) {
+        fprintf(stderr, "Failed to allocate memory for forecast data\n");
+        return -1;
+    }
+    
+    parser->pending = NULL;
+    parser->state = parser->capture_depth == parser->depth + 1 && kind == KIND_SKIP ? STATE_RAW : STATE_KEY_OR_END;
+    return push_frame(parser, kind, 0, target);
+}
+
+static int begin_array(weather_parser_t *parser) {
+    int kind = KIND_SKIP;
+    void *target = NULL;
+    
+    if (parser->depth > 0 && parser->pending) {
+        void *owner = parser->stack[parser->depth - 1].target;
+        if (parser->pending->type == FIELD_DAYS && !((forecast_response_t *)owner)->forecast) {
+            kind = KIND_FORECASTDAY;
+            target = owner;
+        } else if (parser->pending->type == FIELD_HOURS && day_hours(parser, owner)->count == 0) {
+            int section = capture_section(parser, &parser->stack[parser->depth - 1], KIND_HOUR);
+            if (section >= 0) {
+                if (capture_begin(parser, section) != 0) {
+                    return -1;
+                }
+            } else {
+                kind = KIND_HOUR;
+                target = day_hours(parser, owner);
+            }
+        }
+    }
+    
+    parser->pending = NULL;
+    parser->state = parser->capture_depth == parser->depth + 1 ? STATE_RAW : STATE_VALUE_OR_END;
+    return push_frame(parser, kind, 1, target);
+}
+
+/**
+ * Close an object or array at p
+ * If it ends a kept section, the bytes since capture_from are kept. A
+ * finished hour is packed into its day's compact hours.
+ */
+static int end_container(weather_parser_t *parser, int is_array, const char **capture_from, const char *p) {
+    if (parser->depth == 0 || parser->stack[parser->depth - 1].is_array != is_array) {
+        return -1;
+    }
+    
+    if (!is_array && parser->stack[parser->depth - 1].kind == KIND_HOUR) {
+        weather_hours_append(parser->stack[parser->depth - 2].target, &parser->hour);
+    }
+    
+    if (parser->depth == parser->capture_depth) {
+        if (capture_end(parser, *capture_from, (size_t)(p + 1 - *capture_from)) != 0) {
+            return -1;
+        }
+        *capture_from = NULL;
+    }
+    
+    parser->depth--;
+    value_end(parser);
+    return 0;
+}
+
+static void begin_string(weather_parser_t *parser, int is_key) {
+    parser->string_is_key = is_key;
+    parser->string_capture = is_key || (parser->pending && parser->pending->type == FIELD_STRING);
+    parser->token_length = 0;
+    parser->token_truncated = 0;
+    parser->key_hash = FNV_OFFSET;
+    parser->state = STATE_STRING;
+}
+
+static void token_append(weather_parser_t *parser, const char *data, size_t length) {
+    if (!parser->string_capture) {
+        return;
+    }
+    if (parser->string_is_key) {
+        for (size_t i = 0; i < length; i++) {
+            parser->key_hash = (parser->key_hash ^ (unsigned char)data[i]) * FNV_PRIME;
+        }
+    }
+    
+    size_t room = PARSER_TOKEN_SIZE - 1 - parser->token_length;
+    if (length > room) {
+        length = room;
+        parser->token_truncated = 1;
+    }
+    memcpy(parser->token + parser->token_length, data, length);
+    parser->token_length += length;
+}
+
+/**
+ * Append a code point as UTF-8
+ */
+static void token_append_code_point(weather_parser_t *parser, uint32_t code_point) {
+    char utf8[4];
+    size_t length;
+    
+    if (code_point < 0x80) {
+        utf8[0] = (char)code_point;
+        length = 1;
+    } else if (code_point < 0x800) {
+        utf8[0] = (char)(0xC0 | (code_point >> 6));
+        utf8[1] = (char)(0x80 | (code_point & 0x3F));
+        length = 2;
+    } else if (code_point < 0x10000) {
+        utf8[0] = (char)(0xE0 | (code_point >> 12));
+        utf8[1] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        utf8[2] = (char)(0x80 | (code_point & 0x3F));
+        length = 3;
+    } else {
+        utf8[0] = (char)(0xF0 | (code_point >> 18));
+        utf8[1] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+        utf8[2] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+        utf8[3] = (char)(0x80 | (code_point & 0x3F));
+        length = 4;
+    }
+    token_append(parser, utf8, length);
+}
+
+static void end_string(weather_parser_t *parser) {
+    if (parser->string_is_key) {
+        const parser_frame_t *top = &parser->stack[parser->depth - 1];
+        parser->pending = NULL;
+        if (top->kind != KIND_SKIP && !parser->token_truncated) {
+            parser->pending = field_lookup(top->kind, parser->key_hash, parser->token, parser->token_length);
+        }
+        parser->state = STATE_COLON;
+        return;
+    }
+    
+    if (parser->pending && parser->pending->type == FIELD_STRING) {
+        // Truncate like strncpy into the fixed-size field
+        size_t length = parser->token_length;
+        if (length > (size_t)parser->pending->size - 1) {
+            length = parser->pending->size - 1;
+        }
+        char *dest = (char *)parser->stack[parser->depth - 1].target + parser->pending->offset;
+        memcpy(dest, parser->token, length);
+        dest[length] = '\0';
+    }
+    value_end(parser);
+}
+
+static int is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static int end_number(weather_parser_t *parser) {
+    parser->token[parser->token_length] = '\0';
+    
+    char *end;
+    double number = strtod(parser->token, &end);
+    if (end == parser->token || *end != '\0') {
+        return -1;
+    }
+    
+    const field_spec_t *field = parser->pending;
+    if (field && parser->depth > 0) {
+        char *dest = (char *)parser->stack[parser->depth - 1].target + field->offset;
+        if (field->type == FIELD_DOUBLE) {
+            *(double *)dest = number;
+        } else if (field->type == FIELD_INT) {
+            // Saturate like cJSON's valueint
+            *(int *)dest = number >= INT_MAX ? INT_MAX : number <= (double)INT_MIN ? INT_MIN : (int)number;
+        } else if (field->type == FIELD_LONG) {
+            *(long *)dest = (long)number;
+        }
+    }
+    
+    value_end(parser);
+    return 0;
+}
+
+static int is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * Characters that matter outside strings in a kept section
+ */
+static int raw_special(char c) {
+    return c == '"' || c == '{' || c == '}' || c == '[' || c == ']';
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Start a value in STATE_VALUE or STATE_VALUE_OR_END
+ */
+static int begin_value(weather_parser_t *parser, char c) {
+    switch (c) {
+        case '{':
+            return begin_object(parser);
+        case '[':
+            return begin_array(parser);
+        case '"':
+            begin_string(parser, 0);
+            return 0;
+        case 't':
+            parser->literal = "true";
+            break;
+        case 'f':
+            parser->literal = "false";
+            break;
+        case 'n':
+            parser->literal = "null";
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9')) {
+                parser->token[0] = c;
+                parser->token_length = 1;
+                parser->state = STATE_NUMBER;
+                return 0;
+            }
+            return -1;
+    }
+    
+    parser->literal_position = 1;
+    parser->state = STATE_LITERAL;
+    return 0;
+}
+
+int weather_parser_feed(weather_parser_t *parser, const char *data, size_t length) {
+    if (!parser || parser->state == STATE_ERROR) {
+        return -1;
+    }
+    
+    const char *p = data;
+    const char *end = data + length;
+    const char *capture_from = parser->capture_depth ? data : NULL; // Kept bytes start here
+    
+    while (p < end) {
+        char c = *p;
+        
+        switch (parser->state) {
+            case STATE_STRING: {
+                if (parser->high_surrogate && c != '\\') {
+                    return parser_fail(parser);
+                }
+                // Copy the run up to the next quote or escape in one step
+                const char *run = p;
+                while (p < end && *p != '"' && *p != '\\') {
+                    p++;
+                }
+                token_append(parser, run, (size_t)(p - run));
+                if (p == end) {
+                    continue;
+                }
+                if (*p == '"') {
+                    end_string(parser);
+                } else {
+                    parser->state = STATE_ESCAPE;
+                }
+                break;
+            }
+            
+            case STATE_ESCAPE: {
+                char unescaped;
+                if (parser->high_surrogate && c != 'u') {
+                    return parser_fail(parser);
+                }
+                switch (c) {
+                    case '"': unescaped = '"'; break;
+                    case '\\': unescaped = '\\'; break;
+                    case '/': unescaped = '/'; break;
+                    case 'b': unescaped = '\b'; break;
+                    case 'f': unescaped = '\f'; break;
+                    case 'n': unescaped = '\n'; break;
+                    case 'r': unescaped = '\r'; break;
+                    case 't': unescaped = '\t'; break;
+                    case 'u':
+                        parser->unicode = 0;
+                        parser->unicode_digits = 0;
+                        parser->state = STATE_UNICODE;
+                        break;
+                    default:
+                        return parser_fail(parser);
+                }
+                if (c != 'u') {
+                    token_append(parser, &unescaped, 1);
+                    parser->state = STATE_STRING;
+                }
+                break;
+            }
+            
+            case STATE_UNICODE: {
+                int digit = hex_value(c);
+                if (digit < 0) {
+                    return parser_fail(parser);
+                }
+                parser->unicode = (parser->unicode << 4) | (uint32_t)digit;
+                if (++parser->unicode_digits < 4) {
+                    break;
+                }
+                
+                uint32_t code = parser->unicode;
+                if (parser->high_surrogate) {
+                    if (code < 0xDC00 || code > 0xDFFF) {
+                        return parser_fail(parser);
+                    }
+                    code = 0x10000 + ((parser->high_surrogate - 0xD800) << 10) + (code - 0xDC00);
+                    parser->high_surrogate = 0;
+                    token_append_code_point(parser, code);
+                } else if (code >= 0xD800 && code <= 0xDBFF) {
+                    parser->high_surrogate = code;
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return parser_fail(parser);
+                } else {
+                    token_append_code_point(parser, code);
+                }
+                parser->state = STATE_STRING;
+                break;
+            }
+            
+            case STATE_NUMBER:
+                if (is_number_char(c)) {
+                    if (parser->token_length < PARSER_NUMBER_SIZE - 1) {
+                        parser->token[parser->token_length++] = c;
+                    }
+                    break;
+                }
+                // The terminating character belongs to the next token
+                if (end_number(parser) != 0) {
+                    return parser_fail(parser);
+                }
+                continue;
+            
+            case STATE_RAW:
+                // Find the section's closing bracket; section_parse() checks the rest
+                while (p < end) {
+                    if (parser->raw_in_string) {
+                        if (parser->raw_escape) {
+                            parser->raw_escape = 0;
+                            p++;
+                        }
+                        while (p < end && *p != '"' && *p != '\\') {
+                            p++;
+                        }
+                        if (p == end) {
+                            break;
+                        }
+                        parser->raw_escape = *p == '\\';
+                        parser->raw_in_string = *p != '"';
+                        p++;
+                        continue;
+                    }
+                
+                    while (p < end && !raw_special(*p)) {
+                        p++;
+                    }
+                    if (p == end) {
+                        break;
+                    }
+                    c = *p;
+                    if (c == '"') {
+                        parser->raw_in_string = 1;
+                    } else if (c == '{' || c == '[') {
+                        parser->raw_depth++;
+                    } else if (parser->raw_depth == 0) {
+                        break;
+                    } else {
+                        parser->raw_depth--;
+                    }
+                    p++;
+                }
+                if (p == end) {
+                    continue;
+                }
+                if (end_container(parser, c == ']', &capture_from, p) != 0) {
+                    return parser_fail(parser);
+                }
+                break;
+            
+            case STATE_LITERAL:
+                if (c != parser->literal[parser->literal_position]) {
+                    return parser_fail(parser);
+                }
+                if (parser->literal[++parser->literal_position] == '\0') {
+                    value_end(parser);
+                }
+                break;
+            
+            case STATE_VALUE:
+            case STATE_VALUE_OR_END:
+                if (is_whitespace(c)) {
+                    break;
+                }
+                if (c == ']' && parser->state == STATE_VALUE_OR_END) {
+                    if (end_container(parser, 1, &capture_from, p) != 0) {
+                        return parser_fail(parser);
+                    }
+                    break;
+                }
+                if (begin_value(parser, c) != 0) {
+                    return parser_fail(parser);
+                }
+                if (parser->capture_depth && !capture_from) {
+                    capture_from = p;
+                }
+                break;
+            
+            case STATE_KEY_OR_END:
+            case STATE_KEY:
+                if (is_whitespace(c)) {
+                    break;
+                }
+                if (c == '"') {
+                    begin_string(parser, 1);
+                    break;
+                }
+                if (c == '}' && parser->state == STATE_KEY_OR_END && end_container(parser, 0, &capture_from, p) == 0) {
+                    break;
+                }
+                return parser_fail(parser);
+            
+            case STATE_COLON:
+                if (is_whitespace(c)) {
+                    break;
+                }
+                if (c != ':') {
+                    return parser_fail(parser);
+                }
+                parser->state = STATE_VALUE;
+                break;
+            
+            case STATE_NEXT:
+                if (is_whitespace(c)) {
+                    break;
+                }
+                if (c == ',') {
+                    parser->state = parser->stack[parser->depth - 1].is_array ? STATE_VALUE : STATE_KEY;
+                    break;
+                }
+                if ((c == '}' || c == ']') && end_container(parser, c == ']', &capture_from, p) == 0) {
+                    break;
+                }
+                return parser_fail(parser);
+            
+            case STATE_DONE:
+                // Trailing bytes after the document are ignored, as cJSON_Parse does
+                return 0;
+            
+            case STATE_ERROR:
+                return -1;
+        }
+        
+        p++;
+    }
+    
+    // The section continues in the next chunk
+    if (capture_from && lazy_append(parser->lazy, capture_from, (size_t)(end - capture_from)) != 0) {
+        fprintf(stderr, "Failed to allocate memory for forecast data\n");
+        return parser_fail(parser);
+    }
+    
+    return 0;
+}
+
+int weather_parser_finish(weather_parser_t *parser) {
+    if (!parser) {
+        return -1;
+    }
+    
+    // A bare top-level number has no terminator
+    if (parser->state == STATE_NUMBER && parser->depth == 0 && end_number(parser) != 0) {
+        parser->state = STATE_ERROR;
+    }
+    
+    if (parser->state != STATE_DONE) {
+        return -1;
+    }
+    
+    // Move the days and their hours out of the parser into one arena of the right size
+    forecast_response_t *forecast = &parser->result->forecast;
+    if (forecast->forecast == parser->days && forecast->forecast_days > 0) {
+        int days = forecast->forecast_days;
+        weather_arena_t *arena = weather_arena_create(WEATHER_ARENA_SIZE(days * sizeof(forecast_daily_t)) +
+                                                      WEATHER_ARENA_SIZE(days * sizeof(weather_hours_t)));
+        forecast_daily_t *daily = weather_arena_alloc(arena, days * sizeof(forecast_daily_t));
+        weather_hours_t *hours = weather_arena_alloc(arena, days * sizeof(weather_hours_t));
+        if (!daily || !hours) {
+            weather_arena_free(arena);
+            return -1;
+        }
+        memcpy(daily, parser->days, days * sizeof(forecast_daily_t));
+        memcpy(hours, parser->hours, days * sizeof(weather_hours_t));
+        forecast->forecast = daily;
+        parser->result->hours = hours;
+    }
+    
+    // Hand the kept sections to the result, trimmed to size
+    weather_lazy_t *lazy = parser->lazy;
+    if (lazy) {
+        char *raw = realloc(lazy->raw, lazy->raw_length);
+        if (raw) {
+            lazy->raw = raw;
+            lazy->raw_capacity = lazy->raw_length;
+        }
+        
+        parser->result->lazy = lazy;
+        parser->lazy = NULL;
+    }
+    
+    return 0;
+}
+
+/**
+ * Parse a kept section into a forecast (the result's own, or a copy)
+ * The bytes are fed to a parser positioned just after the section's key,
+ * as if the section still sat in its enclosing object. Hour sections are
+ * packed into hours, the compact hours of their day.
+ */
+static int section_parse(const weather_lazy_t *lazy, int section, forecast_response_t *forecast,
+                         weather_hours_t *hours) {
+    weather_parser_t parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.state = STATE_VALUE;
+    parser.depth = 1;
+    
+    parser_frame_t *owner = &parser.stack[0];
+    forecast_daily_t *daily = NULL;
+    if (section == LAZY_CURRENT) {
+        owner->kind = KIND_FORECAST_ROOT;
+        owner->target = forecast;
+        parser.pending = field_named(KIND_FORECAST_ROOT, "current");
+    } else {
+        daily = &forecast->forecast[section % PARSER_MAX_DAYS];
+        owner->kind = KIND_FORECASTDAY;
+        owner->target = daily;
+        parser.days = daily;
+        parser.hours = hours;
+        parser.pending = field_named(KIND_FORECASTDAY, section < PARSER_MAX_DAYS ? "hour" : "astro");
+    }
+    
+    const lazy_span_t *span = &lazy->spans[section];
+    if (weather_parser_feed(&parser, lazy->raw + span->offset, span->length) != 0 ||
+        parser.state != STATE_NEXT || parser.depth != 1) {
+        if (section < PARSER_MAX_DAYS) {
+            hours->count = 0;
+        }
+        fprintf(stderr, "Failed to parse retained forecast section\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Bits of the sections needed for a number of days
+ */
+static uint32_t section_mask(unsigned int sections, int days) {
+    uint32_t days_mask = (1u << days) - 1;
+    uint32_t mask = 0;
+    
+    if (sections & WEATHER_SECTION_HOURS) {
+        mask |= days_mask << LAZY_HOURS(0);
+    }
+    if (sections & WEATHER_SECTION_ASTRO) {
+        mask |= days_mask << LAZY_ASTRO(0);
+    }
+    if (sections & WEATHER_SECTION_CURRENT) {
+        mask |= 1u << LAZY_CURRENT;
+    }
+    return mask;
+}
+
+int weather_result_load(weather_result_t *result, unsigned int sections) {
+    if (!result || !result->is_forecast) {
+        return 0;
+    }
+    
+    weather_result_t *owner = result->source ? result->source : result;
+    weather_lazy_t *lazy = owner->lazy;
+    if (!lazy) {
+        return 0;
+    }
+    
+    int status = 0;
+    uint32_t wanted = section_mask(sections, result->forecast.forecast_days);
+    
+    if (__atomic_load_n(&lazy->pending, __ATOMIC_ACQUIRE) & wanted) {
+        pthread_mutex_lock(&lazy->lock);
+        uint32_t pending = lazy->pending & wanted;
+        for (int section = 0; section < LAZY_SECTIONS; section++) {
+            if (!(pending & (1u << section))) {
+                continue;
+            }
+            weather_hours_t *hours = section < PARSER_MAX_DAYS ? &owner->hours[section] : NULL;
+            if (section_parse(lazy, section, &owner->forecast, hours) != 0) {
+                status = -1;
+                continue;
+            }
+            __atomic_and_fetch(&lazy->pending, ~(1u << section), __ATOMIC_RELEASE);
+        }
+        
+        // Everything parsed: the raw bytes are no longer needed
+        if (lazy->pending == 0) {
+            free(lazy->raw);
+            lazy->raw = NULL;
+            lazy->raw_length = 0;
+            __atomic_store_n(&lazy->raw_capacity, 0, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&lazy->lock);
+    }
+    
+    // A view took its copy of the current block when it was made
+    if (result != owner && (sections & WEATHER_SECTION_CURRENT) && status == 0) {
+        result->forecast.current = owner->forecast.current;
+    }
+    
+    return status;
+}
+
+/**
+ * Bytes a copy of the first days of a forecast needs in its arena
+ * A retained hour array is counted as a full day of hours.
+ */
+static size_t copy_size(const weather_result_t *owner, uint32_t pending, int days) {
+    size_t size = WEATHER_ARENA_SIZE(days * sizeof(forecast_daily_t));
+    for (int i = 0; i < days; i++) {
+        int hours = (pending & (1u << LAZY_HOURS(i))) ? PARSER_MAX_HOURS : owner->hours ? owner->hours[i].count : 0;
+        size += WEATHER_ARENA_SIZE(hours * sizeof(forecast_hour_t));
+    }
+    return size;
+}
+
+int weather_result_copy_forecast(weather_result_t *result, forecast_response_t *copy) {
+    if (!result || !copy) {
+        return -1;
+    }
+    
+    weather_result_t *owner = result->source ? result->source : result;
+    const forecast_response_t *source = &owner->forecast;
+    weather_lazy_t *lazy = owner->lazy;
+    int days = result->forecast.forecast_days;
+    int status = 0;
+    weather_hours_t scratch;
+    
+    memset(copy, 0, sizeof(forecast_response_t));
+    
+    // Loaded sections must not change underneath the copy
+    if (lazy) {
+        pthread_mutex_lock(&lazy->lock);
+    }
+    uint32_t pending = lazy ? lazy->pending : 0;
+    
+    copy->location = source->location;
+    copy->current = source->current;
+    if ((pending & (1u << LAZY_CURRENT)) && section_parse(lazy, LAZY_CURRENT, copy, NULL) != 0) {
+        status = -1;
+    }
+    
+    // Days and hours share one arena, freed with the days array
+    weather_arena_t *arena = NULL;
+    if (status == 0 && days > 0 && source->forecast) {
+        arena = weather_arena_create(copy_size(owner, pending, days));
+        copy->forecast = weather_arena_alloc(arena, days * sizeof(forecast_daily_t));
+        if (!copy->forecast) {
+            status = -1;
+        }
+    }
+    
+    for (int i = 0; status == 0 && copy->forecast && i < days; i++) {
+        const forecast_daily_t *daily = &source->forecast[i];
+        forecast_daily_t *dst = &copy->forecast[i];
+        *dst = *daily;
+        dst->hour = NULL;
+        dst->hour_count = 0;
+        copy->forecast_days = i + 1;
+        
+        // Unpack the hours, parsing a retained hour array into scratch space first
+        const weather_hours_t *hours = owner->hours ? &owner->hours[i] : NULL;
+        if (pending & (1u << LAZY_HOURS(i))) {
+            memset(&scratch, 0, sizeof(scratch));
+            hours = &scratch;
+            if (section_parse(lazy, LAZY_HOURS(i), copy, &scratch) != 0) {
+                status = -1;
+            }
+        }
+        if (status == 0 && hours && hours->count > 0) {
+            dst->hour = weather_arena_alloc(arena, hours->count * sizeof(forecast_hour_t));
+            if (!dst->hour) {
+                status = -1;
+                break;
+            }
+            for (int h = 0; h < hours->count; h++) {
+                weather_hours_get(hours, h, &dst->hour[h]);
+            }
+            dst->hour_count = hours->count;
+        }
+        if ((pending & (1u << LAZY_ASTRO(i))) && section_parse(lazy, LAZY_ASTRO(i), copy, NULL) != 0) {
+            status = -1;
+        }
+    }
+    
+    if (lazy) {
+        pthread_mutex_unlock(&lazy->lock);
+    }
+    
+    if (status != 0) {
+        weather_arena_free(arena);
+        copy->forecast = NULL;
+        copy->forecast_days = 0;
+    }
+    return status;
+}
+
+size_t weather_lazy_bytes(const weather_lazy_t *lazy) {
+    if (!lazy) {
+        return 0;
+    }
+    return sizeof(weather_lazy_t) + __atomic_load_n(&lazy->raw_capacity, __ATOMIC_RELAXED);
+}
+
+void weather_lazy_free(weather_lazy_t *lazy) {
+    if (lazy) {
+        pthread_mutex_destroy(&lazy->lock);
+        free(lazy->raw);
+        free(lazy);
+    }
+}
+
+/**
+ * Skip whitespace in a complete body
+ */
+static const char *bulk_skip_space(const char *p, const char *end) {
+    while (p < end && is_whitespace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Skip one complete value: a string, a scalar, or a container with everything in it
+ * @return Position after the value, or NULL if the body ends inside it
+ */
+static const char *bulk_skip_value(const char *p, const char *end) {
+    int depth = 0;
+    int in_string = 0;
+    
+    if (p < end && *p != '"' && *p != '{' && *p != '[') {
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && !is_whitespace(*p)) {
+            p++;
+        }
+        return p;
+    }
+    
+    for (; p < end; p++) {
+        if (in_string) {
+            if (*p == '\\') {
+                p++;
+            } else if (*p == '"') {
+                in_string = 0;
+                if (depth == 0) {
+                    return p + 1;
+                }
+            }
+        } else if (*p == '"') {
+            in_string = 1;
+        } else if (*p == '{' || *p == '[') {
+            depth++;
+        } else if ((*p == '}' || *p == ']') && --depth == 0) {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Read the next member of an object
+ * @param cursor Just after the '{' or the previous member; advanced past this one
+ * @param key Set to the key's bytes (without quotes or unescaping)
+ * @param value Set to the start of the value, which ends at *cursor
+ * @return 1 for a member, 0 at the end of the object, -1 on a syntax error
+ */
+static int bulk_next_member(const char **cursor, const char *end, const char **key, size_t *key_length,
+                            const char **value) {
+    const char *p = bulk_skip_space(*cursor, end);
+    if (p < end && *p == ',') {
+        p = bulk_skip_space(p + 1, end);
+    }
+    if (p < end && *p == '}') {
+        *cursor = p + 1;
+        return 0;
+    }
+    if (p >= end || *p != '"') {
+        return -1;
+    }
+    
+    const char *key_end = bulk_skip_value(p, end);
+    if (!key_end) {
+        return -1;
+    }
+    *key = p + 1;
+    *key_length = (size_t)(key_end - p - 2);
+    
+    p = bulk_skip_space(key_end, end);
+    if (p >= end || *p != ':') {
+        return -1;
+    }
+    p = bulk_skip_space(p + 1, end);
+    *value = p;
+    *cursor = bulk_skip_value(p, end);
+    return *cursor && *cursor > p ? 1 : -1;
+}
+
+static int bulk_key_is(const char *key, size_t key_length, const char *name) {
+    return key_length == strlen(name) && memcmp(key, name, key_length) == 0;
+}
+
+/**
+ * Hand one {"query": {...}} element of the bulk array to the callback
+ */
+static int bulk_item(const char *p, const char *end, weather_bulk_callback_t callback, void *user_data) {
+    const char *key;
+    size_t key_length;
+    const char *value;
+    int status;
+    
+    if (*p != '{') {
+        return -1;
+    }
+    p++;
+    while ((status = bulk_next_member(&p, end, &key, &key_length, &value)) == 1) {
+        if (!bulk_key_is(key, key_length, "query") || *value != '{') {
+            continue;
+        }
+        
+        // Find the id and any error among the query's members
+        const char *query_end = p;
+        const char *q = value + 1;
+        const char *custom_id = NULL;
+        size_t id_length = 0;
+        int failed = 0;
+        const char *member;
+        while ((status = bulk_next_member(&q, query_end, &key, &key_length, &member)) == 1) {
+            if (bulk_key_is(key, key_length, "custom_id") && *member == '"') {
+                custom_id = member + 1;
+                id_length = (size_t)(q - member - 2);
+            } else if (bulk_key_is(key, key_length, "error")) {
+                failed = 1;
+            }
+        }
+        if (status != 0) {
+            return -1;
+        }
+        if (custom_id) {
+            callback(custom_id, id_length, value, (size_t)(query_end - value), failed, user_data);
+        }
+    }
+    return status;
+}
+
+int weather_parser_error_code(const char *data, size_t length) {
+    const char *end = data ? data + length : NULL;
+    const char *p = data ? bulk_skip_space(data, end) : NULL;
+    const char *key;
+    size_t key_length;
+    const char *value;
+    
+    if (!p || p >= end || *p != '{') {
+        return 0;
+    }
+    p++;
+    while (bulk_next_member(&p, end, &key, &key_length, &value) == 1) {
+        if (!bulk_key_is(key, key_length, "error") || *value != '{') {
+            continue;
+        }
+        
+        const char *error_end = p;
+        const char *q = value + 1;
+        while (bulk_next_member(&q, error_end, &key, &key_length, &value) == 1) {
+            if (bulk_key_is(key, key_length, "code")) {
+                // The value is delimited, so strtol stops inside the body
+                return (int)strtol(value, NULL, 10);
+            }
+        }
+        return 0;
+    }
+    return 0;
+}
+
+int weather_parser_split_bulk(const char *data, size_t length, weather_bulk_callback_t callback, void *user_data) {
+    const char *end = data + length;
+    const char *p = bulk_skip_space(data, end);
+    const char *key;
+    size_t key_length;
+    const char *value;
+    int status;
+    
+    if (!callback || p >= end || *p != '{') {
+        return -1;
+    }
+    p++;
+    while ((status = bulk_next_member(&p, end, &key, &key_length, &value)) == 1) {
+        if (!bulk_key_is(key, key_length, "bulk") || *value != '[') {
+            continue;
+        }
+        
+        const char *items_end = p - 1;
+        const char *item = bulk_skip_space(value + 1, items_end);
+        while (item < items_end) {
+            const char *item_end = bulk_skip_value(item, items_end);
+            if (!item_end || bulk_item(item, item_end, callback, user_data) != 0) {
+                return -1;
+            }
+            item = bulk_skip_space(item_end, items_end);
+            if (item < items_end && *item == ',') {
+                item = bulk_skip_space(item + 1, items_end);
+            }
+        }
+        return 0;
+    }
+    return -1;
+}
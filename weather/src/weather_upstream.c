@@ -0,0 +1,220 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include "weather_upstream.h"
+
+#define LATENCY_BUCKETS 64              // Bucket i holds latencies up to LATENCY_GROWTH^i ms (~98 s)
+#define LATENCY_GROWTH 1.2
+#define LATENCY_WINDOW 1000             // Halve the histogram after this many samples
+#define RTT_SHORT_WEIGHT 0.1            // Weight of a sample in the recent latency average
+#define RTT_LONG_WEIGHT 0.01            // Weight of a sample in the long-term latency average
+#define LATENCY_TOLERANCE 2.0           // Recent latency this far above long-term shrinks the limit
+#define LIMIT_SMOOTHING 0.2             // Share of each new limit estimate taken
+#define LIMIT_BACKOFF 0.75              // Limit kept after a failure
+
+static pthread_mutex_t upstream_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Circuit breaker
+static int breaker_threshold = 0;
+static weather_breaker_state_t breaker = WEATHER_BREAKER_CLOSED;
+static int consecutive_failures = 0;
+static struct timespec breaker_opened;
+static int probe_in_flight = 0;
+
+// Adaptive concurrency limit
+static int max_limit = 0;               // 0 = unlimited
+static double limit = 0;
+static int in_flight = 0;
+static double rtt_short = 0;            // Seconds
+static double rtt_long = 0;
+
+// Time to first byte histogram (decayed), for the hedge delay
+static double latency_counts[LATENCY_BUCKETS];
+static double latency_total = 0;
+static unsigned long latency_samples = 0;
+static long p95_ms = 0;
+
+static weather_upstream_stats_t counters;
+
+void weather_upstream_init(const weather_config_t *config) {
+    pthread_mutex_lock(&upstream_lock);
+    breaker_threshold = config && config->breaker_threshold > 0 ? config->breaker_threshold : 0;
+    max_limit = config && config->max_upstream > 0 ? config->max_upstream : 0;
+    limit = max_limit > WEATHER_UPSTREAM_MIN_LIMIT ? max_limit : WEATHER_UPSTREAM_MIN_LIMIT;
+    breaker = WEATHER_BREAKER_CLOSED;
+    consecutive_failures = 0;
+    probe_in_flight = 0;
+    in_flight = 0;
+    rtt_short = rtt_long = 0;
+    memset(latency_counts, 0, sizeof(latency_counts));
+    latency_total = 0;
+    latency_samples = 0;
+    p95_ms = 0;
+    memset(&counters, 0, sizeof(counters));
+    pthread_mutex_unlock(&upstream_lock);
+}
+
+/**
+ * Open the breaker (caller holds upstream_lock)
+ */
+static void breaker_open(void) {
+    breaker = WEATHER_BREAKER_OPEN;
+    probe_in_flight = 0;
+    clock_gettime(CLOCK_MONOTONIC, &breaker_opened);
+    counters.breaker_trips++;
+    fprintf(stderr, "Upstream circuit breaker open after %d consecutive failures\n", consecutive_failures);
+}
+
+int weather_upstream_acquire(void) {
+    int admitted = 1;
+    
+    pthread_mutex_lock(&upstream_lock);
+    if (breaker == WEATHER_BREAKER_OPEN) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec - breaker_opened.tv_sec >= WEATHER_UPSTREAM_BREAKER_SECONDS) {
+            breaker = WEATHER_BREAKER_HALF_OPEN;
+        }
+    }
+    
+    if (breaker == WEATHER_BREAKER_OPEN || (breaker == WEATHER_BREAKER_HALF_OPEN && probe_in_flight)) {
+        admitted = 0;
+    } else if (max_limit > 0 && in_flight >= (int)limit) {
+        admitted = 0;
+    } else {
+        if (breaker == WEATHER_BREAKER_HALF_OPEN) {
+            probe_in_flight = 1;
+        }
+        in_flight++;
+    }
+    
+    if (!admitted) {
+        counters.shed++;
+    }
+    pthread_mutex_unlock(&upstream_lock);
+    
+    return admitted ? 0 : -1;
+}
+
+/**
+ * Add a time to first byte to the histogram and update the p95 (caller holds upstream_lock)
+ */
+static void latency_record(double seconds) {
+    double ms = seconds * 1000.0;
+    int bucket = ms > 1.0 ? (int)ceil(log(ms) / log(LATENCY_GROWTH)) : 0;
+    if (bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS - 1;
+    }
+    
+    // Halving the counts now and then lets the p95 follow upstream as it changes
+    if (++latency_samples % LATENCY_WINDOW == 0) {
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            latency_counts[i] /= 2;
+        }
+        latency_total /= 2;
+    }
+    latency_counts[bucket]++;
+    latency_total++;
+    
+    double target = latency_total * 0.95;
+    double seen = 0;
+    int i = 0;
+    while (i < LATENCY_BUCKETS - 1 && seen + latency_counts[i] < target) {
+        seen += latency_counts[i];
+        i++;
+    }
+    p95_ms = (long)ceil(pow(LATENCY_GROWTH, i));
+}
+
+/**
+ * Move the concurrency limit toward what upstream sustains (caller holds upstream_lock)
+ * Healthy latency with the limit in use adds about its square root; recent
+ * latency above LATENCY_TOLERANCE times the long-term average scales it down
+ * by the ratio, to half at most.
+ */
+static void limit_update(double seconds) {
+    if (rtt_long == 0) {
+        rtt_short = rtt_long = seconds;
+    }
+    rtt_short += (seconds - rtt_short) * RTT_SHORT_WEIGHT;
+    rtt_long += (seconds - rtt_long) * RTT_LONG_WEIGHT;
+    
+    double gradient = rtt_short > 0 ? LATENCY_TOLERANCE * rtt_long / rtt_short : 1.0;
+    if (gradient > 1.0) {
+        gradient = 1.0;
+    } else if (gradient < 0.5) {
+        gradient = 0.5;
+    }
+    
+    // Only a limit that is being used has shown it can grow
+    double headroom = in_flight * 2 >= limit ? sqrt(limit) : 0;
+    double estimate = limit * gradient + headroom;
+    limit += (estimate - limit) * LIMIT_SMOOTHING;
+}
+
+void weather_upstream_release(weather_upstream_outcome_t outcome, double latency_seconds) {
+    pthread_mutex_lock(&upstream_lock);
+    if (in_flight > 0) {
+        in_flight--;
+    }
+    
+    if (outcome == WEATHER_UPSTREAM_SUCCESS) {
+        consecutive_failures = 0;
+        if (breaker == WEATHER_BREAKER_HALF_OPEN) {
+            breaker = WEATHER_BREAKER_CLOSED;
+            probe_in_flight = 0;
+            fprintf(stderr, "Upstream circuit breaker closed\n");
+        }
+        if (latency_seconds > 0) {
+            latency_record(latency_seconds);
+            limit_update(latency_seconds);
+        }
+    } else if (outcome == WEATHER_UPSTREAM_FAILURE) {
+        counters.failures++;
+        consecutive_failures++;
+        limit *= LIMIT_BACKOFF;
+        if (breaker == WEATHER_BREAKER_HALF_OPEN ||
+            (breaker == WEATHER_BREAKER_CLOSED && breaker_threshold > 0 && consecutive_failures >= breaker_threshold)) {
+            breaker_open();
+        }
+    } else if (breaker == WEATHER_BREAKER_HALF_OPEN) {
+        // The probe was never sent; let the next request probe instead
+        probe_in_flight = 0;
+    }
+    
+    if (limit < WEATHER_UPSTREAM_MIN_LIMIT) {
+        limit = WEATHER_UPSTREAM_MIN_LIMIT;
+    } else if (max_limit > 0 && limit > max_limit) {
+        limit = max_limit;
+    }
+    pthread_mutex_unlock(&upstream_lock);
+}
+
+long weather_upstream_hedge_delay_ms(void) {
+    long delay = 0;
+    
+    pthread_mutex_lock(&upstream_lock);
+    if (latency_samples >= WEATHER_UPSTREAM_HEDGE_SAMPLES) {
+        delay = p95_ms > WEATHER_UPSTREAM_HEDGE_MIN_MS ? p95_ms : WEATHER_UPSTREAM_HEDGE_MIN_MS;
+    }
+    pthread_mutex_unlock(&upstream_lock);
+    
+    return delay;
+}
+
+void weather_upstream_get_stats(weather_upstream_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&upstream_lock);
+    *stats = counters;
+    stats->breaker = breaker;
+    stats->in_flight = in_flight;
+    stats->limit = max_limit > 0 ? (int)limit : 0;
+    stats->p95_ms = latency_samples >= WEATHER_UPSTREAM_HEDGE_SAMPLES ? p95_ms : 0;
+    pthread_mutex_unlock(&upstream_lock);
+}
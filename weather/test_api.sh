@@ -106,6 +106,46 @@ run_test "Forecast (with all options)" \
     "curl -s '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS&include_aqi=true&include_alerts=true&include_hourly=true'" \
     200
 
+echo -e "${BLUE}=== Testing Projection and Layout ===${NC}"
+
+run_test "Current Weather (fields projection)" \
+    "curl -s '$BASE_URL/current?location=$TEST_LOCATION&fields=location.name,current.temp_c'" \
+    200
+
+run_test "Forecast (hourly series projection)" \
+    "curl -s '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS&include_hourly=true&fields=forecast.hour.time,forecast.hour.temp_c'" \
+    200
+
+run_test "Forecast (columnar hourly layout)" \
+    "curl -s '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS&include_hourly=true&layout=columnar'" \
+    200
+
+echo -e "${BLUE}=== Testing Content Negotiation ===${NC}"
+
+run_test "Forecast (CBOR)" \
+    "curl -s -o /dev/null -w '%{http_code} %{content_type} %{size_download} bytes\\n' -H 'Accept: application/cbor' '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS'" \
+    200
+
+run_test "Forecast (MessagePack)" \
+    "curl -s -o /dev/null -w '%{http_code} %{content_type} %{size_download} bytes\\n' -H 'Accept: application/msgpack' '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS'" \
+    200
+
+echo -e "${BLUE}=== Testing Cache Headers ===${NC}"
+
+run_test "Current Weather from cache (Age, and Warning when stale)" \
+    "curl -s -D - -o /dev/null '$BASE_URL/current?location=$TEST_LOCATION' | grep -i -E '^(Age|Warning):'" \
+    200
+
+echo -e "${BLUE}=== Testing Batch Endpoints ===${NC}"
+
+run_test "Batch current weather (NDJSON)" \
+    "curl -s -X POST '$BASE_URL/batch/current' -H 'Content-Type: application/json' -d '{\"locations\": [\"$TEST_LOCATION\", \"Paris\", \"Tokyo\"]}'" \
+    200
+
+run_test "Batch forecast (NDJSON)" \
+    "curl -s -X POST '$BASE_URL/batch/forecast' -H 'Content-Type: application/json' -d '{\"locations\": [\"$TEST_LOCATION\", \"Paris\"], \"days\": $FORECAST_DAYS}'" \
+    200
+
 echo -e "${BLUE}=== Testing Error Conditions ===${NC}"
 
 run_test "Current Weather (missing location)" \
@@ -128,6 +168,22 @@ run_test "Forecast (invalid days - too high)" \
     "curl -s '$BASE_URL/forecast?location=$TEST_LOCATION&days=20'" \
     400
 
+run_test "Current Weather (unknown field in projection)" \
+    "curl -s '$BASE_URL/current?location=$TEST_LOCATION&fields=location.name,current.nosuchfield'" \
+    400
+
+run_test "Forecast (invalid layout)" \
+    "curl -s '$BASE_URL/forecast?location=$TEST_LOCATION&days=$FORECAST_DAYS&include_hourly=true&layout=diagonal'" \
+    400
+
+run_test "Batch forecast (missing days)" \
+    "curl -s -X POST '$BASE_URL/batch/forecast' -H 'Content-Type: application/json' -d '{\"locations\": [\"$TEST_LOCATION\"]}'" \
+    400
+
+run_test "Current Weather (unknown location)" \
+    "curl -s '$BASE_URL/current?location=zzxqvnowhere'" \
+    400
+
 run_test "Non-existent endpoint" \
     "curl -s '$BASE_URL/nonexistent'" \
     404
@@ -148,7 +204,7 @@ echo -e "${BLUE}Available endpoints:${NC}"
 echo "  GET  /health"
 echo "  GET  /current?location=<location>&include_aqi=<true|false>"
 echo "  POST /current (JSON body: {\"location\": \"...\", \"include_aqi\": true})"
-echo "  GET  /forecast?location=<location>&days=<1-14>&include_aqi=<true|false>&include_alerts=<true|false>&include_hourly=<true|false>"
+echo "  GET  /forecast?location=<location>&days=<1-14>&include_aqi=<true|false>&include_alerts=<true|false>&include_hourly=<true|false>&layout=<rows|columnar>"
 echo
 echo -e "${BLUE}Example API calls:${NC}"
 echo "curl '$BASE_URL/health'"